@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <string_view>
+#include <nlohmann/json.hpp>
+#include "market_data_codec.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Build a book.* notification with the given number of levels per side
+std::string make_book_notification(int levels) {
+    std::string bids;
+    std::string asks;
+    for (int i = 0; i < levels; ++i) {
+        const char* action = i % 3 == 0 ? "new" : (i % 3 == 1 ? "change" : "delete");
+        bids += std::string(i ? "," : "") + "[\"" + action + "\"," + std::to_string(50000.0 - i * 0.5) + ",12.5]";
+        asks += std::string(i ? "," : "") + "[\"" + action + "\"," + std::to_string(50000.5 + i * 0.5) + ",3.25]";
+    }
+    
+    return "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"book.BTC-PERPETUAL.100ms\","
+           "\"data\":{\"type\":\"change\",\"timestamp\":1700000000123,\"prev_change_id\":10,"
+           "\"instrument_name\":\"BTC-PERPETUAL\",\"change_id\":11,"
+           "\"bids\":[" + bids + "],\"asks\":[" + asks + "]}}}";
+}
+
+} // namespace
+
+// Benchmark the generic path: parse into a json DOM, then decode the data
+static void BM_DecodeBookJson(benchmark::State& state) {
+    std::string payload = make_book_notification(static_cast<int>(state.range(0)));
+    deribit::BookUpdate update;
+    
+    if (!deribit::MarketDataDecoder::decode_book_json(json::parse(payload)["params"]["data"], update)) {
+        state.SkipWithError("Failed to decode book message");
+        return;
+    }
+    
+    for (auto _ : state) {
+        json message = json::parse(payload);
+        benchmark::DoNotOptimize(deribit::MarketDataDecoder::decode_book_json(message["params"]["data"], update));
+    }
+    
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+}
+BENCHMARK(BM_DecodeBookJson)->Arg(1)->Arg(10)->Arg(100);
+
+// Benchmark the direct path the message worker uses for book channels
+static void BM_DecodeBook(benchmark::State& state) {
+    std::string payload = make_book_notification(static_cast<int>(state.range(0)));
+    deribit::BookUpdate update;
+    deribit::MessageEnvelope envelope;
+    
+    if (!deribit::MarketDataDecoder::parse_envelope(payload, envelope) ||
+        !deribit::MarketDataDecoder::decode_book(std::string_view(payload).substr(envelope.data_offset), update)) {
+        state.SkipWithError("Failed to decode book message");
+        return;
+    }
+    
+    for (auto _ : state) {
+        std::string_view view(payload);
+        benchmark::DoNotOptimize(deribit::MarketDataDecoder::parse_envelope(view, envelope));
+        benchmark::DoNotOptimize(deribit::MarketDataDecoder::decode_book(view.substr(envelope.data_offset), update));
+    }
+    
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+}
+BENCHMARK(BM_DecodeBook)->Arg(1)->Arg(10)->Arg(100);
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include "deribit_api_client.h"
+#include "order_book_engine.h"
+
+namespace {
+
+const std::string INSTRUMENT = "BTC-PERPETUAL";
+
+// Build a snapshot with the given number of levels per side around 50000
+deribit::BookUpdate make_snapshot(int levels) {
+    deribit::BookUpdate snapshot;
+    snapshot.instrument_name = INSTRUMENT;
+    snapshot.snapshot = true;
+    snapshot.timestamp = 1700000000000;
+    snapshot.change_id = 1;
+    
+    for (int i = 0; i < levels; ++i) {
+        snapshot.bids.push_back({deribit::BookAction::NEW, 50000.0 - i * 0.5, 10.0});
+        snapshot.asks.push_back({deribit::BookAction::NEW, 50000.5 + i * 0.5, 10.0});
+    }
+    
+    return snapshot;
+}
+
+// Fill a delta touching the top of the book; even steps add a level, odd ones remove it again,
+// so the book keeps its size however many iterations run
+void make_delta(deribit::BookUpdate& delta, int64_t step, int levels) {
+    double offset = static_cast<double>(step % levels) * 0.5;
+    deribit::BookAction action = step % 2 == 0 ? deribit::BookAction::NEW : deribit::BookAction::DELETE;
+    
+    delta.clear();
+    delta.instrument_name = INSTRUMENT;
+    delta.timestamp = 1700000000000 + step;
+    delta.prev_change_id = step;
+    delta.change_id = step + 1;
+    delta.bids.push_back({deribit::BookAction::CHANGE, 50000.0 - offset, 5.0 + offset});
+    delta.asks.push_back({action, 50000.25 + (step / 2 % levels) * 0.5, 1.0});
+}
+
+} // namespace
+
+// Benchmark applying an in-sequence delta to a single book
+static void BM_L2BookApplyDelta(benchmark::State& state) {
+    int levels = static_cast<int>(state.range(0));
+    deribit::L2Book book(INSTRUMENT);
+    book.apply(make_snapshot(levels));
+    
+    deribit::BookUpdate delta;
+    int64_t step = 1;
+    
+    for (auto _ : state) {
+        make_delta(delta, step++, levels);
+        if (book.apply(delta) != deribit::BookUpdateResult::APPLIED) {
+            state.SkipWithError("Delta was not applied in sequence");
+            break;
+        }
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_L2BookApplyDelta)->Arg(10)->Arg(100)->Arg(1000);
+
+// Benchmark the engine path: book lookup, locking, delta and book callback
+static void BM_OrderBookEngineHandleUpdate(benchmark::State& state) {
+    int levels = static_cast<int>(state.range(0));
+    
+    // The API client is only used for resync snapshots, which in-sequence deltas never need
+    auto api_client = std::make_shared<deribit::ApiClient>("bench_api_key", "bench_api_secret", true);
+    auto engine = std::make_shared<deribit::OrderBookEngine>(api_client);
+    engine->set_book_callback([](const deribit::L2Book& book) {
+        benchmark::DoNotOptimize(book.best_bid());
+    });
+    engine->handle_update(make_snapshot(levels));
+    
+    deribit::BookUpdate delta;
+    int64_t step = 1;
+    
+    for (auto _ : state) {
+        make_delta(delta, step++, levels);
+        if (engine->handle_update(delta) != deribit::BookUpdateResult::APPLIED) {
+            state.SkipWithError("Delta was not applied in sequence");
+            break;
+        }
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OrderBookEngineHandleUpdate)->Arg(10)->Arg(100)->Arg(1000);
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "deribit_api_client.h"
+#include "order_manager.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+// Build a user.orders.* notification for one order
+json make_order_update(const std::string& order_id, const std::string& order_state, double price) {
+    return {
+        {"order_id", order_id},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"label", "bench"},
+        {"order_type", "limit"},
+        {"direction", "buy"},
+        {"price", price},
+        {"amount", 10.0},
+        {"filled_amount", 0.0},
+        {"average_price", 0.0},
+        {"time_in_force", "good_til_cancelled"},
+        {"order_state", order_state},
+        {"creation_timestamp", 1700000000000},
+        {"last_update_timestamp", 1700000000000}
+    };
+}
+
+// Order manager on a client that is never connected; order updates do not use it
+std::shared_ptr<deribit::OrderManager> make_order_manager() {
+    auto api_client = std::make_shared<deribit::ApiClient>("bench_api_key", "bench_api_secret", true);
+    return std::make_shared<deribit::OrderManager>(api_client);
+}
+
+} // namespace
+
+// Benchmark updating resting orders in place, e.g. price amendments of quotes
+static void BM_HandleOrderUpdateOpen(benchmark::State& state) {
+    auto order_manager = make_order_manager();
+    size_t order_count = static_cast<size_t>(state.range(0));
+    
+    std::vector<json> updates;
+    for (size_t i = 0; i < order_count; ++i) {
+        updates.push_back(make_order_update("ETH-" + std::to_string(i), "open", 100.0 + i));
+        order_manager->handle_order_update(updates.back());
+    }
+    
+    size_t next = 0;
+    for (auto _ : state) {
+        order_manager->handle_order_update(updates[next]);
+        next = next + 1 == order_count ? 0 : next + 1;
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HandleOrderUpdateOpen)->Arg(1)->Arg(100)->Arg(10000);
+
+// Benchmark the full life of an order: it opens, then fills and leaves the cache
+static void BM_HandleOrderUpdateOpenFill(benchmark::State& state) {
+    auto order_manager = make_order_manager();
+    json opened = make_order_update("ETH-1", "open", 100.0);
+    json filled = make_order_update("ETH-1", "filled", 100.0);
+    
+    for (auto _ : state) {
+        order_manager->handle_order_update(opened);
+        order_manager->handle_order_update(filled);
+    }
+    
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_HandleOrderUpdateOpenFill);
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <memory>
+#include "performance_monitor.h"
+#include "tracer.h"
+
+namespace {
+
+// One tracker per configuration, shared by the threads of a run
+deribit::LatencyTracker& tracker_for(bool histogram, bool tsc) {
+    static deribit::LatencyTracker trackers[] = {
+        deribit::LatencyTracker("bench_steady", false, deribit::ClockSource::STEADY_CLOCK),
+        deribit::LatencyTracker("bench_tsc", false, deribit::ClockSource::TSC),
+        deribit::LatencyTracker("bench_steady_histogram", true, deribit::ClockSource::STEADY_CLOCK),
+        deribit::LatencyTracker("bench_tsc_histogram", true, deribit::ClockSource::TSC)
+    };
+    
+    return trackers[(histogram ? 2 : 0) + (tsc ? 1 : 0)];
+}
+
+} // namespace
+
+// Benchmark timing an empty operation, i.e. the cost every tracked call pays
+static void BM_LatencyTrackerStartEnd(benchmark::State& state) {
+    deribit::LatencyTracker& tracker = tracker_for(state.range(0) != 0, state.range(1) != 0);
+    
+    for (auto _ : state) {
+        uint64_t token = tracker.start();
+        benchmark::DoNotOptimize(token);
+        tracker.end(token);
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatencyTrackerStartEnd)
+    ->ArgNames({"histogram", "tsc"})
+    ->Args({0, 0})->Args({1, 0})->Args({0, 1})->Args({1, 1})
+    ->Threads(1)->Threads(4);
+
+// Benchmark recording a latency measured elsewhere
+static void BM_LatencyTrackerRecord(benchmark::State& state) {
+    static deribit::LatencyTracker tracker("bench_record", true);
+    std::chrono::nanoseconds latency(1500);
+    
+    for (auto _ : state) {
+        tracker.record(latency);
+        latency += std::chrono::nanoseconds(7);
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatencyTrackerRecord)->Threads(1)->Threads(4);
+
+// Benchmark a counter update shared by all threads
+static void BM_CounterAdd(benchmark::State& state) {
+    static auto counter = deribit::PerformanceMonitor::instance().get_counter("bench_counter");
+    
+    for (auto _ : state) {
+        counter->add();
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CounterAdd)->Threads(1)->Threads(4);
+
+// Benchmark a full trace as opened for each market data message, marking every stage
+static void BM_TraceMessage(benchmark::State& state) {
+    deribit::Tracer& tracer = deribit::Tracer::instance();
+    
+    for (auto _ : state) {
+        tracer.begin(deribit::Tracer::steady_now_ns(), deribit::Tracer::wall_now_ns());
+        deribit::Tracer::mark(deribit::TraceStage::DECODE);
+        deribit::Tracer::mark(deribit::TraceStage::BOOK_APPLIED);
+        deribit::Tracer::mark(deribit::TraceStage::PUBLISHED);
+        tracer.end();
+    }
+    
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TraceMessage);
\ No newline at end of file
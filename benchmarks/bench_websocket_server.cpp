@@ -0,0 +1,125 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/client.hpp>
+#include "deribit_api_client.h"
+#include "order_manager.h"
+#include "websocket_server.h"
+
+namespace {
+
+const uint16_t BENCH_PORT = 9101;
+const std::string BENCH_CHANNEL = "bench.channel";
+
+using WebSocketClient = websocketpp::client<websocketpp::config::asio_client>;
+
+// Wait until a counter reaches a value; false on timeout
+bool wait_for(const std::atomic<size_t>& counter, size_t value, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (counter.load(std::memory_order_acquire) < value) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+} // namespace
+
+// Benchmark a channel broadcast until every in-process client has received it
+static void BM_BroadcastToChannel(benchmark::State& state) {
+    size_t client_count = static_cast<size_t>(state.range(0));
+    std::string message = "{\"type\":\"orderbook\",\"instrument\":\"BTC-PERPETUAL\",\"payload\":\"" +
+                          std::string(static_cast<size_t>(state.range(1)), 'x') + "\"}";
+    
+    // Server on a client that is never connected; broadcasting does not use it
+    auto api_client = std::make_shared<deribit::ApiClient>("bench_api_key", "bench_api_secret", true);
+    auto order_manager = std::make_shared<deribit::OrderManager>(api_client);
+    auto server = std::make_shared<deribit::WebSocketServer>(api_client, order_manager, BENCH_PORT);
+    if (!server->initialize() || !server->start()) {
+        state.SkipWithError("Failed to start WebSocket server");
+        return;
+    }
+    
+    // All clients share one endpoint and one I/O thread
+    WebSocketClient client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.set_error_channels(websocketpp::log::elevel::none);
+    client.init_asio();
+    
+    std::atomic<size_t> subscribed{0};
+    std::atomic<size_t> delivered{0};
+    
+    client.set_open_handler([&client](websocketpp::connection_hdl hdl) {
+        client.send(hdl, "{\"type\":\"subscribe\",\"channel\":\"" + BENCH_CHANNEL + "\"}",
+                    websocketpp::frame::opcode::text);
+    });
+    client.set_message_handler([&subscribed, &delivered, &message](websocketpp::connection_hdl,
+                                                                   WebSocketClient::message_ptr msg) {
+        const std::string& payload = msg->get_payload();
+        if (payload == message) {
+            delivered.fetch_add(1, std::memory_order_release);
+        } else if (payload.find("\"subscribed\"") != std::string::npos) {
+            subscribed.fetch_add(1, std::memory_order_release);
+        }
+    });
+    
+    std::vector<WebSocketClient::connection_ptr> connections;
+    for (size_t i = 0; i < client_count; ++i) {
+        websocketpp::lib::error_code ec;
+        auto connection = client.get_connection("ws://localhost:" + std::to_string(BENCH_PORT), ec);
+        if (ec) {
+            state.SkipWithError("Failed to create client connection");
+            break;
+        }
+        client.connect(connection);
+        connections.push_back(connection);
+    }
+    
+    std::thread client_thread([&client]() {
+        client.run();
+    });
+    
+    if (connections.size() == client_count && !wait_for(subscribed, client_count, std::chrono::seconds(10))) {
+        state.SkipWithError("Clients did not subscribe in time");
+    }
+    
+    for (auto _ : state) {
+        if (connections.size() != client_count) {
+            break;
+        }
+        
+        size_t target = delivered.load(std::memory_order_acquire) + client_count;
+        server->broadcast_to_channel(BENCH_CHANNEL, message);
+        
+        if (!wait_for(delivered, target, std::chrono::seconds(5))) {
+            state.SkipWithError("Broadcast was not delivered in time");
+            break;
+        }
+    }
+    
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(client_count));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(client_count * message.size()));
+    
+    // Tear down
+    for (auto& connection : connections) {
+        websocketpp::lib::error_code ec;
+        client.close(connection->get_handle(), websocketpp::close::status::normal, "Benchmark complete", ec);
+    }
+    server->stop();
+    client.stop();
+    
+    if (client_thread.joinable()) {
+        client_thread.join();
+    }
+}
+BENCHMARK(BM_BroadcastToChannel)
+    ->ArgNames({"clients", "bytes"})
+    ->Args({1, 256})->Args({8, 256})->Args({64, 256})->Args({64, 16384})
+    ->UseRealTime();
\ No newline at end of file
@@ -0,0 +1,382 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/client.hpp>
+#include "deribit_api_client.h"
+#include "order_manager.h"
+#include "websocket_server.h"
+#include "market_data_codec.h"
+#include "latency_histogram.h"
+#include "tracer.h"
+
+using namespace std;
+
+namespace {
+
+using WebSocketClient = websocketpp::client<websocketpp::config::asio_client>;
+
+const string SENT_KEY = "\"sent_ns\":";
+const string TIMESTAMP_KEY = "\"timestamp\":";
+
+struct Options {
+    size_t clients{100};
+    size_t client_threads{1};
+    int duration_seconds{10};
+    string channel{"orderbook.BTC-PERPETUAL"};
+    string connect;                 // host:port of a running server; empty to run one in-process
+    uint16_t port{9102};
+    size_t server_threads{4};
+    double rate{1000.0};            // Messages per second published in-process, 0 for as fast as possible
+    string replay_file;             // One message per line, published in order and looped
+};
+
+// Counters shared by all client connections
+struct Stats {
+    atomic<size_t> opened{0};
+    atomic<size_t> subscribed{0};
+    atomic<size_t> failed{0};
+    atomic<uint64_t> received{0};
+    atomic<uint64_t> published{0};
+    deribit::LatencyHistogram latency;
+};
+
+void print_usage(const char* program) {
+    cerr << "Usage: " << program << " [options]" << endl
+         << "  --clients M          Client connections to open (default: 100)" << endl
+         << "  --client-threads T   Client I/O threads (default: 1)" << endl
+         << "  --duration S         Seconds to measure (default: 10)" << endl
+         << "  --channel NAME       Channel to subscribe to (default: orderbook.BTC-PERPETUAL)" << endl
+         << "  --connect HOST:PORT  Load a running server instead of an in-process one" << endl
+         << "  --port P             Port of the in-process server (default: 9102)" << endl
+         << "  --server-threads N   I/O threads of the in-process server (default: 4)" << endl
+         << "  --rate R             Messages per second published in-process, 0 for unpaced (default: 1000)" << endl
+         << "  --replay FILE        Publish the messages in FILE, one per line, instead of a synthetic book" << endl;
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--help" || i + 1 >= argc) {
+                return false;
+            }
+
+            string value = argv[++i];
+            if (arg == "--clients") {
+                options.clients = stoul(value);
+            } else if (arg == "--client-threads") {
+                options.client_threads = max<size_t>(1, stoul(value));
+            } else if (arg == "--duration") {
+                options.duration_seconds = stoi(value);
+            } else if (arg == "--channel") {
+                options.channel = value;
+            } else if (arg == "--connect") {
+                options.connect = value;
+            } else if (arg == "--port") {
+                options.port = static_cast<uint16_t>(stoi(value));
+            } else if (arg == "--server-threads") {
+                options.server_threads = max<size_t>(1, stoul(value));
+            } else if (arg == "--rate") {
+                options.rate = stod(value);
+            } else if (arg == "--replay") {
+                options.replay_file = value;
+            } else {
+                cerr << "Unknown option: " << arg << endl;
+                return false;
+            }
+        }
+    } catch (const exception& e) {
+        cerr << "Invalid option value: " << e.what() << endl;
+        return false;
+    }
+
+    return options.clients > 0 && options.duration_seconds > 0;
+}
+
+// Load the replay file, or build one synthetic 20-level book
+vector<string> load_messages(const Options& options) {
+    vector<string> messages;
+
+    if (!options.replay_file.empty()) {
+        ifstream file(options.replay_file);
+        string line;
+        while (getline(file, line)) {
+            if (!line.empty() && line[0] == '{') {
+                messages.push_back(line);
+            }
+        }
+        return messages;
+    }
+
+    vector<pair<double, double>> bids;
+    vector<pair<double, double>> asks;
+    for (int i = 0; i < 20; ++i) {
+        bids.emplace_back(50000.0 - i * 0.5, 10.0 + i);
+        asks.emplace_back(50000.5 + i * 0.5, 10.0 + i);
+    }
+
+    string message;
+    deribit::write_orderbook_message(message, "BTC-PERPETUAL", "1700000000000", bids, asks);
+    messages.push_back(message);
+    return messages;
+}
+
+// Prepend the publish time so clients can measure delivery latency
+string stamp(const string& message, int64_t sent_ns) {
+    string stamped;
+    stamped.reserve(message.size() + 32);
+    stamped += '{';
+    stamped += SENT_KEY;
+    stamped += to_string(sent_ns);
+    if (message.size() > 2) {
+        stamped += ',';
+    }
+    stamped.append(message, 1, string::npos);
+    return stamped;
+}
+
+// Delivery latency of a message, or -1 if it carries no usable time
+int64_t read_latency_ns(const string& payload) {
+    // In-process publishing stamps the steady clock
+    if (payload.size() > SENT_KEY.size() && payload.compare(1, SENT_KEY.size(), SENT_KEY) == 0) {
+        int64_t sent_ns = strtoll(payload.c_str() + 1 + SENT_KEY.size(), nullptr, 10);
+        return deribit::Tracer::steady_now_ns() - sent_ns;
+    }
+
+    // A running server forwards Deribit's timestamp, in milliseconds and possibly quoted
+    size_t position = payload.find(TIMESTAMP_KEY);
+    if (position == string::npos) {
+        return -1;
+    }
+
+    position += TIMESTAMP_KEY.size();
+    if (position < payload.size() && payload[position] == '"') {
+        ++position;
+    }
+
+    int64_t timestamp_ms = strtoll(payload.c_str() + position, nullptr, 10);
+    return timestamp_ms > 0 ? deribit::Tracer::wall_now_ns() - timestamp_ms * 1000000 : -1;
+}
+
+void print_report(const Options& options, const Stats& stats, double elapsed_seconds) {
+    deribit::HistogramSnapshot latency = stats.latency.snapshot();
+    uint64_t received = stats.received.load();
+
+    cout << endl << "Clients:    " << stats.subscribed.load() << " subscribed of " << options.clients
+         << " (" << stats.failed.load() << " failed)" << endl;
+
+    if (options.connect.empty()) {
+        uint64_t published = stats.published.load();
+        cout << "Published:  " << published << " messages, " << published / elapsed_seconds << " msg/s" << endl;
+        cout << "Expected:   " << published * stats.subscribed.load() << " deliveries" << endl;
+    }
+
+    cout << "Delivered:  " << received << " messages, " << received / elapsed_seconds << " msg/s" << endl;
+
+    if (latency.count() == 0) {
+        cout << "Latency:    no timestamped messages received" << endl;
+        return;
+    }
+
+    cout << (options.connect.empty() ? "Latency (publish to client, us):" : "Latency (exchange to client, us):") << endl
+         << "  min    " << latency.min() / 1000.0 << endl
+         << "  mean   " << latency.mean() / 1000.0 << endl
+         << "  p50    " << latency.percentile(50.0) / 1000.0 << endl
+         << "  p90    " << latency.percentile(90.0) / 1000.0 << endl
+         << "  p99    " << latency.percentile(99.0) / 1000.0 << endl
+         << "  p99.9  " << latency.percentile(99.9) / 1000.0 << endl
+         << "  max    " << latency.max() / 1000.0 << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    try {
+        Stats stats;
+
+        // Start the in-process server unless an external one is loaded
+        shared_ptr<deribit::ApiClient> api_client;
+        shared_ptr<deribit::OrderManager> order_manager;
+        shared_ptr<deribit::WebSocketServer> server;
+        vector<string> messages;
+        string uri = "ws://" + options.connect;
+
+        if (options.connect.empty()) {
+            messages = load_messages(options);
+            if (messages.empty()) {
+                cerr << "No messages to publish in " << options.replay_file << endl;
+                return 1;
+            }
+
+            // The API client is never connected; publishing does not use it
+            api_client = make_shared<deribit::ApiClient>("load_api_key", "load_api_secret", true);
+            order_manager = make_shared<deribit::OrderManager>(api_client);
+            server = make_shared<deribit::WebSocketServer>(api_client, order_manager, options.port);
+            server->set_thread_count(options.server_threads);
+
+            if (!server->initialize() || !server->start()) {
+                cerr << "Failed to start WebSocket server on port " << options.port << endl;
+                return 1;
+            }
+            uri = "ws://localhost:" + to_string(options.port);
+        }
+
+        // Spread the connections over one endpoint per client thread
+        string subscribe = "{\"type\":\"subscribe\",\"channel\":\"" + options.channel + "\"}";
+        vector<unique_ptr<WebSocketClient>> endpoints;
+        vector<WebSocketClient::connection_ptr> connections;
+
+        for (size_t i = 0; i < options.client_threads; ++i) {
+            auto endpoint = make_unique<WebSocketClient>();
+            endpoint->clear_access_channels(websocketpp::log::alevel::all);
+            endpoint->set_error_channels(websocketpp::log::elevel::none);
+            endpoint->init_asio();
+
+            WebSocketClient* client = endpoint.get();
+            client->set_open_handler([client, &stats, &subscribe](websocketpp::connection_hdl hdl) {
+                stats.opened++;
+                websocketpp::lib::error_code ec;
+                client->send(hdl, subscribe, websocketpp::frame::opcode::text, ec);
+            });
+            client->set_fail_handler([&stats](websocketpp::connection_hdl) {
+                stats.failed++;
+            });
+            client->set_message_handler([&stats](websocketpp::connection_hdl, WebSocketClient::message_ptr msg) {
+                const string& payload = msg->get_payload();
+
+                // Server replies are small, so data messages are seldom searched
+                if (payload.size() < 256) {
+                    if (payload.find("\"type\":\"subscribed\"") != string::npos) {
+                        stats.subscribed++;
+                        return;
+                    }
+                    if (payload.find("\"type\":\"welcome\"") != string::npos ||
+                        payload.find("\"type\":\"unsubscribed\"") != string::npos ||
+                        payload.find("\"type\":\"error\"") != string::npos) {
+                        return;
+                    }
+                }
+
+                stats.received.fetch_add(1, memory_order_relaxed);
+                int64_t latency_ns = read_latency_ns(payload);
+                if (latency_ns >= 0) {
+                    stats.latency.record(latency_ns);
+                }
+            });
+
+            endpoints.push_back(move(endpoint));
+        }
+
+        for (size_t i = 0; i < options.clients; ++i) {
+            WebSocketClient& client = *endpoints[i % endpoints.size()];
+            websocketpp::lib::error_code ec;
+            auto connection = client.get_connection(uri, ec);
+            if (ec) {
+                cerr << "Failed to create connection to " << uri << ": " << ec.message() << endl;
+                stats.failed++;
+                continue;
+            }
+            client.connect(connection);
+            connections.push_back(connection);
+        }
+
+        vector<thread> client_threads;
+        for (auto& endpoint : endpoints) {
+            WebSocketClient* client = endpoint.get();
+            client_threads.emplace_back([client]() {
+                client->run();
+            });
+        }
+
+        // Wait for the subscriptions before measuring
+        cout << "Connecting " << options.clients << " clients to " << uri << "..." << endl;
+        auto connect_deadline = chrono::steady_clock::now() + chrono::seconds(10);
+        while (stats.subscribed.load() + stats.failed.load() < options.clients &&
+               chrono::steady_clock::now() < connect_deadline) {
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+
+        // Discard whatever arrived before the subscriptions completed
+        stats.received = 0;
+        stats.latency.reset();
+
+        auto start = chrono::steady_clock::now();
+        atomic<bool> publishing{true};
+
+        // Publish in-process at the requested rate
+        thread publisher;
+        if (server) {
+            publisher = thread([&]() {
+                auto interval = options.rate > 0.0 ? chrono::nanoseconds(static_cast<int64_t>(1e9 / options.rate))
+                                                   : chrono::nanoseconds(0);
+                auto next = chrono::steady_clock::now();
+                size_t index = 0;
+
+                while (publishing.load(memory_order_relaxed)) {
+                    const string& message = messages[index];
+                    index = index + 1 == messages.size() ? 0 : index + 1;
+
+                    server->broadcast_to_channel(options.channel, stamp(message, deribit::Tracer::steady_now_ns()));
+                    stats.published.fetch_add(1, memory_order_relaxed);
+
+                    if (interval.count() > 0) {
+                        next += interval;
+                        this_thread::sleep_until(next);
+                    }
+                }
+            });
+        }
+
+        // Report throughput once a second
+        uint64_t last_received = 0;
+        for (int second = 1; second <= options.duration_seconds; ++second) {
+            this_thread::sleep_until(start + chrono::seconds(second));
+            uint64_t received = stats.received.load();
+            cout << "[" << second << "s] " << received - last_received << " msg/s" << endl;
+            last_received = received;
+        }
+
+        publishing = false;
+        if (publisher.joinable()) {
+            publisher.join();
+        }
+
+        double elapsed_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        print_report(options, stats, elapsed_seconds);
+
+        // Tear down
+        for (auto& connection : connections) {
+            websocketpp::lib::error_code ec;
+            connection->close(websocketpp::close::status::normal, "Load test complete", ec);
+        }
+        if (server) {
+            server->stop();
+        }
+        for (auto& endpoint : endpoints) {
+            endpoint->stop();
+        }
+        for (auto& client_thread : client_threads) {
+            if (client_thread.joinable()) {
+                client_thread.join();
+            }
+        }
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
\ No newline at end of file
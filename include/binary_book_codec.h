@@ -0,0 +1,115 @@
+#ifndef BINARY_BOOK_CODEC_H
+#define BINARY_BOOK_CODEC_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace deribit {
+
+/**
+ * @enum BinaryMessageType
+ * @brief Kind of a binary orderbook message
+ */
+enum class BinaryMessageType : uint8_t {
+    BOOK_SNAPSHOT = 1,  // The full published book
+    BOOK_DELTA = 2      // Levels changed since the previous sequence
+};
+
+// Version written to, and required in, every binary message
+constexpr uint8_t BINARY_PROTOCOL_VERSION = 1;
+
+// Fixed part of a binary message before the instrument name
+constexpr size_t BINARY_BOOK_HEADER_SIZE = 24;
+
+// One (price, size) level
+constexpr size_t BINARY_BOOK_LEVEL_SIZE = 16;
+
+/**
+ * @struct BinaryBookMessage
+ * @brief A decoded binary orderbook message
+ *
+ * In a delta, a level with size 0 removes that price. instrument_name points
+ * into the buffer the message was decoded from.
+ */
+struct BinaryBookMessage {
+    BinaryMessageType type{BinaryMessageType::BOOK_SNAPSHOT};
+    std::string_view instrument_name;
+    uint64_t sequence{0};
+    int64_t timestamp{0};
+    std::vector<std::pair<double, double>> bids;
+    std::vector<std::pair<double, double>> asks;
+};
+
+/**
+ * @brief Append a binary orderbook snapshot
+ * @param out The string to append to
+ * @param instrument_name The name of the instrument
+ * @param sequence The sequence number of the book
+ * @param timestamp The orderbook timestamp
+ * @param bids The bids as (price, size) pairs, best first
+ * @param asks The asks as (price, size) pairs, best first
+ *
+ * All fields are little-endian. The message is a uint8 type, a uint8 version,
+ * a uint16 instrument name length, uint16 bid and ask counts, the uint64
+ * sequence and the int64 timestamp, followed by the instrument name and then
+ * the bids and asks as pairs of doubles. At most 65535 levels per side are
+ * written.
+ */
+void write_binary_book_snapshot(std::string& out,
+                                std::string_view instrument_name,
+                                uint64_t sequence,
+                                int64_t timestamp,
+                                const std::vector<std::pair<double, double>>& bids,
+                                const std::vector<std::pair<double, double>>& asks);
+
+/**
+ * @brief Append a binary orderbook delta between two publications of a book
+ * @param out The string to append to
+ * @param instrument_name The name of the instrument
+ * @param sequence The sequence number of the new book; it applies to sequence - 1
+ * @param timestamp The new orderbook timestamp
+ * @param old_bids The previously published bids, best first
+ * @param old_asks The previously published asks, best first
+ * @param bids The new bids, best first
+ * @param asks The new asks, best first
+ *
+ * Same layout as a snapshot, but only levels that were added, resized or
+ * removed are written, removed ones with size 0. A delta with no levels still
+ * advances the sequence.
+ */
+void write_binary_book_delta(std::string& out,
+                             std::string_view instrument_name,
+                             uint64_t sequence,
+                             int64_t timestamp,
+                             const std::vector<std::pair<double, double>>& old_bids,
+                             const std::vector<std::pair<double, double>>& old_asks,
+                             const std::vector<std::pair<double, double>>& bids,
+                             const std::vector<std::pair<double, double>>& asks);
+
+/**
+ * @brief Decode a binary orderbook message
+ * @param data The frame payload
+ * @param message The message to fill; its level vectors are reused
+ * @return true if decoding succeeded, false for a truncated or unknown message
+ */
+bool read_binary_book(std::string_view data, BinaryBookMessage& message);
+
+/**
+ * @brief Apply a decoded delta to a book
+ * @param bids The bids, best first, updated in place
+ * @param asks The asks, best first, updated in place
+ * @param delta The delta
+ *
+ * The caller checks that delta.sequence follows the book's sequence; a gap
+ * means updates were missed and the book must be re-requested.
+ */
+void apply_binary_book_delta(std::vector<std::pair<double, double>>& bids,
+                             std::vector<std::pair<double, double>>& asks,
+                             const BinaryBookMessage& delta);
+
+} // namespace deribit
+
+#endif // BINARY_BOOK_CODEC_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef CHANNEL_ROUTER_H
+#define CHANNEL_ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <limits>
+#include <cstdint>
+
+namespace deribit {
+
+// Dense index of a channel in a ChannelRouter
+using ChannelId = uint32_t;
+constexpr ChannelId INVALID_CHANNEL_ID = std::numeric_limits<ChannelId>::max();
+
+/**
+ * @class ChannelRouter
+ * @brief Interned channel names and the wildcard patterns that match them
+ *
+ * A pattern is a channel name with '*' standing for any run of characters
+ * other than '.', so "orderbook.BTC-*" matches "orderbook.BTC-PERPETUAL" but
+ * not "orderbook.BTC-PERPETUAL.10.100ms". Channels and patterns share one
+ * character trie: a channel is stored at the node its name ends on, a
+ * pattern at the node its literal prefix (the part before the first '*')
+ * ends on. Matching a new channel therefore only tests the patterns on its
+ * path, and matching a new pattern only the channels below its prefix.
+ *
+ * Ids are dense and the ids of released channels are reused, so they can
+ * index flat arrays elsewhere that grow only to the most channels interned at
+ * once. The router is not thread-safe; callers synchronize.
+ */
+class ChannelRouter {
+public:
+    /**
+     * @brief Constructor
+     */
+    ChannelRouter();
+
+    /**
+     * @brief Destructor
+     */
+    ~ChannelRouter();
+
+    ChannelRouter(const ChannelRouter&) = delete;
+    ChannelRouter& operator=(const ChannelRouter&) = delete;
+
+    /**
+     * @brief Get the id of a channel, adding it if it is new
+     * @param channel The channel name; must not be a pattern
+     * @return The channel's id
+     */
+    ChannelId intern(const std::string& channel);
+
+    /**
+     * @brief Get the id of a channel
+     * @param channel The channel name
+     * @return The channel's id, or INVALID_CHANNEL_ID if it is not interned
+     */
+    ChannelId find(const std::string& channel) const;
+
+    /**
+     * @brief Remove a channel, freeing its id for the next new channel
+     * @param id A valid channel id
+     */
+    void release(ChannelId id);
+
+    /**
+     * @brief Get the name of a channel
+     * @param id A valid channel id
+     * @return The channel name
+     */
+    const std::string& name(ChannelId id) const;
+
+    /**
+     * @brief Get the number of interned channels
+     * @return The number of channels
+     */
+    size_t channel_count() const;
+
+    /**
+     * @brief Add a pattern
+     * @param pattern The pattern
+     * @return true if it was added, false if it was already present
+     */
+    bool add_pattern(const std::string& pattern);
+
+    /**
+     * @brief Remove a pattern
+     * @param pattern The pattern
+     * @return true if it was removed, false if it was not present
+     */
+    bool remove_pattern(const std::string& pattern);
+
+    /**
+     * @brief Get the interned channels a pattern matches
+     * @param pattern The pattern; it need not have been added
+     * @return The matching channel ids
+     */
+    std::vector<ChannelId> match_channels(const std::string& pattern) const;
+
+    /**
+     * @brief Get the added patterns that match a channel
+     * @param channel The channel name; it need not have been interned
+     * @return The matching patterns
+     */
+    std::vector<std::string> match_patterns(std::string_view channel) const;
+
+    /**
+     * @brief Check if a channel name is a pattern
+     * @param channel The channel name
+     * @return true if it contains '*'
+     */
+    static bool is_pattern(std::string_view channel);
+
+    /**
+     * @brief Match a channel name against a pattern
+     * @param pattern The pattern
+     * @param channel The channel name
+     * @return true if the pattern matches the whole name
+     */
+    static bool matches(std::string_view pattern, std::string_view channel);
+
+private:
+    struct Node {
+        std::vector<std::pair<char, std::unique_ptr<Node>>> children;
+        ChannelId channel{INVALID_CHANNEL_ID};
+        std::vector<std::string> patterns;      // Patterns whose literal prefix ends here
+    };
+
+    std::unique_ptr<Node> root_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, ChannelId> ids_;
+    std::vector<ChannelId> free_ids_;
+
+    // Returns the node a prefix ends on, creating the missing ones if create is set
+    Node* walk(std::string_view prefix, bool create);
+    const Node* walk(std::string_view prefix) const;
+    // Removes the nodes at the end of a prefix that hold nothing any more
+    void prune(std::string_view prefix);
+    void collect_channels(const Node& node, const std::string& pattern, std::vector<ChannelId>& out) const;
+};
+
+} // namespace deribit
+
+#endif // CHANNEL_ROUTER_H
\ No newline at end of file
@@ -5,13 +5,26 @@
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <deque>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <future>
+#include <vector>
+#include <limits>
 #include <condition_variable>
 #include <nlohmann/json.hpp>
 #include "websocketpp_asio_compatibility.h"
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
+#include "https_connection_pool.h"
+#include "market_data_codec.h"
+#include "market_data_journal.h"
+#include "ring_buffer.h"
+#include "request_scheduler.h"
+#include "performance_monitor.h"
+#include "tracer.h"
 
 namespace deribit {
 
@@ -40,13 +53,47 @@ struct ApiCredentials {
 };
 
 /**
- * @struct ApiResponse
- * @brief Response from the API
+ * @struct SubscriptionResult
+ * @brief Outcome of a batch subscribe or unsubscribe
  */
-struct ApiResponse {
-    bool success;
-    json data;
-    std::string error_message;
+struct SubscriptionResult {
+    std::vector<std::string> confirmed;   // Channels the server confirmed
+    std::vector<std::string> failed;      // Channels rejected, not answered or not sent
+};
+
+/**
+ * @struct MessageQueueConfig
+ * @brief Settings for the workers running subscription callbacks
+ */
+struct MessageQueueConfig {
+    size_t worker_count{1};                      // Threads running subscription callbacks
+    std::vector<int> worker_cpus;                // CPU for each worker, reused cyclically; empty to not pin
+    size_t capacity{8192};                       // Slots per worker; messages arriving when all are used are dropped
+    WaitPolicy wait_policy{WaitPolicy::BLOCKING}; // How a worker waits when its queue is empty
+    size_t spin_iterations{10000};               // Polls before sleeping under WaitPolicy::HYBRID
+};
+
+/**
+ * @struct ReconnectConfig
+ * @brief Settings for keeping the WebSocket session alive
+ */
+struct ReconnectConfig {
+    bool enabled{true};                                 // Reconnect when the connection drops
+    std::chrono::milliseconds initial_backoff{500};     // Wait before the first attempt, doubled after each failure
+    std::chrono::milliseconds max_backoff{30000};       // Longest wait between attempts
+    std::chrono::seconds heartbeat_interval{10};        // public/set_heartbeat interval, 0 to disable; at least 10
+};
+
+/**
+ * @struct FeedStats
+ * @brief Arbitration results of one market data feed
+ */
+struct FeedStats {
+    std::string url;
+    bool connected{false};
+    uint64_t wins{0};           // Book updates this feed delivered first
+    uint64_t duplicates{0};     // Book updates that had already arrived on another feed
+    double win_ratio{0.0};      // wins / (wins + duplicates), 0 before any update
 };
 
 /**
@@ -58,6 +105,16 @@ public:
     using WebSocketClient = websocketpp::client<websocketpp::config::asio_tls_client>;
     using WebSocketConnectionPtr = websocketpp::connection_hdl;
     using MessageCallback = std::function<void(const json&)>;
+    using BookUpdateCallback = std::function<void(const BookUpdate&)>;
+    using TradesCallback = std::function<void(const std::vector<TradeUpdate>&)>;
+    using ResponseCallback = std::function<void(const ApiResponse&)>;
+    using ConnectionCallback = std::function<void(bool connected)>;
+    
+    // Let the client pick the worker for a channel
+    static constexpr int AUTO_SHARD = -1;
+    
+    // Channels per public/subscribe or public/unsubscribe request in batch calls
+    static constexpr size_t DEFAULT_SUBSCRIBE_BATCH = 100;
     
     /**
      * @brief Constructor
@@ -80,12 +137,86 @@ public:
      */
     bool initialize();
     
+    /**
+     * @brief Configure the HTTPS connection pool used for REST requests
+     * @param config The pool configuration (call before initialize())
+     * @return true if applied, false if the client is already initialized
+     */
+    bool set_connection_pool_config(const ConnectionPoolConfig& config);
+    
+    /**
+     * @brief Set the number of threads running the shared I/O context
+     * @param count The number of threads (call before initialize())
+     */
+    void set_io_thread_count(size_t count);
+    
+    /**
+     * @brief Configure the workers running subscription callbacks
+     * @param config The worker and queue configuration (call before initialize())
+     *
+     * Each channel is served by one worker, so its messages are handled in
+     * order; different channels may run in parallel. When a worker's queue is
+     * full new messages are dropped and counted in api_message_queue_overflows;
+     * a dropped book delta shows up as a gap and triggers a resync.
+     */
+    void set_message_queue_config(const MessageQueueConfig& config);
+    
+    /**
+     * @brief Get the number of workers running subscription callbacks
+     * @return The number of workers
+     */
+    size_t get_worker_count() const;
+    
+    /**
+     * @brief Get the worker a channel is assigned to with AUTO_SHARD
+     * @param channel The channel name
+     * @return The worker index
+     *
+     * Channels are hashed by instrument, so e.g. book and trades channels of
+     * one instrument share a worker.
+     */
+    size_t shard_for_channel(const std::string& channel) const;
+    
+    /**
+     * @brief Configure the client-side rate limiter
+     * @param config The credit pools and queue limit
+     *
+     * Must be called before initialize(). All requests then wait for credit in
+     * priority lanes, see RequestScheduler; blocking requests wait in the
+     * calling thread and are never folded with others.
+     */
+    void set_rate_limit_config(const RateLimitConfig& config);
+    
+    /**
+     * @brief Get the rate limiter
+     * @return The scheduler, or nullptr before initialize() or when rate limiting is disabled
+     */
+    RequestScheduler* get_request_scheduler() const;
+    
+    /**
+     * @brief Get the shared I/O context used for asynchronous requests
+     * @return Reference to the I/O context
+     *
+     * Other components may post work to it or run their own I/O on it.
+     */
+    boost::asio::io_context& get_io_context();
+    
     /**
      * @brief Authenticate with the API
      * @return true if authentication successful, false otherwise
      */
     bool authenticate();
     
+    /**
+     * @brief Set how long before expiry the access token is refreshed
+     * @param margin The margin (default: 120 seconds); at most half the token lifetime is used
+     *
+     * Once authenticated, a background thread refreshes the token ahead of
+     * expiry, over the WebSocket session when it is authenticated so the same
+     * refresh renews the session, and over REST otherwise.
+     */
+    void set_token_refresh_margin(std::chrono::seconds margin);
+    
     /**
      * @brief Make a public API request
      * @param method The API method to call
@@ -102,6 +233,72 @@ public:
      */
     ApiResponse private_request(const std::string& method, const json& params = {});
     
+    /**
+     * @brief Make a public API request without blocking the caller
+     * @param method The API method to call
+     * @param params The parameters for the API call
+     * @return Future holding the API response
+     */
+    std::future<ApiResponse> public_request_async(const std::string& method, const json& params = {});
+    
+    /**
+     * @brief Make a public API request without blocking the caller
+     * @param method The API method to call
+     * @param params The parameters for the API call
+     * @param callback Called on an I/O thread with the API response
+     */
+    void public_request_async(const std::string& method, const json& params, ResponseCallback callback);
+    
+    /**
+     * @brief Make a private API request without blocking the caller
+     * @param method The API method to call
+     * @param params The parameters for the API call
+     * @return Future holding the API response
+     */
+    std::future<ApiResponse> private_request_async(const std::string& method, const json& params = {});
+    
+    /**
+     * @brief Make a private API request without blocking the caller
+     * @param method The API method to call
+     * @param params The parameters for the API call
+     * @param callback Called on an I/O thread with the API response
+     */
+    void private_request_async(const std::string& method, const json& params, ResponseCallback callback);
+    
+    /**
+     * @brief Make a JSON-RPC request over the WebSocket connection and wait for the reply
+     * @param method The API method to call
+     * @param params The parameters for the API call
+     * @param timeout How long to wait for the reply (0 uses the default request timeout)
+     * @return The API response
+     */
+    ApiResponse websocket_request(const std::string& method,
+                                  const json& params = {},
+                                  std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    
+    /**
+     * @brief Make a JSON-RPC request over the WebSocket connection without waiting
+     * @param method The API method to call
+     * @param params The parameters for the API call
+     * @param callback Called with the reply, or with an error on timeout or disconnect
+     * @param timeout How long to wait for the reply (0 uses the default request timeout)
+     * @return The request ID, or 0 if the request could not be sent
+     *
+     * The callback runs on the WebSocket thread (or the timeout thread) and should not block.
+     * With rate limiting the request may still be waiting for credit when this returns, and
+     * a request folded into an identical one is answered under the other's ID.
+     */
+    uint64_t websocket_request_async(const std::string& method,
+                                     const json& params,
+                                     ResponseCallback callback,
+                                     std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    
+    /**
+     * @brief Set the default timeout for WebSocket requests
+     * @param timeout The timeout
+     */
+    void set_request_timeout(std::chrono::milliseconds timeout);
+    
     /**
      * @brief Connect to the WebSocket API
      * @return true if connection successful, false otherwise
@@ -110,16 +307,173 @@ public:
     
     /**
      * @brief Disconnect from the WebSocket API
+     *
+     * Also stops reconnecting if the connection had dropped.
      */
     void disconnect_websocket();
     
+    /**
+     * @brief Configure reconnects and heartbeats
+     * @param config The reconnect and heartbeat settings (call before connect_websocket())
+     *
+     * After a successful connect_websocket(), a dropped connection is reopened
+     * with exponential backoff, re-authenticated if the client is, and every
+     * channel with a callback is subscribed again in batches. The session asks
+     * Deribit for heartbeats and answers its test requests; a session that
+     * receives nothing for two heartbeat intervals is closed and reopened.
+     */
+    void set_reconnect_config(const ReconnectConfig& config);
+    
+    /**
+     * @brief Set the callback for changes of the connection state
+     * @param callback Called with false when the connection drops unexpectedly,
+     *                 and with true once a reconnect has resubscribed the channels
+     *
+     * Call before connect_websocket(). The callback runs on the WebSocket
+     * thread or the reconnect thread and should not block.
+     */
+    void set_connection_callback(ConnectionCallback callback);
+    
+    /**
+     * @brief Get the number of successful reconnects
+     * @return The number of times a dropped connection was restored
+     */
+    uint64_t get_reconnect_count() const;
+    
+    /**
+     * @brief Add a redundant market data session
+     * @param url The WebSocket URL of the session, e.g. another Deribit edge endpoint
+     * @return true if the feed was added, false if the client is already connected
+     *
+     * Call before connect_websocket() or replaying. Each added feed opens its
+     * own session when the primary one connects and subscribes to every
+     * book.* channel the client does. Updates of a book channel are then
+     * arbitrated on change_id: the first copy to arrive on any feed is queued
+     * for the callback and later copies are dropped. Added feeds send no other
+     * requests, are not authenticated and are not captured to the journal; one
+     * that drops is reopened by the session supervisor.
+     */
+    bool add_market_data_feed(const std::string& url);
+    
+    /**
+     * @brief Get the arbitration results of every market data feed
+     * @return One entry per feed, the primary session first; empty if no feed was added
+     */
+    std::vector<FeedStats> get_feed_stats() const;
+    
+    /**
+     * @brief Capture every received WebSocket frame to a journal
+     * @param journal An open journal, or nullptr to stop capturing
+     *
+     * Must be called before connect_websocket(). The receive path only queues a
+     * reference to each frame; the journal's flusher does the copying.
+     */
+    void set_capture_journal(std::shared_ptr<JournalWriter> journal);
+    
+    /**
+     * @brief Run without a WebSocket connection, fed by replay_message()
+     * @param enabled Whether replay mode is on
+     *
+     * In replay mode subscribing and unsubscribing only change the local
+     * callbacks, and a full worker queue makes replay_message() wait rather
+     * than drop the message.
+     */
+    void set_replay_mode(bool enabled);
+    
+    /**
+     * @brief Check if the client is in replay mode
+     * @return true if in replay mode
+     */
+    bool is_replay_mode() const;
+    
+    /**
+     * @brief Feed a captured frame through the same path as a received one
+     * @param payload The raw frame
+     * @param received_wall_ns The system clock time the frame was originally received
+     * @param feed The feed the frame is attributed to (default: 0, the primary session)
+     */
+    void replay_message(std::string_view payload, int64_t received_wall_ns, size_t feed = 0);
+    
+    /**
+     * @brief Wait until the workers have run every queued message
+     * @param timeout The longest time to wait
+     * @return true if all queues drained in time
+     */
+    bool wait_until_idle(std::chrono::milliseconds timeout);
+    
     /**
      * @brief Subscribe to a channel
      * @param channel The channel to subscribe to
      * @param callback The callback to call when a message is received
+     * @param shard The worker running the callback, or AUTO_SHARD (default: AUTO_SHARD)
+     * @return true if subscription successful, false otherwise
+     */
+    bool subscribe(const std::string& channel, MessageCallback callback, int shard = AUTO_SHARD);
+    
+    /**
+     * @brief Subscribe to a book.* channel with typed decoding
+     * @param channel The channel to subscribe to
+     * @param callback The callback to call with each decoded message
+     * @param shard The worker running the callback, or AUTO_SHARD (default: AUTO_SHARD)
      * @return true if subscription successful, false otherwise
+     *
+     * Messages are decoded straight from the receive buffer without building a
+     * json tree. The update and its string views are only valid during the call.
      */
-    bool subscribe(const std::string& channel, MessageCallback callback);
+    bool subscribe_book(const std::string& channel, BookUpdateCallback callback, int shard = AUTO_SHARD);
+    
+    /**
+     * @brief Subscribe to a trades.* channel with typed decoding
+     * @param channel The channel to subscribe to
+     * @param callback The callback to call with the trades of each message
+     * @param shard The worker running the callback, or AUTO_SHARD (default: AUTO_SHARD)
+     * @return true if subscription successful, false otherwise
+     *
+     * The trades and their string views are only valid during the call.
+     */
+    bool subscribe_trades(const std::string& channel, TradesCallback callback, int shard = AUTO_SHARD);
+    
+    /**
+     * @brief Subscribe to many channels with one callback
+     * @param channels The channels to subscribe to
+     * @param callback The callback to call when a message is received on any of them
+     * @param shard The worker running the callback, or AUTO_SHARD to assign each channel (default: AUTO_SHARD)
+     * @param batch_size The maximum channels per request (default: DEFAULT_SUBSCRIBE_BATCH)
+     * @return The channels the server confirmed and those it did not
+     *
+     * Callbacks are registered in one pass and the requests are pipelined, then
+     * the call waits for all replies. Callbacks of failed channels are removed.
+     */
+    SubscriptionResult subscribe_many(const std::vector<std::string>& channels, MessageCallback callback,
+                                      int shard = AUTO_SHARD, size_t batch_size = DEFAULT_SUBSCRIBE_BATCH);
+    
+    /**
+     * @brief Subscribe to many book.* channels with typed decoding
+     * @param channels The channels to subscribe to
+     * @param callback The callback to call with each decoded message
+     * @param shard The worker running the callback, or AUTO_SHARD to assign each channel (default: AUTO_SHARD)
+     * @param batch_size The maximum channels per request (default: DEFAULT_SUBSCRIBE_BATCH)
+     * @return The channels the server confirmed and those it did not
+     *
+     * Channels that are not book channels are reported as failed without being sent.
+     */
+    SubscriptionResult subscribe_book_many(const std::vector<std::string>& channels, BookUpdateCallback callback,
+                                           int shard = AUTO_SHARD, size_t batch_size = DEFAULT_SUBSCRIBE_BATCH);
+    
+    /**
+     * @brief Subscribe to the book channels of every active instrument of a kind
+     * @param currency The currency (e.g., "BTC")
+     * @param type The instrument type
+     * @param interval The book channel interval (e.g., "100ms")
+     * @param callback The callback to call with each decoded message
+     * @param batch_size The maximum channels per request (default: DEFAULT_SUBSCRIBE_BATCH)
+     * @return The channels the server confirmed and those it did not
+     *
+     * Instruments are spread over the workers with AUTO_SHARD.
+     */
+    SubscriptionResult subscribe_universe(const std::string& currency, InstrumentType type,
+                                          const std::string& interval, BookUpdateCallback callback,
+                                          size_t batch_size = DEFAULT_SUBSCRIBE_BATCH);
     
     /**
      * @brief Unsubscribe from a channel
@@ -128,6 +482,17 @@ public:
      */
     bool unsubscribe(const std::string& channel);
     
+    /**
+     * @brief Unsubscribe from many channels
+     * @param channels The channels to unsubscribe from
+     * @param batch_size The maximum channels per request (default: DEFAULT_SUBSCRIBE_BATCH)
+     * @return The channels whose request the server accepted and those it did not
+     *
+     * Callbacks are removed once the requests are sent, as with unsubscribe().
+     */
+    SubscriptionResult unsubscribe_many(const std::vector<std::string>& channels,
+                                        size_t batch_size = DEFAULT_SUBSCRIBE_BATCH);
+    
     /**
      * @brief Get available instruments
      * @param currency The currency (e.g., "BTC")
@@ -148,6 +513,12 @@ public:
      */
     bool is_websocket_connected() const;
     
+    /**
+     * @brief Check if the WebSocket session is authenticated
+     * @return true if private methods can be called over the WebSocket, false otherwise
+     */
+    bool is_websocket_authenticated() const;
+    
     /**
      * @brief Get the API base URL
      * @return The API base URL
@@ -168,30 +539,226 @@ private:
     std::string api_url_;
     std::string websocket_url_;
     
-    // Authentication state
-    ApiCredentials credentials_;
-    std::mutex auth_mutex_;
-    bool authenticated_;
+    // Keep-alive HTTPS connections for REST requests
+    std::unique_ptr<HttpsConnectionPool> http_pool_;
+    
+    // Client-side rate limiting
+    RateLimitConfig rate_limit_config_;
+    std::unique_ptr<RequestScheduler> scheduler_;
+    
+    // Shared I/O context for asynchronous requests
+    boost::asio::io_context io_context_;
+    std::unique_ptr<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> io_work_;
+    std::vector<std::thread> io_threads_;
+    size_t io_thread_count_{4};
+    
+    // Authentication state. Each new token is built in a fresh copy and
+    // published with std::atomic_store, so readers holding the previous one
+    // keep a consistent token without a lock.
+    std::shared_ptr<const ApiCredentials> credentials_{std::make_shared<const ApiCredentials>()};
+    std::mutex auth_mutex_;                             // Serializes token writers
+    std::atomic<bool> authenticated_;
+    
+    // Background token refresh
+    std::thread auth_thread_;
+    std::mutex auth_thread_mutex_;
+    std::condition_variable auth_condition_;
+    std::chrono::seconds token_refresh_margin_{120};
+    std::chrono::system_clock::time_point token_refresh_at_;
     
     // WebSocket client
     std::unique_ptr<WebSocketClient> websocket_client_;
     WebSocketConnectionPtr websocket_connection_;
+    std::mutex websocket_connection_mutex_;             // Guards the handle and session against a reconnect
+    uint64_t websocket_session_{0};                     // Incremented for every connection opened
     std::mutex websocket_mutex_;
-    bool websocket_connected_;
+    std::atomic<bool> websocket_connected_;
+    std::atomic<bool> websocket_authenticated_;
     std::thread websocket_thread_;
-    std::map<std::string, MessageCallback> channel_callbacks_;
     
-    // Message queue for asynchronous processing
-    std::queue<std::pair<std::string, json>> message_queue_;
-    std::mutex queue_mutex_;
-    std::condition_variable queue_condition_;
-    std::thread message_thread_;
-    bool running_;
+    // Session supervision
+    ReconnectConfig reconnect_config_;
+    ConnectionCallback connection_callback_;
+    std::atomic<bool> websocket_wanted_{false};         // Connected by the user and not disconnected since
+    std::atomic<int64_t> last_receive_ns_{0};           // Steady clock nanoseconds of the last frame
+    std::atomic<uint64_t> reconnect_count_{0};
+    std::thread reconnect_thread_;
+    std::mutex reconnect_mutex_;
+    std::condition_variable reconnect_condition_;
+    bool reconnect_pending_{false};
+    
+    // Capture and replay of received frames
+    std::shared_ptr<JournalWriter> capture_journal_;
+    std::atomic<bool> replay_mode_{false};
+    using ReplayMessageManager = websocketpp::config::asio_tls_client::con_msg_manager_type;
+    std::shared_ptr<ReplayMessageManager> replay_message_manager_{std::make_shared<ReplayMessageManager>()};
+    
+    // Latest update of a book channel taken from any feed. The lock is held
+    // from the change_id check until the winner is queued, so updates won on
+    // different feeds reach the worker in order.
+    struct FeedArbiter {
+        std::mutex mutex;
+        int64_t change_id{std::numeric_limits<int64_t>::min()};
+        int64_t accepted_at{0};                         // Steady clock nanoseconds the first copy arrived
+    };
+    
+    // Subscribed channel; exactly one callback is set
+    struct ChannelHandler {
+        MessageCallback message_callback;
+        BookUpdateCallback book_callback;
+        TradesCallback trades_callback;
+        size_t worker{0};
+        std::shared_ptr<FeedArbiter> arbiter;           // Book channels only
+    };
+    
+    // Channel names are interned to small ids that stay fixed for the life of
+    // the client. The table is replaced rather than modified, and readers only
+    // reload it when the version changes, so lookups take no lock.
+    struct ChannelTable {
+        std::unordered_map<std::string_view, uint32_t> ids;
+        std::vector<std::string_view> names;
+        std::vector<std::shared_ptr<const ChannelHandler>> handlers;
+    };
+    std::shared_ptr<const ChannelTable> channel_table_;
+    std::atomic<uint64_t> channel_table_version_{0};
+    std::deque<std::string> channel_names_;            // Append-only storage behind the table's views
+    std::mutex channel_table_mutex_;
+    std::shared_ptr<const ChannelTable> websocket_channel_table_;   // WebSocket thread's copy
+    uint64_t websocket_channel_table_version_{0};
+    
+    // Redundant market data sessions. feeds_[0] stands for the primary
+    // session and has no client of its own; feeds are only added before
+    // connecting, so the vector is read without a lock.
+    struct MarketDataFeed {
+        size_t index{0};
+        std::string url;
+        std::unique_ptr<WebSocketClient> client;
+        WebSocketConnectionPtr connection;
+        std::thread thread;
+        std::mutex mutex;                               // Serializes opening and closing
+        std::mutex send_mutex;                          // Guards the connection handle
+        std::atomic<bool> connected{false};
+        std::shared_ptr<const ChannelTable> channel_table;  // Receive thread's copy
+        uint64_t channel_table_version{0};
+        std::atomic<uint64_t> wins{0};
+        std::atomic<uint64_t> duplicates{0};
+        std::shared_ptr<Counter> wins_counter;
+        std::shared_ptr<Counter> duplicates_counter;
+        std::shared_ptr<Counter> win_ratio_counter;
+        std::shared_ptr<LatencyTracker> lag_tracker;
+    };
+    std::vector<std::unique_ptr<MarketDataFeed>> feeds_;
+    
+    // WebSocket connection state used to wait for the handshake
+    std::mutex websocket_state_mutex_;
+    std::condition_variable websocket_state_condition_;
+    bool websocket_open_;
+    bool websocket_failed_;
+    
+    // JSON-RPC requests awaiting a reply, keyed by request ID
+    struct PendingRequest {
+        std::string method;
+        ResponseCallback callback;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    std::unordered_map<uint64_t, PendingRequest> pending_requests_;
+    std::mutex pending_mutex_;
+    std::atomic<uint64_t> next_request_id_{1};
+    std::chrono::milliseconds request_timeout_{5000};
+    std::thread timeout_thread_;
+    std::condition_variable timeout_condition_;
+    
+    // Subscription message waiting for a worker; typed channels keep the raw
+    // payload and are decoded there, others carry the parsed data
+    struct QueuedMessage {
+        uint32_t channel_id{0};
+        json data;
+        WebSocketClient::message_ptr payload;
+        size_t data_offset{0};
+        int64_t enqueued_at{0};                         // Steady clock nanoseconds
+        int64_t received_at{0};                         // Steady clock nanoseconds at socket receive
+        int64_t received_wall_ns{0};                    // System clock at socket receive, for tracing
+    };
+    
+    // A thread running the callbacks of its share of the channels
+    struct MessageWorker {
+        size_t index{0};
+        std::unique_ptr<MpscRingBuffer<QueuedMessage>> queue;
+        std::unique_ptr<QueueWaiter> waiter;
+        std::thread thread;
+        std::shared_ptr<Counter> depth_counter;
+        std::shared_ptr<Counter> max_depth_counter;
+        std::shared_ptr<LatencyTracker> residency_tracker;
+        std::shared_ptr<LatencyTracker> processing_tracker;
+        std::atomic<uint64_t> accepted{0};      // Messages pushed onto the queue
+        std::atomic<uint64_t> processed{0};     // Messages the worker finished with
+        
+        // Decode targets reused for every message
+        BookUpdate book_update;
+        std::vector<TradeUpdate> trade_updates;
+    };
+    
+    // Message workers for asynchronous processing
+    MessageQueueConfig message_queue_config_;
+    std::vector<std::unique_ptr<MessageWorker>> workers_;
+    std::shared_ptr<Counter> queue_overflow_counter_;
+    std::atomic<bool> running_;
     
     // Helper methods
     bool refresh_token();
+    bool request_token(const json& params);
+    void store_credentials(const json& result);
+    std::shared_ptr<const ApiCredentials> current_credentials() const;
+    void process_token_refresh();
+    bool acquire_request_slot(const std::string& method);
+    ApiResponse send_public_request(const std::string& method, const json& params);
+    ApiResponse send_private_request(const std::string& method, const json& params);
+    bool send_websocket_request(uint64_t id, uint64_t session, const std::string& method, const json& params,
+                                ResponseCallback callback, std::chrono::milliseconds timeout);
+    bool open_websocket();
+    void handle_connection_lost();
+    void process_reconnects();
+    void resubscribe_all();
+    void handle_heartbeat(const json& params);
+    bool open_feed(MarketDataFeed& feed);
+    void close_feed(MarketDataFeed& feed);
+    void handle_feed_lost(MarketDataFeed& feed);
+    void reopen_feeds();
+    bool any_feed_connected() const;
+    void reset_feed_arbiters();
+    void send_feed_channels(const std::string& method, const std::vector<std::string>& channels);
+    void send_feed_channels(MarketDataFeed& feed, const std::string& method, const std::vector<std::string>& channels);
     void websocket_message_handler(websocketpp::connection_hdl hdl, WebSocketClient::message_ptr msg);
-    void process_message_queue();
+    void feed_message_handler(MarketDataFeed& feed, WebSocketClient::message_ptr msg);
+    void route_message(const WebSocketClient::message_ptr& msg, int64_t received_at, int64_t received_wall_ns,
+                       size_t feed = 0);
+    void process_message_queue(MessageWorker& worker);
+    void dispatch_message(MessageWorker& worker, const ChannelHandler& handler, std::string_view channel,
+                          const QueuedMessage& message);
+    bool add_subscription(const std::string& channel, ChannelHandler handler, int shard);
+    SubscriptionResult add_subscriptions(const std::vector<std::string>& channels, const ChannelHandler& handler,
+                                         int shard, size_t batch_size);
+    std::vector<std::future<ApiResponse>> send_channel_batches(const std::string& method,
+                                                               const std::vector<std::string>& channels,
+                                                               size_t batch_size);
+    SubscriptionResult collect_channel_batches(const std::vector<std::string>& channels, size_t batch_size,
+                                               std::vector<std::future<ApiResponse>>& replies,
+                                               bool listed_only);
+    void set_channel_handler(const std::string& channel, std::shared_ptr<const ChannelHandler> handler);
+    void set_channel_handlers(const std::vector<std::string>& channels,
+                              const std::vector<std::shared_ptr<const ChannelHandler>>& handlers);
+    const ChannelTable& load_channel_table(std::shared_ptr<const ChannelTable>& cache, uint64_t& version) const;
+    bool enqueue_message(const ChannelHandler& handler, uint32_t channel_id, json data,
+                         WebSocketClient::message_ptr payload, size_t data_offset,
+                         int64_t received_at, int64_t received_wall_ns);
+    bool enqueue_arbitrated(size_t feed, int64_t change_id, const ChannelHandler& handler, uint32_t channel_id,
+                            json data, WebSocketClient::message_ptr payload, size_t data_offset,
+                            int64_t received_at, int64_t received_wall_ns);
+    void pin_worker(MessageWorker& worker);
+    void process_request_timeouts();
+    void complete_request(uint64_t id, const json& message);
+    void fail_pending_requests(const std::string& error_message);
+    ApiResponse parse_response(const json& response_json) const;
     std::string create_signature(const std::string& method, const std::string& path, const std::string& nonce, const std::string& data);
     std::string instrument_type_to_string(InstrumentType type);
 };
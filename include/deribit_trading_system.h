@@ -2,6 +2,7 @@
 #define DERIBIT_TRADING_SYSTEM_H
 
 #include <string>
+#include <vector>
 #include <memory>
 #include <thread>
 #include <atomic>
@@ -10,8 +11,13 @@
 #include <nlohmann/json.hpp>
 #include "deribit_api_client.h"
 #include "order_manager.h"
+#include "order_book_engine.h"
+#include "instrument_registry.h"
+#include "market_data_journal.h"
+#include "risk_gate.h"
 #include "websocket_server.h"
 #include "performance_monitor.h"
+#include "object_pool.h"
 
 namespace deribit {
 
@@ -40,6 +46,62 @@ public:
      */
     ~TradingSystem();
     
+    /**
+     * @brief Set the number of threads serving WebSocket clients
+     * @param threads The number of threads; 0 runs the server on the API client's I/O pool (default: 4)
+     *
+     * Must be called before initialize(). A shared pool also runs asynchronous
+     * REST requests, which occupy a thread while they are in flight.
+     */
+    void set_websocket_server_threads(size_t threads);
+    
+    /**
+     * @brief Configure the API client's subscription callback workers
+     * @param config The worker and queue configuration
+     *
+     * Must be called before initialize(). With several workers, books of
+     * different instruments are updated in parallel.
+     */
+    void set_message_queue_config(const MessageQueueConfig& config);
+    
+    /**
+     * @brief Configure the API client's rate limiter
+     * @param config The credit pools and queue limit
+     *
+     * Must be called before initialize(). Set config.enabled to false to send
+     * requests as soon as they are made.
+     */
+    void set_rate_limit_config(const RateLimitConfig& config);
+    
+    /**
+     * @brief Receive book updates over redundant sessions
+     * @param urls WebSocket URLs of the extra sessions, e.g. other Deribit edge endpoints
+     *
+     * Must be called before initialize(). Each update is taken from whichever
+     * session delivers it first, see ApiClient::add_market_data_feed().
+     */
+    void set_market_data_feeds(const std::vector<std::string>& urls);
+    
+    /**
+     * @brief Capture all market data frames to a journal
+     * @param path The journal file; an existing journal is appended to
+     * @param config The journal settings (default: JournalConfig())
+     *
+     * Must be called before initialize().
+     */
+    void set_capture_file(const std::string& path, const JournalConfig& config = JournalConfig());
+    
+    /**
+     * @brief Run from a journal instead of the exchange
+     * @param enabled Whether replay mode is on
+     *
+     * Must be called before initialize(). The system neither authenticates nor
+     * connects; subscriptions only register their callbacks, and replay()
+     * feeds the journal through the same path live frames take. Book resync
+     * snapshots are still fetched over REST, and private requests fail.
+     */
+    void set_replay_mode(bool enabled);
+    
     /**
      * @brief Initialize the trading system
      * @return true if initialization successful, false otherwise
@@ -81,6 +143,46 @@ public:
      */
     std::shared_ptr<WebSocketServer> get_websocket_server() const;
     
+    /**
+     * @brief Get the order book engine
+     * @return Shared pointer to the order book engine
+     */
+    std::shared_ptr<OrderBookEngine> get_book_engine() const;
+    
+    /**
+     * @brief Get the instrument registry
+     * @return Shared pointer to the instrument registry
+     */
+    std::shared_ptr<InstrumentRegistry> get_instrument_registry() const;
+    
+    /**
+     * @brief Get the pre-trade risk gate
+     * @return Shared pointer to the risk gate, to configure its limits
+     */
+    std::shared_ptr<RiskGate> get_risk_gate() const;
+    
+    /**
+     * @brief Load instrument metadata into the registry
+     * @param currency The currency (e.g., "BTC")
+     * @param type The instrument type
+     * @param cache_file A cache file to read instead of the API if present, and to write otherwise (default: none)
+     * @return true if instruments were loaded, false otherwise
+     *
+     * When the system is running the registry also follows the instrument.state channel.
+     */
+    bool load_instruments(const std::string& currency, InstrumentType type, const std::string& cache_file = "");
+    
+    /**
+     * @brief Feed a journal through the market data pipeline
+     * @param path The journal file
+     * @param speed 0 for as fast as possible, 1 for the original pacing, N for N times faster (default: 0)
+     * @return The number of frames replayed
+     *
+     * Requires replay mode and a started system. Returns once every frame has
+     * been handled by the subscription callbacks.
+     */
+    size_t replay(const std::string& path, double speed = 0.0);
+    
     /**
      * @brief Wait for the system to stop
      */
@@ -89,9 +191,25 @@ public:
     /**
      * @brief Subscribe to market data for an instrument
      * @param instrument_name The name of the instrument
+     * @param shard The worker processing the updates, or ApiClient::AUTO_SHARD (default: ApiClient::AUTO_SHARD)
      * @return true if subscription successful, false otherwise
      */
-    bool subscribe_market_data(const std::string& instrument_name);
+    bool subscribe_market_data(const std::string& instrument_name, int shard = ApiClient::AUTO_SHARD);
+    
+    /**
+     * @brief Subscribe to market data for many instruments in batched requests
+     * @param instrument_names The names of the instruments
+     * @return The book channels the server confirmed and those it did not
+     */
+    SubscriptionResult subscribe_market_data_many(const std::vector<std::string>& instrument_names);
+    
+    /**
+     * @brief Subscribe to market data for every active instrument of a kind
+     * @param currency The currency (e.g., "BTC")
+     * @param type The instrument type
+     * @return The book channels the server confirmed and those it did not
+     */
+    SubscriptionResult subscribe_market_data_universe(const std::string& currency, InstrumentType type);
     
     /**
      * @brief Unsubscribe from market data for an instrument
@@ -123,17 +241,35 @@ private:
     std::string api_secret_;
     bool test_mode_;
     uint16_t websocket_port_;
+    size_t websocket_server_threads_{4};
+    MessageQueueConfig message_queue_config_;
+    RateLimitConfig rate_limit_config_;
+    std::vector<std::string> market_data_feeds_;
+    std::string capture_file_;
+    JournalConfig capture_config_;
+    bool replay_mode_{false};
     
     std::shared_ptr<ApiClient> api_client_;
     std::shared_ptr<OrderManager> order_manager_;
     std::shared_ptr<WebSocketServer> websocket_server_;
+    std::shared_ptr<OrderBookEngine> book_engine_;
+    std::shared_ptr<InstrumentRegistry> instrument_registry_;
+    std::shared_ptr<RiskGate> risk_gate_;
+    std::shared_ptr<JournalWriter> capture_journal_;
+    
+    // Levels per side published to WebSocket clients
+    size_t publish_depth_{20};
+    
+    // Books being published, one per worker at a time; reused so publishing does not allocate
+    std::unique_ptr<ObjectPool<OrderBook>> orderbook_pool_;
     
     std::atomic<bool> running_{false};
     std::mutex wait_mutex_;
     std::condition_variable wait_condition_;
     
     // Market data handling
-    void handle_orderbook_update(const json& update);
+    void handle_orderbook_update(const BookUpdate& update);
+    void publish_book(const L2Book& book);
     void handle_trade_update(const json& update);
     void handle_instrument_update(const json& update);
     
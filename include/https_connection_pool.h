@@ -0,0 +1,130 @@
+#ifndef HTTPS_CONNECTION_POOL_H
+#define HTTPS_CONNECTION_POOL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+
+typedef struct ssl_session_st SSL_SESSION;
+
+namespace deribit {
+
+/**
+ * @struct ConnectionPoolConfig
+ * @brief Configuration for the keep-alive HTTPS connection pool
+ */
+struct ConnectionPoolConfig {
+    size_t pool_size{4};                                     // Maximum number of idle connections kept open
+    size_t min_idle_connections{1};                          // Connections kept warm by the maintenance thread
+    std::chrono::milliseconds idle_timeout{30000};           // Idle connections older than this are closed
+    std::chrono::milliseconds resolve_ttl{300000};           // How long resolver results are reused
+    std::chrono::milliseconds maintenance_interval{1000};    // Period of the background maintenance pass
+};
+
+/**
+ * @class HttpsConnectionPool
+ * @brief Pool of persistent HTTP/1.1 keep-alive TLS connections to a single host
+ *
+ * Connections are reused across requests, TLS sessions are resumed when a new
+ * connection has to be opened and resolver results are cached. A background
+ * thread evicts idle connections and keeps a few connections warm so that
+ * requests rarely pay for a TCP connect or TLS handshake.
+ */
+class HttpsConnectionPool {
+public:
+    /**
+     * @brief Constructor
+     * @param host The host to connect to
+     * @param port The port to connect to (default: "443")
+     * @param config The pool configuration
+     */
+    HttpsConnectionPool(const std::string& host,
+                        const std::string& port = "443",
+                        const ConnectionPoolConfig& config = ConnectionPoolConfig());
+
+    /**
+     * @brief Destructor
+     */
+    ~HttpsConnectionPool();
+
+    /**
+     * @brief Start the background maintenance thread
+     */
+    void start();
+
+    /**
+     * @brief Stop the background maintenance thread and close all idle connections
+     */
+    void stop();
+
+    /**
+     * @brief Send an HTTP POST request over a pooled connection
+     * @param target The request target (e.g., "/api/v2/public/get_time")
+     * @param body The JSON request body
+     * @return The response body
+     * @throws std::exception if the request fails
+     */
+    std::string post(const std::string& target, const std::string& body);
+
+    /**
+     * @brief Get the number of idle connections currently in the pool
+     * @return The number of idle connections
+     */
+    size_t idle_count() const;
+
+    /**
+     * @brief Get the pool configuration
+     * @return The pool configuration
+     */
+    const ConnectionPoolConfig& config() const;
+
+private:
+    struct Connection;
+    using Clock = std::chrono::steady_clock;
+
+    std::string host_;
+    std::string port_;
+    ConnectionPoolConfig config_;
+
+    boost::asio::io_context io_context_;
+    boost::asio::ssl::context ssl_context_;
+
+    // Idle keep-alive connections, most recently used at the back
+    std::vector<std::unique_ptr<Connection>> idle_connections_;
+    mutable std::mutex pool_mutex_;
+
+    // Cached resolver results
+    boost::asio::ip::tcp::resolver::results_type endpoints_;
+    Clock::time_point resolved_at_;
+    std::mutex resolver_mutex_;
+
+    // Last TLS session, used to resume handshakes on new connections
+    SSL_SESSION* tls_session_{nullptr};
+    std::mutex session_mutex_;
+
+    // Background maintenance
+    std::thread maintenance_thread_;
+    std::mutex maintenance_mutex_;
+    std::condition_variable maintenance_condition_;
+    std::atomic<bool> running_{false};
+
+    // Helper methods
+    std::unique_ptr<Connection> acquire();
+    void release(std::unique_ptr<Connection> connection);
+    std::unique_ptr<Connection> open_connection();
+    boost::asio::ip::tcp::resolver::results_type resolve(bool force);
+    void store_session(Connection& connection);
+    void maintenance_loop();
+};
+
+} // namespace deribit
+
+#endif // HTTPS_CONNECTION_POOL_H
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef INSTRUMENT_ID_H
+#define INSTRUMENT_ID_H
+
+#include <cstdint>
+#include <limits>
+
+namespace deribit {
+
+// Dense index of an instrument in an InstrumentRegistry
+using InstrumentId = uint32_t;
+constexpr InstrumentId INVALID_INSTRUMENT_ID = std::numeric_limits<InstrumentId>::max();
+
+} // namespace deribit
+
+#endif // INSTRUMENT_ID_H
\ No newline at end of file
@@ -0,0 +1,197 @@
+#ifndef INSTRUMENT_REGISTRY_H
+#define INSTRUMENT_REGISTRY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "deribit_api_client.h"
+#include "instrument_id.h"
+
+namespace deribit {
+
+using json = nlohmann::json;
+
+/**
+ * @struct InstrumentInfo
+ * @brief Static metadata of an instrument
+ */
+struct InstrumentInfo {
+    InstrumentId id{INVALID_INSTRUMENT_ID};
+    std::string instrument_name;
+    std::string currency;                 // Base currency, e.g. "BTC"
+    std::string settlement_currency;      // e.g. "USDC" for BTC_USDC-PERPETUAL; the base currency if not given
+    InstrumentType kind{InstrumentType::FUTURES};
+    double tick_size{0.0};
+    double min_trade_amount{0.0};
+    double contract_size{0.0};
+    int64_t expiration_timestamp{0};      // Milliseconds since epoch
+    double strike{0.0};                   // Options only
+    std::string option_type;              // "call" or "put" for options, empty otherwise
+    bool active{true};
+
+    /**
+     * @brief Round a price to the nearest tick
+     * @param price The price
+     * @return The rounded price, or price itself if the tick size is unknown
+     */
+    double round_price(double price) const;
+
+    /**
+     * @brief Check if a price lies on the tick grid
+     * @param price The price
+     * @return true if price is a multiple of the tick size or the tick size is unknown
+     */
+    bool is_valid_price(double price) const;
+};
+
+/**
+ * @struct InstrumentFilter
+ * @brief Criteria for InstrumentRegistry::find; unset fields match everything
+ */
+struct InstrumentFilter {
+    std::string currency;
+    bool match_kind{false};
+    InstrumentType kind{InstrumentType::FUTURES};
+    int64_t expiration_timestamp{0};
+    double strike{0.0};
+    bool active_only{true};
+};
+
+/**
+ * @class InstrumentRegistry
+ * @brief Instrument metadata loaded once and indexed by name and dense id
+ *
+ * Ids are assigned in load order and never reused, so they can index flat
+ * arrays elsewhere. Entries are immutable; an update replaces the entry, so
+ * pointers handed out stay valid. Instruments that expire or are closed are
+ * marked inactive rather than removed. The registry must be owned by a
+ * std::shared_ptr for subscribe_updates(), so that late callbacks can detect
+ * when it has been destroyed.
+ */
+class InstrumentRegistry : public std::enable_shared_from_this<InstrumentRegistry> {
+public:
+    using InstrumentPtr = std::shared_ptr<const InstrumentInfo>;
+
+    /**
+     * @brief Constructor
+     * @param api_client Pointer to an initialized ApiClient, or nullptr for cache files only
+     */
+    explicit InstrumentRegistry(std::shared_ptr<ApiClient> api_client = nullptr);
+
+    /**
+     * @brief Load the active instruments of a kind with public/get_instruments
+     * @param currency The currency (e.g., "BTC")
+     * @param type The instrument type
+     * @return The number of instruments loaded, or 0 on error
+     */
+    size_t load(const std::string& currency, InstrumentType type);
+
+    /**
+     * @brief Load instruments from a cache file written by save_to_file()
+     * @param filename The path of the cache file
+     * @return true if the file was read, false otherwise
+     */
+    bool load_from_file(const std::string& filename);
+
+    /**
+     * @brief Write all instruments to a cache file
+     * @param filename The path of the cache file
+     * @return true if the file was written, false otherwise
+     */
+    bool save_to_file(const std::string& filename) const;
+
+    /**
+     * @brief Keep the registry current through the instrument.state channel
+     * @param currency The currency (e.g., "BTC")
+     * @param type The instrument type
+     * @return true if subscription successful, false otherwise
+     *
+     * New instruments are fetched with public/get_instrument when they are created.
+     */
+    bool subscribe_updates(const std::string& currency, InstrumentType type);
+
+    /**
+     * @brief Add or replace an instrument
+     * @param instrument An instrument object as returned by public/get_instruments
+     * @return The id of the instrument, or INVALID_INSTRUMENT_ID if the object is malformed
+     */
+    InstrumentId upsert(const json& instrument);
+
+    /**
+     * @brief Apply an instrument.state notification
+     * @param update The notification data
+     */
+    void handle_state_update(const json& update);
+
+    /**
+     * @brief Look up the id of an instrument
+     * @param instrument_name The name of the instrument
+     * @return The id, or INVALID_INSTRUMENT_ID if unknown
+     */
+    InstrumentId find_id(std::string_view instrument_name) const;
+
+    /**
+     * @brief Look up an instrument by id
+     * @param id The instrument id
+     * @return The instrument, or nullptr if unknown
+     */
+    InstrumentPtr get(InstrumentId id) const;
+
+    /**
+     * @brief Look up an instrument by name
+     * @param instrument_name The name of the instrument
+     * @return The instrument, or nullptr if unknown
+     */
+    InstrumentPtr get(std::string_view instrument_name) const;
+
+    /**
+     * @brief Find instruments matching a filter
+     * @param filter The criteria
+     * @return The matching instruments ordered by expiration, then strike, then name
+     */
+    std::vector<InstrumentPtr> find(const InstrumentFilter& filter) const;
+
+    /**
+     * @brief Get the expirations of a currency's instruments
+     * @param currency The currency
+     * @param type The instrument type
+     * @return The distinct expiration timestamps of active instruments, ascending
+     */
+    std::vector<int64_t> expirations(const std::string& currency, InstrumentType type) const;
+
+    /**
+     * @brief Get the number of instruments
+     * @return The number of instruments, active or not
+     */
+    size_t size() const;
+
+    /**
+     * @brief Convert a Deribit kind string
+     * @param kind The kind, e.g. "future" or "option_combo"
+     * @param type Receives the instrument type
+     * @return true if the kind is known, false otherwise
+     */
+    static bool parse_kind(std::string_view kind, InstrumentType& type);
+
+private:
+    std::shared_ptr<ApiClient> api_client_;
+
+    std::vector<InstrumentPtr> instruments_;                          // Indexed by id
+    std::map<std::string, InstrumentId, std::less<>> ids_;
+    std::map<std::string, std::vector<InstrumentId>, std::less<>> by_currency_;
+    std::vector<json> sources_;                                       // Raw objects, for the cache file
+    mutable std::mutex mutex_;
+
+    void set_active(std::string_view instrument_name, bool active);
+    void fetch_instrument(const std::string& instrument_name);
+};
+
+} // namespace deribit
+
+#endif // INSTRUMENT_REGISTRY_H
\ No newline at end of file
@@ -0,0 +1,208 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace deribit {
+
+/**
+ * @struct HistogramConfig
+ * @brief Precision and window settings for latency histograms
+ */
+struct HistogramConfig {
+    int significant_bits{7};                            // Sub-buckets per power of two; relative error is 2^-(bits-1)
+    int64_t max_value_ns{60000000000};                  // Larger values are clamped to this
+    std::chrono::milliseconds window_interval{10000};   // Length of one rolling window interval
+    size_t window_intervals{6};                         // Intervals making up the rolling window
+};
+
+/**
+ * @class HistogramSnapshot
+ * @brief Point-in-time copy of a histogram that can be merged and queried
+ */
+class HistogramSnapshot {
+public:
+    /**
+     * @brief Constructor for an empty snapshot
+     * @param significant_bits The precision of the histogram (default: 0, adopts the first merged snapshot)
+     */
+    explicit HistogramSnapshot(int significant_bits = 0);
+
+    /**
+     * @brief Add the counts of another snapshot
+     * @param other The snapshot to merge
+     * @throws std::invalid_argument if the precisions differ
+     */
+    void merge(const HistogramSnapshot& other);
+
+    /**
+     * @brief Get the number of recorded values
+     * @return The number of values
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief Get the smallest recorded value
+     * @return The minimum in nanoseconds, 0 if empty
+     */
+    int64_t min() const;
+
+    /**
+     * @brief Get the largest recorded value
+     * @return The maximum in nanoseconds, 0 if empty
+     */
+    int64_t max() const;
+
+    /**
+     * @brief Get the mean of the recorded values
+     * @return The mean in nanoseconds, 0 if empty
+     */
+    double mean() const;
+
+    /**
+     * @brief Get the value at a percentile
+     * @param percentile The percentile (0-100)
+     * @return The highest value equivalent to the percentile's bucket, in nanoseconds
+     */
+    int64_t percentile(double percentile) const;
+
+private:
+    friend class LatencyHistogram;
+
+    int significant_bits_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_{0};
+    int64_t sum_{0};
+    int64_t min_{INT64_MAX};
+    int64_t max_{0};
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-memory log-linear histogram with atomic O(1) recording
+ *
+ * Values below 2^significant_bits get one bucket each; every higher power of
+ * two is split into 2^(significant_bits-1) equal buckets, so the relative
+ * error stays constant across the range.
+ */
+class LatencyHistogram {
+public:
+    /**
+     * @brief Constructor
+     * @param significant_bits The sub-bucket resolution (default: 7, about 1.6% error)
+     * @param max_value_ns The largest trackable value (default: 60s)
+     */
+    explicit LatencyHistogram(int significant_bits = 7, int64_t max_value_ns = 60000000000);
+
+    /**
+     * @brief Record a value
+     * @param value_ns The value in nanoseconds; negative values count as 0
+     */
+    void record(int64_t value_ns);
+
+    /**
+     * @brief Take a snapshot of the current counts
+     * @return The snapshot
+     */
+    HistogramSnapshot snapshot() const;
+
+    /**
+     * @brief Add the current counts to a snapshot
+     * @param snapshot The snapshot to add to
+     */
+    void add_to(HistogramSnapshot& snapshot) const;
+
+    /**
+     * @brief Clear all counts
+     */
+    void reset();
+
+    /**
+     * @brief Get the bucket index of a value
+     * @param value The value
+     * @param significant_bits The sub-bucket resolution
+     * @return The bucket index
+     */
+    static size_t bucket_index(int64_t value, int significant_bits);
+
+    /**
+     * @brief Get the largest value that falls in a bucket
+     * @param index The bucket index
+     * @param significant_bits The sub-bucket resolution
+     * @return The highest equivalent value
+     */
+    static int64_t bucket_upper_bound(size_t index, int significant_bits);
+
+private:
+    int significant_bits_;
+    int64_t max_value_;
+    size_t bucket_count_;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+    std::atomic<uint64_t> total_count_{0};
+    std::atomic<int64_t> sum_{0};
+    std::atomic<int64_t> min_{INT64_MAX};
+    std::atomic<int64_t> max_{0};
+};
+
+/**
+ * @class RollingHistogram
+ * @brief Histogram over the most recent window, built from a ring of intervals
+ *
+ * The first recorder in a new interval recycles the oldest slot. Values
+ * recorded concurrently with that reset may be lost, so window counts are
+ * approximate at interval boundaries.
+ */
+class RollingHistogram {
+public:
+    /**
+     * @brief Constructor
+     * @param config The histogram configuration
+     */
+    explicit RollingHistogram(const HistogramConfig& config = HistogramConfig());
+
+    /**
+     * @brief Record a value
+     * @param value_ns The value in nanoseconds
+     * @param now_ns The current steady clock time in nanoseconds
+     */
+    void record(int64_t value_ns, int64_t now_ns);
+
+    /**
+     * @brief Merge the intervals inside the window
+     * @param now_ns The current steady clock time in nanoseconds
+     * @return The snapshot of the window
+     */
+    HistogramSnapshot snapshot(int64_t now_ns) const;
+
+    /**
+     * @brief Get the length of the window
+     * @return The window length
+     */
+    std::chrono::nanoseconds window() const;
+
+    /**
+     * @brief Clear all intervals
+     */
+    void reset();
+
+private:
+    struct Interval {
+        Interval(int significant_bits, int64_t max_value_ns)
+            : histogram(significant_bits, max_value_ns) {}
+
+        std::atomic<int64_t> epoch{-1};
+        LatencyHistogram histogram;
+    };
+
+    int significant_bits_;
+    int64_t interval_ns_;
+    std::vector<std::unique_ptr<Interval>> intervals_;
+};
+
+} // namespace deribit
+
+#endif // LATENCY_HISTOGRAM_H
\ No newline at end of file
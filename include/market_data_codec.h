@@ -0,0 +1,195 @@
+#ifndef MARKET_DATA_CODEC_H
+#define MARKET_DATA_CODEC_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace deribit {
+
+using json = nlohmann::json;
+
+/**
+ * @enum BookAction
+ * @brief Action carried by one level of a book.* message
+ */
+enum class BookAction {
+    NEW,
+    CHANGE,
+    DELETE
+};
+
+/**
+ * @struct BookLevelUpdate
+ * @brief One level of a book.* message
+ */
+struct BookLevelUpdate {
+    BookAction action;
+    double price;
+    double amount;
+};
+
+/**
+ * @struct BookUpdate
+ * @brief Decoded book.* notification data
+ *
+ * Reuse one instance per thread: clear() keeps the capacity of the level
+ * vectors, so steady-state decoding does not allocate. instrument_name points
+ * into the buffer the message was decoded from.
+ */
+struct BookUpdate {
+    std::string_view instrument_name;
+    bool snapshot{false};               // Full book rather than a delta
+    int64_t timestamp{0};
+    int64_t change_id{0};
+    int64_t prev_change_id{0};
+    std::vector<BookLevelUpdate> bids;
+    std::vector<BookLevelUpdate> asks;
+
+    void clear() {
+        instrument_name = std::string_view();
+        snapshot = false;
+        timestamp = 0;
+        change_id = 0;
+        prev_change_id = 0;
+        bids.clear();
+        asks.clear();
+    }
+};
+
+/**
+ * @struct TradeUpdate
+ * @brief One trade of a trades.* notification
+ *
+ * The string views point into the buffer the message was decoded from.
+ */
+struct TradeUpdate {
+    std::string_view instrument_name;
+    std::string_view trade_id;
+    std::string_view direction;
+    int64_t trade_seq{0};
+    int64_t timestamp{0};
+    double price{0.0};
+    double amount{0.0};
+    double mark_price{0.0};
+    double index_price{0.0};
+};
+
+/**
+ * @struct MessageEnvelope
+ * @brief Routing fields of a subscription notification
+ */
+struct MessageEnvelope {
+    std::string_view channel;
+    size_t data_offset{0};              // Offset of params.data in the payload
+};
+
+/**
+ * @class MarketDataDecoder
+ * @brief Decodes market data notifications straight from the payload, without a json DOM
+ *
+ * Only what the typed structs need is read; other fields are skipped. Strings
+ * containing escape sequences are rejected, so callers fall back to the
+ * generic json path for them.
+ */
+class MarketDataDecoder {
+public:
+    /**
+     * @brief Find the channel and data of a subscription notification
+     * @param payload The raw message
+     * @param envelope Filled with the channel and the offset of the data
+     * @return true for a subscription notification, false for anything else
+     *
+     * Scanning stops at the data when method and channel precede it, as they
+     * do in Deribit notifications, so the data is not read twice.
+     */
+    static bool parse_envelope(std::string_view payload, MessageEnvelope& envelope);
+
+    /**
+     * @brief Decode book.* notification data
+     * @param data The payload starting at the data object
+     * @param update The update to fill
+     * @return true if decoding succeeded, false otherwise
+     */
+    static bool decode_book(std::string_view data, BookUpdate& update);
+
+    /**
+     * @brief Decode book.* notification data from a json value
+     * @param data The data object
+     * @param update The update to fill; instrument_name points into data
+     * @return true if decoding succeeded, false otherwise
+     */
+    static bool decode_book_json(const json& data, BookUpdate& update);
+
+    /**
+     * @brief Decode trades.* notification data
+     * @param data The payload starting at the data array
+     * @param trades The trades to fill, cleared first
+     * @return true if decoding succeeded, false otherwise
+     */
+    static bool decode_trades(std::string_view data, std::vector<TradeUpdate>& trades);
+
+    /**
+     * @brief Decode trades.* notification data from a json value
+     * @param data The data array
+     * @param trades The trades to fill, cleared first; string views point into data
+     * @return true if decoding succeeded, false otherwise
+     */
+    static bool decode_trades_json(const json& data, std::vector<TradeUpdate>& trades);
+
+    /**
+     * @brief Check if a channel carries book.* messages
+     * @param channel The channel name
+     * @return true for book channels
+     */
+    static bool is_book_channel(std::string_view channel);
+
+    /**
+     * @brief Check if a channel carries trades.* messages
+     * @param channel The channel name
+     * @return true for trades channels
+     */
+    static bool is_trades_channel(std::string_view channel);
+};
+
+/**
+ * @brief Append an orderbook message for WebSocket clients
+ * @param out The string to append to
+ * @param instrument_name The name of the instrument
+ * @param timestamp The orderbook timestamp
+ * @param bids The bids as (price, size) pairs
+ * @param asks The asks as (price, size) pairs
+ *
+ * Produces the document json::dump() gives for the same fields, keys in the
+ * same order and numbers in shortest round-trip form.
+ */
+void write_orderbook_message(std::string& out,
+                             std::string_view instrument_name,
+                             std::string_view timestamp,
+                             const std::vector<std::pair<double, double>>& bids,
+                             const std::vector<std::pair<double, double>>& asks);
+
+/**
+ * @brief Append a top-of-book message for WebSocket clients
+ * @param out The string to append to
+ * @param instrument_name The name of the instrument
+ * @param timestamp The orderbook timestamp
+ * @param best_bid The best (price, size) bid, or nullptr if there is none
+ * @param best_ask The best (price, size) ask, or nullptr if there is none
+ *
+ * Produces {"type":"ticker",...} with best_bid_price, best_bid_amount,
+ * best_ask_price and best_ask_amount, as json::dump() writes them; a missing
+ * side is null.
+ */
+void write_ticker_message(std::string& out,
+                          std::string_view instrument_name,
+                          std::string_view timestamp,
+                          const std::pair<double, double>* best_bid,
+                          const std::pair<double, double>* best_ask);
+
+} // namespace deribit
+
+#endif // MARKET_DATA_CODEC_H
\ No newline at end of file
@@ -0,0 +1,210 @@
+#ifndef MARKET_DATA_JOURNAL_H
+#define MARKET_DATA_JOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "ring_buffer.h"
+#include "performance_monitor.h"
+
+namespace deribit {
+
+/**
+ * @struct JournalConfig
+ * @brief Settings for a capture journal
+ */
+struct JournalConfig {
+    size_t queue_capacity{65536};                   // Frames waiting for the flusher; later ones are dropped
+    size_t grow_bytes{64 * 1024 * 1024};            // File growth per remap
+    std::chrono::milliseconds sync_interval{1000};  // Period of asynchronous msync of written pages
+};
+
+/**
+ * @struct JournalRecord
+ * @brief One captured frame as read back from a journal
+ */
+struct JournalRecord {
+    int64_t received_wall_ns{0};    // System clock at socket receive
+    std::string_view payload;       // Points into the reader's mapping
+};
+
+/**
+ * @class JournalWriter
+ * @brief Append-only, memory-mapped binary journal of raw WebSocket frames
+ *
+ * The file starts with a 32-byte header: the magic "DRBJRNL1", a uint32
+ * version, a uint32 header size and the int64 creation time. Each record is a
+ * uint32 payload length, a uint32 reserved word and the int64 receive time,
+ * followed by the payload padded to 8 bytes. The file grows in zero-filled
+ * steps, so a length of 0 marks the end; the tail is trimmed on close.
+ *
+ * append() only queues a reference to the frame; a background flusher copies
+ * it into the mapping. When the queue is full the frame is dropped and
+ * counted in journal_dropped rather than delaying the caller.
+ */
+class JournalWriter {
+public:
+    // Size of the file header
+    static constexpr size_t HEADER_SIZE = 32;
+
+    /**
+     * @brief Constructor
+     * @param config The queue and file growth settings
+     */
+    explicit JournalWriter(const JournalConfig& config = JournalConfig());
+
+    /**
+     * @brief Destructor
+     */
+    ~JournalWriter();
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    /**
+     * @brief Open a journal and start the flusher
+     * @param path The file; an existing journal is appended to
+     * @return true if the journal is ready, false otherwise
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Write everything queued, trim the file and stop the flusher
+     */
+    void close();
+
+    /**
+     * @brief Check if the journal is open
+     * @return true if frames are accepted
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Queue a frame for writing
+     * @param payload The raw frame, kept alive until written
+     * @param received_wall_ns System clock nanoseconds at socket receive
+     * @return false if the journal is closed or its queue is full
+     */
+    bool append(std::shared_ptr<const std::string> payload, int64_t received_wall_ns);
+
+    /**
+     * @brief Wait until every frame queued so far is in the mapping and scheduled for writeback
+     * @param timeout The longest time to wait
+     * @return true if everything was handed to the OS in time
+     */
+    bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
+    /**
+     * @brief Get the number of records written
+     * @return The records, including those found when the journal was opened
+     */
+    uint64_t records_written() const;
+
+    /**
+     * @brief Get the size of the journal
+     * @return Bytes up to the end of the last record
+     */
+    uint64_t bytes_written() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const std::string> payload;
+        int64_t received_wall_ns{0};
+    };
+
+    JournalConfig config_;
+    MpscRingBuffer<Entry> queue_;
+    QueueWaiter waiter_;
+    std::thread thread_;
+    std::atomic<bool> open_{false};
+    std::mutex mutex_;
+
+    // File state, owned by the flusher while it runs
+    int fd_{-1};
+    char* mapping_{nullptr};
+    size_t mapped_size_{0};
+    std::atomic<uint64_t> end_offset_{0};
+    std::atomic<uint64_t> records_{0};
+
+    // Frames accepted by append() and frames copied into the mapping
+    std::atomic<uint64_t> appended_{0};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> synced_{0};
+    std::atomic<bool> sync_requested_{false};
+
+    std::shared_ptr<Counter> records_counter_;
+    std::shared_ptr<Counter> bytes_counter_;
+    std::shared_ptr<Counter> dropped_counter_;
+
+    bool map(size_t size);
+    void unmap();
+    bool write_entry(const Entry& entry);
+    void sync(bool wait);
+    void run();
+};
+
+/**
+ * @class JournalReader
+ * @brief Reads a journal written by JournalWriter through a read-only mapping
+ */
+class JournalReader {
+public:
+    /**
+     * @brief Constructor
+     */
+    JournalReader() = default;
+
+    /**
+     * @brief Destructor
+     */
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    /**
+     * @brief Open a journal
+     * @param path The file
+     * @return true if the file is a journal, false otherwise
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Release the mapping; records read before become invalid
+     */
+    void close();
+
+    /**
+     * @brief Read the next record
+     * @param record Filled with the record; its payload is valid until close()
+     * @return false at the end of the journal or on a truncated record
+     */
+    bool next(JournalRecord& record);
+
+    /**
+     * @brief Go back to the first record
+     */
+    void rewind();
+
+    /**
+     * @brief Get the creation time of the journal
+     * @return System clock nanoseconds
+     */
+    int64_t created_wall_ns() const;
+
+private:
+    int fd_{-1};
+    const char* mapping_{nullptr};
+    size_t size_{0};
+    size_t offset_{0};
+    int64_t created_wall_ns_{0};
+};
+
+} // namespace deribit
+
+#endif // MARKET_DATA_JOURNAL_H
\ No newline at end of file
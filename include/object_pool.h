@@ -0,0 +1,229 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <functional>
+#include <new>
+#include <cstddef>
+#include "performance_monitor.h"
+
+namespace deribit {
+
+/**
+ * @class ObjectPool
+ * @brief Fixed set of reusable objects handed out as shared pointers
+ *
+ * Every object is constructed up front. acquire() returns one as its previous
+ * user left it, so strings and vectors keep their capacity and assigning into
+ * them does not allocate once they have grown. An object goes back to the
+ * pool when its last shared pointer is released. The control blocks of those
+ * shared pointers come from the pool too, so acquiring and releasing never
+ * touch the heap while objects are free.
+ *
+ * When every object is in use, acquire() falls back to std::make_shared and
+ * counts a miss in <name>_pool_misses; a steady state without misses is free
+ * of allocations. <name>_pool_in_use counts the objects handed out. The
+ * storage lives until the last object is released, so shared pointers may
+ * outlive the pool.
+ */
+template <typename T>
+class ObjectPool {
+public:
+    /**
+     * @brief Constructor
+     * @param capacity The number of objects
+     * @param name The prefix of the pool's counters
+     */
+    ObjectPool(size_t capacity, const std::string& name)
+        : ObjectPool(capacity, name, [](T&) {}) {
+    }
+
+    /**
+     * @brief Constructor
+     * @param capacity The number of objects
+     * @param name The prefix of the pool's counters
+     * @param prepare Called once with each object, e.g. to reserve capacity
+     */
+    template <typename Prepare>
+    ObjectPool(size_t capacity, const std::string& name, Prepare&& prepare)
+        : state_(std::make_shared<State>(capacity, name)) {
+        for (size_t i = 0; i < capacity; ++i) {
+            prepare(state_->objects[i]);
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    /**
+     * @brief Take an object from the pool
+     * @return The object, holding whatever its previous user left in it
+     */
+    std::shared_ptr<T> acquire() {
+        T* object = state_->pop_object();
+        if (!object) {
+            state_->misses->add();
+            return std::make_shared<T>();
+        }
+
+        return std::shared_ptr<T>(object, Releaser{state_}, BlockAllocator<T>(state_));
+    }
+
+    /**
+     * @brief Get the number of objects
+     * @return The capacity given to the constructor
+     */
+    size_t capacity() const {
+        return state_->capacity;
+    }
+
+    /**
+     * @brief Get the number of objects not in use
+     * @return The number of free objects
+     */
+    size_t available() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->free_objects.size();
+    }
+
+private:
+    // Room for a shared pointer's control block holding a Releaser and a BlockAllocator
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    struct alignas(std::max_align_t) Block {
+        unsigned char bytes[BLOCK_SIZE];
+    };
+
+    struct State {
+        State(size_t capacity, const std::string& name)
+            : capacity(capacity),
+              objects(std::make_unique<T[]>(capacity)),
+              blocks(std::make_unique<Block[]>(capacity)) {
+            // One control block per object, so blocks only run out if weak pointers keep them
+            free_objects.reserve(capacity);
+            free_blocks.reserve(capacity);
+            for (size_t i = capacity; i > 0; --i) {
+                free_objects.push_back(&objects[i - 1]);
+                free_blocks.push_back(&blocks[i - 1]);
+            }
+
+            misses = PerformanceMonitor::instance().get_counter(name + "_pool_misses");
+            in_use = PerformanceMonitor::instance().get_counter(name + "_pool_in_use");
+        }
+
+        T* pop_object() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (free_objects.empty()) {
+                return nullptr;
+            }
+
+            T* object = free_objects.back();
+            free_objects.pop_back();
+            in_use->add();
+            return object;
+        }
+
+        void push_object(T* object) {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_objects.push_back(object);
+            in_use->add(-1);
+        }
+
+        void* pop_block() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (free_blocks.empty()) {
+                return nullptr;
+            }
+
+            Block* block = free_blocks.back();
+            free_blocks.pop_back();
+            return block;
+        }
+
+        // Returns false for memory that did not come from the pool
+        bool push_block(void* pointer) {
+            std::less<const void*> before;
+            if (before(pointer, blocks.get()) || !before(pointer, blocks.get() + capacity)) {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            free_blocks.push_back(static_cast<Block*>(pointer));
+            return true;
+        }
+
+        const size_t capacity;
+        std::unique_ptr<T[]> objects;
+        std::unique_ptr<Block[]> blocks;
+        std::mutex mutex;
+        std::vector<T*> free_objects;                   // Never grows past capacity, so never reallocates
+        std::vector<Block*> free_blocks;
+        std::shared_ptr<Counter> misses;
+        std::shared_ptr<Counter> in_use;
+    };
+
+    // Deleter returning the object; it keeps the storage alive
+    struct Releaser {
+        std::shared_ptr<State> state;
+
+        void operator()(T* object) const {
+            state->push_object(object);
+        }
+    };
+
+    // Allocator placing shared pointer control blocks in the pool's blocks
+    template <typename U>
+    struct BlockAllocator {
+        using value_type = U;
+
+        explicit BlockAllocator(std::shared_ptr<State> state)
+            : state(std::move(state)) {
+        }
+
+        template <typename V>
+        BlockAllocator(const BlockAllocator<V>& other)
+            : state(other.state) {
+        }
+
+        U* allocate(size_t n) {
+            void* block = nullptr;
+            if (sizeof(U) * n <= BLOCK_SIZE && alignof(U) <= alignof(Block)) {
+                block = state->pop_block();
+            }
+
+            if (!block) {
+                state->misses->add();
+                block = ::operator new(sizeof(U) * n);
+            }
+
+            return static_cast<U*>(block);
+        }
+
+        void deallocate(U* pointer, size_t) {
+            if (!state->push_block(pointer)) {
+                ::operator delete(pointer);
+            }
+        }
+
+        template <typename V>
+        bool operator==(const BlockAllocator<V>& other) const {
+            return state == other.state;
+        }
+
+        template <typename V>
+        bool operator!=(const BlockAllocator<V>& other) const {
+            return state != other.state;
+        }
+
+        std::shared_ptr<State> state;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace deribit
+
+#endif // OBJECT_POOL_H
\ No newline at end of file
@@ -0,0 +1,331 @@
+#ifndef ORDER_BOOK_ENGINE_H
+#define ORDER_BOOK_ENGINE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <nlohmann/json.hpp>
+#include "deribit_api_client.h"
+#include "order_manager.h"
+#include "orderbook_cache.h"
+#include "market_data_codec.h"
+
+namespace deribit {
+
+using json = nlohmann::json;
+
+/**
+ * @class BookSide
+ * @brief One side of an L2 book stored as a flat array sorted best-first
+ *
+ * Updates near the top of the book only move the few levels in front of them,
+ * and the best level and top-N views are plain pointer reads.
+ */
+class BookSide {
+public:
+    /**
+     * @brief Constructor
+     * @param descending true for bids (highest price first), false for asks
+     */
+    explicit BookSide(bool descending);
+
+    /**
+     * @brief Insert or update a level; a size of zero removes it
+     * @param price The level price
+     * @param size The new aggregated size
+     */
+    void set(double price, double size);
+
+    /**
+     * @brief Remove a level if present
+     * @param price The level price
+     */
+    void erase(double price);
+
+    /**
+     * @brief Remove all levels
+     */
+    void clear();
+
+    /**
+     * @brief Reserve space for a number of levels
+     * @param levels The number of levels
+     */
+    void reserve(size_t levels);
+
+    /**
+     * @brief Get the best level
+     * @return Pointer to the best level, or nullptr if the side is empty
+     */
+    const PriceLevel* best() const;
+
+    /**
+     * @brief Get a view of the best levels
+     * @param depth The maximum number of levels
+     * @return View over at most depth levels
+     */
+    BookView top(size_t depth) const;
+
+    /**
+     * @brief Get the number of levels
+     * @return The number of levels
+     */
+    size_t size() const;
+
+private:
+    std::vector<PriceLevel> levels_;
+    bool descending_;
+
+    size_t find_position(double price) const;
+};
+
+/**
+ * @enum BookUpdateResult
+ * @brief Outcome of applying a book message
+ */
+enum class BookUpdateResult {
+    APPLIED,            // Delta applied in sequence
+    SNAPSHOT_APPLIED,   // Book replaced by a snapshot
+    STALE,              // Message older than the current book, ignored
+    GAP,                // Sequence gap detected, book needs a snapshot
+    RESYNCING,          // Message buffered while waiting for a snapshot
+    INVALID             // Malformed message
+};
+
+/**
+ * @class L2Book
+ * @brief Incrementally maintained L2 book for one instrument
+ */
+class L2Book {
+public:
+    /**
+     * @brief Constructor
+     * @param instrument_name The name of the instrument
+     */
+    explicit L2Book(const std::string& instrument_name);
+
+    /**
+     * @brief Apply a book.* subscription message
+     * @param update The notification data (snapshot or change)
+     * @return The result of applying the message
+     *
+     * Messages carrying [price, amount] pairs instead of [action, price, amount]
+     * (grouped book channels) are treated as full snapshots.
+     */
+    BookUpdateResult apply(const json& update);
+
+    /**
+     * @brief Apply a decoded book.* subscription message
+     * @param update The decoded notification data
+     * @return The result of applying the message
+     */
+    BookUpdateResult apply(const BookUpdate& update);
+
+    /**
+     * @brief Replace the book with a public/get_order_book result
+     * @param snapshot The result object of public/get_order_book
+     */
+    void apply_snapshot(const json& snapshot);
+
+    /**
+     * @brief Clear the book and mark it invalid
+     */
+    void clear();
+
+    /**
+     * @brief Check if the book holds a consistent state
+     * @return true once a snapshot has been applied and no gap was detected since
+     */
+    bool is_valid() const;
+
+    /**
+     * @brief Get the name of the instrument
+     * @return The instrument name
+     */
+    const std::string& instrument_name() const;
+
+    /**
+     * @brief Get the id of the instrument
+     * @return The id, or INVALID_INSTRUMENT_ID if it was never resolved
+     */
+    InstrumentId instrument_id() const;
+
+    /**
+     * @brief Set the id of the instrument
+     * @param id The id in the instrument registry
+     */
+    void set_instrument_id(InstrumentId id);
+
+    /**
+     * @brief Get the change ID of the last applied message
+     * @return The change ID
+     */
+    int64_t change_id() const;
+
+    /**
+     * @brief Get the exchange timestamp of the last applied message
+     * @return Milliseconds since epoch
+     */
+    int64_t timestamp() const;
+
+    /**
+     * @brief Get the best bid
+     * @return Pointer to the best bid, or nullptr if there are no bids
+     */
+    const PriceLevel* best_bid() const;
+
+    /**
+     * @brief Get the best ask
+     * @return Pointer to the best ask, or nullptr if there are no asks
+     */
+    const PriceLevel* best_ask() const;
+
+    /**
+     * @brief Get a view of the best bids
+     * @param depth The maximum number of levels
+     * @return View over the best bids
+     */
+    BookView bids(size_t depth) const;
+
+    /**
+     * @brief Get a view of the best asks
+     * @param depth The maximum number of levels
+     * @return View over the best asks
+     */
+    BookView asks(size_t depth) const;
+
+    /**
+     * @brief Copy the top of the book into an OrderBook, reusing its storage
+     * @param orderbook The orderbook to fill
+     * @param depth The maximum number of levels per side
+     */
+    void to_orderbook(OrderBook& orderbook, size_t depth) const;
+
+private:
+    std::string instrument_name_;
+    InstrumentId instrument_id_{INVALID_INSTRUMENT_ID};
+    BookSide bids_;
+    BookSide asks_;
+    int64_t change_id_{0};
+    int64_t timestamp_{0};
+    bool valid_{false};
+
+    void apply_levels(BookSide& side, const std::vector<BookLevelUpdate>& levels);
+    void replace_levels(BookSide& side, const std::vector<BookLevelUpdate>& levels);
+    void replace_levels(BookSide& side, const json& levels);
+};
+
+/**
+ * @class OrderBookEngine
+ * @brief Maintains L2 books from Deribit deltas and resyncs them on sequence gaps
+ *
+ * When a gap is detected the engine requests public/get_order_book
+ * asynchronously, buffers the deltas that arrive in the meantime and replays
+ * them on top of the snapshot. The engine must be owned by a std::shared_ptr
+ * so that in-flight snapshot requests can detect when it has been destroyed.
+ */
+class OrderBookEngine : public std::enable_shared_from_this<OrderBookEngine> {
+public:
+    using BookCallback = std::function<void(const L2Book& book)>;
+
+    /**
+     * @brief Constructor
+     * @param api_client Pointer to an initialized ApiClient, used for resync snapshots
+     * @param snapshot_depth The depth requested for resync snapshots (default: 1000)
+     * @param max_buffered_updates Deltas kept while resyncing (default: 1000)
+     */
+    explicit OrderBookEngine(std::shared_ptr<ApiClient> api_client,
+                             int snapshot_depth = 1000,
+                             size_t max_buffered_updates = 1000);
+
+    /**
+     * @brief Set the callback invoked whenever a book changes
+     * @param callback The callback
+     *
+     * The callback runs with the book locked, so views taken from it are valid
+     * for the duration of the call only. It may run on a message worker or,
+     * after a resync, on an ApiClient I/O thread.
+     */
+    void set_book_callback(BookCallback callback);
+
+    /**
+     * @brief Set the registry used to give each book its instrument id
+     * @param registry The instrument registry
+     *
+     * The id is looked up when a book is created and, until it is found,
+     * whenever a snapshot is applied.
+     */
+    void set_instrument_registry(std::shared_ptr<InstrumentRegistry> registry);
+
+    /**
+     * @brief Apply a book.* subscription message
+     * @param update The notification data
+     * @return The result of applying the message
+     */
+    BookUpdateResult handle_update(const json& update);
+
+    /**
+     * @brief Apply a decoded book.* subscription message
+     * @param update The decoded notification data
+     * @return The result of applying the message
+     *
+     * Looking up an existing book does not allocate.
+     */
+    BookUpdateResult handle_update(const BookUpdate& update);
+
+    /**
+     * @brief Run a function on a book while it is locked
+     * @param instrument_name The name of the instrument
+     * @param fn The function to run
+     * @return true if the book exists and is valid, false otherwise
+     */
+    bool with_book(const std::string& instrument_name, const BookCallback& fn);
+
+    /**
+     * @brief Stop tracking an instrument
+     * @param instrument_name The name of the instrument
+     */
+    void remove(const std::string& instrument_name);
+
+    /**
+     * @brief Mark every book invalid until it is resynced
+     *
+     * For when the feed was interrupted: with_book() refuses the stale books,
+     * and each is rebuilt from the snapshot that follows resubscribing, or
+     * from public/get_order_book when a delta arrives first.
+     */
+    void invalidate_all();
+
+private:
+    struct BookState {
+        explicit BookState(const std::string& instrument_name)
+            : book(instrument_name) {}
+
+        L2Book book;
+        std::mutex mutex;
+        bool resyncing{false};
+        std::vector<BookUpdate> buffered_updates;   // instrument_name is cleared, it would dangle
+    };
+
+    std::shared_ptr<ApiClient> api_client_;
+    int snapshot_depth_;
+    size_t max_buffered_updates_;
+    BookCallback book_callback_;
+    std::shared_ptr<InstrumentRegistry> instrument_registry_;
+
+    std::map<std::string, std::shared_ptr<BookState>, std::less<>> books_;
+    std::mutex books_mutex_;
+
+    std::shared_ptr<BookState> get_state(std::string_view instrument_name, bool create);
+    void buffer_update(BookState& state, const BookUpdate& update);
+    void resolve_instrument_id(L2Book& book) const;
+    void request_snapshot(std::shared_ptr<BookState> state);
+    void handle_snapshot(const std::shared_ptr<BookState>& state, const ApiResponse& response);
+};
+
+} // namespace deribit
+
+#endif // ORDER_BOOK_ENGINE_H
\ No newline at end of file
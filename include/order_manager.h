@@ -4,60 +4,32 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <chrono>
 #include <nlohmann/json.hpp>
 #include "deribit_api_client.h"
+#include "orderbook_cache.h"
+#include "order_store.h"
+#include "instrument_registry.h"
+#include "risk_gate.h"
+#include "object_pool.h"
 
 namespace deribit {
 
 using json = nlohmann::json;
 
 /**
- * @enum OrderType
- * @brief Types of orders that can be placed
+ * @enum OrderTransport
+ * @brief Transport used for private (order entry) requests
  */
-enum class OrderType {
-    MARKET,
-    LIMIT,
-    STOP_MARKET,
-    STOP_LIMIT
-};
-
-/**
- * @enum OrderDirection
- * @brief Direction of the order (buy or sell)
- */
-enum class OrderDirection {
-    BUY,
-    SELL
-};
-
-/**
- * @enum TimeInForce
- * @brief Time in force options for orders
- */
-enum class TimeInForce {
-    GOOD_TIL_CANCELLED,
-    FILL_OR_KILL,
-    IMMEDIATE_OR_CANCEL
-};
-
-/**
- * @struct Order
- * @brief Represents an order in the system
- */
-struct Order {
-    std::string order_id;
-    std::string instrument_name;
-    OrderType type;
-    OrderDirection direction;
-    double price;
-    double amount;
-    TimeInForce time_in_force;
-    std::string status;
-    std::string created_at;
-    std::string last_updated_at;
+enum class OrderTransport {
+    REST,       // HTTPS requests through ApiClient::private_request
+    WEBSOCKET   // JSON-RPC over the authenticated WebSocket session
 };
 
 /**
@@ -66,6 +38,7 @@ struct Order {
  */
 struct Position {
     std::string instrument_name;
+    InstrumentId instrument_id{INVALID_INSTRUMENT_ID};
     double size;
     double entry_price;
     double mark_price;
@@ -85,18 +58,105 @@ struct OrderBook {
     std::string timestamp;
 };
 
+/**
+ * @struct OrderRequest
+ * @brief One order of a batch
+ */
+struct OrderRequest {
+    std::string instrument_name;
+    InstrumentId instrument_id{INVALID_INSTRUMENT_ID};   // Looked up by name when left unset
+    OrderType type{OrderType::LIMIT};
+    OrderDirection direction{OrderDirection::BUY};
+    double amount{0.0};
+    double price{0.0};
+    TimeInForce time_in_force{TimeInForce::GOOD_TIL_CANCELLED};
+    std::string label;      // Empty for the default label
+};
+
+/**
+ * @struct OrderModification
+ * @brief One modification of a batch; zero leaves a field unchanged
+ */
+struct OrderModification {
+    std::string order_id;
+    double amount{0.0};
+    double price{0.0};
+};
+
+/**
+ * @struct OrderResult
+ * @brief Outcome of one order of a batch
+ */
+struct OrderResult {
+    bool success{false};
+    std::string order_id;
+    std::string error_message;
+};
+
+/**
+ * @enum CancelScope
+ * @brief Selects the orders cancelled by OrderManager::cancel_all
+ */
+enum class CancelScope {
+    ALL,          // Every open order
+    INSTRUMENT,   // Orders on one instrument
+    CURRENCY,     // Orders on instruments of one currency
+    LABEL         // Orders carrying one label
+};
+
 /**
  * @class OrderManager
  * @brief Manages orders and positions on Deribit
  */
 class OrderManager {
 public:
+    using PlaceOrderCallback = std::function<void(const std::string& order_id)>;
+    using RequestCallback = std::function<void(bool success)>;
+    using OrderBookCallback = std::function<void(const OrderBook& orderbook)>;
+
     /**
      * @brief Constructor
      * @param api_client Pointer to an initialized ApiClient
+     *
+     * The OrderManager must outlive any asynchronous request it has started.
      */
     explicit OrderManager(std::shared_ptr<ApiClient> api_client);
 
+    /**
+     * @brief Set the transport used for private requests
+     * @param transport The transport to use
+     *
+     * With OrderTransport::WEBSOCKET, requests fall back to REST while the
+     * WebSocket session is not authenticated.
+     */
+    void set_transport(OrderTransport transport);
+
+    /**
+     * @brief Get the transport used for private requests
+     * @return The configured transport
+     */
+    OrderTransport get_transport() const;
+
+    /**
+     * @brief Set the instrument metadata used to validate orders
+     * @param registry The registry, or nullptr to only validate basic parameters
+     *
+     * Must be called before orders are placed. Orders on known instruments are
+     * rejected locally if the instrument is inactive, the amount is below the
+     * minimum or a limit price is off the tick grid; unknown instruments are
+     * left to the server.
+     */
+    void set_instrument_registry(std::shared_ptr<InstrumentRegistry> registry);
+
+    /**
+     * @brief Set the pre-trade risk gate orders must pass before being sent
+     * @param risk_gate The gate, or nullptr to send orders unchecked
+     *
+     * Must be called before orders are placed. The gate is fed positions and
+     * the top of book as they arrive through this manager.
+     */
+    void set_risk_gate(std::shared_ptr<RiskGate> risk_gate);
+
     /**
      * @brief Place a new order
      * @param instrument_name The name of the instrument to trade
@@ -114,6 +174,41 @@ public:
                            double price = 0.0,
                            TimeInForce time_in_force = TimeInForce::GOOD_TIL_CANCELLED);
 
+    /**
+     * @brief Place a new order without blocking the caller
+     * @param instrument_name The name of the instrument to trade
+     * @param type The type of order
+     * @param direction Buy or sell
+     * @param amount The amount to trade
+     * @param price The price for limit orders (ignored for market orders)
+     * @param time_in_force Time in force option
+     * @return Future holding the order ID if successful, empty string otherwise
+     */
+    std::future<std::string> place_order_async(const std::string& instrument_name,
+                                               OrderType type,
+                                               OrderDirection direction,
+                                               double amount,
+                                               double price = 0.0,
+                                               TimeInForce time_in_force = TimeInForce::GOOD_TIL_CANCELLED);
+
+    /**
+     * @brief Place a new order without blocking the caller
+     * @param callback Called with the order ID, or an empty string on failure
+     * @param instrument_name The name of the instrument to trade
+     * @param type The type of order
+     * @param direction Buy or sell
+     * @param amount The amount to trade
+     * @param price The price for limit orders (ignored for market orders)
+     * @param time_in_force Time in force option
+     */
+    void place_order_async(PlaceOrderCallback callback,
+                           const std::string& instrument_name,
+                           OrderType type,
+                           OrderDirection direction,
+                           double amount,
+                           double price = 0.0,
+                           TimeInForce time_in_force = TimeInForce::GOOD_TIL_CANCELLED);
+
     /**
      * @brief Cancel an existing order
      * @param order_id The ID of the order to cancel
@@ -121,6 +216,20 @@ public:
      */
     bool cancel_order(const std::string& order_id);
 
+    /**
+     * @brief Cancel an existing order without blocking the caller
+     * @param order_id The ID of the order to cancel
+     * @return Future holding true if cancellation successful, false otherwise
+     */
+    std::future<bool> cancel_order_async(const std::string& order_id);
+
+    /**
+     * @brief Cancel an existing order without blocking the caller
+     * @param callback Called with the result of the cancellation
+     * @param order_id The ID of the order to cancel
+     */
+    void cancel_order_async(RequestCallback callback, const std::string& order_id);
+
     /**
      * @brief Modify an existing order
      * @param order_id The ID of the order to modify
@@ -132,14 +241,143 @@ public:
                      double amount = 0.0, 
                      double price = 0.0);
 
+    /**
+     * @brief Modify an existing order without blocking the caller
+     * @param order_id The ID of the order to modify
+     * @param amount The new amount (optional)
+     * @param price The new price (optional)
+     * @return Future holding true if modification successful, false otherwise
+     */
+    std::future<bool> modify_order_async(const std::string& order_id,
+                                         double amount = 0.0,
+                                         double price = 0.0);
+
+    /**
+     * @brief Modify an existing order without blocking the caller
+     * @param callback Called with the result of the modification
+     * @param order_id The ID of the order to modify
+     * @param amount The new amount (optional)
+     * @param price The new price (optional)
+     */
+    void modify_order_async(RequestCallback callback,
+                            const std::string& order_id,
+                            double amount = 0.0,
+                            double price = 0.0);
+
+    /**
+     * @brief Place many orders at once
+     * @param requests The orders to place
+     * @return One result per request, in request order
+     *
+     * All requests are sent before any reply is awaited, pipelined on the
+     * WebSocket session or spread over the REST I/O pool, so the batch takes
+     * about one round trip. Invalid requests fail locally without being sent.
+     */
+    std::vector<OrderResult> place_orders(const std::vector<OrderRequest>& requests);
+
+    /**
+     * @brief Modify many orders at once
+     * @param modifications The modifications to apply
+     * @return One result per modification, in order
+     */
+    std::vector<OrderResult> modify_orders(const std::vector<OrderModification>& modifications);
+
+    /**
+     * @brief Cancel a group of orders with a single request
+     * @param scope Which orders to cancel
+     * @param value The instrument name, currency or label; ignored for CancelScope::ALL
+     * @return The number of orders cancelled, or -1 on error
+     */
+    int cancel_all(CancelScope scope = CancelScope::ALL, const std::string& value = "");
+
+    /**
+     * @brief Replace the quotes carrying a label with a new set
+     * @param label The label identifying the quotes
+     * @param quotes The new quotes; their label is set to label
+     * @return One result per quote, in order, followed by one per cancelled open order
+     *
+     * Open orders with the label are matched to new quotes on the same
+     * instrument and side and edited in place when their price or amount
+     * differs. Unmatched new quotes are placed and unmatched open orders are
+     * cancelled. All requests of the cycle are pipelined, and the call
+     * returns once every one of them, cancels included, has completed.
+     */
+    std::vector<OrderResult> replace_quotes(const std::string& label, const std::vector<OrderRequest>& quotes);
+
+    /**
+     * @brief Set the maximum age of a cached orderbook
+     * @param max_staleness Cached books older than this are refreshed over REST (default: 5000ms)
+     */
+    void set_max_orderbook_staleness(std::chrono::milliseconds max_staleness);
+
+    /**
+     * @brief Get the maximum age of a cached orderbook
+     * @return The maximum staleness
+     */
+    std::chrono::milliseconds get_max_orderbook_staleness() const;
+
+    /**
+     * @brief Feed the orderbook cache from the market data stream
+     * @param instrument_name The name of the instrument
+     * @param bids The best bids
+     * @param asks The best asks
+     * @param timestamp The exchange timestamp in milliseconds
+     * @param instrument_id The id of the instrument, or INVALID_INSTRUMENT_ID to look it up by name
+     */
+    void update_orderbook(const std::string& instrument_name, BookView bids, BookView asks, int64_t timestamp,
+                          InstrumentId instrument_id = INVALID_INSTRUMENT_ID);
+
+    /**
+     * @brief Drop the cached orderbook for an instrument
+     * @param instrument_name The name of the instrument
+     */
+    void invalidate_orderbook(const std::string& instrument_name);
+
+    /**
+     * @brief Drop every cached orderbook and the risk gate's market state
+     *
+     * Called when the market data feed is lost, so nothing is priced off a
+     * book that stopped updating.
+     */
+    void invalidate_orderbooks();
+
+    /**
+     * @brief Read the cached orderbook snapshot without locking or allocating
+     * @param instrument_name The name of the instrument
+     * @param snapshot Receives the snapshot
+     * @return true if a snapshot exists, false otherwise
+     *
+     * No staleness check is applied; use BookSnapshot::age() to decide.
+     */
+    bool get_orderbook_snapshot(const std::string& instrument_name, BookSnapshot& snapshot) const;
+
     /**
      * @brief Get the current orderbook for an instrument
      * @param instrument_name The name of the instrument
      * @param depth The depth of the orderbook (default: 10)
      * @return The orderbook
+     *
+     * Served from the cache when it is fresh and covers the requested depth,
+     * otherwise fetched over REST.
      */
     OrderBook get_orderbook(const std::string& instrument_name, int depth = 10);
 
+    /**
+     * @brief Get the current orderbook for an instrument without blocking the caller
+     * @param instrument_name The name of the instrument
+     * @param depth The depth of the orderbook (default: 10)
+     * @return Future holding the orderbook
+     */
+    std::future<OrderBook> get_orderbook_async(const std::string& instrument_name, int depth = 10);
+
+    /**
+     * @brief Get the current orderbook for an instrument without blocking the caller
+     * @param callback Called with the orderbook
+     * @param instrument_name The name of the instrument
+     * @param depth The depth of the orderbook (default: 10)
+     */
+    void get_orderbook_async(OrderBookCallback callback, const std::string& instrument_name, int depth = 10);
+
     /**
      * @brief Get all current positions
      * @return Vector of positions
@@ -150,19 +388,34 @@ public:
      * @brief Get a specific position
      * @param instrument_name The name of the instrument
      * @return The position, or nullptr if no position exists
+     *
+     * The copy comes from a pool and is recycled once released; holding many
+     * copies at once makes the pool fall back to the heap.
      */
     std::shared_ptr<Position> get_position(const std::string& instrument_name);
 
     /**
-     * @brief Get all open orders
-     * @return Vector of open orders
+     * @brief Get all open orders known locally
+     * @return Immutable snapshot of the open orders
+     *
+     * Served from the order store kept current by order placement and order
+     * updates; the snapshot is shared until the next change, so polling does
+     * not copy the table.
      */
-    std::vector<Order> get_open_orders();
+    OrderStore::Snapshot get_open_orders();
+
+    /**
+     * @brief Reload the open orders with private/get_open_orders_by_currency
+     * @return The number of open orders, or -1 on error
+     */
+    int refresh_open_orders();
 
     /**
      * @brief Get order details
      * @param order_id The ID of the order
      * @return The order details, or nullptr if order not found
+     *
+     * The copy comes from a pool and is recycled once released, as with get_position().
      */
     std::shared_ptr<Order> get_order(const std::string& order_id);
 
@@ -179,15 +432,46 @@ public:
     void handle_position_update(const json& update);
 
 private:
+    // Copies handed out by get_order() and get_position() at a time before falling back to the heap
+    static constexpr size_t RESULT_POOL_SIZE = 256;
+
     std::shared_ptr<ApiClient> api_client_;
-    std::map<std::string, Order> open_orders_;
-    std::map<std::string, Position> positions_;
-    std::map<std::string, OrderBook> orderbooks_;
+    OrderStore open_orders_;
+    std::unordered_map<std::string, Position> positions_;
     std::mutex orders_mutex_;
     std::mutex positions_mutex_;
-    std::mutex orderbooks_mutex_;
+    OrderBookCache orderbook_cache_;
+    std::atomic<int64_t> max_orderbook_staleness_ms_{5000};
+    std::atomic<OrderTransport> transport_{OrderTransport::REST};
+    std::shared_ptr<InstrumentRegistry> instrument_registry_;
+    std::shared_ptr<RiskGate> risk_gate_;
+    ObjectPool<Order> order_pool_{RESULT_POOL_SIZE, "order"};
+    ObjectPool<Position> position_pool_{RESULT_POOL_SIZE, "position"};
 
     // Helper methods
+    ApiResponse send_private_request(const std::string& method, const json& params);
+    void send_private_request_async(const std::string& method, const json& params, ApiClient::ResponseCallback callback);
+    json make_place_order_params(const std::string& instrument_name, OrderType type, OrderDirection direction,
+                                 double amount, double price, TimeInForce time_in_force,
+                                 const std::string& label, InstrumentId& instrument_id);
+    std::string place_order_method(OrderDirection direction);
+    void send_place_order(const OrderRequest& request, std::function<void(OrderResult)> done);
+    void send_modify_order(const OrderModification& modification, std::function<void(OrderResult)> done);
+    std::string record_placed_order(const ApiResponse& response, const std::string& instrument_name,
+                                    OrderType type, OrderDirection direction, double amount,
+                                    double price, TimeInForce time_in_force, InstrumentId instrument_id);
+    InstrumentId resolve_instrument_id(const std::string& instrument_name) const;
+    json make_cancel_order_params(const std::string& order_id);
+    bool record_cancelled_order(const ApiResponse& response, const std::string& order_id);
+    std::string settlement_currency(const std::string& instrument_name) const;
+    json make_modify_order_params(const std::string& order_id, double amount, double price);
+    bool record_modified_order(const ApiResponse& response, const std::string& order_id,
+                               double amount, double price);
+    bool read_cached_orderbook(const std::string& instrument_name, int depth, OrderBook& orderbook) const;
+    void record_orderbook(const ApiResponse& response, OrderBook& orderbook, int depth);
+    std::string timestamp_to_string(const json& timestamp);
+    static void parse_order(const json& order_json, Order& order);
+    static int64_t now_ms();
     std::string order_type_to_string(OrderType type);
     std::string order_direction_to_string(OrderDirection direction);
     std::string time_in_force_to_string(TimeInForce time_in_force);
@@ -0,0 +1,244 @@
+#ifndef ORDER_STORE_H
+#define ORDER_STORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <limits>
+#include <cstdint>
+#include "instrument_id.h"
+
+namespace deribit {
+
+/**
+ * @enum OrderType
+ * @brief Types of orders that can be placed
+ */
+enum class OrderType {
+    MARKET,
+    LIMIT,
+    STOP_MARKET,
+    STOP_LIMIT
+};
+
+/**
+ * @enum OrderDirection
+ * @brief Direction of the order (buy or sell)
+ */
+enum class OrderDirection {
+    BUY,
+    SELL
+};
+
+/**
+ * @enum TimeInForce
+ * @brief Time in force options for orders
+ */
+enum class TimeInForce {
+    GOOD_TIL_CANCELLED,
+    FILL_OR_KILL,
+    IMMEDIATE_OR_CANCEL
+};
+
+/**
+ * @enum OrderStatus
+ * @brief Deribit order states
+ */
+enum class OrderStatus {
+    OPEN,
+    UNTRIGGERED,
+    FILLED,
+    REJECTED,
+    CANCELLED,
+    UNKNOWN
+};
+
+/**
+ * @brief Convert a Deribit order_state string
+ * @param state The state, e.g. "open"
+ * @return The status, or OrderStatus::UNKNOWN
+ */
+OrderStatus parse_order_status(std::string_view state);
+
+/**
+ * @brief Convert an order status to its Deribit string
+ * @param status The status
+ * @return The order_state string
+ */
+const char* order_status_to_string(OrderStatus status);
+
+/**
+ * @struct Order
+ * @brief Represents an order in the system
+ */
+struct Order {
+    std::string order_id;
+    std::string instrument_name;
+    InstrumentId instrument_id{INVALID_INSTRUMENT_ID};   // Resolved once when the order is first stored
+    std::string label;
+    OrderType type{OrderType::LIMIT};
+    OrderDirection direction{OrderDirection::BUY};
+    double price{0.0};
+    double amount{0.0};
+    TimeInForce time_in_force{TimeInForce::GOOD_TIL_CANCELLED};
+    OrderStatus status{OrderStatus::UNKNOWN};
+    int64_t created_at{0};          // Milliseconds since epoch
+    int64_t last_updated_at{0};     // Milliseconds since epoch
+
+    /**
+     * @brief Check if the order can still trade
+     * @return true for open and untriggered orders
+     */
+    bool is_open() const {
+        return status == OrderStatus::OPEN || status == OrderStatus::UNTRIGGERED;
+    }
+};
+
+// Stable reference to a stored order: slot index in the low half, slot generation in the high half
+using OrderHandle = uint64_t;
+constexpr OrderHandle INVALID_ORDER_HANDLE = std::numeric_limits<OrderHandle>::max();
+
+/**
+ * @class OrderStore
+ * @brief Open orders in pooled slots with a hash index on the order ID
+ *
+ * Removed orders return their slot to a free list, and a reused slot keeps
+ * the string capacity of its previous order, so a steady stream of updates
+ * does not allocate once the pool has grown. A handle stays valid until its
+ * order is erased; it then no longer resolves even if the slot is reused.
+ *
+ * The store is not synchronized; the owner serializes access.
+ */
+class OrderStore {
+public:
+    using Snapshot = std::shared_ptr<const std::vector<Order>>;
+
+    /**
+     * @brief Constructor
+     * @param capacity The number of orders to reserve space for (default: 1024)
+     */
+    explicit OrderStore(size_t capacity = 1024);
+
+    /**
+     * @brief Find an order or add an empty one
+     * @param order_id The order ID
+     * @param handle Receives the handle of the order if not null
+     * @return The stored order, to be filled in place
+     */
+    Order& emplace(const std::string& order_id, OrderHandle* handle = nullptr);
+
+    /**
+     * @brief Add or replace an order
+     * @param order The order
+     * @return The handle of the order
+     */
+    OrderHandle upsert(const Order& order);
+
+    /**
+     * @brief Find an order
+     * @param order_id The order ID
+     * @return The order, or nullptr if not stored
+     */
+    Order* find(const std::string& order_id);
+
+    /**
+     * @brief Find an order
+     * @param order_id The order ID
+     * @return The order, or nullptr if not stored
+     */
+    const Order* find(const std::string& order_id) const;
+
+    /**
+     * @brief Resolve a handle
+     * @param handle The handle
+     * @return The order, or nullptr if it has been erased
+     */
+    const Order* get(OrderHandle handle) const;
+
+    /**
+     * @brief Look up the handle of an order
+     * @param order_id The order ID
+     * @return The handle, or INVALID_ORDER_HANDLE if not stored
+     */
+    OrderHandle handle(const std::string& order_id) const;
+
+    /**
+     * @brief Remove an order
+     * @param order_id The order ID
+     * @return true if the order was stored
+     */
+    bool erase(const std::string& order_id);
+
+    /**
+     * @brief Remove the orders matching a predicate
+     * @param pred Called with each order; returns true to remove it
+     * @return The number of orders removed
+     */
+    template <typename Pred>
+    size_t erase_if(Pred&& pred) {
+        size_t removed = 0;
+        for (uint32_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].in_use && pred(static_cast<const Order&>(slots_[i].order))) {
+                release(i);
+                ++removed;
+            }
+        }
+        return removed;
+    }
+
+    /**
+     * @brief Remove all orders
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of stored orders
+     * @return The number of orders
+     */
+    size_t size() const;
+
+    /**
+     * @brief Call a function on every stored order without copying
+     * @param fn Called with each order
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& slot : slots_) {
+            if (slot.in_use) {
+                fn(slot.order);
+            }
+        }
+    }
+
+    /**
+     * @brief Get an immutable copy of the stored orders
+     * @return The orders at the last change
+     *
+     * The copy is made at most once per change and shared between callers,
+     * so repeated queries on an unchanged store are free.
+     */
+    Snapshot snapshot();
+
+private:
+    struct Slot {
+        Order order;
+        uint32_t generation{0};
+        bool in_use{false};
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> free_slots_;
+    std::unordered_map<std::string, uint32_t> index_;
+    uint64_t version_{0};
+    uint64_t snapshot_version_{std::numeric_limits<uint64_t>::max()};
+    Snapshot snapshot_;
+
+    void release(uint32_t slot);
+    static OrderHandle make_handle(uint32_t slot, uint32_t generation);
+};
+
+} // namespace deribit
+
+#endif // ORDER_STORE_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+#ifndef ORDERBOOK_CACHE_H
+#define ORDERBOOK_CACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace deribit {
+
+/**
+ * @struct PriceLevel
+ * @brief A single aggregated price level
+ */
+struct PriceLevel {
+    double price;
+    double size;
+};
+
+/**
+ * @struct BookView
+ * @brief Non-owning view over the best levels of one side of a book
+ *
+ * Views point into the book and are only valid until the book is next updated.
+ */
+struct BookView {
+    const PriceLevel* levels{nullptr};
+    size_t count{0};
+
+    const PriceLevel* begin() const { return levels; }
+    const PriceLevel* end() const { return levels + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const PriceLevel& operator[](size_t index) const { return levels[index]; }
+};
+
+/**
+ * @struct BookSnapshot
+ * @brief Fixed-size copy of the top of a book with its freshness
+ */
+struct BookSnapshot {
+    static constexpr size_t MAX_DEPTH = 50;
+
+    PriceLevel bids[MAX_DEPTH];
+    PriceLevel asks[MAX_DEPTH];
+    uint32_t bid_count{0};
+    uint32_t ask_count{0};
+    uint32_t depth{0};          // Levels per side covered by the source
+    int64_t timestamp{0};       // Exchange timestamp in milliseconds
+    int64_t received_at{0};     // Steady clock time of the store in nanoseconds
+
+    BookView bid_view() const { return BookView{bids, bid_count}; }
+    BookView ask_view() const { return BookView{asks, ask_count}; }
+
+    /**
+     * @brief Get the time since the snapshot was stored
+     * @return The age of the snapshot
+     */
+    std::chrono::nanoseconds age() const;
+};
+
+/**
+ * @class OrderBookCache
+ * @brief Per-instrument book snapshots readable without locks
+ *
+ * Each instrument has a seqlock-protected slot: writers bump the sequence to
+ * an odd value, copy the levels and bump it again, and readers retry if the
+ * sequence changed while they copied. Slots live in a fixed open-addressed
+ * table and are never removed, so lookups are lock-free as well.
+ */
+class OrderBookCache {
+public:
+    /**
+     * @brief Constructor
+     * @param capacity Maximum number of instruments, rounded up to a power of two (default: 8192)
+     */
+    explicit OrderBookCache(size_t capacity = 8192);
+
+    /**
+     * @brief Destructor
+     */
+    ~OrderBookCache();
+
+    OrderBookCache(const OrderBookCache&) = delete;
+    OrderBookCache& operator=(const OrderBookCache&) = delete;
+
+    /**
+     * @brief Store the top of a book
+     * @param instrument_name The name of the instrument
+     * @param bids The best bids
+     * @param asks The best asks
+     * @param timestamp The exchange timestamp in milliseconds
+     * @param depth The number of levels per side the source covers
+     * @return true if stored, false if the cache is full
+     *
+     * At most BookSnapshot::MAX_DEPTH levels per side are kept.
+     */
+    bool store(const std::string& instrument_name, BookView bids, BookView asks,
+               int64_t timestamp, size_t depth);
+
+    /**
+     * @brief Read a consistent snapshot of a book
+     * @param instrument_name The name of the instrument
+     * @param snapshot Receives the snapshot
+     * @return true if a snapshot exists, false otherwise
+     */
+    bool load(const std::string& instrument_name, BookSnapshot& snapshot) const;
+
+    /**
+     * @brief Mark the snapshot of an instrument as missing
+     * @param instrument_name The name of the instrument
+     */
+    void invalidate(const std::string& instrument_name);
+
+    /**
+     * @brief Mark every snapshot as missing, e.g. when the feed is lost
+     */
+    void invalidate_all();
+
+private:
+    struct Slot {
+        explicit Slot(const std::string& name)
+            : instrument_name(name) {}
+
+        const std::string instrument_name;
+        alignas(64) std::atomic<uint64_t> sequence{0};
+        BookSnapshot snapshot;
+    };
+
+    std::unique_ptr<std::atomic<Slot*>[]> slots_;
+    size_t mask_;
+    std::mutex insert_mutex_;
+
+    Slot* find_slot(const std::string& instrument_name) const;
+    Slot* get_or_create_slot(const std::string& instrument_name);
+    void write_slot(Slot& slot, BookView bids, BookView asks, int64_t timestamp,
+                    size_t depth, int64_t received_at);
+};
+
+} // namespace deribit
+
+#endif // ORDERBOOK_CACHE_H
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <memory>
 #include <atomic>
 #include <fstream>
+#include "latency_histogram.h"
 
 namespace deribit {
 
@@ -22,9 +23,8 @@ struct LatencyMetric {
     std::chrono::nanoseconds max_latency{std::chrono::nanoseconds::min()};
     std::chrono::nanoseconds total_latency{0};
     uint64_t count{0};
-    std::vector<std::chrono::nanoseconds> samples;
-    bool store_samples{false};
-    size_t max_samples{1000};
+    HistogramSnapshot histogram;          // All values since the last reset
+    HistogramSnapshot window_histogram;   // Values in the rolling window
 
     // Calculate average latency
     double average_latency_ns() const {
@@ -42,35 +42,64 @@ struct LatencyMetric {
         return average_latency_us() / 1000.0;
     }
 
-    // Get percentile latency
+    // Get percentile latency since the last reset
     double percentile_latency_ns(double percentile) const;
+
+    // Get percentile latency over the rolling window
+    double window_percentile_latency_ns(double percentile) const;
+};
+
+/**
+ * @enum ClockSource
+ * @brief Time source used by latency trackers
+ */
+enum class ClockSource {
+    STEADY_CLOCK,   // std::chrono::steady_clock
+    TSC             // CPU timestamp counter, assumes an invariant TSC; falls back to STEADY_CLOCK off x86
 };
 
 /**
  * @class LatencyTracker
  * @brief Tracks latency for a single operation
+ *
+ * start() returns the start timestamp itself, so timing an operation takes
+ * no locks and allocates nothing. Resolve trackers once and keep the handle:
+ *
+ *     static auto tracker = PerformanceMonitor::instance().get_tracker("place_order");
+ *     auto token = tracker->start();
+ *     ...
+ *     tracker->end(token);
  */
 class LatencyTracker {
 public:
     /**
      * @brief Constructor
      * @param name The name of the operation being tracked
-     * @param store_samples Whether to store individual samples (default: false)
-     * @param max_samples Maximum number of samples to store (default: 1000)
+     * @param record_histogram Whether to keep latency histograms for percentiles (default: false)
+     * @param clock_source The time source (default: ClockSource::STEADY_CLOCK)
+     * @param histogram_config The histogram precision and rolling window (default: HistogramConfig())
      */
-    explicit LatencyTracker(const std::string& name, bool store_samples = false, size_t max_samples = 1000);
+    explicit LatencyTracker(const std::string& name, bool record_histogram = false,
+                            ClockSource clock_source = ClockSource::STEADY_CLOCK,
+                            const HistogramConfig& histogram_config = HistogramConfig());
 
     /**
      * @brief Start timing an operation
-     * @return A unique ID for this timing operation
+     * @return A token holding the start timestamp, to be passed to end()
      */
-    uint64_t start();
+    uint64_t start() const;
 
     /**
      * @brief End timing an operation
-     * @param id The ID returned by start()
+     * @param token The token returned by start()
+     */
+    void end(uint64_t token);
+
+    /**
+     * @brief Record a latency measured by the caller
+     * @param latency The measured latency
      */
-    void end(uint64_t id);
+    void record(std::chrono::nanoseconds latency);
 
     /**
      * @brief Get the current metrics
@@ -83,12 +112,72 @@ public:
      */
     void reset();
 
+    /**
+     * @brief Get the time source of this tracker
+     * @return The clock source
+     */
+    ClockSource clock_source() const;
+
 private:
     std::string name_;
-    std::map<uint64_t, std::chrono::high_resolution_clock::time_point> start_times_;
-    LatencyMetric metrics_;
-    std::mutex mutex_;
-    std::atomic<uint64_t> next_id_{0};
+    ClockSource clock_source_;
+
+    // Aggregates, updated with relaxed atomics
+    alignas(64) std::atomic<uint64_t> count_{0};
+    std::atomic<int64_t> total_ns_{0};
+    std::atomic<int64_t> min_ns_;
+    std::atomic<int64_t> max_ns_;
+
+    // Fixed-size histograms, null if percentiles are not recorded
+    std::unique_ptr<LatencyHistogram> histogram_;
+    std::unique_ptr<RollingHistogram> window_histogram_;
+};
+
+/**
+ * @class Counter
+ * @brief Thread-safe event counter or gauge
+ */
+class Counter {
+public:
+    /**
+     * @brief Constructor
+     * @param name The name of the counter
+     */
+    explicit Counter(const std::string& name);
+
+    /**
+     * @brief Add to the counter
+     * @param delta The amount to add, may be negative (default: 1)
+     */
+    void add(int64_t delta = 1);
+
+    /**
+     * @brief Set the counter to a value
+     * @param value The new value
+     */
+    void set(int64_t value);
+
+    /**
+     * @brief Raise the counter to a value if it is currently lower
+     * @param value The candidate maximum
+     */
+    void update_max(int64_t value);
+
+    /**
+     * @brief Get the current value
+     * @return The current value
+     */
+    int64_t get() const;
+
+    /**
+     * @brief Get the name of the counter
+     * @return The counter name
+     */
+    const std::string& name() const;
+
+private:
+    std::string name_;
+    std::atomic<int64_t> value_{0};
 };
 
 /**
@@ -106,13 +195,48 @@ public:
     /**
      * @brief Get a latency tracker for an operation
      * @param name The name of the operation
-     * @param store_samples Whether to store individual samples (default: false)
-     * @param max_samples Maximum number of samples to store (default: 1000)
+     * @param record_histogram Whether to keep latency histograms for percentiles (default: false)
      * @return Shared pointer to the latency tracker
      */
     std::shared_ptr<LatencyTracker> get_tracker(const std::string& name, 
-                                              bool store_samples = false, 
-                                              size_t max_samples = 1000);
+                                              bool record_histogram = false);
+
+    /**
+     * @brief Get a counter
+     * @param name The name of the counter
+     * @return Shared pointer to the counter
+     */
+    std::shared_ptr<Counter> get_counter(const std::string& name);
+
+    /**
+     * @brief Get the values of all counters
+     * @return Map of counter names to values
+     */
+    std::map<std::string, int64_t> get_all_counters() const;
+
+    /**
+     * @brief Set the time source for trackers created from now on
+     * @param clock_source The clock source
+     */
+    void set_clock_source(ClockSource clock_source);
+
+    /**
+     * @brief Get the time source for new trackers
+     * @return The clock source
+     */
+    ClockSource get_clock_source() const;
+
+    /**
+     * @brief Set the histogram settings for trackers created from now on
+     * @param config The histogram configuration
+     */
+    void set_histogram_config(const HistogramConfig& config);
+
+    /**
+     * @brief Get the histogram settings for new trackers
+     * @return The histogram configuration
+     */
+    HistogramConfig get_histogram_config() const;
 
     /**
      * @brief Get all metrics
@@ -159,6 +283,9 @@ private:
     PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
 
     std::map<std::string, std::shared_ptr<LatencyTracker>> trackers_;
+    std::map<std::string, std::shared_ptr<Counter>> counters_;
+    std::atomic<ClockSource> clock_source_{ClockSource::STEADY_CLOCK};
+    HistogramConfig histogram_config_;
     mutable std::mutex mutex_;
 };
 
@@ -184,9 +311,10 @@ private:
     uint64_t id_;
 };
 
-// Convenience macro for scoped latency tracking
+// Convenience macro for scoped latency tracking; the tracker is resolved once per call site, so
+// the name must be a string literal ("" name does not compile for anything else)
 #define TRACK_LATENCY(name) \
-    auto tracker = deribit::PerformanceMonitor::instance().get_tracker(name); \
+    static auto tracker = deribit::PerformanceMonitor::instance().get_tracker("" name); \
     deribit::ScopedLatencyTracker scoped_tracker(tracker);
 
 } // namespace deribit
@@ -0,0 +1,208 @@
+#ifndef REQUEST_SCHEDULER_H
+#define REQUEST_SCHEDULER_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "performance_monitor.h"
+
+namespace deribit {
+
+using json = nlohmann::json;
+
+/**
+ * @struct ApiResponse
+ * @brief Response from the API
+ */
+struct ApiResponse {
+    bool success;
+    json data;
+    std::string error_message;
+};
+
+/**
+ * @enum RequestLane
+ * @brief Priority lanes of the request scheduler, highest first
+ */
+enum class RequestLane {
+    CANCEL,         // private/cancel*, drawn from the matching engine pool
+    ORDER_ENTRY,    // private/buy, private/sell, private/edit, ... drawn from the matching engine pool
+    QUERY           // Everything else, drawn from the non-matching engine pool
+};
+
+/**
+ * @struct CreditPoolConfig
+ * @brief Token bucket modelling one of Deribit's credit pools
+ */
+struct CreditPoolConfig {
+    double max_credits;          // Bucket size, i.e. the burst allowance
+    double refill_per_second;    // Credits restored per second
+    double request_cost;         // Credits taken by one request
+};
+
+/**
+ * @struct RateLimitConfig
+ * @brief Settings for the client-side rate limiter
+ *
+ * The defaults match Deribit's base tier: bursts of 20 matching engine
+ * requests at 5 per second, and bursts of 100 other requests at 20 per second.
+ */
+struct RateLimitConfig {
+    bool enabled{true};
+    CreditPoolConfig matching_engine{20000.0, 5000.0, 1000.0};
+    CreditPoolConfig non_matching_engine{50000.0, 10000.0, 500.0};
+    size_t max_queued{4096};    // Requests waiting for credit; later ones fail immediately
+};
+
+/**
+ * @class RequestScheduler
+ * @brief Token bucket scheduler sending API requests within the rate limits
+ *
+ * Requests wait in three lanes and are sent as soon as their pool has credit,
+ * cancels before order entry on the shared matching engine pool. Redundant
+ * requests are folded while they wait:
+ *   - a private/edit of an order replaces a queued edit of the same order,
+ *   - a private/cancel of an order drops its queued edits,
+ *   - identical cancels and identical read-only (get_*) queries are sent once.
+ * The callbacks of folded requests all receive the reply of the one sent.
+ *
+ * Queueing delay is tracked per lane in api_rate_limit_queue_delay.<lane>
+ * and the remaining credits in api_rate_limit_credits.<pool>.
+ */
+class RequestScheduler {
+public:
+    using ResponseCallback = std::function<void(const ApiResponse&)>;
+    using SendFunction = std::function<void(const std::string& method, const json& params,
+                                            ResponseCallback callback)>;
+
+    /**
+     * @brief Constructor
+     * @param config The pool sizes and queue limit
+     */
+    explicit RequestScheduler(const RateLimitConfig& config = RateLimitConfig());
+
+    /**
+     * @brief Destructor
+     */
+    ~RequestScheduler();
+
+    /**
+     * @brief Start the thread sending queued requests as credit becomes available
+     */
+    void start();
+
+    /**
+     * @brief Stop the thread and fail all queued requests
+     */
+    void stop();
+
+    /**
+     * @brief Queue a request
+     * @param method The API method
+     * @param params The parameters of the request
+     * @param callback Called with the reply, or with an error if the request is dropped
+     * @param send Called without the lock held to actually send the request; must not block
+     * @param mergeable Whether the request may be folded with others (default: true)
+     * @return false if the queue is full, in which case the callback has already run
+     */
+    bool submit(const std::string& method, const json& params, ResponseCallback callback,
+                SendFunction send, bool mergeable = true);
+
+    /**
+     * @brief Send every queued request that has credit
+     * @param now_ns The current steady clock time in nanoseconds
+     * @return Nanoseconds until the next queued request has credit, or -1 if none is queued
+     *
+     * Called by the scheduler thread; exposed to drive the scheduler manually.
+     */
+    int64_t dispatch(int64_t now_ns);
+
+    /**
+     * @brief Empty the pool of a method after the server reported too_many_requests
+     * @param method The API method that was rejected
+     */
+    void on_rate_limited(const std::string& method);
+
+    /**
+     * @brief Get the credits left in the pool of a lane at the last dispatch
+     * @param lane The lane
+     * @return The credits
+     */
+    double available_credits(RequestLane lane) const;
+
+    /**
+     * @brief Get the number of queued requests
+     * @return The number of requests waiting for credit
+     */
+    size_t queued() const;
+
+    /**
+     * @brief Get the lane of an API method
+     * @param method The API method
+     * @return The lane
+     */
+    static RequestLane classify(const std::string& method);
+
+    /**
+     * @brief Get the current steady clock time
+     * @return Nanoseconds, as passed to dispatch()
+     */
+    static int64_t now_ns();
+
+private:
+    static constexpr size_t LANE_COUNT = 3;
+
+    struct CreditPool {
+        CreditPoolConfig config;
+        double credits{0.0};
+        int64_t refilled_at{-1};    // Steady clock nanoseconds; -1 until first used
+        std::shared_ptr<Counter> credits_counter;
+    };
+
+    struct QueuedRequest {
+        std::string method;
+        json params;
+        std::string merge_key;
+        std::vector<ResponseCallback> callbacks;
+        SendFunction send;
+        int64_t enqueued_at{0};
+    };
+
+    RateLimitConfig config_;
+    CreditPool matching_engine_;
+    CreditPool non_matching_engine_;
+    std::list<QueuedRequest> lanes_[LANE_COUNT];
+    std::unordered_map<std::string, std::list<QueuedRequest>::iterator> merge_index_;
+    size_t queued_{0};
+    mutable std::mutex mutex_;
+
+    std::thread thread_;
+    std::condition_variable condition_;
+    std::atomic<bool> running_{false};
+    bool wake_{false};
+
+    std::shared_ptr<LatencyTracker> delay_trackers_[LANE_COUNT];
+    std::shared_ptr<Counter> queued_counter_;
+    std::shared_ptr<Counter> merged_counter_;
+    std::shared_ptr<Counter> dropped_counter_;
+
+    CreditPool& pool_for(RequestLane lane);
+    static void refill(CreditPool& pool, int64_t now_ns);
+    static std::string merge_key(const std::string& method, RequestLane lane, const json& params);
+    ResponseCallback make_callback(const std::string& method, std::vector<ResponseCallback> callbacks);
+    static void fail(const std::vector<ResponseCallback>& callbacks, const std::string& error_message);
+    void run();
+};
+
+} // namespace deribit
+
+#endif // REQUEST_SCHEDULER_H
\ No newline at end of file
@@ -0,0 +1,244 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace deribit {
+
+/**
+ * @class MpscRingBuffer
+ * @brief Bounded lock-free queue for many producers and one consumer
+ *
+ * Slots are allocated once and reused, so pushing and popping never allocate
+ * beyond what moving T itself does. Each slot carries a sequence number that
+ * tells producers and the consumer whose turn it is, so neither side takes a
+ * lock. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MpscRingBuffer {
+public:
+    /**
+     * @brief Constructor
+     * @param capacity The minimum number of slots (default: 8192)
+     */
+    explicit MpscRingBuffer(size_t capacity = 8192)
+        : capacity_(round_up_pow2(capacity)),
+          mask_(capacity_ - 1),
+          slots_(std::make_unique<Slot[]>(capacity_)) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRingBuffer(const MpscRingBuffer&) = delete;
+    MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+    /**
+     * @brief Claim a slot and fill it in place
+     * @param fill Called with the slot's value to write into
+     * @return true if a slot was free, false if the queue is full
+     */
+    template <typename Fill>
+    bool try_push(Fill&& fill) {
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+        Slot* slot;
+
+        for (;;) {
+            slot = &slots_[position & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (difference == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                // The consumer has not released this slot yet
+                return false;
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+
+        fill(slot->value);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Move the oldest value out of the queue
+     * @param value Receives the value
+     * @return true if a value was taken, false if the queue is empty
+     *
+     * Must only be called from the consumer thread.
+     */
+    bool try_pop(T& value) {
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[position & mask_];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence != position + 1) {
+            return false;
+        }
+
+        value = std::move(slot.value);
+
+        // Drop anything the moved-from value still holds before handing the slot back
+        slot.value = T();
+
+        slot.sequence.store(position + capacity_, std::memory_order_release);
+        dequeue_position_.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Check if the queue is empty
+     * @return true if nothing is ready to pop
+     *
+     * Exact on the consumer thread, approximate elsewhere.
+     */
+    bool empty() const {
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+        return slots_[position & mask_].sequence.load(std::memory_order_acquire) != position + 1;
+    }
+
+    /**
+     * @brief Get the number of queued values
+     * @return The approximate number of values
+     */
+    size_t size() const {
+        size_t enqueued = enqueue_position_.load(std::memory_order_relaxed);
+        size_t dequeued = dequeue_position_.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    /**
+     * @brief Get the number of slots
+     * @return The capacity
+     */
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        T value;
+    };
+
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    // Producers and the consumer write different cache lines
+    alignas(64) std::atomic<size_t> enqueue_position_{0};
+    alignas(64) std::atomic<size_t> dequeue_position_{0};
+};
+
+/**
+ * @enum WaitPolicy
+ * @brief How a queue consumer waits for work
+ */
+enum class WaitPolicy {
+    BLOCKING,   // Sleep on a condition variable; lowest CPU use
+    BUSY_SPIN,  // Poll continuously; lowest latency, occupies a core
+    HYBRID      // Poll for a while, then sleep
+};
+
+/**
+ * @class QueueWaiter
+ * @brief Parks a queue consumer according to a wait policy
+ *
+ * Producers call notify() after every push. It only touches the mutex when
+ * the consumer is actually asleep, so a busy consumer costs producers one
+ * atomic load.
+ */
+class QueueWaiter {
+public:
+    /**
+     * @brief Constructor
+     * @param policy The wait policy (default: WaitPolicy::BLOCKING)
+     * @param spin_iterations Polls per wait() before sleeping or returning (default: 10000)
+     */
+    explicit QueueWaiter(WaitPolicy policy = WaitPolicy::BLOCKING, size_t spin_iterations = 10000);
+
+    /**
+     * @brief Wait until there may be work
+     * @param has_work Returns true when the consumer should run again
+     *
+     * May return without work, at the latest after a short timeout, so the
+     * caller must loop and can check for shutdown in between.
+     */
+    template <typename Predicate>
+    void wait(Predicate&& has_work) {
+        if (policy_ != WaitPolicy::BLOCKING) {
+            for (size_t i = 0; i < spin_iterations_; ++i) {
+                if (has_work()) {
+                    return;
+                }
+                pause();
+            }
+
+            // A spinning consumer never sleeps; the caller polls again
+            if (policy_ == WaitPolicy::BUSY_SPIN) {
+                return;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+
+        // Pairs with the fence in notify(): either the producer sees sleeping_
+        // or this check sees its push
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!has_work()) {
+            condition_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wake the consumer if it is asleep
+     */
+    void notify();
+
+    /**
+     * @brief Wake the consumer unconditionally, e.g. for shutdown
+     */
+    void notify_all();
+
+    /**
+     * @brief Get the wait policy
+     * @return The wait policy
+     */
+    WaitPolicy policy() const;
+
+private:
+    WaitPolicy policy_;
+    size_t spin_iterations_;
+    std::atomic<bool> sleeping_{false};
+    std::mutex mutex_;
+    std::condition_variable condition_;
+
+    static void pause();
+};
+
+} // namespace deribit
+
+#endif // RING_BUFFER_H
\ No newline at end of file
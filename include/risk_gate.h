@@ -0,0 +1,213 @@
+#ifndef RISK_GATE_H
+#define RISK_GATE_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "instrument_registry.h"
+#include "order_store.h"
+#include "performance_monitor.h"
+
+namespace deribit {
+
+/**
+ * @struct RiskLimits
+ * @brief Pre-trade limits of an instrument; zero disables a check
+ */
+struct RiskLimits {
+    double max_order_amount{0.0};   // Largest amount of a single order
+    double max_notional{0.0};       // Largest amount * price of a single order
+    double max_position{0.0};       // Largest absolute position after the order fills
+    double price_band{0.0};         // Largest distance from the mid as a fraction of it, e.g. 0.05
+};
+
+/**
+ * @enum RiskCheck
+ * @brief Outcome of a pre-trade check
+ */
+enum class RiskCheck {
+    ACCEPTED,
+    ORDER_AMOUNT,   // Order larger than max_order_amount
+    NOTIONAL,       // Order notional above max_notional
+    POSITION,       // Resulting position beyond max_position
+    PRICE_BAND,     // Limit price too far from the live mid
+    ORDER_RATE,     // Too many orders in the current second
+    NO_REFERENCE    // Market order under max_notional with no fresh price to value it
+};
+
+/**
+ * @brief Get the name of a check outcome
+ * @param check The outcome
+ * @return A short lower-case name, e.g. "price_band"
+ */
+const char* risk_check_to_string(RiskCheck check);
+
+/**
+ * @class RiskGate
+ * @brief Constant-time pre-trade checks in front of order entry
+ *
+ * Limits, positions and the live best bid/ask are kept per instrument id in
+ * a flat table of atomics, so check() takes no lock and does not allocate.
+ * Instruments without an id in the registry, or beyond the table, fall back
+ * to the default limits and skip the position and price band checks. The
+ * overloads taking a name look the id up in the registry, which locks it;
+ * callers on the order path cache the id and use the id overloads.
+ *
+ * A best bid/ask older than the maximum market age is treated as unknown,
+ * so a silent feed cannot anchor the price band to an old mid. A market
+ * order cannot be valued without one, and is refused under max_notional.
+ */
+class RiskGate {
+public:
+    /**
+     * @brief Constructor
+     * @param registry The registry assigning instrument ids, or nullptr to only apply default limits
+     * @param max_instruments The size of the per-instrument table (default: 8192)
+     */
+    explicit RiskGate(std::shared_ptr<InstrumentRegistry> registry = nullptr, size_t max_instruments = 8192);
+
+    /**
+     * @brief Set the limits applied to instruments without their own
+     * @param limits The limits
+     */
+    void set_default_limits(const RiskLimits& limits);
+
+    /**
+     * @brief Set the limits of one instrument
+     * @param id The instrument id
+     * @param limits The limits
+     */
+    void set_limits(InstrumentId id, const RiskLimits& limits);
+
+    /**
+     * @brief Set the limits of one instrument
+     * @param instrument_name The name of the instrument
+     * @param limits The limits
+     * @return true if the instrument has an id, false otherwise
+     */
+    bool set_limits(std::string_view instrument_name, const RiskLimits& limits);
+
+    /**
+     * @brief Limit the number of orders accepted per second across all instruments
+     * @param max_orders The limit, or 0 for none
+     */
+    void set_max_orders_per_second(uint32_t max_orders);
+
+    /**
+     * @brief Set how long a top of book stays usable without an update
+     * @param max_age The age (default: 5000 ms), or 0 to never age it out
+     *
+     * Past this age the price band is skipped and market orders are not
+     * valued, as after clear_market().
+     */
+    void set_max_market_age(std::chrono::milliseconds max_age);
+
+    /**
+     * @brief Record the current position of an instrument
+     * @param id The instrument id
+     * @param size The signed position size
+     */
+    void update_position(InstrumentId id, double size);
+
+    /**
+     * @brief Record the current position of an instrument
+     * @param instrument_name The name of the instrument
+     * @param size The signed position size
+     */
+    void update_position(std::string_view instrument_name, double size);
+
+    /**
+     * @brief Record the live top of book of an instrument
+     * @param id The instrument id
+     * @param best_bid The best bid price, or 0 if there is none
+     * @param best_ask The best ask price, or 0 if there is none
+     */
+    void update_market(InstrumentId id, double best_bid, double best_ask);
+
+    /**
+     * @brief Record the live top of book of an instrument
+     * @param instrument_name The name of the instrument
+     * @param best_bid The best bid price, or 0 if there is none
+     * @param best_ask The best ask price, or 0 if there is none
+     */
+    void update_market(std::string_view instrument_name, double best_bid, double best_ask);
+
+    /**
+     * @brief Forget the top of book of every instrument, e.g. when the feed is lost
+     *
+     * Until the next update_market() the price band is skipped and market
+     * orders are refused under max_notional.
+     */
+    void clear_market();
+
+    /**
+     * @brief Check an order against the limits by instrument id
+     * @param id The instrument id, or INVALID_INSTRUMENT_ID
+     * @param direction Buy or sell
+     * @param amount The order amount
+     * @param price The limit price, or 0 for market orders
+     * @return ACCEPTED, or the first check that failed
+     *
+     * Accepted orders count towards the order rate. Rejections are counted in
+     * risk_rejections.<check> and the check time in the risk_gate tracker.
+     */
+    RiskCheck check(InstrumentId id, OrderDirection direction, double amount, double price);
+
+    /**
+     * @brief Check an order against the limits by instrument name
+     * @param instrument_name The name of the instrument
+     * @param direction Buy or sell
+     * @param amount The order amount
+     * @param price The limit price, or 0 for market orders
+     * @return ACCEPTED, or the first check that failed
+     */
+    RiskCheck check(std::string_view instrument_name, OrderDirection direction, double amount, double price);
+
+    /**
+     * @brief Resolve an instrument id
+     * @param instrument_name The name of the instrument
+     * @return The id, or INVALID_INSTRUMENT_ID if unknown
+     */
+    InstrumentId instrument_id(std::string_view instrument_name) const;
+
+private:
+    // Limits and live state of one instrument; all fields are read without a lock
+    struct alignas(64) InstrumentState {
+        std::atomic<bool> has_limits{false};
+        std::atomic<double> max_order_amount{0.0};
+        std::atomic<double> max_notional{0.0};
+        std::atomic<double> max_position{0.0};
+        std::atomic<double> price_band{0.0};
+        std::atomic<double> position{0.0};
+        std::atomic<double> best_bid{0.0};
+        std::atomic<double> best_ask{0.0};
+        std::atomic<int64_t> market_updated_ns{0};   // Steady clock time of the last update_market()
+    };
+
+    std::shared_ptr<InstrumentRegistry> registry_;
+    size_t max_instruments_;
+    std::unique_ptr<InstrumentState[]> instruments_;
+    InstrumentState defaults_;
+
+    // Fixed one-second order rate window
+    std::atomic<uint32_t> max_orders_per_second_{0};
+    std::atomic<int64_t> rate_window_start_ns_{0};
+    std::atomic<uint32_t> rate_window_count_{0};
+
+    std::atomic<int64_t> max_market_age_ns_{5000000000};
+
+    std::shared_ptr<LatencyTracker> tracker_;
+    std::shared_ptr<Counter> rejection_counters_[7];
+
+    InstrumentState* state(InstrumentId id);
+    static void store_limits(InstrumentState& state, const RiskLimits& limits);
+    RiskCheck evaluate(InstrumentId id, OrderDirection direction, double amount, double price);
+    bool take_rate_slot();
+};
+
+} // namespace deribit
+
+#endif // RISK_GATE_H
\ No newline at end of file
@@ -0,0 +1,208 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "performance_monitor.h"
+
+namespace deribit {
+
+/**
+ * @enum TraceStage
+ * @brief Points on the path of a market data message, in path order
+ */
+enum class TraceStage {
+    RECEIVE,        // Read from the socket
+    DEQUEUE,        // Taken off the worker queue
+    DECODE,         // Decoded; the subscription callback starts
+    BOOK_APPLIED,   // Applied to the local book
+    PUBLISHED,      // Fanned out to WebSocket server clients
+    ORDER_SENT,     // An order, edit or cancel was handed to the API client in response
+    COMPLETE,       // The subscription callback returned
+    COUNT
+};
+
+constexpr size_t TRACE_STAGE_COUNT = static_cast<size_t>(TraceStage::COUNT);
+
+/**
+ * @brief Get the name of a trace stage
+ * @param stage The stage
+ * @return A short lower-case name, e.g. "book_applied"
+ */
+const char* trace_stage_to_string(TraceStage stage);
+
+/**
+ * @struct TraceRecord
+ * @brief Timestamps of one message on its way through the system
+ */
+struct TraceRecord {
+    uint64_t trace_id{0};
+    int64_t exchange_timestamp_ms{0};           // Deribit's timestamp of the event, 0 if unknown
+    int64_t received_wall_ns{0};                // System clock at socket receive
+    int64_t stamps[TRACE_STAGE_COUNT]{};        // Steady clock nanoseconds, 0 if not reached
+
+    /**
+     * @brief Get the time a stage was reached
+     * @param stage The stage
+     * @return Steady clock nanoseconds, or 0 if the stage was not reached
+     */
+    int64_t at(TraceStage stage) const {
+        return stamps[static_cast<size_t>(stage)];
+    }
+
+    /**
+     * @brief Get the time from socket receive to a stage
+     * @param stage The stage
+     * @return Nanoseconds, or -1 if the stage was not reached
+     */
+    int64_t since_receive(TraceStage stage) const {
+        return at(stage) != 0 ? at(stage) - at(TraceStage::RECEIVE) : -1;
+    }
+};
+
+/**
+ * @class Tracer
+ * @brief Follows each inbound market data message through the system
+ *
+ * The message worker opens a trace for every message it dispatches, seeded
+ * with the socket receive time. Code running on that thread, i.e. the book
+ * engine, the server fan-out and orders placed from callbacks, stamps its
+ * stage with mark(); stamping without an open trace does nothing. When the
+ * trace closes, the time between consecutive stages goes to trace.<stage>,
+ * receive to completion to trace.total, receive to order to trace.tick_to_trade
+ * and exchange timestamp to local receive to trace.network.
+ *
+ * Every record_interval-th trace is also kept as a TraceRecord.
+ */
+class Tracer {
+public:
+    // Traces kept for recent_records()
+    static constexpr size_t RECORD_CAPACITY = 1024;
+
+    /**
+     * @brief Get the singleton instance
+     * @return Reference to the singleton instance
+     */
+    static Tracer& instance();
+
+    /**
+     * @brief Enable or disable tracing
+     * @param enabled Whether new traces are opened (default: true)
+     */
+    void set_enabled(bool enabled);
+
+    /**
+     * @brief Check if tracing is enabled
+     * @return true if new traces are opened
+     */
+    bool is_enabled() const;
+
+    /**
+     * @brief Set how many traces pass per kept record
+     * @param interval Keep one in interval traces, or 0 to keep none (default: 16)
+     */
+    void set_record_interval(uint32_t interval);
+
+    /**
+     * @brief Open a trace on the calling thread
+     * @param received_ns Steady clock nanoseconds at socket receive
+     * @param received_wall_ns System clock nanoseconds at socket receive
+     *
+     * A trace still open on the thread is discarded.
+     */
+    void begin(int64_t received_ns, int64_t received_wall_ns);
+
+    /**
+     * @brief Close the trace on the calling thread and record its stages
+     */
+    void end();
+
+    /**
+     * @brief Stamp a stage of the trace open on the calling thread
+     * @param stage The stage; only its first stamp is kept
+     */
+    static void mark(TraceStage stage);
+
+    /**
+     * @brief Attach the exchange timestamp of the traced event
+     * @param timestamp_ms Deribit's timestamp in milliseconds since epoch
+     */
+    static void set_exchange_timestamp(int64_t timestamp_ms);
+
+    /**
+     * @brief Get the trace open on the calling thread
+     * @return The trace, or nullptr if none is open
+     */
+    static const TraceRecord* current();
+
+    /**
+     * @brief Get the kept traces
+     * @return The records, oldest first
+     */
+    std::vector<TraceRecord> recent_records() const;
+
+    /**
+     * @brief Get the current steady clock time
+     * @return Nanoseconds, as passed to begin()
+     */
+    static int64_t steady_now_ns();
+
+    /**
+     * @brief Get the current system clock time
+     * @return Nanoseconds since epoch, as passed to begin()
+     */
+    static int64_t wall_now_ns();
+
+private:
+    Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    std::atomic<bool> enabled_{true};
+    std::atomic<uint32_t> record_interval_{16};
+    std::atomic<uint64_t> next_trace_id_{1};
+
+    std::shared_ptr<LatencyTracker> stage_trackers_[TRACE_STAGE_COUNT];
+    std::shared_ptr<LatencyTracker> total_tracker_;
+    std::shared_ptr<LatencyTracker> tick_to_trade_tracker_;
+    std::shared_ptr<LatencyTracker> network_tracker_;
+
+    // Fixed ring of kept traces
+    std::vector<TraceRecord> records_;
+    size_t records_next_{0};
+    size_t records_size_{0};
+    mutable std::mutex records_mutex_;
+};
+
+/**
+ * @class ScopedTrace
+ * @brief RAII class opening a trace for a scope
+ */
+class ScopedTrace {
+public:
+    /**
+     * @brief Constructor
+     * @param received_ns Steady clock nanoseconds at socket receive
+     * @param received_wall_ns System clock nanoseconds at socket receive
+     */
+    ScopedTrace(int64_t received_ns, int64_t received_wall_ns) {
+        Tracer::instance().begin(received_ns, received_wall_ns);
+    }
+
+    /**
+     * @brief Destructor
+     */
+    ~ScopedTrace() {
+        Tracer::instance().end();
+    }
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+};
+
+} // namespace deribit
+
+#endif // TRACER_H
\ No newline at end of file
@@ -0,0 +1,403 @@
+#ifndef WEBSOCKET_COMPRESSION_H
+#define WEBSOCKET_COMPRESSION_H
+
+#include <string>
+#include <utility>
+#include <cstdint>
+#include "websocketpp_asio_compatibility.h"
+#include <websocketpp/config/asio.hpp>
+
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+#include <memory>
+#include <algorithm>
+#include <zlib.h>
+#include <websocketpp/http/constants.hpp>
+#include <websocketpp/extensions/permessage_deflate/enabled.hpp>
+#include <websocketpp/connection.hpp>
+#include "performance_monitor.h"
+#endif
+
+namespace deribit {
+
+/**
+ * @struct CompressionConfig
+ * @brief Settings for permessage-deflate (RFC 7692) on the WebSocket server
+ *
+ * Only takes effect in builds configured with WEBSOCKET_PERMESSAGE_DEFLATE.
+ */
+struct CompressionConfig {
+    bool enabled{false};            // Accept permessage-deflate offers from clients
+    int level{1};                   // zlib level, 1 (fastest) to 9 (smallest)
+    int memory_level{8};            // zlib memory level, 1 to 9
+    bool context_takeover{true};    // Keep the window between messages; false compresses each message alone
+    uint8_t max_window_bits{15};    // Largest server window, 9 to 15
+};
+
+/**
+ * @brief Bring out-of-range compression settings into range
+ * @param config The settings
+ * @return The settings with each value clamped to its range
+ */
+CompressionConfig clamp_compression_config(const CompressionConfig& config);
+
+/**
+ * @brief Check if permessage-deflate was compiled in
+ * @return true in builds configured with WEBSOCKET_PERMESSAGE_DEFLATE
+ */
+bool is_deflate_available();
+
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+
+namespace deflate_error = websocketpp::extensions::permessage_deflate::error;
+
+/**
+ * @class DeflateSettingsScope
+ * @brief Hands compression settings to the extensions constructed on this thread
+ *
+ * websocketpp default-constructs the extension inside the processor it builds
+ * for each handshake, so the settings of the connection are put in scope
+ * around that call.
+ */
+class DeflateSettingsScope {
+public:
+    /**
+     * @brief Constructor
+     * @param settings The settings, or nullptr to decline every offer
+     */
+    explicit DeflateSettingsScope(const CompressionConfig* settings);
+
+    /**
+     * @brief Destructor; restores the settings of the enclosing scope
+     */
+    ~DeflateSettingsScope();
+
+    DeflateSettingsScope(const DeflateSettingsScope&) = delete;
+    DeflateSettingsScope& operator=(const DeflateSettingsScope&) = delete;
+
+    /**
+     * @brief Get the settings in scope on this thread
+     * @return The settings, or nullptr outside any scope
+     */
+    static const CompressionConfig* current();
+
+private:
+    const CompressionConfig* previous_;
+};
+
+/**
+ * @class PerMessageDeflate
+ * @brief permessage-deflate extension for websocketpp with tunable zlib settings
+ *
+ * websocketpp's own extension always deflates at the default level, so this
+ * one takes its place in the server config. websocketpp constructs one per
+ * connection, with the settings of the server that accepted it. The zlib
+ * streams use raw deflate and a sync flush per message; websocketpp strips
+ * the trailing 0x00 0x00 0xff 0xff before framing.
+ */
+template <typename config>
+class PerMessageDeflate {
+public:
+    using err_str_pair = std::pair<websocketpp::lib::error_code, std::string>;
+
+    // As built by websocketpp; outside a DeflateSettingsScope every offer is declined
+    PerMessageDeflate()
+        : PerMessageDeflate(DeflateSettingsScope::current() ? *DeflateSettingsScope::current() : CompressionConfig()) {
+    }
+
+    explicit PerMessageDeflate(const CompressionConfig& settings)
+        : settings_(settings),
+          server_max_window_bits_(settings_.max_window_bits),
+          server_no_context_takeover_(!settings_.context_takeover) {
+        input_counter_ = PerformanceMonitor::instance().get_counter("ws_deflate_input_bytes");
+        output_counter_ = PerformanceMonitor::instance().get_counter("ws_deflate_output_bytes");
+    }
+
+    ~PerMessageDeflate() {
+        if (initialized_) {
+            deflateEnd(&deflate_state_);
+            inflateEnd(&inflate_state_);
+        }
+    }
+
+    PerMessageDeflate(const PerMessageDeflate&) = delete;
+    PerMessageDeflate& operator=(const PerMessageDeflate&) = delete;
+
+    bool is_implemented() const {
+        return true;
+    }
+
+    bool is_enabled() const {
+        return enabled_;
+    }
+
+    // Server only; clients of this config do not offer compression
+    std::string generate_offer() const {
+        return "";
+    }
+
+    websocketpp::lib::error_code validate_offer(const websocketpp::http::attribute_list&) {
+        return make_error(deflate_error::general);
+    }
+
+    /**
+     * @brief Accept or decline one permessage-deflate offer
+     * @param offer The offer's parameters
+     * @return An error to decline, or the Sec-WebSocket-Extensions response value
+     */
+    err_str_pair negotiate(const websocketpp::http::attribute_list& offer) {
+        err_str_pair result;
+
+        if (!settings_.enabled) {
+            result.first = make_error(deflate_error::general);
+            return result;
+        }
+
+        uint8_t server_bits = settings_.max_window_bits;
+        bool server_no_context_takeover = !settings_.context_takeover;
+        bool client_no_context_takeover = false;
+        bool server_bits_requested = false;
+
+        for (const auto& attribute : offer) {
+            if (attribute.first == "server_no_context_takeover") {
+                server_no_context_takeover = true;
+            } else if (attribute.first == "client_no_context_takeover") {
+                client_no_context_takeover = true;
+            } else if (attribute.first == "server_max_window_bits") {
+                int bits = parse_window_bits(attribute.second);
+                if (bits < 0) {
+                    result.first = make_error(deflate_error::invalid_attribute_value);
+                    return result;
+                }
+                // zlib cannot produce an 8-bit window, so 9 is the least we use
+                server_bits = static_cast<uint8_t>(std::min<int>(server_bits, std::max(bits, 9)));
+                server_bits_requested = true;
+            } else if (attribute.first == "client_max_window_bits") {
+                // The client picks its own window; inflating with 15 bits accepts any of them
+                if (!attribute.second.empty() && parse_window_bits(attribute.second) < 0) {
+                    result.first = make_error(deflate_error::invalid_attribute_value);
+                    return result;
+                }
+            } else {
+                result.first = make_error(deflate_error::invalid_attributes);
+                return result;
+            }
+        }
+
+        server_max_window_bits_ = server_bits;
+        server_no_context_takeover_ = server_no_context_takeover;
+
+        result.second = "permessage-deflate";
+        if (server_no_context_takeover_) {
+            result.second += "; server_no_context_takeover";
+        }
+        if (client_no_context_takeover) {
+            result.second += "; client_no_context_takeover";
+        }
+        // A requested server window must be acknowledged for the offer to be accepted
+        if (server_bits_requested || server_max_window_bits_ < 15) {
+            result.second += "; server_max_window_bits=" + std::to_string(server_max_window_bits_);
+        }
+
+        enabled_ = true;
+        return result;
+    }
+
+    /**
+     * @brief Set up the zlib streams after a successful negotiation
+     * @return An error if zlib could not be initialized
+     */
+    websocketpp::lib::error_code init(bool) {
+        if (initialized_) {
+            return websocketpp::lib::error_code();
+        }
+
+        deflate_state_ = z_stream();
+        if (deflateInit2(&deflate_state_, settings_.level, Z_DEFLATED, -static_cast<int>(server_max_window_bits_),
+                         settings_.memory_level, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return make_error(deflate_error::zlib_error);
+        }
+
+        // Clients may use windows up to 15 bits whatever we send with
+        inflate_state_ = z_stream();
+        if (inflateInit2(&inflate_state_, -15) != Z_OK) {
+            deflateEnd(&deflate_state_);
+            return make_error(deflate_error::zlib_error);
+        }
+
+        buffer_.reset(new unsigned char[BUFFER_SIZE]);
+        initialized_ = true;
+        return websocketpp::lib::error_code();
+    }
+
+    websocketpp::lib::error_code compress(const std::string& in, std::string& out) {
+        if (!initialized_) {
+            return make_error(deflate_error::uninitialized);
+        }
+
+        // An empty stored block, as websocketpp's own extension sends
+        if (in.empty()) {
+            static const char empty[6] = {0x02, 0x00, 0x00, 0x00, static_cast<char>(0xff), static_cast<char>(0xff)};
+            out.append(empty, sizeof(empty));
+            return websocketpp::lib::error_code();
+        }
+
+        size_t start = out.size();
+        deflate_state_.avail_in = static_cast<uInt>(in.size());
+        deflate_state_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+
+        do {
+            deflate_state_.avail_out = BUFFER_SIZE;
+            deflate_state_.next_out = buffer_.get();
+            if (deflate(&deflate_state_, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+                return make_error(deflate_error::zlib_error);
+            }
+            out.append(reinterpret_cast<char*>(buffer_.get()), BUFFER_SIZE - deflate_state_.avail_out);
+        } while (deflate_state_.avail_out == 0);
+
+        // Without context takeover the next message must not refer back to this one
+        if (server_no_context_takeover_) {
+            deflateReset(&deflate_state_);
+        }
+
+        input_counter_->add(static_cast<int64_t>(in.size()));
+        output_counter_->add(static_cast<int64_t>(out.size() - start));
+        return websocketpp::lib::error_code();
+    }
+
+    websocketpp::lib::error_code decompress(const uint8_t* buf, size_t len, std::string& out) {
+        if (!initialized_) {
+            return make_error(deflate_error::uninitialized);
+        }
+
+        inflate_state_.avail_in = static_cast<uInt>(len);
+        inflate_state_.next_in = const_cast<Bytef*>(buf);
+
+        do {
+            inflate_state_.avail_out = BUFFER_SIZE;
+            inflate_state_.next_out = buffer_.get();
+
+            int ret = inflate(&inflate_state_, Z_SYNC_FLUSH);
+            if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+                return make_error(deflate_error::zlib_error);
+            }
+
+            out.append(reinterpret_cast<char*>(buffer_.get()), BUFFER_SIZE - inflate_state_.avail_out);
+        } while (inflate_state_.avail_out == 0);
+
+        return websocketpp::lib::error_code();
+    }
+
+private:
+    static constexpr uInt BUFFER_SIZE = 16384;
+
+    CompressionConfig settings_;
+    uint8_t server_max_window_bits_;
+    bool server_no_context_takeover_;
+    bool enabled_{false};
+    bool initialized_{false};
+    z_stream deflate_state_;
+    z_stream inflate_state_;
+    std::unique_ptr<unsigned char[]> buffer_;
+
+    std::shared_ptr<Counter> input_counter_;
+    std::shared_ptr<Counter> output_counter_;
+
+    static websocketpp::lib::error_code make_error(deflate_error::value value) {
+        return deflate_error::make_error_code(value);
+    }
+
+    // Returns the bits of a window parameter value, or -1 if it is not 8 to 15
+    static int parse_window_bits(const std::string& value) {
+        if (value.empty() || value.size() > 2 ||
+            value.find_first_not_of("0123456789") != std::string::npos) {
+            return -1;
+        }
+
+        int bits = std::stoi(value);
+        return bits >= 8 && bits <= 15 ? bits : -1;
+    }
+};
+
+/**
+ * @struct DeflateServerConfig
+ * @brief websocketpp::config::asio with PerMessageDeflate enabled
+ */
+struct DeflateServerConfig : public websocketpp::config::asio {
+    using type = DeflateServerConfig;
+    using core = websocketpp::config::asio;
+
+    using concurrency_type = core::concurrency_type;
+    using request_type = core::request_type;
+    using response_type = core::response_type;
+    using message_type = core::message_type;
+    using con_msg_manager_type = core::con_msg_manager_type;
+    using endpoint_msg_manager_type = core::endpoint_msg_manager_type;
+    using alog_type = core::alog_type;
+    using elog_type = core::elog_type;
+    using rng_type = core::rng_type;
+    using endpoint_base = core::endpoint_base;
+
+    struct transport_config : public core::transport_config {
+        using concurrency_type = core::concurrency_type;
+        using elog_type = core::elog_type;
+        using alog_type = core::alog_type;
+        using request_type = core::request_type;
+        using response_type = core::response_type;
+    };
+
+    using transport_type = websocketpp::transport::asio::endpoint<transport_config>;
+
+    using permessage_deflate_type = PerMessageDeflate<DeflateServerConfig>;
+
+    // Set by the server that accepted the connection, before its handshake is read
+    struct connection_base {
+        std::shared_ptr<const CompressionConfig> deflate_settings;
+    };
+};
+
+#endif // DERIBIT_WS_PERMESSAGE_DEFLATE
+
+} // namespace deribit
+
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+
+namespace websocketpp {
+
+// websocketpp's own get_processor(), with the connection's compression settings in scope
+template <>
+inline connection<deribit::DeflateServerConfig>::processor_ptr
+connection<deribit::DeflateServerConfig>::get_processor(int version) const {
+    using config = deribit::DeflateServerConfig;
+    deribit::DeflateSettingsScope scope(deflate_settings.get());
+
+    processor_ptr p;
+    switch (version) {
+        case 0:
+            p = lib::make_shared<processor::hybi00<config>>(transport_con_type::is_secure(), m_is_server,
+                                                           m_msg_manager);
+            break;
+        case 7:
+            p = lib::make_shared<processor::hybi07<config>>(transport_con_type::is_secure(), m_is_server,
+                                                           m_msg_manager, lib::ref(m_rng));
+            break;
+        case 8:
+            p = lib::make_shared<processor::hybi08<config>>(transport_con_type::is_secure(), m_is_server,
+                                                           m_msg_manager, lib::ref(m_rng));
+            break;
+        case 13:
+            p = lib::make_shared<processor::hybi13<config>>(transport_con_type::is_secure(), m_is_server,
+                                                           m_msg_manager, lib::ref(m_rng));
+            break;
+        default:
+            return p;
+    }
+
+    p->set_max_message_size(m_max_message_size);
+    return p;
+}
+
+} // namespace websocketpp
+
+#endif // DERIBIT_WS_PERMESSAGE_DEFLATE
+
+#endif // WEBSOCKET_COMPRESSION_H
\ No newline at end of file
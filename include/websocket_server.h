@@ -4,30 +4,120 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <chrono>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
 #include <functional>
 #include <thread>
+#include <atomic>
 #include "websocketpp_asio_compatibility.h"
 #include <websocketpp/config/asio.hpp>
 #include <websocketpp/server.hpp>
 #include <nlohmann/json.hpp>
 #include "deribit_api_client.h"
 #include "order_manager.h"
+#include "instrument_registry.h"
+#include "performance_monitor.h"
+#include "websocket_compression.h"
+#include "channel_router.h"
 
 namespace deribit {
 
 using json = nlohmann::json;
 
+/**
+ * @struct SendQueueConfig
+ * @brief Limits for the per-connection outbound queues
+ */
+struct SendQueueConfig {
+    size_t socket_buffer_limit{256 * 1024};          // Bytes buffered in websocketpp before queueing locally
+    size_t high_water_mark{64};                      // Queued messages beyond which market data is conflated
+    size_t max_queued_messages{1024};                // Queued messages beyond which a client is disconnected
+    size_t max_queued_bytes{16 * 1024 * 1024};       // Queued bytes beyond which a client is disconnected
+    std::chrono::milliseconds drain_interval{5};     // Period of the queue drain pass
+};
+
+/**
+ * @struct CoalescingConfig
+ * @brief Settings for batching small messages into shared frames
+ *
+ * Clients opt in with {"type":"configure","coalesce":true}. Their small text
+ * messages then wait up to the window to share one frame, newline-separated.
+ */
+struct CoalescingConfig {
+    std::chrono::microseconds window{0};             // Longest wait for more messages, 0 disables coalescing
+    size_t max_message_bytes{1024};                  // Larger messages get a frame of their own
+    size_t max_batch_bytes{16 * 1024};               // A batch this size is sent without waiting
+};
+
+/**
+ * @struct DepthChannelConfig
+ * @brief The orderbook.<instrument>.<depth>.<interval> channels clients may subscribe to
+ */
+struct DepthChannelConfig {
+    std::vector<size_t> depths{1, 5, 10, 20};
+    std::vector<std::chrono::milliseconds> intervals{       // 0 is "raw"
+        std::chrono::milliseconds(0), std::chrono::milliseconds(100), std::chrono::milliseconds(250),
+        std::chrono::milliseconds(500), std::chrono::milliseconds(1000)};
+};
+
+/**
+ * @struct ConnectionStats
+ * @brief Outbound traffic of one client connection
+ */
+struct ConnectionStats {
+    std::string remote_endpoint;
+    uint64_t frames_sent{0};            // Frames handed to websocketpp
+    uint64_t bytes_sent{0};             // Their payload bytes before compression
+    uint64_t messages_coalesced{0};     // Messages that shared a frame with an earlier one
+    size_t queued_messages{0};          // Waiting for the socket buffer to drain
+    bool compressed{false};             // permessage-deflate was negotiated
+    bool coalescing{false};             // The client opted in to coalescing
+};
+
 /**
  * @class WebSocketServer
  * @brief Server for distributing real-time market data to clients
+ *
+ * Clients subscribe with {"type":"subscribe","channel":...} and get JSON text
+ * frames. Adding "encoding":"binary" to an orderbook subscription switches
+ * that channel to binary frames in the layout of binary_book_codec.h: one
+ * snapshot after subscribing, then a delta per update. Every update of an
+ * instrument advances its sequence by one, so a client seeing a gap
+ * resubscribes for a fresh snapshot.
+ *
+ * Channels derived from orderbook updates are built once per update and
+ * shared by their subscribers: ticker.<instrument> carries the best bid and
+ * ask whenever either changes, and orderbook.<instrument>.<depth>.<interval>
+ * the top depth levels, at most once per interval ("100ms") or on every
+ * change ("raw"). Only the depths and intervals of the DepthChannelConfig are
+ * accepted, and a depth channel is dropped when its last subscriber leaves.
+ * Once the instrument registry holds instruments, channels of unknown
+ * instruments are refused. Other channels, published with
+ * broadcast_to_channel(), are accepted only under the configured prefixes.
+ *
+ * Subscribing to a pattern such as orderbook.BTC-* or ticker.*-PERPETUAL
+ * subscribes to every matching instrument, including ones that appear later.
+ * Patterns are resolved when they are subscribed and when a channel is first
+ * seen, not on publish: each channel keeps a precomputed subscriber list
+ * indexed by its ChannelId. A channel is forgotten once it has no subscribers
+ * and no published book or depth channel uses it.
  */
 class WebSocketServer {
 public:
-    using WebSocketServerType = websocketpp::server<websocketpp::config::asio>;
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+    using ServerConfig = DeflateServerConfig;
+#else
+    using ServerConfig = websocketpp::config::asio;
+#endif
+    using WebSocketServerType = websocketpp::server<ServerConfig>;
     using ConnectionHandle = websocketpp::connection_hdl;
     using MessagePtr = WebSocketServerType::message_ptr;
+    using MessageManager = ServerConfig::con_msg_manager_type;
     using ConnectionCallback = std::function<void(ConnectionHandle)>;
     using MessageCallback = std::function<void(ConnectionHandle, MessagePtr)>;
     
@@ -46,6 +136,24 @@ public:
      */
     ~WebSocketServer();
     
+    /**
+     * @brief Set the number of threads running the server's io_context
+     * @param count The number of threads (default: 4)
+     *
+     * Must be called before start(). Handlers for a single connection are
+     * serialized on that connection's strand, so ordering is preserved.
+     */
+    void set_thread_count(size_t count);
+    
+    /**
+     * @brief Run the server on an io_context owned by someone else
+     * @param io_context The io_context to use, e.g. ApiClient::get_io_context()
+     *
+     * Must be called before initialize(). The owner runs the context, so
+     * start() does not create threads and stop() leaves the context running.
+     */
+    void set_io_context(boost::asio::io_context& io_context);
+    
     /**
      * @brief Initialize the server
      * @return true if initialization successful, false otherwise
@@ -69,6 +177,85 @@ public:
      */
     bool is_running() const;
     
+    /**
+     * @brief Set the outbound queue limits
+     * @param config The queue configuration
+     *
+     * Must be called before start().
+     */
+    void set_send_queue_config(const SendQueueConfig& config);
+    
+    /**
+     * @brief Get the outbound queue limits
+     * @return The queue configuration
+     */
+    const SendQueueConfig& get_send_queue_config() const;
+    
+    /**
+     * @brief Set the permessage-deflate settings
+     * @param config The compression configuration; out-of-range values are clamped
+     *
+     * Must be called before initialize(). Without WEBSOCKET_PERMESSAGE_DEFLATE
+     * in the build, enabling compression only logs a warning.
+     */
+    void set_compression_config(const CompressionConfig& config);
+    
+    /**
+     * @brief Get the permessage-deflate settings
+     * @return The compression configuration
+     */
+    const CompressionConfig& get_compression_config() const;
+    
+    /**
+     * @brief Set the message coalescing settings
+     * @param config The coalescing configuration
+     *
+     * Must be called before start().
+     */
+    void set_coalescing_config(const CoalescingConfig& config);
+    
+    /**
+     * @brief Get the message coalescing settings
+     * @return The coalescing configuration
+     */
+    const CoalescingConfig& get_coalescing_config() const;
+    
+    /**
+     * @brief Set the depths and intervals accepted on depth channels
+     * @param config The depth channel configuration
+     */
+    void set_depth_channel_config(const DepthChannelConfig& config);
+    
+    /**
+     * @brief Get the depths and intervals accepted on depth channels
+     * @return The depth channel configuration
+     */
+    const DepthChannelConfig& get_depth_channel_config() const;
+    
+    /**
+     * @brief Set the prefixes of the other channels clients may subscribe to
+     * @param prefixes Channel name prefixes, "trades." by default
+     *
+     * Orderbook and ticker channels are always accepted. Must be called
+     * before start().
+     */
+    void set_channel_prefixes(const std::vector<std::string>& prefixes);
+    
+    /**
+     * @brief Get the prefixes of the other channels clients may subscribe to
+     * @return The channel name prefixes
+     */
+    const std::vector<std::string>& get_channel_prefixes() const;
+    
+    /**
+     * @brief Only accept subscriptions to instruments the registry knows
+     * @param registry The instrument registry, or nullptr to accept any instrument
+     *
+     * Any instrument is accepted while the registry is empty. Must be called
+     * before start().
+     */
+    void set_instrument_registry(std::shared_ptr<InstrumentRegistry> registry);
+    
     /**
      * @brief Set the connection open callback
      * @param callback The callback to call when a connection is opened
@@ -97,6 +284,10 @@ public:
      * @brief Broadcast a message to subscribers of a specific channel
      * @param channel The channel to broadcast to
      * @param message The message to broadcast
+     *
+     * The message is framed once and the same buffer is queued on every
+     * subscriber connection. For orderbook channels, a client whose queue is
+     * past the high-water mark only keeps the newest pending update.
      */
     void broadcast_to_channel(const std::string& channel, const std::string& message);
     
@@ -113,47 +304,299 @@ public:
      */
     size_t get_connection_count() const;
     
+    /**
+     * @brief Get the outbound traffic of every connected client
+     * @return One entry per connection
+     */
+    std::vector<ConnectionStats> get_connection_stats() const;
+    
     /**
      * @brief Handle an orderbook update from the API
      * @param instrument_name The name of the instrument
      * @param orderbook The updated orderbook
+     *
+     * JSON subscribers get the whole book and binary subscribers the levels
+     * changed since the previous update. Binary deltas are never conflated,
+     * as skipping one would leave a gap.
      */
     void handle_orderbook_update(const std::string& instrument_name, const OrderBook& orderbook);
+    
+    /**
+     * @brief Get the sequence number of an instrument's published book
+     * @param instrument_name The name of the instrument
+     * @return The number of updates handled, 0 if none
+     */
+    uint64_t get_book_sequence(const std::string& instrument_name) const;
 
 private:
+    // A message waiting for the connection's socket buffer to drain
+    struct QueuedMessage {
+        MessagePtr message;
+        std::string channel;    // Conflation key, empty if the message must not be merged
+    };
+    
+    // Outbound state of one client connection
+    struct ConnectionState {
+        ConnectionHandle hdl;
+        WebSocketServerType::connection_ptr connection;
+        std::mutex mutex;
+        std::deque<QueuedMessage> queue;
+        std::unordered_map<std::string, QueuedMessage*> latest_by_channel;
+        size_t queued_bytes{0};
+        bool closing{false};
+        bool deflate{false};
+        
+        // Small messages waiting to share a frame; only filled while the queue is empty
+        bool coalesce{false};
+        std::string batch;
+        size_t batch_messages{0};
+        std::unique_ptr<boost::asio::steady_timer> batch_timer;
+        
+        // Traffic counters
+        uint64_t frames_sent{0};
+        uint64_t bytes_sent{0};
+        uint64_t messages_coalesced{0};
+    };
+    
+    using ConnectionStatePtr = std::shared_ptr<ConnectionState>;
+    using SubscriberList = std::vector<ConnectionStatePtr>;
+    
+    // Subscriber lists are replaced rather than modified, so broadcasts can
+    // send to a snapshot without holding the subscriptions lock
+    struct ChannelSubscribers {
+        std::shared_ptr<const SubscriberList> subscribers;          // JSON text
+        std::shared_ptr<const SubscriberList> binary_subscribers;   // Binary orderbook deltas
+    };
+    
+    // A channel's published lists are rebuilt from its exact subscribers and
+    // those of the patterns matching it whenever either changes
+    struct ChannelEntry {
+        ChannelSubscribers published;
+        SubscriberList exact;           // Subscribed to this name, JSON
+        SubscriberList binary;          // Subscribed to this name, binary
+        bool held{false};               // Used by a published book or depth channel
+    };
+    
+    // An orderbook.<instrument>.<depth>.<interval> channel
+    struct DepthChannel {
+        std::string channel;
+        ChannelId id{INVALID_CHANNEL_ID};
+        size_t depth{0};
+        std::chrono::milliseconds interval{0};                  // 0 sends every change
+        std::chrono::steady_clock::time_point last_sent;
+        bool pending{false};                                    // Changed, waiting for the interval to pass
+        std::vector<std::pair<double, double>> bids;            // As last sent
+        std::vector<std::pair<double, double>> asks;
+    };
+    
+    // The last book sent for an instrument, the base of the next binary delta
+    // and of the derived channels. The mutex orders a new binary subscriber's
+    // snapshot against the deltas.
+    struct PublishedBook {
+        std::mutex mutex;
+        std::atomic<uint64_t> sequence{0};
+        OrderBook book;
+        std::string binary_message;     // Reused encoding buffer
+        
+        // Channels, interned when the book is created
+        std::string instrument_name;
+        std::string book_channel;
+        std::string ticker_channel;
+        ChannelId book_channel_id{INVALID_CHANNEL_ID};
+        ChannelId ticker_channel_id{INVALID_CHANNEL_ID};
+        
+        // Derived channels
+        bool ticker_sent{false};
+        std::pair<double, double> ticker_bid;                   // As last sent; size 0 for an empty side
+        std::pair<double, double> ticker_ask;
+        std::vector<std::shared_ptr<DepthChannel>> depth_channels;
+    };
+    
+    using ThrottledChannel = std::pair<std::shared_ptr<PublishedBook>, std::shared_ptr<DepthChannel>>;
+    
+    // A new subscriber waiting for the first book of an instrument
+    struct BookWaiter {
+        ConnectionHandle hdl;
+        std::string channel;
+        bool binary{false};
+    };
+    
+    // Shared with every handler the io_context may run after stop(); a handler only
+    // touches the server while the gate is open, and closing waits for running ones
+    struct HandlerGate {
+        std::mutex mutex;
+        std::condition_variable idle;
+        size_t running{0};
+        bool open{false};
+    };
+    
+    // How long stop() waits for connections to close
+    static constexpr std::chrono::milliseconds CLOSE_TIMEOUT{1000};
+    
+    // Levels of an initial orderbook.<instrument> message when nothing was published yet
+    static constexpr size_t INITIAL_BOOK_DEPTH = 10;
+    
     std::shared_ptr<ApiClient> api_client_;
     std::shared_ptr<OrderManager> order_manager_;
     uint16_t port_;
     std::unique_ptr<WebSocketServerType> server_;
-    std::thread server_thread_;
-    bool running_;
+    std::vector<std::thread> server_threads_;
+    size_t thread_count_{4};
+    boost::asio::io_context* external_io_context_{nullptr};
+    std::atomic<bool> running_;
+    std::shared_ptr<HandlerGate> handler_gate_;
+    std::unique_ptr<boost::asio::steady_timer> drain_timer_;
     
     // Connection management
-    std::set<ConnectionHandle, std::owner_less<ConnectionHandle>> connections_;
-    std::map<std::string, std::set<ConnectionHandle, std::owner_less<ConnectionHandle>>> channel_subscriptions_;
+    std::map<ConnectionHandle, ConnectionStatePtr, std::owner_less<ConnectionHandle>> connections_;
     std::map<ConnectionHandle, std::set<std::string>, std::owner_less<ConnectionHandle>> connection_subscriptions_;
-    std::mutex connections_mutex_;
+    mutable std::mutex connections_mutex_;
+    std::condition_variable connections_closed_;
+    std::shared_ptr<MessageManager> message_manager_;
+    
+    // Subscriptions, by channel id and by pattern
+    ChannelRouter router_;
+    std::vector<ChannelEntry> channels_;
+    std::unordered_map<std::string, SubscriberList> pattern_subscriptions_;
     std::mutex subscriptions_mutex_;
     
+    // Published books by instrument
+    std::unordered_map<std::string, std::shared_ptr<PublishedBook>> published_books_;
+    mutable std::mutex published_books_mutex_;
+    
+    // Depth channels with an interval, flushed by the drain pass
+    std::vector<ThrottledChannel> throttled_channels_;
+    std::mutex throttled_channels_mutex_;
+    DepthChannelConfig depth_channel_config_;
+    std::vector<std::string> channel_prefixes_{"trades."};
+    std::shared_ptr<InstrumentRegistry> instrument_registry_;
+    
+    // Initial books being fetched, one request per instrument
+    std::unordered_map<std::string, std::vector<BookWaiter>> pending_books_;
+    std::mutex pending_books_mutex_;
+    
+    // Outbound queues
+    SendQueueConfig send_queue_config_;
+    std::shared_ptr<Counter> queued_messages_counter_;
+    std::shared_ptr<Counter> max_queue_depth_counter_;
+    std::shared_ptr<Counter> conflated_messages_counter_;
+    std::shared_ptr<Counter> dropped_messages_counter_;
+    std::shared_ptr<Counter> slow_consumer_counter_;
+    
+    // Outbound traffic
+    CompressionConfig compression_config_;
+    CoalescingConfig coalescing_config_;
+    std::shared_ptr<Counter> frames_sent_counter_;
+    std::shared_ptr<Counter> bytes_sent_counter_;
+    std::shared_ptr<Counter> coalesced_messages_counter_;
+    std::shared_ptr<LatencyTracker> fanout_tracker_;                // One histogram across all channels
+    
     // Callbacks
     ConnectionCallback open_callback_;
     ConnectionCallback close_callback_;
     MessageCallback message_callback_;
     
+    // Wrap a handler so it does nothing once the gate has closed
+    template <typename Handler>
+    auto guarded(Handler handler) {
+        std::shared_ptr<HandlerGate> gate = handler_gate_;
+        return [gate, handler](auto&&... args) {
+            {
+                std::lock_guard<std::mutex> lock(gate->mutex);
+                if (!gate->open) {
+                    return;
+                }
+                ++gate->running;
+            }
+            
+            try {
+                handler(std::forward<decltype(args)>(args)...);
+            } catch (...) {
+                leave_gate(*gate);
+                throw;
+            }
+            leave_gate(*gate);
+        };
+    }
+    
+    static void leave_gate(HandlerGate& gate);
+    void close_gate();
+    
     // Event handlers
     void on_open(ConnectionHandle hdl);
     void on_close(ConnectionHandle hdl);
     void on_message(ConnectionHandle hdl, MessagePtr msg);
     
     // Subscription management
-    bool subscribe_client(ConnectionHandle hdl, const std::string& channel);
+    bool subscribe_client(ConnectionHandle hdl, const std::string& channel, bool binary = false);
     bool unsubscribe_client(ConnectionHandle hdl, const std::string& channel);
     void unsubscribe_all(ConnectionHandle hdl);
+    bool remove_subscriber(const std::string& channel, ConnectionHandle hdl);
+    ConnectionStatePtr find_connection(ConnectionHandle hdl);
+    bool is_subscribed(ConnectionHandle hdl, const std::string& channel);
+    ChannelSubscribers get_subscribers(ChannelId id);
+    ChannelSubscribers find_subscribers(const std::string& channel);
+    std::vector<std::string> get_matching_channels(const std::string& pattern);
+    ChannelId hold_channel(const std::string& channel);
+    void drop_channel(ChannelId id);
+    
+    // Called with the subscriptions lock held
+    ChannelId intern_channel(const std::string& channel);
+    void rebuild_subscribers(ChannelId id);
+    void release_channel(ChannelId id);
+    
+    // Published books
+    std::shared_ptr<PublishedBook> get_published_book(const std::string& instrument_name);
+    std::shared_ptr<PublishedBook> find_published_book(const std::string& instrument_name) const;
+    void validate_instrument(const std::string& instrument_name) const;
+    void validate_channel(const std::string& channel) const;
+    void validate_depth(const std::string& channel, size_t depth, std::chrono::milliseconds interval) const;
+    void release_depth_channels(const std::vector<std::string>& channels);
+    
+    // Initial books for new subscribers, served without blocking the server thread
+    void send_initial_book(ConnectionHandle hdl, const std::string& channel, const std::string& instrument_name);
+    void request_initial_book(ConnectionHandle hdl, const std::string& channel,
+                              const std::string& instrument_name, bool binary);
+    void handle_initial_book(const std::string& instrument_name, const OrderBook& orderbook);
+    std::string make_initial_message(const std::string& channel, const OrderBook& orderbook, size_t max_depth);
+    
+    // Called with the published book's mutex held
+    void subscribe_binary(ConnectionHandle hdl, const std::string& channel, PublishedBook& published);
+    
+    // Called with the published book's mutex held
+    std::shared_ptr<DepthChannel> get_depth_channel(const std::shared_ptr<PublishedBook>& published,
+                                                    const std::string& channel, size_t depth,
+                                                    std::chrono::milliseconds interval);
+    
+    // Derived channels, called with the published book's mutex held
+    void publish_ticker(PublishedBook& published);
+    void publish_depth(PublishedBook& published, DepthChannel& depth_channel);
+    void publish_throttled();
+    
+    // Message framing and queueing
+    MessagePtr make_prepared_message(const std::string& payload,
+                                     websocketpp::frame::opcode::value opcode = websocketpp::frame::opcode::text);
+    void fan_out(const SubscriberList& subscribers, const MessagePtr& message, const std::string& conflation_key);
+    void enqueue(const ConnectionStatePtr& state, const MessagePtr& message, const std::string& channel);
+    void queue_or_send(ConnectionState& state, const MessagePtr& message, const std::string& channel);
+    void add_to_batch(const ConnectionStatePtr& state, const std::string& payload);
+    void flush_batch(ConnectionState& state);
+    void drain(ConnectionState& state);
+    void drain_all();
+    void schedule_drain();
+    void send_now(ConnectionState& state, const MessagePtr& message);
+    void disconnect_slow_consumer(ConnectionState& state);
+    void discard_queue(ConnectionState& state);
     
     // Message processing
     void process_message(ConnectionHandle hdl, const std::string& message);
     void handle_subscribe_request(ConnectionHandle hdl, const json& request);
+    void handle_pattern_subscribe_request(ConnectionHandle hdl, const std::string& pattern);
+    void handle_binary_subscribe_request(ConnectionHandle hdl, const std::string& channel);
     void handle_unsubscribe_request(ConnectionHandle hdl, const json& request);
+    void handle_configure_request(ConnectionHandle hdl, const json& request);
+    std::string make_orderbook_message(const std::string& instrument_name, const OrderBook& orderbook);
+    std::string make_ticker_message(const std::string& instrument_name, const OrderBook& orderbook);
 };
 
 } // namespace deribit
@@ -0,0 +1,222 @@
+#include "binary_book_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace deribit {
+
+namespace {
+
+using Levels = std::vector<std::pair<double, double>>;
+
+constexpr size_t MAX_LEVELS = std::numeric_limits<uint16_t>::max();
+
+// Offsets of the header fields
+constexpr size_t TYPE_OFFSET = 0;
+constexpr size_t VERSION_OFFSET = 1;
+constexpr size_t NAME_LENGTH_OFFSET = 2;
+constexpr size_t BID_COUNT_OFFSET = 4;
+constexpr size_t ASK_COUNT_OFFSET = 6;
+constexpr size_t SEQUENCE_OFFSET = 8;
+constexpr size_t TIMESTAMP_OFFSET = 16;
+
+// Written byte by byte so the layout does not depend on the host byte order
+void store_le(char* out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+uint64_t load_le(const char* in, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    return value;
+}
+
+void append_level(std::string& out, double price, double size) {
+    uint64_t bits[2];
+    std::memcpy(&bits[0], &price, sizeof(double));
+    std::memcpy(&bits[1], &size, sizeof(double));
+
+    char buffer[BINARY_BOOK_LEVEL_SIZE];
+    store_le(buffer, bits[0], 8);
+    store_le(buffer + 8, bits[1], 8);
+    out.append(buffer, sizeof(buffer));
+}
+
+std::pair<double, double> load_level(const char* in) {
+    uint64_t price_bits = load_le(in, 8);
+    uint64_t size_bits = load_le(in + 8, 8);
+
+    std::pair<double, double> level;
+    std::memcpy(&level.first, &price_bits, sizeof(double));
+    std::memcpy(&level.second, &size_bits, sizeof(double));
+    return level;
+}
+
+// Writes the header with zero level counts and returns its offset in out
+size_t append_header(std::string& out, BinaryMessageType type, std::string_view instrument_name,
+                     uint64_t sequence, int64_t timestamp) {
+    size_t start = out.size();
+    size_t name_length = std::min<size_t>(instrument_name.size(), std::numeric_limits<uint16_t>::max());
+
+    char header[BINARY_BOOK_HEADER_SIZE] = {};
+    store_le(header + TYPE_OFFSET, static_cast<uint8_t>(type), 1);
+    store_le(header + VERSION_OFFSET, BINARY_PROTOCOL_VERSION, 1);
+    store_le(header + NAME_LENGTH_OFFSET, name_length, 2);
+    store_le(header + SEQUENCE_OFFSET, sequence, 8);
+    store_le(header + TIMESTAMP_OFFSET, static_cast<uint64_t>(timestamp), 8);
+
+    out.append(header, sizeof(header));
+    out.append(instrument_name.data(), name_length);
+    return start;
+}
+
+void set_counts(std::string& out, size_t start, size_t bid_count, size_t ask_count) {
+    store_le(&out[start + BID_COUNT_OFFSET], bid_count, 2);
+    store_le(&out[start + ASK_COUNT_OFFSET], ask_count, 2);
+}
+
+size_t append_levels(std::string& out, const Levels& levels) {
+    size_t count = std::min(levels.size(), MAX_LEVELS);
+    for (size_t i = 0; i < count; ++i) {
+        append_level(out, levels[i].first, levels[i].second);
+    }
+    return count;
+}
+
+// Bids are best first in descending price order, asks in ascending order
+bool ahead(double a, double b, bool descending) {
+    return descending ? a > b : a < b;
+}
+
+// Walks both sides in book order, writing only what differs
+size_t append_side_delta(std::string& out, const Levels& old_levels, const Levels& levels, bool descending) {
+    size_t count = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    while ((i < old_levels.size() || j < levels.size()) && count < MAX_LEVELS) {
+        if (j == levels.size() ||
+            (i < old_levels.size() && ahead(old_levels[i].first, levels[j].first, descending))) {
+            // The price is no longer in the book
+            append_level(out, old_levels[i].first, 0.0);
+            ++count;
+            ++i;
+        } else if (i == old_levels.size() || ahead(levels[j].first, old_levels[i].first, descending)) {
+            append_level(out, levels[j].first, levels[j].second);
+            ++count;
+            ++j;
+        } else {
+            if (levels[j].second != old_levels[i].second) {
+                append_level(out, levels[j].first, levels[j].second);
+                ++count;
+            }
+            ++i;
+            ++j;
+        }
+    }
+
+    return count;
+}
+
+void apply_side_delta(Levels& levels, const Levels& changes, bool descending) {
+    for (const auto& change : changes) {
+        auto it = std::lower_bound(levels.begin(), levels.end(), change.first,
+                                   [descending](const std::pair<double, double>& level, double price) {
+                                       return ahead(level.first, price, descending);
+                                   });
+
+        bool found = it != levels.end() && it->first == change.first;
+        if (change.second == 0.0) {
+            if (found) {
+                levels.erase(it);
+            }
+        } else if (found) {
+            it->second = change.second;
+        } else {
+            levels.insert(it, change);
+        }
+    }
+}
+
+} // namespace
+
+void write_binary_book_snapshot(std::string& out,
+                                std::string_view instrument_name,
+                                uint64_t sequence,
+                                int64_t timestamp,
+                                const Levels& bids,
+                                const Levels& asks) {
+    size_t start = append_header(out, BinaryMessageType::BOOK_SNAPSHOT, instrument_name, sequence, timestamp);
+    size_t bid_count = append_levels(out, bids);
+    size_t ask_count = append_levels(out, asks);
+    set_counts(out, start, bid_count, ask_count);
+}
+
+void write_binary_book_delta(std::string& out,
+                             std::string_view instrument_name,
+                             uint64_t sequence,
+                             int64_t timestamp,
+                             const Levels& old_bids,
+                             const Levels& old_asks,
+                             const Levels& bids,
+                             const Levels& asks) {
+    size_t start = append_header(out, BinaryMessageType::BOOK_DELTA, instrument_name, sequence, timestamp);
+    size_t bid_count = append_side_delta(out, old_bids, bids, true);
+    size_t ask_count = append_side_delta(out, old_asks, asks, false);
+    set_counts(out, start, bid_count, ask_count);
+}
+
+bool read_binary_book(std::string_view data, BinaryBookMessage& message) {
+    if (data.size() < BINARY_BOOK_HEADER_SIZE) {
+        return false;
+    }
+
+    const char* in = data.data();
+    uint8_t type = static_cast<uint8_t>(load_le(in + TYPE_OFFSET, 1));
+    if (type != static_cast<uint8_t>(BinaryMessageType::BOOK_SNAPSHOT) &&
+        type != static_cast<uint8_t>(BinaryMessageType::BOOK_DELTA)) {
+        return false;
+    }
+
+    if (load_le(in + VERSION_OFFSET, 1) != BINARY_PROTOCOL_VERSION) {
+        return false;
+    }
+
+    size_t name_length = load_le(in + NAME_LENGTH_OFFSET, 2);
+    size_t bid_count = load_le(in + BID_COUNT_OFFSET, 2);
+    size_t ask_count = load_le(in + ASK_COUNT_OFFSET, 2);
+
+    if (data.size() != BINARY_BOOK_HEADER_SIZE + name_length + (bid_count + ask_count) * BINARY_BOOK_LEVEL_SIZE) {
+        return false;
+    }
+
+    message.type = static_cast<BinaryMessageType>(type);
+    message.sequence = load_le(in + SEQUENCE_OFFSET, 8);
+    message.timestamp = static_cast<int64_t>(load_le(in + TIMESTAMP_OFFSET, 8));
+    message.instrument_name = data.substr(BINARY_BOOK_HEADER_SIZE, name_length);
+
+    const char* level = in + BINARY_BOOK_HEADER_SIZE + name_length;
+
+    message.bids.clear();
+    for (size_t i = 0; i < bid_count; ++i, level += BINARY_BOOK_LEVEL_SIZE) {
+        message.bids.push_back(load_level(level));
+    }
+
+    message.asks.clear();
+    for (size_t i = 0; i < ask_count; ++i, level += BINARY_BOOK_LEVEL_SIZE) {
+        message.asks.push_back(load_level(level));
+    }
+
+    return true;
+}
+
+void apply_binary_book_delta(Levels& bids, Levels& asks, const BinaryBookMessage& delta) {
+    apply_side_delta(bids, delta.bids, true);
+    apply_side_delta(asks, delta.asks, false);
+}
+
+} // namespace deribit
\ No newline at end of file
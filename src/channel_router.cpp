@@ -0,0 +1,239 @@
+#include "channel_router.h"
+#include <algorithm>
+
+namespace deribit {
+
+namespace {
+
+// Literal part of a pattern before its first wildcard
+std::string_view literal_prefix(std::string_view pattern) {
+    return pattern.substr(0, std::min(pattern.find('*'), pattern.size()));
+}
+
+// Matches one '.'-free segment; a '*' may stand for any run of characters
+bool matches_segment(std::string_view pattern, std::string_view text) {
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::string_view::npos;
+    size_t star_text = 0;
+
+    while (t < text.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_text = t;
+        } else if (p < pattern.size() && pattern[p] == text[t]) {
+            ++p;
+            ++t;
+        } else if (star != std::string_view::npos) {
+            // Let the last '*' take one more character and retry from there
+            p = star + 1;
+            t = ++star_text;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+
+    return p == pattern.size();
+}
+
+} // namespace
+
+ChannelRouter::ChannelRouter()
+    : root_(std::make_unique<Node>()) {
+}
+
+ChannelRouter::~ChannelRouter() = default;
+
+ChannelId ChannelRouter::intern(const std::string& channel) {
+    auto it = ids_.find(channel);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+
+    ChannelId id;
+    if (!free_ids_.empty()) {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+        names_[id] = channel;
+    } else {
+        id = static_cast<ChannelId>(names_.size());
+        names_.push_back(channel);
+    }
+    ids_.emplace(channel, id);
+    walk(channel, true)->channel = id;
+    return id;
+}
+
+ChannelId ChannelRouter::find(const std::string& channel) const {
+    auto it = ids_.find(channel);
+    return it != ids_.end() ? it->second : INVALID_CHANNEL_ID;
+}
+
+void ChannelRouter::release(ChannelId id) {
+    std::string channel = std::move(names_[id]);
+    names_[id].clear();
+    ids_.erase(channel);
+    free_ids_.push_back(id);
+
+    walk(channel, false)->channel = INVALID_CHANNEL_ID;
+    prune(channel);
+}
+
+const std::string& ChannelRouter::name(ChannelId id) const {
+    return names_[id];
+}
+
+size_t ChannelRouter::channel_count() const {
+    return ids_.size();
+}
+
+bool ChannelRouter::add_pattern(const std::string& pattern) {
+    Node* node = walk(literal_prefix(pattern), true);
+    if (std::find(node->patterns.begin(), node->patterns.end(), pattern) != node->patterns.end()) {
+        return false;
+    }
+
+    node->patterns.push_back(pattern);
+    return true;
+}
+
+bool ChannelRouter::remove_pattern(const std::string& pattern) {
+    Node* node = walk(literal_prefix(pattern), false);
+    if (!node) {
+        return false;
+    }
+
+    auto it = std::find(node->patterns.begin(), node->patterns.end(), pattern);
+    if (it == node->patterns.end()) {
+        return false;
+    }
+
+    node->patterns.erase(it);
+    prune(literal_prefix(pattern));
+    return true;
+}
+
+std::vector<ChannelId> ChannelRouter::match_channels(const std::string& pattern) const {
+    std::vector<ChannelId> channels;
+
+    const Node* node = walk(literal_prefix(pattern));
+    if (node) {
+        collect_channels(*node, pattern, channels);
+    }
+
+    return channels;
+}
+
+std::vector<std::string> ChannelRouter::match_patterns(std::string_view channel) const {
+    std::vector<std::string> patterns;
+
+    // Only patterns whose literal prefix is a prefix of the channel can match
+    const Node* node = root_.get();
+    for (size_t i = 0;; ++i) {
+        for (const auto& pattern : node->patterns) {
+            if (matches(pattern, channel)) {
+                patterns.push_back(pattern);
+            }
+        }
+
+        if (i == channel.size()) {
+            break;
+        }
+
+        auto child = std::find_if(node->children.begin(), node->children.end(),
+                                  [c = channel[i]](const auto& entry) { return entry.first == c; });
+        if (child == node->children.end()) {
+            break;
+        }
+        node = child->second.get();
+    }
+
+    return patterns;
+}
+
+bool ChannelRouter::is_pattern(std::string_view channel) {
+    return channel.find('*') != std::string_view::npos;
+}
+
+bool ChannelRouter::matches(std::string_view pattern, std::string_view channel) {
+    // '*' never crosses a '.', so the segments pair up one to one
+    while (true) {
+        size_t pattern_dot = pattern.find('.');
+        size_t channel_dot = channel.find('.');
+
+        if (!matches_segment(pattern.substr(0, pattern_dot), channel.substr(0, channel_dot))) {
+            return false;
+        }
+
+        if (pattern_dot == std::string_view::npos || channel_dot == std::string_view::npos) {
+            return pattern_dot == channel_dot;
+        }
+
+        pattern.remove_prefix(pattern_dot + 1);
+        channel.remove_prefix(channel_dot + 1);
+    }
+}
+
+ChannelRouter::Node* ChannelRouter::walk(std::string_view prefix, bool create) {
+    Node* node = root_.get();
+
+    for (char c : prefix) {
+        auto child = std::find_if(node->children.begin(), node->children.end(),
+                                  [c](const auto& entry) { return entry.first == c; });
+        if (child != node->children.end()) {
+            node = child->second.get();
+        } else if (create) {
+            node->children.emplace_back(c, std::make_unique<Node>());
+            node = node->children.back().second.get();
+        } else {
+            return nullptr;
+        }
+    }
+
+    return node;
+}
+
+const ChannelRouter::Node* ChannelRouter::walk(std::string_view prefix) const {
+    return const_cast<ChannelRouter*>(this)->walk(prefix, false);
+}
+
+void ChannelRouter::prune(std::string_view prefix) {
+    std::vector<Node*> path{root_.get()};
+    for (char c : prefix) {
+        auto& children = path.back()->children;
+        auto child = std::find_if(children.begin(), children.end(),
+                                  [c](const auto& entry) { return entry.first == c; });
+        if (child == children.end()) {
+            return;
+        }
+        path.push_back(child->second.get());
+    }
+
+    // Nodes shared with other channels or patterns stay
+    for (size_t i = path.size() - 1; i > 0; --i) {
+        const Node* node = path[i];
+        if (node->channel != INVALID_CHANNEL_ID || !node->patterns.empty() || !node->children.empty()) {
+            break;
+        }
+
+        auto& siblings = path[i - 1]->children;
+        siblings.erase(std::find_if(siblings.begin(), siblings.end(),
+                                    [node](const auto& entry) { return entry.second.get() == node; }));
+    }
+}
+
+void ChannelRouter::collect_channels(const Node& node, const std::string& pattern, std::vector<ChannelId>& out) const {
+    if (node.channel != INVALID_CHANNEL_ID && matches(pattern, names_[node.channel])) {
+        out.push_back(node.channel);
+    }
+
+    for (const auto& child : node.children) {
+        collect_channels(*child.second, pattern, out);
+    }
+}
+
+} // namespace deribit
\ No newline at end of file
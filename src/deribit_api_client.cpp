@@ -1,8 +1,12 @@
 #include "deribit_api_client.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <future>
+#include <charconv>
+#include <unordered_set>
 #include <openssl/hmac.h>
 #include <openssl/sha.h>
 #include <boost/beast/core.hpp>
@@ -13,6 +17,10 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl/error.hpp>
 #include <boost/asio/ssl/stream.hpp>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace deribit {
 
@@ -22,12 +30,44 @@ namespace net = boost::asio;
 namespace ssl = net::ssl;
 using tcp = net::ip::tcp;
 
+namespace {
+
+int64_t steady_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reads the change_id of book notification data without decoding the rest
+bool find_change_id(std::string_view data, int64_t& change_id) {
+    static constexpr std::string_view key = "\"change_id\":";
+    
+    size_t pos = data.find(key);
+    if (pos == std::string_view::npos) {
+        return false;
+    }
+    
+    pos += key.size();
+    while (pos < data.size() && data[pos] == ' ') {
+        ++pos;
+    }
+    
+    auto result = std::from_chars(data.data() + pos, data.data() + data.size(), change_id);
+    return result.ec == std::errc();
+}
+
+} // namespace
+
 ApiClient::ApiClient(const std::string& api_key, const std::string& api_secret, bool test_mode)
     : api_key_(api_key),
       api_secret_(api_secret),
       test_mode_(test_mode),
       authenticated_(false),
       websocket_connected_(false),
+      websocket_authenticated_(false),
+      channel_table_(std::make_shared<ChannelTable>()),
+      websocket_channel_table_(channel_table_),
+      websocket_open_(false),
+      websocket_failed_(false),
       running_(false) {
     
     // Set API URLs based on test mode
@@ -38,18 +78,64 @@ ApiClient::ApiClient(const std::string& api_key, const std::string& api_secret,
         api_url_ = "https://www.deribit.com";
         websocket_url_ = "wss://www.deribit.com/ws/api/v2";
     }
+    
+    // Create HTTPS connection pool
+    http_pool_ = std::make_unique<HttpsConnectionPool>(api_url_.substr(8));
 }
 
 ApiClient::~ApiClient() {
-    // Stop message processing thread
+    // Stop the rate limiter, failing requests still waiting for credit
+    if (scheduler_) {
+        scheduler_->stop();
+    }
+    
+    // Stop message processing workers
     running_ = false;
-    if (message_thread_.joinable()) {
-        queue_condition_.notify_all();
-        message_thread_.join();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->waiter->notify_all();
+            worker->thread.join();
+        }
+    }
+    
+    // Stop request timeout thread
+    if (timeout_thread_.joinable()) {
+        timeout_condition_.notify_all();
+        timeout_thread_.join();
+    }
+    
+    // Stop reconnecting
+    if (reconnect_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(reconnect_mutex_);
+        }
+        reconnect_condition_.notify_all();
+        reconnect_thread_.join();
+    }
+    
+    // Stop token refresh thread
+    if (auth_thread_.joinable()) {
+        {
+            // Ensures the thread is either waiting or will see running_ cleared
+            std::lock_guard<std::mutex> lock(auth_thread_mutex_);
+        }
+        auth_condition_.notify_all();
+        auth_thread_.join();
     }
     
     // Disconnect WebSocket
     disconnect_websocket();
+    
+    // Let queued asynchronous requests finish, then stop I/O threads
+    io_work_.reset();
+    for (auto& thread : io_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    
+    // Close pooled HTTPS connections
+    http_pool_->stop();
 }
 
 bool ApiClient::initialize() {
@@ -65,9 +151,63 @@ bool ApiClient::initialize() {
             return websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23);
         });
         
-        // Start message processing thread
+        // Start HTTPS connection pool maintenance
+        http_pool_->start();
+        
+        // Start the rate limiter
+        if (rate_limit_config_.enabled) {
+            scheduler_ = std::make_unique<RequestScheduler>(rate_limit_config_);
+            scheduler_->start();
+        }
+        
+        // Start shared I/O threads for asynchronous requests
+        io_work_ = std::make_unique<net::executor_work_guard<net::io_context::executor_type>>(
+            net::make_work_guard(io_context_));
+        for (size_t i = 0; i < io_thread_count_; ++i) {
+            io_threads_.emplace_back([this]() {
+                try {
+                    io_context_.run();
+                } catch (const std::exception& e) {
+                    std::cerr << "I/O thread error: " << e.what() << std::endl;
+                }
+            });
+        }
+        
+        // Create the message workers, each with its own queue and metrics
+        auto& monitor = PerformanceMonitor::instance();
+        queue_overflow_counter_ = monitor.get_counter("api_message_queue_overflows");
+        
+        size_t worker_count = get_worker_count();
+        for (size_t i = 0; i < worker_count; ++i) {
+            auto worker = std::make_unique<MessageWorker>();
+            std::string suffix = "." + std::to_string(i);
+            
+            worker->index = i;
+            worker->queue = std::make_unique<MpscRingBuffer<QueuedMessage>>(message_queue_config_.capacity);
+            worker->waiter = std::make_unique<QueueWaiter>(message_queue_config_.wait_policy,
+                                                           message_queue_config_.spin_iterations);
+            worker->depth_counter = monitor.get_counter("api_message_queue_depth" + suffix);
+            worker->max_depth_counter = monitor.get_counter("api_message_queue_max_depth" + suffix);
+            worker->residency_tracker = monitor.get_tracker("api_message_queue_residency" + suffix, true);
+            worker->processing_tracker = monitor.get_tracker("api_message_processing" + suffix, true);
+            
+            workers_.push_back(std::move(worker));
+        }
+        
+        // Start message processing workers
         running_ = true;
-        message_thread_ = std::thread(&ApiClient::process_message_queue, this);
+        for (auto& worker : workers_) {
+            worker->thread = std::thread(&ApiClient::process_message_queue, this, std::ref(*worker));
+        }
+        
+        // Start WebSocket request timeout thread
+        timeout_thread_ = std::thread(&ApiClient::process_request_timeouts, this);
+        
+        // Start background token refresh
+        auth_thread_ = std::thread(&ApiClient::process_token_refresh, this);
+        
+        // Start WebSocket session supervision
+        reconnect_thread_ = std::thread(&ApiClient::process_reconnects, this);
         
         return true;
     } catch (const std::exception& e) {
@@ -76,6 +216,53 @@ bool ApiClient::initialize() {
     }
 }
 
+bool ApiClient::set_connection_pool_config(const ConnectionPoolConfig& config) {
+    // Request threads use the pool without a lock once initialize() has started it
+    if (websocket_client_) {
+        std::cerr << "Connection pool config ignored: the client is already initialized" << std::endl;
+        return false;
+    }
+    
+    http_pool_ = std::make_unique<HttpsConnectionPool>(api_url_.substr(8), "443", config);
+    return true;
+}
+
+void ApiClient::set_io_thread_count(size_t count) {
+    io_thread_count_ = std::max<size_t>(1, count);
+}
+
+void ApiClient::set_message_queue_config(const MessageQueueConfig& config) {
+    message_queue_config_ = config;
+}
+
+size_t ApiClient::get_worker_count() const {
+    return std::max<size_t>(1, message_queue_config_.worker_count);
+}
+
+size_t ApiClient::shard_for_channel(const std::string& channel) const {
+    // Hash the instrument part of "kind.instrument.interval" so an instrument's channels share a worker
+    std::string_view key(channel);
+    size_t first = key.find('.');
+    if (first != std::string_view::npos) {
+        size_t second = key.find('.', first + 1);
+        key = key.substr(first + 1, second == std::string_view::npos ? std::string_view::npos : second - first - 1);
+    }
+    
+    return std::hash<std::string_view>()(key) % get_worker_count();
+}
+
+void ApiClient::set_rate_limit_config(const RateLimitConfig& config) {
+    rate_limit_config_ = config;
+}
+
+RequestScheduler* ApiClient::get_request_scheduler() const {
+    return scheduler_.get();
+}
+
+boost::asio::io_context& ApiClient::get_io_context() {
+    return io_context_;
+}
+
 bool ApiClient::authenticate() {
     std::lock_guard<std::mutex> lock(auth_mutex_);
     
@@ -87,104 +274,84 @@ bool ApiClient::authenticate() {
             {"client_secret", api_secret_}
         };
         
-        // Make authentication request
-        ApiResponse response = public_request("public/auth", params);
-        
-        if (response.success) {
-            // Store authentication tokens
-            credentials_.api_key = api_key_;
-            credentials_.api_secret = api_secret_;
-            credentials_.access_token = response.data["result"]["access_token"];
-            credentials_.refresh_token = response.data["result"]["refresh_token"];
-            
-            // Calculate token expiry time
-            int expires_in = response.data["result"]["expires_in"];
-            credentials_.token_expiry = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
-            
-            authenticated_ = true;
-            return true;
-        } else {
-            std::cerr << "Authentication failed: " << response.error_message << std::endl;
-            return false;
-        }
+        return request_token(params);
     } catch (const std::exception& e) {
         std::cerr << "Error during authentication: " << e.what() << std::endl;
         return false;
     }
 }
 
+void ApiClient::set_token_refresh_margin(std::chrono::seconds margin) {
+    {
+        std::lock_guard<std::mutex> lock(auth_thread_mutex_);
+        token_refresh_margin_ = margin;
+    }
+    auth_condition_.notify_all();
+}
+
 ApiResponse ApiClient::public_request(const std::string& method, const json& params) {
+    if (!acquire_request_slot(method)) {
+        ApiResponse response;
+        response.success = false;
+        response.error_message = "Rate limit queue full";
+        return response;
+    }
+    
+    return send_public_request(method, params);
+}
+
+ApiResponse ApiClient::private_request(const std::string& method, const json& params) {
+    if (!acquire_request_slot(method)) {
+        ApiResponse response;
+        response.success = false;
+        response.error_message = "Rate limit queue full";
+        return response;
+    }
+    
+    return send_private_request(method, params);
+}
+
+bool ApiClient::acquire_request_slot(const std::string& method) {
+    if (!scheduler_) {
+        return true;
+    }
+    
+    // The scheduler only signals the slot; the request itself runs in this thread
+    auto slot = std::make_shared<std::promise<bool>>();
+    std::future<bool> granted = slot->get_future();
+    
+    scheduler_->submit(method, json::object(),
+        [slot](const ApiResponse&) {
+            slot->set_value(false);
+        },
+        [slot](const std::string&, const json&, ResponseCallback) {
+            slot->set_value(true);
+        },
+        false);
+    
+    return granted.get();
+}
+
+ApiResponse ApiClient::send_public_request(const std::string& method, const json& params) {
     try {
-        // Parse URL
-        std::string host = api_url_.substr(8); // Remove "https://"
+        // Build request target
         std::string target = "/api/v2/" + method;
         
         // Create request body
         json request_body = {
             {"jsonrpc", "2.0"},
-            {"id", 42},
+            {"id", next_request_id_++},
             {"method", method},
             {"params", params}
         };
         
         std::string body = request_body.dump();
         
-        // Set up SSL context
-        ssl::context ctx(ssl::context::tlsv12_client);
-        ctx.set_default_verify_paths();
-        
-        // Create and connect socket
-        net::io_context ioc;
-        tcp::resolver resolver(ioc);
-        beast::ssl_stream<beast::tcp_stream> stream(ioc, ctx);
-        
-        // Set SNI hostname (required for SSL)
-        if (!SSL_set_tlsext_host_name(stream.native_handle(), host.c_str())) {
-            beast::error_code ec{static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
-            throw beast::system_error{ec};
-        }
-        
-        // Resolve and connect
-        auto const results = resolver.resolve(host, "443");
-        beast::get_lowest_layer(stream).connect(results);
-        
-        // Perform SSL handshake
-        stream.handshake(ssl::stream_base::client);
-        
-        // Create HTTP request
-        http::request<http::string_body> req{http::verb::post, target, 11};
-        req.set(http::field::host, host);
-        req.set(http::field::user_agent, "DeribitTradingSystem/1.0");
-        req.set(http::field::content_type, "application/json");
-        req.set(http::field::accept, "application/json");
-        req.body() = body;
-        req.prepare_payload();
-        
-        // Send HTTP request
-        http::write(stream, req);
-        
-        // Receive HTTP response
-        beast::flat_buffer buffer;
-        http::response<http::string_body> res;
-        http::read(stream, buffer, res);
-        
-        // Close connection
-        beast::error_code ec;
-        stream.shutdown(ec);
+        // Send over a pooled keep-alive connection
+        std::string response_body = http_pool_->post(target, body);
         
         // Parse response
-        json response_json = json::parse(res.body());
-        
-        ApiResponse api_response;
-        if (response_json.contains("error")) {
-            api_response.success = false;
-            api_response.error_message = response_json["error"]["message"];
-        } else {
-            api_response.success = true;
-            api_response.data = response_json;
-        }
-        
-        return api_response;
+        return parse_response(json::parse(response_body));
     } catch (const std::exception& e) {
         ApiResponse api_response;
         api_response.success = false;
@@ -193,9 +360,7 @@ ApiResponse ApiClient::public_request(const std::string& method, const json& par
     }
 }
 
-ApiResponse ApiClient::private_request(const std::string& method, const json& params) {
-    std::lock_guard<std::mutex> lock(auth_mutex_);
-    
+ApiResponse ApiClient::send_private_request(const std::string& method, const json& params) {
     // Check if authenticated
     if (!authenticated_) {
         ApiResponse response;
@@ -204,22 +369,30 @@ ApiResponse ApiClient::private_request(const std::string& method, const json& pa
         return response;
     }
     
-    // Check if token is expired
-    if (std::chrono::system_clock::now() >= credentials_.token_expiry) {
-        if (!refresh_token()) {
+    // The token is refreshed in the background, so this is normally lock-free
+    std::shared_ptr<const ApiCredentials> credentials = current_credentials();
+    std::string access_token = credentials->access_token;
+    
+    if (std::chrono::system_clock::now() >= credentials->token_expiry) {
+        // Only reached when background refreshes have failed until expiry
+        std::lock_guard<std::mutex> lock(auth_mutex_);
+        
+        if (std::chrono::system_clock::now() >= current_credentials()->token_expiry && !refresh_token()) {
             ApiResponse response;
             response.success = false;
             response.error_message = "Failed to refresh token";
             return response;
         }
+        
+        access_token = current_credentials()->access_token;
     }
     
     try {
         // Create request with authentication
         json auth_params = params;
-        auth_params["access_token"] = credentials_.access_token;
+        auth_params["access_token"] = access_token;
         
-        return public_request(method, auth_params);
+        return send_public_request(method, auth_params);
     } catch (const std::exception& e) {
         ApiResponse response;
         response.success = false;
@@ -228,6 +401,188 @@ ApiResponse ApiClient::private_request(const std::string& method, const json& pa
     }
 }
 
+std::future<ApiResponse> ApiClient::public_request_async(const std::string& method, const json& params) {
+    auto promise = std::make_shared<std::promise<ApiResponse>>();
+    std::future<ApiResponse> future = promise->get_future();
+    
+    public_request_async(method, params, [promise](const ApiResponse& response) {
+        promise->set_value(response);
+    });
+    
+    return future;
+}
+
+void ApiClient::public_request_async(const std::string& method, const json& params, ResponseCallback callback) {
+    // Each I/O thread uses its own pooled connection, so requests run concurrently
+    auto send = [this](const std::string& method, const json& params, ResponseCallback callback) {
+        net::post(io_context_, [this, method, params, callback]() {
+            ApiResponse response = send_public_request(method, params);
+            
+            try {
+                callback(response);
+            } catch (const std::exception& e) {
+                std::cerr << "Error in request callback: " << e.what() << std::endl;
+            }
+        });
+    };
+    
+    if (scheduler_) {
+        scheduler_->submit(method, params, callback, send);
+        return;
+    }
+    
+    send(method, params, callback);
+}
+
+std::future<ApiResponse> ApiClient::private_request_async(const std::string& method, const json& params) {
+    auto promise = std::make_shared<std::promise<ApiResponse>>();
+    std::future<ApiResponse> future = promise->get_future();
+    
+    private_request_async(method, params, [promise](const ApiResponse& response) {
+        promise->set_value(response);
+    });
+    
+    return future;
+}
+
+void ApiClient::private_request_async(const std::string& method, const json& params, ResponseCallback callback) {
+    auto send = [this](const std::string& method, const json& params, ResponseCallback callback) {
+        net::post(io_context_, [this, method, params, callback]() {
+            ApiResponse response = send_private_request(method, params);
+            
+            try {
+                callback(response);
+            } catch (const std::exception& e) {
+                std::cerr << "Error in request callback: " << e.what() << std::endl;
+            }
+        });
+    };
+    
+    if (scheduler_) {
+        scheduler_->submit(method, params, callback, send);
+        return;
+    }
+    
+    send(method, params, callback);
+}
+
+ApiResponse ApiClient::websocket_request(const std::string& method,
+                                         const json& params,
+                                         std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<ApiResponse>>();
+    std::future<ApiResponse> future = promise->get_future();
+    
+    websocket_request_async(method, params, [promise](const ApiResponse& response) {
+        promise->set_value(response);
+    }, timeout);
+    
+    // The callback always runs: on reply, on send failure, on timeout or on disconnect
+    return future.get();
+}
+
+uint64_t ApiClient::websocket_request_async(const std::string& method,
+                                            const json& params,
+                                            ResponseCallback callback,
+                                            std::chrono::milliseconds timeout) {
+    if (!websocket_connected_) {
+        ApiResponse response;
+        response.success = false;
+        response.error_message = "WebSocket not connected";
+        callback(response);
+        return 0;
+    }
+    
+    uint64_t id = next_request_id_++;
+    
+    if (timeout.count() <= 0) {
+        timeout = request_timeout_;
+    }
+    
+    // The request belongs to the current connection and is not sent on a later one
+    uint64_t session = 0;
+    {
+        std::lock_guard<std::mutex> lock(websocket_connection_mutex_);
+        session = websocket_session_;
+    }
+    
+    // Queued requests keep their ID; the timeout starts once they are sent
+    if (scheduler_) {
+        scheduler_->submit(method, params, callback,
+            [this, id, session, timeout](const std::string& method, const json& params, ResponseCallback callback) {
+                net::post(io_context_, [this, id, session, method, params, callback, timeout]() {
+                    send_websocket_request(id, session, method, params, callback, timeout);
+                });
+            });
+        return id;
+    }
+    
+    return send_websocket_request(id, session, method, params, callback, timeout) ? id : 0;
+}
+
+bool ApiClient::send_websocket_request(uint64_t id,
+                                       uint64_t session,
+                                       const std::string& method,
+                                       const json& params,
+                                       ResponseCallback callback,
+                                       std::chrono::milliseconds timeout) {
+    // Register the request before sending so a fast reply always finds it
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_requests_[id] = PendingRequest{method, callback, std::chrono::steady_clock::now() + timeout};
+    }
+    
+    try {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", id},
+            {"method", method},
+            {"params", params}
+        };
+        
+        // Send request; the lock keeps a reconnect from swapping the connection meanwhile
+        websocketpp::lib::error_code ec;
+        {
+            std::lock_guard<std::mutex> lock(websocket_connection_mutex_);
+            
+            if (!websocket_connected_) {
+                throw std::runtime_error("not connected");
+            }
+            
+            if (session != websocket_session_) {
+                throw std::runtime_error("connection was reopened after the request was issued");
+            }
+            
+            websocket_client_->send(websocket_connection_, request.dump(), websocketpp::frame::opcode::text, ec);
+        }
+        
+        if (ec) {
+            throw std::runtime_error(ec.message());
+        }
+        
+        return true;
+    } catch (const std::exception& e) {
+        // Remove the request unless a reply or timeout already completed it
+        bool pending = false;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            pending = pending_requests_.erase(id) > 0;
+        }
+        
+        if (pending) {
+            ApiResponse response;
+            response.success = false;
+            response.error_message = std::string("WebSocket send error: ") + e.what();
+            callback(response);
+        }
+        
+        return false;
+    }
+}
+
+void ApiClient::set_request_timeout(std::chrono::milliseconds timeout) {
+    request_timeout_ = timeout;
+}
+
 bool ApiClient::connect_websocket() {
     std::lock_guard<std::mutex> lock(websocket_mutex_);
     
@@ -235,12 +590,63 @@ bool ApiClient::connect_websocket() {
         return true;
     }
     
+    if (!open_websocket()) {
+        return false;
+    }
+    
+    // From here on a dropped connection is reopened
+    websocket_wanted_ = true;
+    
+    // Added feeds that fail to open now are retried by the supervisor
+    for (size_t i = 1; i < feeds_.size(); ++i) {
+        open_feed(*feeds_[i]);
+    }
+    
+    return true;
+}
+
+bool ApiClient::open_websocket() {
     try {
-        // Set message handler
+        // Clean up a previous session whose thread has finished
+        if (websocket_thread_.joinable()) {
+            websocket_thread_.join();
+        }
+        
+        {
+            std::lock_guard<std::mutex> connection_lock(websocket_connection_mutex_);
+            websocket_client_->reset();
+        }
+        
+        {
+            std::lock_guard<std::mutex> state_lock(websocket_state_mutex_);
+            websocket_open_ = false;
+            websocket_failed_ = false;
+        }
+        
+        // Set handlers
         websocket_client_->set_message_handler(
             std::bind(&ApiClient::websocket_message_handler, this, std::placeholders::_1, std::placeholders::_2)
         );
         
+        websocket_client_->set_open_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> state_lock(websocket_state_mutex_);
+            websocket_open_ = true;
+            websocket_state_condition_.notify_all();
+        });
+        
+        websocket_client_->set_fail_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> state_lock(websocket_state_mutex_);
+            websocket_failed_ = true;
+            websocket_state_condition_.notify_all();
+        });
+        
+        websocket_client_->set_close_handler([this](websocketpp::connection_hdl) {
+            websocket_connected_ = false;
+            websocket_authenticated_ = false;
+            fail_pending_requests("WebSocket connection closed");
+            handle_connection_lost();
+        });
+        
         // Connect to WebSocket server
         websocketpp::lib::error_code ec;
         WebSocketClient::connection_ptr con = websocket_client_->get_connection(websocket_url_, ec);
@@ -250,7 +656,11 @@ bool ApiClient::connect_websocket() {
             return false;
         }
         
-        websocket_connection_ = con->get_handle();
+        {
+            std::lock_guard<std::mutex> connection_lock(websocket_connection_mutex_);
+            websocket_connection_ = con->get_handle();
+            ++websocket_session_;
+        }
         websocket_client_->connect(con);
         
         // Start WebSocket thread
@@ -262,7 +672,27 @@ bool ApiClient::connect_websocket() {
             }
         });
         
+        // Wait for the handshake to complete before sending anything
+        bool open = false;
+        {
+            std::unique_lock<std::mutex> state_lock(websocket_state_mutex_);
+            websocket_state_condition_.wait_for(state_lock, std::chrono::seconds(10), [this] {
+                return websocket_open_ || websocket_failed_;
+            });
+            open = websocket_open_;
+        }
+        
+        if (!open) {
+            std::cerr << "WebSocket connection failed" << std::endl;
+            websocket_client_->stop();
+            if (websocket_thread_.joinable()) {
+                websocket_thread_.join();
+            }
+            return false;
+        }
+        
         websocket_connected_ = true;
+        last_receive_ns_ = steady_clock_ns();
         
         // Authenticate over WebSocket if we have credentials
         if (authenticated_) {
@@ -272,14 +702,29 @@ bool ApiClient::connect_websocket() {
                 {"client_secret", api_secret_}
             };
             
-            json auth_request = {
-                {"jsonrpc", "2.0"},
-                {"id", 42},
-                {"method", "public/auth"},
-                {"params", auth_params}
+            ApiResponse response = websocket_request("public/auth", auth_params);
+            
+            if (response.success) {
+                // The session's token becomes the current one, so REST and WebSocket refresh together
+                std::lock_guard<std::mutex> auth_lock(auth_mutex_);
+                store_credentials(response.data["result"]);
+                websocket_authenticated_ = true;
+            } else {
+                std::cerr << "WebSocket authentication failed: " << response.error_message << std::endl;
+            }
+        }
+        
+        // Heartbeats keep an idle session producing frames, so silence means it is dead
+        if (reconnect_config_.heartbeat_interval.count() > 0) {
+            json heartbeat_params = {
+                {"interval", std::max<int64_t>(10, reconnect_config_.heartbeat_interval.count())}
             };
             
-            websocket_client_->send(websocket_connection_, auth_request.dump(), websocketpp::frame::opcode::text);
+            websocket_request_async("public/set_heartbeat", heartbeat_params, [](const ApiResponse& response) {
+                if (!response.success) {
+                    std::cerr << "Setting WebSocket heartbeat failed: " << response.error_message << std::endl;
+                }
+            });
         }
         
         return true;
@@ -290,9 +735,21 @@ bool ApiClient::connect_websocket() {
 }
 
 void ApiClient::disconnect_websocket() {
+    // Stop a reconnect in progress before waiting for it to release the connection
+    websocket_wanted_ = false;
+    reconnect_condition_.notify_all();
+    
+    for (size_t i = 1; i < feeds_.size(); ++i) {
+        close_feed(*feeds_[i]);
+    }
+    
     std::lock_guard<std::mutex> lock(websocket_mutex_);
     
     if (!websocket_connected_) {
+        // The connection may have closed on its own; reap its thread
+        if (websocket_thread_.joinable()) {
+            websocket_thread_.join();
+        }
         return;
     }
     
@@ -307,54 +764,768 @@ void ApiClient::disconnect_websocket() {
         }
         
         websocket_connected_ = false;
+        websocket_authenticated_ = false;
+        
+        // Fail requests that will never get a reply
+        fail_pending_requests("WebSocket disconnected");
     } catch (const std::exception& e) {
         std::cerr << "Error disconnecting from WebSocket: " << e.what() << std::endl;
     }
 }
 
-bool ApiClient::subscribe(const std::string& channel, MessageCallback callback) {
-    std::lock_guard<std::mutex> lock(websocket_mutex_);
+void ApiClient::set_reconnect_config(const ReconnectConfig& config) {
+    reconnect_config_ = config;
+}
+
+void ApiClient::set_connection_callback(ConnectionCallback callback) {
+    connection_callback_ = callback;
+}
+
+uint64_t ApiClient::get_reconnect_count() const {
+    return reconnect_count_;
+}
+
+void ApiClient::handle_connection_lost() {
+    // A close requested by disconnect_websocket() is not a loss
+    if (!websocket_wanted_) {
+        return;
+    }
     
-    if (!websocket_connected_) {
+    static auto disconnects = PerformanceMonitor::instance().get_counter("api_websocket_disconnects");
+    disconnects->add();
+    std::cerr << "WebSocket connection lost" << std::endl;
+    
+    // With redundant feeds the books stay current while any of them is up
+    if (!any_feed_connected()) {
+        reset_feed_arbiters();
+        
+        if (connection_callback_) {
+            connection_callback_(false);
+        }
+    }
+    
+    if (reconnect_config_.enabled) {
+        {
+            std::lock_guard<std::mutex> lock(reconnect_mutex_);
+            reconnect_pending_ = true;
+        }
+        reconnect_condition_.notify_all();
+    }
+}
+
+void ApiClient::process_reconnects() {
+    static auto tracker = PerformanceMonitor::instance().get_tracker("websocket_reconnect", true);
+    static auto failures = PerformanceMonitor::instance().get_counter("api_reconnect_failures");
+    static auto stale_sessions = PerformanceMonitor::instance().get_counter("api_websocket_stale");
+    
+    std::unique_lock<std::mutex> lock(reconnect_mutex_);
+    
+    while (running_) {
+        if (!reconnect_pending_) {
+            reconnect_condition_.wait_for(lock, std::chrono::seconds(1));
+            
+            // Between reconnects, close a session that has gone quiet despite heartbeats
+            auto interval = reconnect_config_.heartbeat_interval;
+            if (!reconnect_pending_ && interval.count() > 0 && websocket_connected_ &&
+                steady_clock_ns() - last_receive_ns_ > 2 * std::chrono::nanoseconds(interval).count()) {
+                lock.unlock();
+                {
+                    std::lock_guard<std::mutex> websocket_lock(websocket_mutex_);
+                    if (websocket_connected_) {
+                        stale_sessions->add();
+                        std::cerr << "WebSocket silent for two heartbeat intervals, reconnecting" << std::endl;
+                        
+                        // The close handler schedules the reconnect
+                        websocketpp::lib::error_code ec;
+                        websocket_client_->close(websocket_connection_, websocketpp::close::status::going_away,
+                                                 "Heartbeat timeout", ec);
+                        last_receive_ns_ = steady_clock_ns();
+                    }
+                }
+                lock.lock();
+            }
+            
+            // Added feeds are reopened independently of the primary session
+            if (!reconnect_pending_ && websocket_wanted_ && feeds_.size() > 1) {
+                lock.unlock();
+                reopen_feeds();
+                lock.lock();
+            }
+            continue;
+        }
+        
+        reconnect_pending_ = false;
+        auto tracking_id = tracker->start();
+        auto backoff = reconnect_config_.initial_backoff;
+        bool connected = false;
+        
+        while (running_ && websocket_wanted_) {
+            reconnect_condition_.wait_for(lock, backoff, [this] { return !running_ || !websocket_wanted_; });
+            if (!running_ || !websocket_wanted_) {
+                break;
+            }
+            
+            lock.unlock();
+            {
+                // Opening includes the handshake and re-authentication
+                std::lock_guard<std::mutex> websocket_lock(websocket_mutex_);
+                connected = websocket_wanted_ && (websocket_connected_ || open_websocket());
+            }
+            lock.lock();
+            
+            if (connected) {
+                break;
+            }
+            
+            failures->add();
+            backoff = std::min(backoff * 2, reconnect_config_.max_backoff);
+        }
+        
+        if (!connected) {
+            continue;
+        }
+        
+        lock.unlock();
+        resubscribe_all();
+        reconnect_count_++;
+        tracker->end(tracking_id);
+        
+        if (connection_callback_) {
+            connection_callback_(true);
+        }
+        lock.lock();
+    }
+}
+
+void ApiClient::resubscribe_all() {
+    static auto failures = PerformanceMonitor::instance().get_counter("api_resubscribe_failures");
+    
+    // Every channel that still has a callback
+    std::vector<std::string> channels;
+    {
+        std::shared_ptr<const ChannelTable> table = std::atomic_load(&channel_table_);
+        for (size_t i = 0; i < table->names.size(); ++i) {
+            if (table->handlers[i]) {
+                channels.emplace_back(table->names[i]);
+            }
+        }
+    }
+    
+    if (channels.empty()) {
+        return;
+    }
+    
+    std::vector<std::future<ApiResponse>> replies;
+    {
+        std::lock_guard<std::mutex> lock(websocket_mutex_);
+        if (!websocket_connected_) {
+            return;
+        }
+        replies = send_channel_batches("public/subscribe", channels, DEFAULT_SUBSCRIBE_BATCH);
+    }
+    
+    // Callbacks of failed channels stay registered, so the next reconnect tries them again
+    SubscriptionResult result = collect_channel_batches(channels, DEFAULT_SUBSCRIBE_BATCH, replies, true);
+    if (!result.failed.empty()) {
+        failures->add(static_cast<int64_t>(result.failed.size()));
+        std::cerr << "Resubscribing failed for " << result.failed.size() << " of " << channels.size()
+                  << " channels" << std::endl;
+    }
+}
+
+void ApiClient::handle_heartbeat(const json& params) {
+    // Deribit closes the session unless a test request is answered with public/test
+    if (replay_mode_ || !params.is_object() || params.value("type", "") != "test_request") {
+        return;
+    }
+    
+    static auto tracker = PerformanceMonitor::instance().get_tracker("websocket_heartbeat_rtt", true);
+    auto tracking_id = tracker->start();
+    
+    websocket_request_async("public/test", json::object(), [tracking_id](const ApiResponse& response) {
+        tracker->end(tracking_id);
+        
+        if (!response.success) {
+            std::cerr << "Heartbeat test request failed: " << response.error_message << std::endl;
+        }
+    });
+}
+
+bool ApiClient::add_market_data_feed(const std::string& url) {
+    std::lock_guard<std::mutex> lock(websocket_mutex_);
+    
+    if (websocket_wanted_ || websocket_connected_) {
+        std::cerr << "Cannot add market data feed: WebSocket already connected" << std::endl;
+        return false;
+    }
+    
+    auto add_feed = [this](const std::string& feed_url) {
+        auto& monitor = PerformanceMonitor::instance();
+        auto feed = std::make_unique<MarketDataFeed>();
+        std::string suffix = "." + std::to_string(feeds_.size());
+        
+        feed->index = feeds_.size();
+        feed->url = feed_url;
+        feed->wins_counter = monitor.get_counter("api_feed_wins" + suffix);
+        feed->duplicates_counter = monitor.get_counter("api_feed_duplicates" + suffix);
+        feed->win_ratio_counter = monitor.get_counter("api_feed_win_permille" + suffix);
+        feed->lag_tracker = monitor.get_tracker("api_feed_lag" + suffix, true);
+        
+        feeds_.push_back(std::move(feed));
+    };
+    
+    // The primary session takes part in the arbitration as feed 0
+    if (feeds_.empty()) {
+        add_feed(websocket_url_);
+    }
+    add_feed(url);
+    
+    return true;
+}
+
+std::vector<FeedStats> ApiClient::get_feed_stats() const {
+    std::vector<FeedStats> stats;
+    stats.reserve(feeds_.size());
+    
+    for (const auto& feed : feeds_) {
+        FeedStats entry;
+        entry.url = feed->url;
+        entry.connected = feed->index == 0 ? websocket_connected_.load() : feed->connected.load();
+        entry.wins = feed->wins.load(std::memory_order_relaxed);
+        entry.duplicates = feed->duplicates.load(std::memory_order_relaxed);
+        
+        uint64_t total = entry.wins + entry.duplicates;
+        if (total > 0) {
+            entry.win_ratio = static_cast<double>(entry.wins) / static_cast<double>(total);
+        }
+        
+        stats.push_back(std::move(entry));
+    }
+    
+    return stats;
+}
+
+bool ApiClient::open_feed(MarketDataFeed& feed) {
+    std::lock_guard<std::mutex> lock(feed.mutex);
+    
+    if (feed.connected) {
+        return true;
+    }
+    
+    try {
+        // Clean up a previous session whose thread has finished
+        if (feed.thread.joinable()) {
+            feed.thread.join();
+        }
+        
+        if (!feed.client) {
+            feed.client = std::make_unique<WebSocketClient>();
+            feed.client->set_access_channels(websocketpp::log::alevel::none);
+            feed.client->set_error_channels(websocketpp::log::elevel::fatal);
+            feed.client->init_asio();
+            feed.client->set_tls_init_handler([](websocketpp::connection_hdl) {
+                return websocketpp::lib::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23);
+            });
+        } else {
+            feed.client->reset();
+        }
+        
+        // Exactly one of the open and fail handlers runs per connection attempt
+        auto opened = std::make_shared<std::promise<bool>>();
+        std::future<bool> open = opened->get_future();
+        
+        feed.client->set_message_handler([this, &feed](websocketpp::connection_hdl, WebSocketClient::message_ptr msg) {
+            feed_message_handler(feed, msg);
+        });
+        
+        feed.client->set_open_handler([opened](websocketpp::connection_hdl) {
+            opened->set_value(true);
+        });
+        
+        feed.client->set_fail_handler([opened](websocketpp::connection_hdl) {
+            opened->set_value(false);
+        });
+        
+        feed.client->set_close_handler([this, &feed](websocketpp::connection_hdl) {
+            feed.connected = false;
+            handle_feed_lost(feed);
+        });
+        
+        websocketpp::lib::error_code ec;
+        WebSocketClient::connection_ptr con = feed.client->get_connection(feed.url, ec);
+        
+        if (ec) {
+            std::cerr << "Market data feed " << feed.url << " connection error: " << ec.message() << std::endl;
+            return false;
+        }
+        
+        {
+            std::lock_guard<std::mutex> send_lock(feed.send_mutex);
+            feed.connection = con->get_handle();
+        }
+        feed.client->connect(con);
+        
+        feed.thread = std::thread([&feed]() {
+            try {
+                feed.client->run();
+            } catch (const std::exception& e) {
+                std::cerr << "Market data feed thread error: " << e.what() << std::endl;
+            }
+        });
+        
+        if (open.wait_for(std::chrono::seconds(10)) != std::future_status::ready || !open.get()) {
+            std::cerr << "Market data feed " << feed.url << " failed to connect" << std::endl;
+            feed.client->stop();
+            if (feed.thread.joinable()) {
+                feed.thread.join();
+            }
+            return false;
+        }
+        
+        // Marked connected before the table is read, so a channel subscribed
+        // meanwhile is sent by this call, by the subscriber, or by both
+        feed.connected = true;
+        
+        std::vector<std::string> channels;
+        {
+            std::shared_ptr<const ChannelTable> table = std::atomic_load(&channel_table_);
+            for (size_t i = 0; i < table->names.size(); ++i) {
+                if (table->handlers[i] && table->handlers[i]->arbiter) {
+                    channels.emplace_back(table->names[i]);
+                }
+            }
+        }
+        send_feed_channels(feed, "public/subscribe", channels);
+        
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error connecting market data feed " << feed.url << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void ApiClient::close_feed(MarketDataFeed& feed) {
+    std::lock_guard<std::mutex> lock(feed.mutex);
+    
+    if (!feed.client) {
+        return;
+    }
+    
+    try {
+        if (feed.connected) {
+            std::lock_guard<std::mutex> send_lock(feed.send_mutex);
+            websocketpp::lib::error_code ec;
+            feed.client->close(feed.connection, websocketpp::close::status::normal, "Disconnecting", ec);
+        }
+        
+        if (feed.thread.joinable()) {
+            feed.thread.join();
+        }
+        
+        feed.connected = false;
+    } catch (const std::exception& e) {
+        std::cerr << "Error disconnecting market data feed " << feed.url << ": " << e.what() << std::endl;
+    }
+}
+
+void ApiClient::handle_feed_lost(MarketDataFeed& feed) {
+    // A close requested by disconnect_websocket() is not a loss
+    if (!websocket_wanted_) {
+        return;
+    }
+    
+    static auto disconnects = PerformanceMonitor::instance().get_counter("api_feed_disconnects");
+    disconnects->add();
+    std::cerr << "Market data feed " << feed.url << " lost" << std::endl;
+    
+    // Only the last session to drop leaves the books without updates
+    if (!websocket_connected_ && !any_feed_connected()) {
+        reset_feed_arbiters();
+        
+        if (connection_callback_) {
+            connection_callback_(false);
+        }
+    }
+}
+
+void ApiClient::reopen_feeds() {
+    static auto reconnects = PerformanceMonitor::instance().get_counter("api_feed_reconnects");
+    
+    for (size_t i = 1; i < feeds_.size() && websocket_wanted_; ++i) {
+        MarketDataFeed& feed = *feeds_[i];
+        if (!feed.connected && open_feed(feed)) {
+            reconnects->add();
+        }
+    }
+}
+
+bool ApiClient::any_feed_connected() const {
+    for (size_t i = 1; i < feeds_.size(); ++i) {
+        if (feeds_[i]->connected) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void ApiClient::reset_feed_arbiters() {
+    // Once every session is down the next snapshot must pass, whatever its change_id
+    std::shared_ptr<const ChannelTable> table = std::atomic_load(&channel_table_);
+    for (const auto& handler : table->handlers) {
+        if (handler && handler->arbiter) {
+            std::lock_guard<std::mutex> lock(handler->arbiter->mutex);
+            handler->arbiter->change_id = std::numeric_limits<int64_t>::min();
+        }
+    }
+}
+
+void ApiClient::send_feed_channels(const std::string& method, const std::vector<std::string>& channels) {
+    if (feeds_.size() < 2) {
+        return;
+    }
+    
+    // Added feeds only carry book channels
+    std::vector<std::string> book_channels;
+    for (const auto& channel : channels) {
+        if (MarketDataDecoder::is_book_channel(channel)) {
+            book_channels.push_back(channel);
+        }
+    }
+    
+    if (book_channels.empty()) {
+        return;
+    }
+    
+    for (size_t i = 1; i < feeds_.size(); ++i) {
+        if (feeds_[i]->connected) {
+            send_feed_channels(*feeds_[i], method, book_channels);
+        }
+    }
+}
+
+void ApiClient::send_feed_channels(MarketDataFeed& feed, const std::string& method,
+                                   const std::vector<std::string>& channels) {
+    std::lock_guard<std::mutex> lock(feed.send_mutex);
+    
+    // Replies are not tracked; a channel the feed rejects only loses its redundancy
+    for (size_t begin = 0; begin < channels.size(); begin += DEFAULT_SUBSCRIBE_BATCH) {
+        size_t end = std::min(channels.size(), begin + DEFAULT_SUBSCRIBE_BATCH);
+        
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", next_request_id_++},
+            {"method", method},
+            {"params", {
+                {"channels", std::vector<std::string>(channels.begin() + begin, channels.begin() + end)}
+            }}
+        };
+        
+        websocketpp::lib::error_code ec;
+        feed.client->send(feed.connection, request.dump(), websocketpp::frame::opcode::text, ec);
+        
+        if (ec) {
+            std::cerr << "Market data feed " << feed.url << " " << method << " failed: " << ec.message() << std::endl;
+            return;
+        }
+    }
+}
+
+void ApiClient::set_capture_journal(std::shared_ptr<JournalWriter> journal) {
+    capture_journal_ = journal;
+}
+
+void ApiClient::set_replay_mode(bool enabled) {
+    replay_mode_ = enabled;
+}
+
+bool ApiClient::is_replay_mode() const {
+    return replay_mode_;
+}
+
+void ApiClient::replay_message(std::string_view payload, int64_t received_wall_ns, size_t feed) {
+    if (feed != 0 && feed >= feeds_.size()) {
+        std::cerr << "Cannot replay: unknown market data feed " << feed << std::endl;
+        return;
+    }
+    
+    // Wrap the frame as if the WebSocket client had received it
+    WebSocketClient::message_ptr msg =
+        replay_message_manager_->get_message(websocketpp::frame::opcode::text, payload.size());
+    msg->set_payload(payload.data(), payload.size());
+    
+    route_message(msg, steady_clock_ns(), received_wall_ns, feed);
+}
+
+bool ApiClient::wait_until_idle(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    
+    for (const auto& worker : workers_) {
+        while (worker->processed.load(std::memory_order_acquire) < worker->accepted.load(std::memory_order_acquire)) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    
+    return true;
+}
+
+bool ApiClient::subscribe(const std::string& channel, MessageCallback callback, int shard) {
+    ChannelHandler handler;
+    handler.message_callback = callback;
+    return add_subscription(channel, std::move(handler), shard);
+}
+
+bool ApiClient::subscribe_book(const std::string& channel, BookUpdateCallback callback, int shard) {
+    if (!MarketDataDecoder::is_book_channel(channel)) {
+        std::cerr << "Cannot subscribe: not a book channel: " << channel << std::endl;
+        return false;
+    }
+    
+    ChannelHandler handler;
+    handler.book_callback = callback;
+    return add_subscription(channel, std::move(handler), shard);
+}
+
+bool ApiClient::subscribe_trades(const std::string& channel, TradesCallback callback, int shard) {
+    if (!MarketDataDecoder::is_trades_channel(channel)) {
+        std::cerr << "Cannot subscribe: not a trades channel: " << channel << std::endl;
+        return false;
+    }
+    
+    ChannelHandler handler;
+    handler.trades_callback = callback;
+    return add_subscription(channel, std::move(handler), shard);
+}
+
+bool ApiClient::add_subscription(const std::string& channel, ChannelHandler handler, int shard) {
+    std::lock_guard<std::mutex> lock(websocket_mutex_);
+    
+    if (!websocket_connected_ && !replay_mode_) {
         std::cerr << "Cannot subscribe: WebSocket not connected" << std::endl;
         return false;
     }
     
-    try {
-        // Store callback
-        channel_callbacks_[channel] = callback;
+    if (shard != AUTO_SHARD && (shard < 0 || static_cast<size_t>(shard) >= get_worker_count())) {
+        std::cerr << "Cannot subscribe: invalid shard " << shard << " for " << channel << std::endl;
+        return false;
+    }
+    
+    try {
+        // Pick the worker; messages already queued on a previous worker may still run there
+        handler.worker = shard == AUTO_SHARD ? shard_for_channel(channel) : static_cast<size_t>(shard);
+        if (MarketDataDecoder::is_book_channel(channel)) {
+            handler.arbiter = std::make_shared<FeedArbiter>();
+        }
+        
+        // Store callback
+        set_channel_handler(channel, std::make_shared<const ChannelHandler>(std::move(handler)));
+        
+        // A replay only needs the callback
+        if (replay_mode_) {
+            return true;
+        }
+        
+        // Create subscription request
+        json params = {
+            {"channels", {channel}}
+        };
+        
+        // Send subscription request
+        uint64_t id = websocket_request_async("public/subscribe", params, [channel](const ApiResponse& response) {
+            if (!response.success) {
+                std::cerr << "Subscription to " << channel << " failed: " << response.error_message << std::endl;
+            }
+        });
+        
+        send_feed_channels("public/subscribe", {channel});
+        
+        return id != 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error subscribing to channel: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+SubscriptionResult ApiClient::subscribe_many(const std::vector<std::string>& channels, MessageCallback callback,
+                                             int shard, size_t batch_size) {
+    ChannelHandler handler;
+    handler.message_callback = callback;
+    return add_subscriptions(channels, handler, shard, batch_size);
+}
+
+SubscriptionResult ApiClient::subscribe_book_many(const std::vector<std::string>& channels,
+                                                  BookUpdateCallback callback, int shard, size_t batch_size) {
+    std::vector<std::string> book_channels;
+    std::vector<std::string> rejected;
+    book_channels.reserve(channels.size());
+    
+    for (const auto& channel : channels) {
+        if (MarketDataDecoder::is_book_channel(channel)) {
+            book_channels.push_back(channel);
+        } else {
+            std::cerr << "Cannot subscribe: not a book channel: " << channel << std::endl;
+            rejected.push_back(channel);
+        }
+    }
+    
+    ChannelHandler handler;
+    handler.book_callback = callback;
+    SubscriptionResult result = add_subscriptions(book_channels, handler, shard, batch_size);
+    result.failed.insert(result.failed.end(), rejected.begin(), rejected.end());
+    
+    return result;
+}
+
+SubscriptionResult ApiClient::subscribe_universe(const std::string& currency, InstrumentType type,
+                                                 const std::string& interval, BookUpdateCallback callback,
+                                                 size_t batch_size) {
+    std::vector<std::string> instruments = get_instruments(currency, type);
+    
+    std::vector<std::string> channels;
+    channels.reserve(instruments.size());
+    for (const auto& instrument : instruments) {
+        channels.push_back("book." + instrument + "." + interval);
+    }
+    
+    return subscribe_book_many(channels, callback, AUTO_SHARD, batch_size);
+}
+
+SubscriptionResult ApiClient::add_subscriptions(const std::vector<std::string>& channels,
+                                                const ChannelHandler& handler, int shard, size_t batch_size) {
+    SubscriptionResult result;
+    if (channels.empty()) {
+        return result;
+    }
+    
+    std::vector<std::future<ApiResponse>> replies;
+    
+    {
+        std::lock_guard<std::mutex> lock(websocket_mutex_);
+        
+        if (!websocket_connected_ && !replay_mode_) {
+            std::cerr << "Cannot subscribe: WebSocket not connected" << std::endl;
+            result.failed = channels;
+            return result;
+        }
+        
+        if (shard != AUTO_SHARD && (shard < 0 || static_cast<size_t>(shard) >= get_worker_count())) {
+            std::cerr << "Cannot subscribe: invalid shard " << shard << std::endl;
+            result.failed = channels;
+            return result;
+        }
+        
+        try {
+            // Register every callback with a single table update before any reply can arrive
+            std::vector<std::shared_ptr<const ChannelHandler>> handlers;
+            handlers.reserve(channels.size());
+            for (const auto& channel : channels) {
+                auto channel_handler = std::make_shared<ChannelHandler>(handler);
+                channel_handler->worker = shard == AUTO_SHARD ? shard_for_channel(channel) : static_cast<size_t>(shard);
+                if (MarketDataDecoder::is_book_channel(channel)) {
+                    channel_handler->arbiter = std::make_shared<FeedArbiter>();
+                }
+                handlers.push_back(std::move(channel_handler));
+            }
+            set_channel_handlers(channels, handlers);
+            
+            // A replay only needs the callbacks
+            if (replay_mode_) {
+                result.confirmed = channels;
+                return result;
+            }
+            
+            replies = send_channel_batches("public/subscribe", channels, batch_size);
+            send_feed_channels("public/subscribe", channels);
+        } catch (const std::exception& e) {
+            std::cerr << "Error subscribing to channels: " << e.what() << std::endl;
+            result.failed = channels;
+            return result;
+        }
+    }
+    
+    // Wait without the lock so other requests can go out meanwhile
+    result = collect_channel_batches(channels, batch_size, replies, true);
+    
+    if (!result.failed.empty()) {
+        set_channel_handlers(result.failed,
+                             std::vector<std::shared_ptr<const ChannelHandler>>(result.failed.size()));
+    }
+    
+    return result;
+}
+
+std::vector<std::future<ApiResponse>> ApiClient::send_channel_batches(const std::string& method,
+                                                                      const std::vector<std::string>& channels,
+                                                                      size_t batch_size) {
+    std::vector<std::future<ApiResponse>> replies;
+    batch_size = std::max<size_t>(1, batch_size);
+    
+    for (size_t begin = 0; begin < channels.size(); begin += batch_size) {
+        size_t end = std::min(channels.size(), begin + batch_size);
         
-        // Create subscription request
         json params = {
-            {"channels", {channel}}
+            {"channels", std::vector<std::string>(channels.begin() + begin, channels.begin() + end)}
         };
         
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", 42},
-            {"method", "public/subscribe"},
-            {"params", params}
-        };
+        // Requests are pipelined; the callback runs on reply, failure or timeout
+        auto promise = std::make_shared<std::promise<ApiResponse>>();
+        replies.push_back(promise->get_future());
         
-        // Send subscription request
-        websocketpp::lib::error_code ec;
-        websocket_client_->send(websocket_connection_, request.dump(), websocketpp::frame::opcode::text, ec);
+        websocket_request_async(method, params, [promise](const ApiResponse& response) {
+            promise->set_value(response);
+        });
+    }
+    
+    return replies;
+}
+
+SubscriptionResult ApiClient::collect_channel_batches(const std::vector<std::string>& channels, size_t batch_size,
+                                                      std::vector<std::future<ApiResponse>>& replies,
+                                                      bool listed_only) {
+    SubscriptionResult result;
+    batch_size = std::max<size_t>(1, batch_size);
+    
+    for (size_t batch = 0; batch < replies.size(); ++batch) {
+        size_t begin = batch * batch_size;
+        size_t end = std::min(channels.size(), begin + batch_size);
         
-        if (ec) {
-            std::cerr << "WebSocket send error: " << ec.message() << std::endl;
-            return false;
+        ApiResponse response = replies[batch].get();
+        if (!response.success) {
+            std::cerr << "Channel request for " << (end - begin) << " channels failed: "
+                      << response.error_message << std::endl;
         }
         
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Error subscribing to channel: " << e.what() << std::endl;
-        return false;
+        // The reply lists the channels the server accepted
+        std::unordered_set<std::string> listed;
+        if (response.success && listed_only && response.data.contains("result") &&
+            response.data["result"].is_array()) {
+            for (const auto& channel : response.data["result"]) {
+                if (channel.is_string()) {
+                    listed.insert(channel.get<std::string>());
+                }
+            }
+        }
+        
+        for (size_t i = begin; i < end; ++i) {
+            bool confirmed = response.success && (!listed_only || listed.count(channels[i]) > 0);
+            (confirmed ? result.confirmed : result.failed).push_back(channels[i]);
+        }
     }
+    
+    return result;
 }
 
 bool ApiClient::unsubscribe(const std::string& channel) {
     std::lock_guard<std::mutex> lock(websocket_mutex_);
     
+    if (replay_mode_) {
+        set_channel_handler(channel, nullptr);
+        return true;
+    }
+    
     if (!websocket_connected_) {
         std::cerr << "Cannot unsubscribe: WebSocket not connected" << std::endl;
         return false;
@@ -366,24 +1537,20 @@ bool ApiClient::unsubscribe(const std::string& channel) {
             {"channels", {channel}}
         };
         
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", 42},
-            {"method", "public/unsubscribe"},
-            {"params", params}
-        };
-        
         // Send unsubscription request
-        websocketpp::lib::error_code ec;
-        websocket_client_->send(websocket_connection_, request.dump(), websocketpp::frame::opcode::text, ec);
+        uint64_t id = websocket_request_async("public/unsubscribe", params, [channel](const ApiResponse& response) {
+            if (!response.success) {
+                std::cerr << "Unsubscription from " << channel << " failed: " << response.error_message << std::endl;
+            }
+        });
         
-        if (ec) {
-            std::cerr << "WebSocket send error: " << ec.message() << std::endl;
+        if (id == 0) {
             return false;
         }
         
         // Remove callback
-        channel_callbacks_.erase(channel);
+        set_channel_handler(channel, nullptr);
+        send_feed_channels("public/unsubscribe", {channel});
         
         return true;
     } catch (const std::exception& e) {
@@ -392,6 +1559,39 @@ bool ApiClient::unsubscribe(const std::string& channel) {
     }
 }
 
+SubscriptionResult ApiClient::unsubscribe_many(const std::vector<std::string>& channels, size_t batch_size) {
+    SubscriptionResult result;
+    if (channels.empty()) {
+        return result;
+    }
+    
+    std::vector<std::future<ApiResponse>> replies;
+    
+    {
+        std::lock_guard<std::mutex> lock(websocket_mutex_);
+        
+        if (!websocket_connected_) {
+            std::cerr << "Cannot unsubscribe: WebSocket not connected" << std::endl;
+            result.failed = channels;
+            return result;
+        }
+        
+        try {
+            replies = send_channel_batches("public/unsubscribe", channels, batch_size);
+            
+            // Remove callbacks
+            set_channel_handlers(channels, std::vector<std::shared_ptr<const ChannelHandler>>(channels.size()));
+            send_feed_channels("public/unsubscribe", channels);
+        } catch (const std::exception& e) {
+            std::cerr << "Error unsubscribing from channels: " << e.what() << std::endl;
+            result.failed = channels;
+            return result;
+        }
+    }
+    
+    return collect_channel_batches(channels, batch_size, replies, false);
+}
+
 std::vector<std::string> ApiClient::get_instruments(const std::string& currency, InstrumentType type) {
     std::vector<std::string> instruments;
     
@@ -429,6 +1629,10 @@ bool ApiClient::is_websocket_connected() const {
     return websocket_connected_;
 }
 
+bool ApiClient::is_websocket_authenticated() const {
+    return websocket_authenticated_;
+}
+
 std::string ApiClient::get_api_url() const {
     return api_url_;
 }
@@ -442,55 +1646,215 @@ bool ApiClient::refresh_token() {
         // Create refresh token request
         json params = {
             {"grant_type", "refresh_token"},
-            {"refresh_token", credentials_.refresh_token}
+            {"refresh_token", current_credentials()->refresh_token}
         };
         
-        // Make request
-        ApiResponse response = public_request("public/auth", params);
-        
-        if (response.success) {
-            // Update tokens
-            credentials_.access_token = response.data["result"]["access_token"];
-            credentials_.refresh_token = response.data["result"]["refresh_token"];
-            
-            // Calculate token expiry time
-            int expires_in = response.data["result"]["expires_in"];
-            credentials_.token_expiry = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
-            
+        if (request_token(params)) {
             return true;
-        } else {
-            std::cerr << "Token refresh failed: " << response.error_message << std::endl;
-            authenticated_ = false;
-            return false;
         }
+        
+        // The refresh token may have been used or expired; start a new session
+        json credentials_params = {
+            {"grant_type", "client_credentials"},
+            {"client_id", api_key_},
+            {"client_secret", api_secret_}
+        };
+        
+        return request_token(credentials_params);
     } catch (const std::exception& e) {
         std::cerr << "Error refreshing token: " << e.what() << std::endl;
-        authenticated_ = false;
         return false;
     }
 }
 
+bool ApiClient::request_token(const json& params) {
+    ApiResponse response;
+    response.success = false;
+    
+    // Over the WebSocket the same request renews the session's authentication
+    if (websocket_authenticated_) {
+        response = websocket_request("public/auth", params);
+        if (!response.success) {
+            std::cerr << "WebSocket token request failed: " << response.error_message << std::endl;
+        }
+    }
+    
+    if (!response.success) {
+        response = public_request("public/auth", params);
+    }
+    
+    if (!response.success) {
+        std::cerr << "Authentication failed: " << response.error_message << std::endl;
+        return false;
+    }
+    
+    store_credentials(response.data["result"]);
+    return true;
+}
+
+void ApiClient::store_credentials(const json& result) {
+    // Fill a new copy, then publish it; readers keep using the current one until then
+    auto credentials = std::make_shared<ApiCredentials>();
+    
+    credentials->api_key = api_key_;
+    credentials->api_secret = api_secret_;
+    credentials->access_token = result["access_token"];
+    credentials->refresh_token = result["refresh_token"];
+    
+    // Calculate token expiry time
+    int expires_in = result["expires_in"];
+    credentials->token_expiry = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
+    auto token_expiry = credentials->token_expiry;
+    
+    std::atomic_store(&credentials_, std::shared_ptr<const ApiCredentials>(std::move(credentials)));
+    authenticated_ = true;
+    
+    // Schedule the next refresh
+    {
+        std::lock_guard<std::mutex> lock(auth_thread_mutex_);
+        auto margin = std::min(token_refresh_margin_, std::chrono::seconds(expires_in / 2));
+        token_refresh_at_ = token_expiry - margin;
+    }
+    auth_condition_.notify_all();
+}
+
+std::shared_ptr<const ApiCredentials> ApiClient::current_credentials() const {
+    return std::atomic_load(&credentials_);
+}
+
+void ApiClient::process_token_refresh() {
+    static auto tracker = PerformanceMonitor::instance().get_tracker("token_refresh", true);
+    static auto failures = PerformanceMonitor::instance().get_counter("api_token_refresh_failures");
+    
+    auto retry_delay = std::chrono::seconds(1);
+    std::unique_lock<std::mutex> lock(auth_thread_mutex_);
+    
+    while (running_) {
+        // Wait for a token, or for the current one to become due
+        if (!authenticated_) {
+            auth_condition_.wait(lock);
+            continue;
+        }
+        
+        if (std::chrono::system_clock::now() < token_refresh_at_) {
+            auth_condition_.wait_until(lock, token_refresh_at_);
+            continue;
+        }
+        
+        lock.unlock();
+        
+        auto tracking_id = tracker->start();
+        bool refreshed;
+        {
+            std::lock_guard<std::mutex> auth_lock(auth_mutex_);
+            refreshed = refresh_token();
+        }
+        tracker->end(tracking_id);
+        
+        lock.lock();
+        
+        // On failure retry with backoff; the current token stays in use until it expires
+        if (refreshed) {
+            retry_delay = std::chrono::seconds(1);
+        } else {
+            failures->add();
+            token_refresh_at_ = std::chrono::system_clock::now() + retry_delay;
+            retry_delay = std::min(retry_delay * 2, std::chrono::seconds(30));
+        }
+    }
+}
+
 void ApiClient::websocket_message_handler(websocketpp::connection_hdl hdl, WebSocketClient::message_ptr msg) {
+    // Stamp the receive time for tracing and capture before any work is done
+    int64_t received_at = steady_clock_ns();
+    int64_t received_wall_ns = capture_journal_ || Tracer::instance().is_enabled() ? Tracer::wall_now_ns() : 0;
+    last_receive_ns_.store(received_at, std::memory_order_relaxed);
+    
+    // The journal holds a reference to the frame; its flusher does the copying
+    if (capture_journal_) {
+        capture_journal_->append(std::shared_ptr<const std::string>(msg, &msg->get_payload()), received_wall_ns);
+    }
+    
+    route_message(msg, received_at, received_wall_ns);
+}
+
+void ApiClient::feed_message_handler(MarketDataFeed& feed, WebSocketClient::message_ptr msg) {
+    // Only the primary session is captured, so a replay sees one copy of each update
+    int64_t received_at = steady_clock_ns();
+    int64_t received_wall_ns = Tracer::instance().is_enabled() ? Tracer::wall_now_ns() : 0;
+    
+    route_message(msg, received_at, received_wall_ns, feed.index);
+}
+
+void ApiClient::route_message(const WebSocketClient::message_ptr& msg, int64_t received_at, int64_t received_wall_ns,
+                              size_t feed) {
     try {
+        // Each receive thread keeps its own copy of the table
+        const ChannelTable& table = feed == 0
+            ? load_channel_table(websocket_channel_table_, websocket_channel_table_version_)
+            : load_channel_table(feeds_[feed]->channel_table, feeds_[feed]->channel_table_version);
+        bool arbitrated = feeds_.size() > 1;
+        
+        // Typed channels are routed without parsing; decoding happens on the workers
+        MessageEnvelope envelope;
+        if (MarketDataDecoder::parse_envelope(msg->get_payload(), envelope)) {
+            auto it = table.ids.find(envelope.channel);
+            if (it == table.ids.end() || !table.handlers[it->second]) {
+                return;
+            }
+            
+            const ChannelHandler& handler = *table.handlers[it->second];
+            if (!handler.message_callback) {
+                int64_t change_id = 0;
+                if (arbitrated && handler.arbiter &&
+                    find_change_id(std::string_view(msg->get_payload()).substr(envelope.data_offset), change_id)) {
+                    enqueue_arbitrated(feed, change_id, handler, it->second, json(), msg, envelope.data_offset,
+                                       received_at, received_wall_ns);
+                } else {
+                    enqueue_message(handler, it->second, json(), msg, envelope.data_offset,
+                                    received_at, received_wall_ns);
+                }
+                return;
+            }
+        }
+        
         // Parse message
         json message = json::parse(msg->get_payload());
         
         // Handle different message types
         if (message.contains("method") && message["method"] == "subscription") {
             // Subscription message
-            std::string channel = message["params"]["channel"];
+            const std::string& channel = message["params"]["channel"].get_ref<const std::string&>();
             
             // Find callback for this channel
-            auto it = channel_callbacks_.find(channel);
-            if (it != channel_callbacks_.end()) {
+            auto it = table.ids.find(channel);
+            if (it != table.ids.end() && table.handlers[it->second]) {
+                const ChannelHandler& handler = *table.handlers[it->second];
+                json& data = message["params"]["data"];
+                
                 // Add message to queue for processing
-                std::lock_guard<std::mutex> lock(queue_mutex_);
-                message_queue_.push(std::make_pair(channel, message["params"]["data"]));
-                queue_condition_.notify_one();
+                if (arbitrated && handler.arbiter && data.is_object() && data.contains("change_id") &&
+                    data["change_id"].is_number_integer()) {
+                    int64_t change_id = data["change_id"].get<int64_t>();
+                    enqueue_arbitrated(feed, change_id, handler, it->second, std::move(data), nullptr, 0,
+                                       received_at, received_wall_ns);
+                } else {
+                    enqueue_message(handler, it->second, std::move(data), nullptr, 0, received_at, received_wall_ns);
+                }
+            }
+        } else if (feed != 0) {
+            // Added feeds only carry book updates; replies to their subscriptions are not tracked
+            if (message.contains("error")) {
+                std::cerr << "Market data feed " << feeds_[feed]->url << " error: " << message["error"]["message"]
+                          << std::endl;
             }
-        } else if (message.contains("id") && message.contains("result")) {
+        } else if (message.contains("method") && message["method"] == "heartbeat") {
+            // Heartbeat or test request
+            handle_heartbeat(message.value("params", json::object()));
+        } else if (message.contains("id") && message["id"].is_number_unsigned() &&
+                   (message.contains("result") || message.contains("error"))) {
             // Response to a request
-            // Currently not handling these specifically
+            complete_request(message["id"].get<uint64_t>(), message);
         } else if (message.contains("error")) {
             // Error message
             std::cerr << "WebSocket error: " << message["error"]["message"] << std::endl;
@@ -500,35 +1864,341 @@ void ApiClient::websocket_message_handler(websocketpp::connection_hdl hdl, WebSo
     }
 }
 
-void ApiClient::process_message_queue() {
+bool ApiClient::enqueue_message(const ChannelHandler& handler, uint32_t channel_id, json data,
+                                WebSocketClient::message_ptr payload, size_t data_offset,
+                                int64_t received_at, int64_t received_wall_ns) {
+    if (handler.worker >= workers_.size()) {
+        return false;
+    }
+    
+    MessageWorker& worker = *workers_[handler.worker];
+    int64_t now = steady_clock_ns();
+    
+    auto fill = [&](QueuedMessage& slot) {
+        slot.channel_id = channel_id;
+        slot.data = std::move(data);
+        slot.payload = std::move(payload);
+        slot.data_offset = data_offset;
+        slot.enqueued_at = now;
+        slot.received_at = received_at;
+        slot.received_wall_ns = received_wall_ns;
+    };
+    
+    // A replay waits for the worker rather than dropping messages
+    bool pushed = worker.queue->try_push(fill);
+    while (!pushed && replay_mode_.load(std::memory_order_relaxed) && running_) {
+        std::this_thread::yield();
+        pushed = worker.queue->try_push(fill);
+    }
+    
+    if (!pushed) {
+        queue_overflow_counter_->add();
+        return false;
+    }
+    
+    worker.accepted.fetch_add(1, std::memory_order_relaxed);
+    worker.max_depth_counter->update_max(static_cast<int64_t>(worker.queue->size()));
+    worker.waiter->notify();
+    
+    return true;
+}
+
+bool ApiClient::enqueue_arbitrated(size_t feed, int64_t change_id, const ChannelHandler& handler, uint32_t channel_id,
+                                   json data, WebSocketClient::message_ptr payload, size_t data_offset,
+                                   int64_t received_at, int64_t received_wall_ns) {
+    MarketDataFeed& source = *feeds_[feed];
+    FeedArbiter& arbiter = *handler.arbiter;
+    
+    std::lock_guard<std::mutex> lock(arbiter.mutex);
+    
+    // The first copy of each update wins; copies and older updates are dropped
+    bool won = change_id > arbiter.change_id;
+    if (won) {
+        source.wins.fetch_add(1, std::memory_order_relaxed);
+        source.wins_counter->add();
+    } else {
+        source.duplicates.fetch_add(1, std::memory_order_relaxed);
+        source.duplicates_counter->add();
+    }
+    
+    uint64_t wins = source.wins.load(std::memory_order_relaxed);
+    uint64_t duplicates = source.duplicates.load(std::memory_order_relaxed);
+    source.win_ratio_counter->set(static_cast<int64_t>(wins * 1000 / (wins + duplicates)));
+    
+    if (!won) {
+        // How far this feed trailed the winner; receive stamps of racing threads may be slightly out of order
+        if (change_id == arbiter.change_id) {
+            source.lag_tracker->record(std::chrono::nanoseconds(std::max<int64_t>(0, received_at - arbiter.accepted_at)));
+        }
+        return false;
+    }
+    
+    arbiter.change_id = change_id;
+    arbiter.accepted_at = received_at;
+    
+    return enqueue_message(handler, channel_id, std::move(data), std::move(payload), data_offset,
+                           received_at, received_wall_ns);
+}
+
+void ApiClient::pin_worker(MessageWorker& worker) {
+    const auto& cpus = message_queue_config_.worker_cpus;
+    if (cpus.empty()) {
+        return;
+    }
+    
+    int cpu = cpus[worker.index % cpus.size()];
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        std::cerr << "Failed to pin message worker " << worker.index << " to CPU " << cpu << std::endl;
+    }
+#else
+    std::cerr << "Pinning message worker " << worker.index << " to CPU " << cpu << " is not supported" << std::endl;
+#endif
+}
+
+void ApiClient::process_message_queue(MessageWorker& worker) {
+    pin_worker(worker);
+    
+    std::shared_ptr<const ChannelTable> table;
+    uint64_t table_version = 0;
+    QueuedMessage message;
+    
+    while (running_) {
+        if (!worker.queue->try_pop(message)) {
+            worker.depth_counter->set(0);
+            worker.waiter->wait([this, &worker] { return !worker.queue->empty() || !running_; });
+            continue;
+        }
+        
+        worker.depth_counter->set(static_cast<int64_t>(worker.queue->size()));
+        worker.residency_tracker->record(std::chrono::nanoseconds(steady_clock_ns() - message.enqueued_at));
+        
+        auto tracking_id = worker.processing_tracker->start();
+        
+        try {
+            // The local table keeps handlers alive while they run, even if unsubscribed meanwhile
+            const ChannelTable& current = load_channel_table(table, table_version);
+            
+            if (message.channel_id < current.handlers.size() && current.handlers[message.channel_id]) {
+                // Everything the callback does on this thread is stamped into the message's trace
+                ScopedTrace trace(message.received_at, message.received_wall_ns);
+                dispatch_message(worker, *current.handlers[message.channel_id], current.names[message.channel_id],
+                                 message);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error processing message: " << e.what() << std::endl;
+        }
+        
+        worker.processing_tracker->end(tracking_id);
+        
+        // Release the payload now rather than at the next pop
+        message.data = json();
+        message.payload.reset();
+        worker.processed.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void ApiClient::dispatch_message(MessageWorker& worker, const ChannelHandler& handler, std::string_view channel,
+                                 const QueuedMessage& message) {
+    BookUpdate& book_update = worker.book_update;
+    std::vector<TradeUpdate>& trade_updates = worker.trade_updates;
+    
+    std::string_view data;
+    if (message.payload) {
+        data = std::string_view(message.payload->get_payload()).substr(message.data_offset);
+    }
+    
+    // Raw payloads the in-place decoder rejects, e.g. escaped strings, take the json path
+    json parsed;
+    auto data_tree = [&]() -> const json& {
+        if (!message.payload) {
+            return message.data;
+        }
+        
+        if (parsed.is_null()) {
+            parsed = json::parse(message.payload->get_payload())["params"]["data"];
+        }
+        return parsed;
+    };
+    
+    if (handler.message_callback) {
+        const json& tree = data_tree();
+        if (tree.is_object() && tree.contains("timestamp") && tree["timestamp"].is_number()) {
+            Tracer::set_exchange_timestamp(tree["timestamp"].get<int64_t>());
+        }
+        Tracer::mark(TraceStage::DECODE);
+        
+        handler.message_callback(tree);
+    } else if (handler.book_callback) {
+        if ((message.payload && MarketDataDecoder::decode_book(data, book_update)) ||
+            MarketDataDecoder::decode_book_json(data_tree(), book_update)) {
+            Tracer::set_exchange_timestamp(book_update.timestamp);
+            Tracer::mark(TraceStage::DECODE);
+            
+            handler.book_callback(book_update);
+        } else {
+            std::cerr << "Invalid book message on " << channel << std::endl;
+        }
+    } else if (handler.trades_callback) {
+        if ((message.payload && MarketDataDecoder::decode_trades(data, trade_updates)) ||
+            MarketDataDecoder::decode_trades_json(data_tree(), trade_updates)) {
+            if (!trade_updates.empty()) {
+                Tracer::set_exchange_timestamp(trade_updates.back().timestamp);
+            }
+            Tracer::mark(TraceStage::DECODE);
+            
+            handler.trades_callback(trade_updates);
+        } else {
+            std::cerr << "Invalid trades message on " << channel << std::endl;
+        }
+    }
+}
+
+void ApiClient::set_channel_handler(const std::string& channel, std::shared_ptr<const ChannelHandler> handler) {
+    set_channel_handlers({channel}, {std::move(handler)});
+}
+
+void ApiClient::set_channel_handlers(const std::vector<std::string>& channels,
+                                     const std::vector<std::shared_ptr<const ChannelHandler>>& handlers) {
+    std::lock_guard<std::mutex> lock(channel_table_mutex_);
+    
+    auto table = std::make_shared<ChannelTable>(*channel_table_);
+    
+    for (size_t i = 0; i < channels.size() && i < handlers.size(); ++i) {
+        const std::string& channel = channels[i];
+        auto it = table->ids.find(channel);
+        uint32_t id;
+        
+        if (it != table->ids.end()) {
+            id = it->second;
+        } else {
+            // Intern the name; the deque never moves existing strings
+            channel_names_.push_back(channel);
+            std::string_view name(channel_names_.back());
+            
+            id = static_cast<uint32_t>(table->names.size());
+            table->ids.emplace(name, id);
+            table->names.push_back(name);
+            table->handlers.emplace_back();
+        }
+        
+        table->handlers[id] = handlers[i];
+    }
+    
+    std::atomic_store(&channel_table_, std::shared_ptr<const ChannelTable>(std::move(table)));
+    channel_table_version_.fetch_add(1, std::memory_order_release);
+}
+
+const ApiClient::ChannelTable& ApiClient::load_channel_table(std::shared_ptr<const ChannelTable>& cache,
+                                                             uint64_t& version) const {
+    // One atomic load per message; the shared pointer is only reloaded after a change
+    uint64_t current = channel_table_version_.load(std::memory_order_acquire);
+    
+    if (!cache || current != version) {
+        cache = std::atomic_load(&channel_table_);
+        version = current;
+    }
+    
+    return *cache;
+}
+
+void ApiClient::process_request_timeouts() {
     while (running_) {
-        std::pair<std::string, json> message;
+        std::vector<PendingRequest> expired;
         
         {
-            std::unique_lock<std::mutex> lock(queue_mutex_);
-            queue_condition_.wait(lock, [this] { return !message_queue_.empty() || !running_; });
+            std::unique_lock<std::mutex> lock(pending_mutex_);
+            timeout_condition_.wait_for(lock, std::chrono::milliseconds(10), [this] { return !running_; });
             
-            if (!running_) {
-                break;
+            // Collect expired requests
+            auto now = std::chrono::steady_clock::now();
+            for (auto it = pending_requests_.begin(); it != pending_requests_.end();) {
+                if (now >= it->second.deadline) {
+                    expired.push_back(std::move(it->second));
+                    it = pending_requests_.erase(it);
+                } else {
+                    ++it;
+                }
             }
+        }
+        
+        // Complete them outside the lock
+        for (auto& request : expired) {
+            ApiResponse response;
+            response.success = false;
+            response.error_message = "Request timed out: " + request.method;
             
-            message = message_queue_.front();
-            message_queue_.pop();
+            try {
+                request.callback(response);
+            } catch (const std::exception& e) {
+                std::cerr << "Error in request callback: " << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+void ApiClient::complete_request(uint64_t id, const json& message) {
+    PendingRequest request;
+    
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        auto it = pending_requests_.find(id);
+        if (it == pending_requests_.end()) {
+            // Late reply to a request that already timed out
+            return;
         }
         
+        request = std::move(it->second);
+        pending_requests_.erase(it);
+    }
+    
+    try {
+        request.callback(parse_response(message));
+    } catch (const std::exception& e) {
+        std::cerr << "Error in request callback: " << e.what() << std::endl;
+    }
+}
+
+void ApiClient::fail_pending_requests(const std::string& error_message) {
+    std::unordered_map<uint64_t, PendingRequest> requests;
+    
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        requests.swap(pending_requests_);
+    }
+    
+    for (auto& pair : requests) {
+        ApiResponse response;
+        response.success = false;
+        response.error_message = error_message;
+        
         try {
-            // Find callback for this channel
-            auto it = channel_callbacks_.find(message.first);
-            if (it != channel_callbacks_.end()) {
-                // Call callback
-                it->second(message.second);
-            }
+            pair.second.callback(response);
         } catch (const std::exception& e) {
-            std::cerr << "Error processing message: " << e.what() << std::endl;
+            std::cerr << "Error in request callback: " << e.what() << std::endl;
         }
     }
 }
 
+ApiResponse ApiClient::parse_response(const json& response_json) const {
+    ApiResponse api_response;
+    
+    if (response_json.contains("error")) {
+        api_response.success = false;
+        api_response.error_message = response_json["error"].value("message", "Unknown error");
+    } else {
+        api_response.success = true;
+        api_response.data = response_json;
+    }
+    
+    return api_response;
+}
+
 std::string ApiClient::create_signature(const std::string& method, const std::string& path, const std::string& nonce, const std::string& data) {
     // Create string to sign
     std::string string_to_sign = nonce + method + path + data;
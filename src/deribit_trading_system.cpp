@@ -1,4 +1,5 @@
 #include "deribit_trading_system.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -22,31 +23,106 @@ TradingSystem::~TradingSystem() {
     }
 }
 
+void TradingSystem::set_websocket_server_threads(size_t threads) {
+    websocket_server_threads_ = threads;
+}
+
+void TradingSystem::set_message_queue_config(const MessageQueueConfig& config) {
+    message_queue_config_ = config;
+}
+
+void TradingSystem::set_rate_limit_config(const RateLimitConfig& config) {
+    rate_limit_config_ = config;
+}
+
+void TradingSystem::set_market_data_feeds(const std::vector<std::string>& urls) {
+    market_data_feeds_ = urls;
+}
+
+void TradingSystem::set_capture_file(const std::string& path, const JournalConfig& config) {
+    capture_file_ = path;
+    capture_config_ = config;
+}
+
+void TradingSystem::set_replay_mode(bool enabled) {
+    replay_mode_ = enabled;
+}
+
 bool TradingSystem::initialize() {
     try {
         // Initialize API client
         api_client_ = std::make_shared<ApiClient>(api_key_, api_secret_, test_mode_);
+        api_client_->set_message_queue_config(message_queue_config_);
+        api_client_->set_rate_limit_config(rate_limit_config_);
+        api_client_->set_replay_mode(replay_mode_);
+        for (const auto& url : market_data_feeds_) {
+            api_client_->add_market_data_feed(url);
+        }
         if (!api_client_->initialize()) {
             std::cerr << "Failed to initialize API client" << std::endl;
             return false;
         }
         
-        // Authenticate with API
-        if (!api_client_->authenticate()) {
+        // Open the capture journal before any frame arrives
+        if (!capture_file_.empty()) {
+            capture_journal_ = std::make_shared<JournalWriter>(capture_config_);
+            if (!capture_journal_->open(capture_file_)) {
+                std::cerr << "Failed to open capture journal " << capture_file_ << std::endl;
+                return false;
+            }
+            api_client_->set_capture_journal(capture_journal_);
+        }
+        
+        // Authenticate with API; a replay never talks to the exchange
+        if (!replay_mode_ && !api_client_->authenticate()) {
             std::cerr << "Failed to authenticate with API" << std::endl;
             return false;
         }
         
-        // Initialize order manager
+        // Initialize instrument registry, risk gate and order manager
+        instrument_registry_ = std::make_shared<InstrumentRegistry>(api_client_);
+        risk_gate_ = std::make_shared<RiskGate>(instrument_registry_);
         order_manager_ = std::make_shared<OrderManager>(api_client_);
+        order_manager_->set_instrument_registry(instrument_registry_);
+        order_manager_->set_risk_gate(risk_gate_);
         
         // Initialize WebSocket server
         websocket_server_ = std::make_shared<WebSocketServer>(api_client_, order_manager_, websocket_port_);
+        websocket_server_->set_instrument_registry(instrument_registry_);
+        if (websocket_server_threads_ == 0) {
+            websocket_server_->set_io_context(api_client_->get_io_context());
+        } else {
+            websocket_server_->set_thread_count(websocket_server_threads_);
+        }
         if (!websocket_server_->initialize()) {
             std::cerr << "Failed to initialize WebSocket server" << std::endl;
             return false;
         }
         
+        // Preallocate the published books to the publishing depth
+        size_t pool_size = std::max<size_t>(1, api_client_->get_worker_count()) * 2;
+        orderbook_pool_ = std::make_unique<ObjectPool<OrderBook>>(
+            pool_size, "orderbook", [this](OrderBook& orderbook) {
+                orderbook.instrument_name.reserve(64);
+                orderbook.bids.reserve(publish_depth_);
+                orderbook.asks.reserve(publish_depth_);
+            });
+        
+        // Initialize order book engine
+        book_engine_ = std::make_shared<OrderBookEngine>(api_client_);
+        book_engine_->set_instrument_registry(instrument_registry_);
+        book_engine_->set_book_callback([this](const L2Book& book) {
+            publish_book(book);
+        });
+        
+        // Books go stale while the feed is down; resubscribing brings fresh snapshots
+        api_client_->set_connection_callback([this](bool connected) {
+            if (!connected) {
+                book_engine_->invalidate_all();
+                order_manager_->invalidate_orderbooks();
+            }
+        });
+        
         return true;
     } catch (const std::exception& e) {
         std::cerr << "Error initializing trading system: " << e.what() << std::endl;
@@ -60,8 +136,8 @@ bool TradingSystem::start() {
     }
     
     try {
-        // Connect to WebSocket API
-        if (!api_client_->connect_websocket()) {
+        // Connect to WebSocket API; a replay is fed by replay() instead
+        if (!replay_mode_ && !api_client_->connect_websocket()) {
             std::cerr << "Failed to connect to WebSocket API" << std::endl;
             return false;
         }
@@ -95,6 +171,11 @@ void TradingSystem::stop() {
         // Stop WebSocket server
         websocket_server_->stop();
         
+        // Write out the rest of the capture
+        if (capture_journal_) {
+            capture_journal_->close();
+        }
+        
         running_ = false;
         
         // Notify waiting threads
@@ -122,12 +203,93 @@ std::shared_ptr<WebSocketServer> TradingSystem::get_websocket_server() const {
     return websocket_server_;
 }
 
+std::shared_ptr<OrderBookEngine> TradingSystem::get_book_engine() const {
+    return book_engine_;
+}
+
+std::shared_ptr<InstrumentRegistry> TradingSystem::get_instrument_registry() const {
+    return instrument_registry_;
+}
+
+std::shared_ptr<RiskGate> TradingSystem::get_risk_gate() const {
+    return risk_gate_;
+}
+
+bool TradingSystem::load_instruments(const std::string& currency, InstrumentType type, const std::string& cache_file) {
+    if (!instrument_registry_) {
+        std::cerr << "Cannot load instruments: system not initialized" << std::endl;
+        return false;
+    }
+    
+    try {
+        // Prefer the cache file, then the API
+        bool loaded = !cache_file.empty() && instrument_registry_->load_from_file(cache_file);
+        if (!loaded) {
+            loaded = instrument_registry_->load(currency, type) > 0;
+            
+            if (loaded && !cache_file.empty()) {
+                instrument_registry_->save_to_file(cache_file);
+            }
+        }
+        
+        // Follow instruments being created and expiring
+        if (loaded && running_) {
+            instrument_registry_->subscribe_updates(currency, type);
+        }
+        
+        return loaded;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading instruments: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+size_t TradingSystem::replay(const std::string& path, double speed) {
+    if (!running_ || !replay_mode_) {
+        std::cerr << "Cannot replay: system not running in replay mode" << std::endl;
+        return 0;
+    }
+    
+    JournalReader reader;
+    if (!reader.open(path)) {
+        return 0;
+    }
+    
+    JournalRecord record;
+    size_t replayed = 0;
+    int64_t first_received_ns = 0;
+    auto started = std::chrono::steady_clock::now();
+    
+    while (running_ && reader.next(record)) {
+        // Keep the original gaps between frames, scaled by the speed
+        if (speed > 0.0) {
+            if (replayed == 0) {
+                first_received_ns = record.received_wall_ns;
+            }
+            
+            auto offset = std::chrono::nanoseconds(
+                static_cast<int64_t>(static_cast<double>(record.received_wall_ns - first_received_ns) / speed));
+            std::this_thread::sleep_until(started + offset);
+        }
+        
+        api_client_->replay_message(record.payload, record.received_wall_ns);
+        ++replayed;
+    }
+    
+    // Results are only final once the workers have caught up
+    if (!api_client_->wait_until_idle(std::chrono::seconds(30))) {
+        std::cerr << "Replay finished before all messages were processed" << std::endl;
+    }
+    
+    return replayed;
+}
+
 void TradingSystem::wait() {
     std::unique_lock<std::mutex> lock(wait_mutex_);
     wait_condition_.wait(lock, [this] { return !running_; });
 }
 
-bool TradingSystem::subscribe_market_data(const std::string& instrument_name) {
+bool TradingSystem::subscribe_market_data(const std::string& instrument_name, int shard) {
     if (!running_) {
         std::cerr << "Cannot subscribe: system not running" << std::endl;
         return false;
@@ -137,15 +299,54 @@ bool TradingSystem::subscribe_market_data(const std::string& instrument_name) {
         // Subscribe to orderbook channel
         std::string channel = "book." + instrument_name + ".100ms";
         
-        return api_client_->subscribe(channel, [this, instrument_name](const json& data) {
-            handle_orderbook_update(data);
-        });
+        return api_client_->subscribe_book(channel, [this](const BookUpdate& update) {
+            handle_orderbook_update(update);
+        }, shard);
     } catch (const std::exception& e) {
         std::cerr << "Error subscribing to market data: " << e.what() << std::endl;
         return false;
     }
 }
 
+SubscriptionResult TradingSystem::subscribe_market_data_many(const std::vector<std::string>& instrument_names) {
+    if (!running_) {
+        std::cerr << "Cannot subscribe: system not running" << std::endl;
+        return SubscriptionResult();
+    }
+    
+    try {
+        // Subscribe to all orderbook channels in batches
+        std::vector<std::string> channels;
+        channels.reserve(instrument_names.size());
+        for (const auto& instrument_name : instrument_names) {
+            channels.push_back("book." + instrument_name + ".100ms");
+        }
+        
+        return api_client_->subscribe_book_many(channels, [this](const BookUpdate& update) {
+            handle_orderbook_update(update);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error subscribing to market data: " << e.what() << std::endl;
+        return SubscriptionResult();
+    }
+}
+
+SubscriptionResult TradingSystem::subscribe_market_data_universe(const std::string& currency, InstrumentType type) {
+    if (!running_) {
+        std::cerr << "Cannot subscribe: system not running" << std::endl;
+        return SubscriptionResult();
+    }
+    
+    try {
+        return api_client_->subscribe_universe(currency, type, "100ms", [this](const BookUpdate& update) {
+            handle_orderbook_update(update);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Error subscribing to market data: " << e.what() << std::endl;
+        return SubscriptionResult();
+    }
+}
+
 bool TradingSystem::unsubscribe_market_data(const std::string& instrument_name) {
     if (!running_) {
         std::cerr << "Cannot unsubscribe: system not running" << std::endl;
@@ -156,7 +357,13 @@ bool TradingSystem::unsubscribe_market_data(const std::string& instrument_name)
         // Unsubscribe from orderbook channel
         std::string channel = "book." + instrument_name + ".100ms";
         
-        return api_client_->unsubscribe(channel);
+        bool result = api_client_->unsubscribe(channel);
+        
+        // Drop the book so a later subscription starts from a fresh snapshot
+        book_engine_->remove(instrument_name);
+        order_manager_->invalidate_orderbook(instrument_name);
+        
+        return result;
     } catch (const std::exception& e) {
         std::cerr << "Error unsubscribing from market data: " << e.what() << std::endl;
         return false;
@@ -175,36 +382,14 @@ void TradingSystem::print_performance_metrics() const {
     PerformanceMonitor::instance().print_metrics();
 }
 
-void TradingSystem::handle_orderbook_update(const json& update) {
+void TradingSystem::handle_orderbook_update(const BookUpdate& update) {
     try {
         // Start latency tracking
-        auto tracker = PerformanceMonitor::instance().get_tracker("process_orderbook_update", true);
+        static auto tracker = PerformanceMonitor::instance().get_tracker("process_orderbook_update", true);
         auto tracking_id = tracker->start();
         
-        // Extract instrument name
-        std::string instrument_name = update["instrument_name"];
-        
-        // Create orderbook
-        OrderBook orderbook;
-        orderbook.instrument_name = instrument_name;
-        orderbook.timestamp = update["timestamp"];
-        
-        // Parse bids
-        for (const auto& bid : update["bids"]) {
-            double price = bid[0];
-            double size = bid[1];
-            orderbook.bids.push_back(std::make_pair(price, size));
-        }
-        
-        // Parse asks
-        for (const auto& ask : update["asks"]) {
-            double price = ask[0];
-            double size = ask[1];
-            orderbook.asks.push_back(std::make_pair(price, size));
-        }
-        
-        // Update WebSocket server
-        websocket_server_->handle_orderbook_update(instrument_name, orderbook);
+        // Apply the delta in place; the book callback publishes the result
+        book_engine_->handle_update(update);
         
         // End latency tracking
         tracker->end(tracking_id);
@@ -213,6 +398,20 @@ void TradingSystem::handle_orderbook_update(const json& update) {
     }
 }
 
+void TradingSystem::publish_book(const L2Book& book) {
+    Tracer::mark(TraceStage::BOOK_APPLIED);
+    
+    // Keep the order manager's cache in step with the stream
+    order_manager_->update_orderbook(book.instrument_name(), book.bids(BookSnapshot::MAX_DEPTH),
+                                     book.asks(BookSnapshot::MAX_DEPTH), book.timestamp(), book.instrument_id());
+    
+    // Only the top of the book is sent to clients
+    std::shared_ptr<OrderBook> orderbook = orderbook_pool_->acquire();
+    book.to_orderbook(*orderbook, publish_depth_);
+    
+    websocket_server_->handle_orderbook_update(book.instrument_name(), *orderbook);
+}
+
 void TradingSystem::handle_trade_update(const json& update) {
     // Not implemented yet
 }
@@ -0,0 +1,337 @@
+#include "https_connection_pool.h"
+#include <iostream>
+#include <stdexcept>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/asio/ssl/error.hpp>
+#include "performance_monitor.h"
+
+namespace deribit {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+using tcp = net::ip::tcp;
+
+struct HttpsConnectionPool::Connection {
+    Connection(net::io_context& ioc, ssl::context& ctx)
+        : stream(ioc, ctx) {}
+
+    beast::ssl_stream<beast::tcp_stream> stream;
+    beast::flat_buffer buffer;
+    Clock::time_point last_used;
+    uint64_t requests{0};
+    bool from_pool{false};
+};
+
+namespace {
+
+// Errors that indicate the server closed an idle keep-alive connection before
+// it saw our request, in which case the request can safely be sent again
+bool is_stale_connection_error(const beast::error_code& ec) {
+    return ec == http::error::end_of_stream ||
+           ec == net::error::eof ||
+           ec == net::error::connection_reset ||
+           ec == net::error::broken_pipe ||
+           ec == ssl::error::stream_truncated;
+}
+
+void close_connection(beast::ssl_stream<beast::tcp_stream>& stream) {
+    // Close the socket directly; a TLS close_notify would block on the peer
+    beast::error_code ec;
+    beast::get_lowest_layer(stream).socket().shutdown(tcp::socket::shutdown_both, ec);
+    beast::get_lowest_layer(stream).socket().close(ec);
+}
+
+} // namespace
+
+HttpsConnectionPool::HttpsConnectionPool(const std::string& host,
+                                         const std::string& port,
+                                         const ConnectionPoolConfig& config)
+    : host_(host),
+      port_(port),
+      config_(config),
+      ssl_context_(ssl::context::tlsv12_client) {
+    ssl_context_.set_default_verify_paths();
+
+    // Keep client-side sessions so new connections can use abbreviated handshakes
+    SSL_CTX_set_session_cache_mode(ssl_context_.native_handle(), SSL_SESS_CACHE_CLIENT);
+}
+
+HttpsConnectionPool::~HttpsConnectionPool() {
+    stop();
+
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    if (tls_session_) {
+        SSL_SESSION_free(tls_session_);
+        tls_session_ = nullptr;
+    }
+}
+
+void HttpsConnectionPool::start() {
+    if (running_) {
+        return;
+    }
+
+    running_ = true;
+    maintenance_thread_ = std::thread(&HttpsConnectionPool::maintenance_loop, this);
+}
+
+void HttpsConnectionPool::stop() {
+    if (running_) {
+        running_ = false;
+        maintenance_condition_.notify_all();
+    }
+
+    if (maintenance_thread_.joinable()) {
+        maintenance_thread_.join();
+    }
+
+    // Close idle connections
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    for (auto& connection : idle_connections_) {
+        close_connection(connection->stream);
+    }
+    idle_connections_.clear();
+}
+
+std::string HttpsConnectionPool::post(const std::string& target, const std::string& body) {
+    // Create HTTP request
+    http::request<http::string_body> req{http::verb::post, target, 11};
+    req.set(http::field::host, host_);
+    req.set(http::field::user_agent, "DeribitTradingSystem/1.0");
+    req.set(http::field::content_type, "application/json");
+    req.set(http::field::accept, "application/json");
+    req.keep_alive(true);
+    req.body() = body;
+    req.prepare_payload();
+
+    static auto tracker = PerformanceMonitor::instance().get_tracker("https_request", true);
+
+    // A pooled connection may turn out to be stale, so allow one retry on a fresh one
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        std::unique_ptr<Connection> connection = acquire();
+        auto tracking_id = tracker->start();
+
+        // Send HTTP request
+        beast::error_code ec;
+        http::write(connection->stream, req, ec);
+
+        // Receive HTTP response
+        http::response<http::string_body> res;
+        if (!ec) {
+            http::read(connection->stream, connection->buffer, res, ec);
+        }
+
+        tracker->end(tracking_id);
+
+        if (ec) {
+            close_connection(connection->stream);
+
+            if (connection->from_pool && attempt == 0 && is_stale_connection_error(ec)) {
+                continue;
+            }
+
+            throw beast::system_error{ec};
+        }
+
+        connection->requests++;
+        connection->last_used = Clock::now();
+
+        // TLS 1.3 session tickets arrive after the handshake, so capture the
+        // session once the first response has been read
+        if (connection->requests == 1) {
+            store_session(*connection);
+        }
+
+        if (res.keep_alive()) {
+            release(std::move(connection));
+        } else {
+            close_connection(connection->stream);
+        }
+
+        return std::move(res.body());
+    }
+
+    throw std::runtime_error("HTTPS request failed after retry");
+}
+
+size_t HttpsConnectionPool::idle_count() const {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    return idle_connections_.size();
+}
+
+const ConnectionPoolConfig& HttpsConnectionPool::config() const {
+    return config_;
+}
+
+std::unique_ptr<HttpsConnectionPool::Connection> HttpsConnectionPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+
+        // Take the most recently used connection that has not idled out
+        while (!idle_connections_.empty()) {
+            std::unique_ptr<Connection> connection = std::move(idle_connections_.back());
+            idle_connections_.pop_back();
+
+            if (Clock::now() - connection->last_used < config_.idle_timeout) {
+                connection->from_pool = true;
+                return connection;
+            }
+
+            close_connection(connection->stream);
+        }
+    }
+
+    return open_connection();
+}
+
+void HttpsConnectionPool::release(std::unique_ptr<Connection> connection) {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+
+    if (idle_connections_.size() >= config_.pool_size) {
+        close_connection(connection->stream);
+        return;
+    }
+
+    connection->from_pool = false;
+    idle_connections_.push_back(std::move(connection));
+}
+
+std::unique_ptr<HttpsConnectionPool::Connection> HttpsConnectionPool::open_connection() {
+    auto connection = std::make_unique<Connection>(io_context_, ssl_context_);
+
+    // Set SNI hostname (required for SSL)
+    if (!SSL_set_tlsext_host_name(connection->stream.native_handle(), host_.c_str())) {
+        beast::error_code ec{static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()};
+        throw beast::system_error{ec};
+    }
+
+    // Offer the last session for resumption
+    {
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        if (tls_session_) {
+            SSL_set_session(connection->stream.native_handle(), tls_session_);
+        }
+    }
+
+    // Resolve and connect, re-resolving once if the cached endpoints fail
+    {
+        static auto tracker = PerformanceMonitor::instance().get_tracker("https_connect", true);
+        auto tracking_id = tracker->start();
+
+        beast::error_code ec;
+        beast::get_lowest_layer(connection->stream).connect(resolve(false), ec);
+        if (ec) {
+            beast::get_lowest_layer(connection->stream).connect(resolve(true), ec);
+        }
+
+        tracker->end(tracking_id);
+
+        if (ec) {
+            throw beast::system_error{ec};
+        }
+
+        beast::get_lowest_layer(connection->stream).socket().set_option(tcp::no_delay(true));
+    }
+
+    // Perform SSL handshake
+    {
+        static auto tracker = PerformanceMonitor::instance().get_tracker("https_handshake", true);
+        auto tracking_id = tracker->start();
+
+        beast::error_code ec;
+        connection->stream.handshake(ssl::stream_base::client, ec);
+
+        tracker->end(tracking_id);
+
+        if (ec) {
+            throw beast::system_error{ec};
+        }
+    }
+
+    connection->last_used = Clock::now();
+
+    return connection;
+}
+
+tcp::resolver::results_type HttpsConnectionPool::resolve(bool force) {
+    std::lock_guard<std::mutex> lock(resolver_mutex_);
+
+    if (!force && !endpoints_.empty() && Clock::now() - resolved_at_ < config_.resolve_ttl) {
+        return endpoints_;
+    }
+
+    tcp::resolver resolver(io_context_);
+    endpoints_ = resolver.resolve(host_, port_);
+    resolved_at_ = Clock::now();
+
+    return endpoints_;
+}
+
+void HttpsConnectionPool::store_session(Connection& connection) {
+    SSL_SESSION* session = SSL_get1_session(connection.stream.native_handle());
+    if (!session) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    if (tls_session_) {
+        SSL_SESSION_free(tls_session_);
+    }
+    tls_session_ = session;
+}
+
+void HttpsConnectionPool::maintenance_loop() {
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(maintenance_mutex_);
+            maintenance_condition_.wait_for(lock, config_.maintenance_interval, [this] { return !running_; });
+        }
+
+        if (!running_) {
+            break;
+        }
+
+        try {
+            // Evict connections that have been idle too long
+            size_t idle = 0;
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex_);
+                auto now = Clock::now();
+
+                auto it = idle_connections_.begin();
+                while (it != idle_connections_.end()) {
+                    if (now - (*it)->last_used >= config_.idle_timeout) {
+                        close_connection((*it)->stream);
+                        it = idle_connections_.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+
+                idle = idle_connections_.size();
+            }
+
+            // Refresh resolver results when they have expired
+            resolve(false);
+
+            // Keep warm connections ready so requests skip the handshake
+            size_t target = std::min(config_.min_idle_connections, config_.pool_size);
+            while (running_ && idle < target) {
+                std::unique_ptr<Connection> connection = open_connection();
+                store_session(*connection);
+                release(std::move(connection));
+                idle++;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "HTTPS connection pool maintenance error: " << e.what() << std::endl;
+        }
+    }
+}
+
+} // namespace deribit
\ No newline at end of file
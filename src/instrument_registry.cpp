@@ -0,0 +1,360 @@
+#include "instrument_registry.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace deribit {
+
+namespace {
+
+const char* kind_to_string(InstrumentType type) {
+    switch (type) {
+        case InstrumentType::SPOT:
+            return "spot";
+        case InstrumentType::FUTURES:
+            return "future";
+        case InstrumentType::OPTIONS:
+            return "option";
+        default:
+            return "";
+    }
+}
+
+} // namespace
+
+double InstrumentInfo::round_price(double price) const {
+    if (tick_size <= 0.0) {
+        return price;
+    }
+
+    return std::round(price / tick_size) * tick_size;
+}
+
+bool InstrumentInfo::is_valid_price(double price) const {
+    if (tick_size <= 0.0) {
+        return true;
+    }
+
+    // Allow for the representation error of prices like 0.0005 * 3
+    double ticks = price / tick_size;
+    return std::fabs(ticks - std::round(ticks)) < 1e-6;
+}
+
+InstrumentRegistry::InstrumentRegistry(std::shared_ptr<ApiClient> api_client)
+    : api_client_(api_client) {
+}
+
+bool InstrumentRegistry::parse_kind(std::string_view kind, InstrumentType& type) {
+    if (kind == "future" || kind == "future_combo") {
+        type = InstrumentType::FUTURES;
+    } else if (kind == "option" || kind == "option_combo") {
+        type = InstrumentType::OPTIONS;
+    } else if (kind == "spot") {
+        type = InstrumentType::SPOT;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+size_t InstrumentRegistry::load(const std::string& currency, InstrumentType type) {
+    if (!api_client_) {
+        std::cerr << "Cannot load instruments: no API client" << std::endl;
+        return 0;
+    }
+
+    try {
+        // Create request parameters
+        json params = {
+            {"currency", currency},
+            {"kind", kind_to_string(type)},
+            {"expired", false}
+        };
+
+        // Make request
+        ApiResponse response = api_client_->public_request("public/get_instruments", params);
+
+        if (!response.success) {
+            std::cerr << "Error loading instruments: " << response.error_message << std::endl;
+            return 0;
+        }
+
+        size_t loaded = 0;
+        for (const auto& instrument : response.data["result"]) {
+            if (upsert(instrument) != INVALID_INSTRUMENT_ID) {
+                ++loaded;
+            }
+        }
+
+        return loaded;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading instruments: " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+bool InstrumentRegistry::load_from_file(const std::string& filename) {
+    try {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        json instruments = json::parse(file);
+        if (!instruments.is_array()) {
+            std::cerr << "Invalid instrument cache file: " << filename << std::endl;
+            return false;
+        }
+
+        for (const auto& instrument : instruments) {
+            upsert(instrument);
+        }
+
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading instrument cache: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool InstrumentRegistry::save_to_file(const std::string& filename) const {
+    try {
+        json instruments = json::array();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& source : sources_) {
+                instruments.push_back(source);
+            }
+        }
+
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            return false;
+        }
+
+        file << instruments.dump();
+        return file.good();
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving instrument cache: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool InstrumentRegistry::subscribe_updates(const std::string& currency, InstrumentType type) {
+    if (!api_client_) {
+        std::cerr << "Cannot subscribe to instrument updates: no API client" << std::endl;
+        return false;
+    }
+
+    std::string channel = std::string("instrument.state.") + kind_to_string(type) + "." + currency;
+
+    std::weak_ptr<InstrumentRegistry> weak_self = shared_from_this();
+    return api_client_->subscribe(channel, [weak_self](const json& update) {
+        if (auto self = weak_self.lock()) {
+            self->handle_state_update(update);
+        }
+    });
+}
+
+InstrumentId InstrumentRegistry::upsert(const json& instrument) {
+    try {
+        auto info = std::make_shared<InstrumentInfo>();
+
+        info->instrument_name = instrument.at("instrument_name").get<std::string>();
+        info->currency = instrument.value("base_currency", "");
+        info->settlement_currency = instrument.value("settlement_currency", info->currency);
+        if (!parse_kind(instrument.value("kind", ""), info->kind)) {
+            return INVALID_INSTRUMENT_ID;
+        }
+
+        info->tick_size = instrument.value("tick_size", 0.0);
+        info->min_trade_amount = instrument.value("min_trade_amount", 0.0);
+        info->contract_size = instrument.value("contract_size", 0.0);
+        info->expiration_timestamp = instrument.value("expiration_timestamp", int64_t(0));
+        info->active = instrument.value("is_active", true);
+
+        if (instrument.contains("strike") && instrument["strike"].is_number()) {
+            info->strike = instrument["strike"].get<double>();
+        }
+        if (instrument.contains("option_type") && instrument["option_type"].is_string()) {
+            info->option_type = instrument["option_type"].get<std::string>();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = ids_.find(info->instrument_name);
+        if (it != ids_.end()) {
+            // Replace the entry, keeping its id
+            info->id = it->second;
+
+            // Keep the currency index in step
+            const std::string& old_currency = instruments_[info->id]->currency;
+            if (old_currency != info->currency) {
+                auto& old_ids = by_currency_[old_currency];
+                old_ids.erase(std::remove(old_ids.begin(), old_ids.end(), info->id), old_ids.end());
+                by_currency_[info->currency].push_back(info->id);
+            }
+
+            instruments_[info->id] = info;
+            sources_[info->id] = instrument;
+        } else {
+            info->id = static_cast<InstrumentId>(instruments_.size());
+
+            ids_.emplace(info->instrument_name, info->id);
+            by_currency_[info->currency].push_back(info->id);
+            instruments_.push_back(info);
+            sources_.push_back(instrument);
+        }
+
+        return info->id;
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid instrument: " << e.what() << std::endl;
+        return INVALID_INSTRUMENT_ID;
+    }
+}
+
+void InstrumentRegistry::handle_state_update(const json& update) {
+    try {
+        const std::string& instrument_name = update.at("instrument_name").get_ref<const std::string&>();
+        const std::string& state = update.at("state").get_ref<const std::string&>();
+
+        if (state == "created" || state == "started") {
+            if (find_id(instrument_name) == INVALID_INSTRUMENT_ID) {
+                fetch_instrument(instrument_name);
+            } else {
+                set_active(instrument_name, true);
+            }
+        } else if (state == "settled" || state == "deactivated" || state == "closed" || state == "terminated") {
+            set_active(instrument_name, false);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error handling instrument state update: " << e.what() << std::endl;
+    }
+}
+
+InstrumentId InstrumentRegistry::find_id(std::string_view instrument_name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = ids_.find(instrument_name);
+    return it != ids_.end() ? it->second : INVALID_INSTRUMENT_ID;
+}
+
+InstrumentRegistry::InstrumentPtr InstrumentRegistry::get(InstrumentId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return id < instruments_.size() ? instruments_[id] : nullptr;
+}
+
+InstrumentRegistry::InstrumentPtr InstrumentRegistry::get(std::string_view instrument_name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = ids_.find(instrument_name);
+    return it != ids_.end() ? instruments_[it->second] : nullptr;
+}
+
+std::vector<InstrumentRegistry::InstrumentPtr> InstrumentRegistry::find(const InstrumentFilter& filter) const {
+    std::vector<InstrumentPtr> result;
+
+    auto matches = [&filter](const InstrumentInfo& info) {
+        return (!filter.match_kind || info.kind == filter.kind) &&
+               (filter.expiration_timestamp == 0 || info.expiration_timestamp == filter.expiration_timestamp) &&
+               (filter.strike == 0.0 || info.strike == filter.strike) &&
+               (!filter.active_only || info.active);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (filter.currency.empty()) {
+            for (const auto& info : instruments_) {
+                if (matches(*info)) {
+                    result.push_back(info);
+                }
+            }
+        } else {
+            auto it = by_currency_.find(filter.currency);
+            if (it != by_currency_.end()) {
+                for (InstrumentId id : it->second) {
+                    if (matches(*instruments_[id])) {
+                        result.push_back(instruments_[id]);
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const InstrumentPtr& a, const InstrumentPtr& b) {
+        if (a->expiration_timestamp != b->expiration_timestamp) {
+            return a->expiration_timestamp < b->expiration_timestamp;
+        }
+        if (a->strike != b->strike) {
+            return a->strike < b->strike;
+        }
+        return a->instrument_name < b->instrument_name;
+    });
+
+    return result;
+}
+
+std::vector<int64_t> InstrumentRegistry::expirations(const std::string& currency, InstrumentType type) const {
+    InstrumentFilter filter;
+    filter.currency = currency;
+    filter.match_kind = true;
+    filter.kind = type;
+
+    std::vector<int64_t> result;
+    for (const auto& info : find(filter)) {
+        if (result.empty() || result.back() != info->expiration_timestamp) {
+            result.push_back(info->expiration_timestamp);
+        }
+    }
+
+    return result;
+}
+
+size_t InstrumentRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return instruments_.size();
+}
+
+void InstrumentRegistry::set_active(std::string_view instrument_name, bool active) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = ids_.find(instrument_name);
+    if (it == ids_.end() || instruments_[it->second]->active == active) {
+        return;
+    }
+
+    auto info = std::make_shared<InstrumentInfo>(*instruments_[it->second]);
+    info->active = active;
+    instruments_[it->second] = info;
+    sources_[it->second]["is_active"] = active;
+}
+
+void InstrumentRegistry::fetch_instrument(const std::string& instrument_name) {
+    if (!api_client_) {
+        return;
+    }
+
+    std::weak_ptr<InstrumentRegistry> weak_self = shared_from_this();
+
+    api_client_->public_request_async("public/get_instrument", {{"instrument_name", instrument_name}},
+        [weak_self, instrument_name](const ApiResponse& response) {
+            auto self = weak_self.lock();
+            if (!self) {
+                return;
+            }
+
+            if (response.success) {
+                self->upsert(response.data["result"]);
+            } else {
+                std::cerr << "Error fetching instrument " << instrument_name << ": "
+                          << response.error_message << std::endl;
+            }
+        });
+}
+
+} // namespace deribit
\ No newline at end of file
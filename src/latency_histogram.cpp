@@ -0,0 +1,254 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace deribit {
+
+namespace {
+
+int most_significant_bit(uint64_t value) {
+    return 63 - __builtin_clzll(value);
+}
+
+} // namespace
+
+// HistogramSnapshot implementation
+HistogramSnapshot::HistogramSnapshot(int significant_bits)
+    : significant_bits_(significant_bits) {
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    if (other.total_count_ == 0 && other.counts_.empty()) {
+        return;
+    }
+
+    if (significant_bits_ == 0) {
+        significant_bits_ = other.significant_bits_;
+    } else if (significant_bits_ != other.significant_bits_) {
+        throw std::invalid_argument("Cannot merge histograms with different precision");
+    }
+
+    if (counts_.size() < other.counts_.size()) {
+        counts_.resize(other.counts_.size(), 0);
+    }
+
+    for (size_t i = 0; i < other.counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+
+    total_count_ += other.total_count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t HistogramSnapshot::count() const {
+    return total_count_;
+}
+
+int64_t HistogramSnapshot::min() const {
+    return total_count_ == 0 ? 0 : min_;
+}
+
+int64_t HistogramSnapshot::max() const {
+    return max_;
+}
+
+double HistogramSnapshot::mean() const {
+    if (total_count_ == 0) {
+        return 0.0;
+    }
+
+    return static_cast<double>(sum_) / total_count_;
+}
+
+int64_t HistogramSnapshot::percentile(double percentile) const {
+    if (total_count_ == 0) {
+        return 0;
+    }
+
+    // Rank of the value at this percentile, at least the first value
+    double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * total_count_)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+
+        if (seen >= rank) {
+            // Never report beyond what was actually recorded
+            return std::min(LatencyHistogram::bucket_upper_bound(i, significant_bits_), max_);
+        }
+    }
+
+    return max_;
+}
+
+// LatencyHistogram implementation
+LatencyHistogram::LatencyHistogram(int significant_bits, int64_t max_value_ns)
+    : significant_bits_(std::min(std::max(significant_bits, 1), 20)),
+      max_value_(std::max<int64_t>(max_value_ns, 1)) {
+    bucket_count_ = bucket_index(max_value_, significant_bits_) + 1;
+    counts_ = std::make_unique<std::atomic<uint64_t>[]>(bucket_count_);
+
+    for (size_t i = 0; i < bucket_count_; ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::record(int64_t value_ns) {
+    int64_t value = std::min(std::max<int64_t>(value_ns, 0), max_value_);
+
+    counts_[bucket_index(value, significant_bits_)].fetch_add(1, std::memory_order_relaxed);
+    total_count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    int64_t current_min = min_.load(std::memory_order_relaxed);
+    while (value < current_min &&
+           !min_.compare_exchange_weak(current_min, value, std::memory_order_relaxed)) {
+    }
+
+    int64_t current_max = max_.load(std::memory_order_relaxed);
+    while (value > current_max &&
+           !max_.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot snapshot(significant_bits_);
+    add_to(snapshot);
+    return snapshot;
+}
+
+void LatencyHistogram::add_to(HistogramSnapshot& snapshot) const {
+    if (snapshot.significant_bits_ == 0) {
+        snapshot.significant_bits_ = significant_bits_;
+    } else if (snapshot.significant_bits_ != significant_bits_) {
+        throw std::invalid_argument("Cannot merge histograms with different precision");
+    }
+
+    if (snapshot.counts_.size() < bucket_count_) {
+        snapshot.counts_.resize(bucket_count_, 0);
+    }
+
+    // Counts are read bucket by bucket, so the total is summed from what was read
+    uint64_t total = 0;
+    for (size_t i = 0; i < bucket_count_; ++i) {
+        uint64_t count = counts_[i].load(std::memory_order_relaxed);
+        snapshot.counts_[i] += count;
+        total += count;
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    snapshot.total_count_ += total;
+    snapshot.sum_ += sum_.load(std::memory_order_relaxed);
+    snapshot.min_ = std::min(snapshot.min_, min_.load(std::memory_order_relaxed));
+    snapshot.max_ = std::max(snapshot.max_, max_.load(std::memory_order_relaxed));
+}
+
+void LatencyHistogram::reset() {
+    for (size_t i = 0; i < bucket_count_; ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+
+    total_count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(INT64_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::bucket_index(int64_t value, int significant_bits) {
+    uint64_t v = static_cast<uint64_t>(value);
+    uint64_t linear_limit = uint64_t(1) << significant_bits;
+
+    // Small values map one-to-one
+    if (v < linear_limit) {
+        return static_cast<size_t>(v);
+    }
+
+    // Keep the top significant_bits of the value; each shift is one power of two
+    uint64_t half = linear_limit >> 1;
+    int shift = most_significant_bit(v) - (significant_bits - 1);
+    uint64_t sub_bucket = v >> shift;
+
+    return static_cast<size_t>(linear_limit + (shift - 1) * half + (sub_bucket - half));
+}
+
+int64_t LatencyHistogram::bucket_upper_bound(size_t index, int significant_bits) {
+    uint64_t linear_limit = uint64_t(1) << significant_bits;
+
+    if (index < linear_limit) {
+        return static_cast<int64_t>(index);
+    }
+
+    uint64_t half = linear_limit >> 1;
+    uint64_t offset = index - linear_limit;
+    int shift = static_cast<int>(offset / half) + 1;
+    uint64_t sub_bucket = offset % half + half;
+
+    return static_cast<int64_t>(((sub_bucket + 1) << shift) - 1);
+}
+
+// RollingHistogram implementation
+RollingHistogram::RollingHistogram(const HistogramConfig& config)
+    : significant_bits_(std::min(std::max(config.significant_bits, 1), 20)),
+      interval_ns_(std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(config.window_interval).count())) {
+    size_t interval_count = std::max<size_t>(1, config.window_intervals);
+
+    for (size_t i = 0; i < interval_count; ++i) {
+        intervals_.push_back(std::make_unique<Interval>(config.significant_bits, config.max_value_ns));
+    }
+}
+
+void RollingHistogram::record(int64_t value_ns, int64_t now_ns) {
+    int64_t epoch = now_ns / interval_ns_;
+    Interval& interval = *intervals_[static_cast<size_t>(epoch) % intervals_.size()];
+
+    int64_t current = interval.epoch.load(std::memory_order_acquire);
+    if (current != epoch) {
+        // A recorder delayed past the interval end must not write into the new one
+        if (current > epoch) {
+            return;
+        }
+
+        // The first recorder of a new interval recycles the slot
+        if (interval.epoch.compare_exchange_strong(current, epoch, std::memory_order_acq_rel)) {
+            interval.histogram.reset();
+        }
+    }
+
+    interval.histogram.record(value_ns);
+}
+
+HistogramSnapshot RollingHistogram::snapshot(int64_t now_ns) const {
+    int64_t epoch = now_ns / interval_ns_;
+    int64_t oldest = epoch - static_cast<int64_t>(intervals_.size()) + 1;
+
+    HistogramSnapshot snapshot(significant_bits_);
+    for (const auto& interval : intervals_) {
+        int64_t interval_epoch = interval->epoch.load(std::memory_order_acquire);
+
+        if (interval_epoch >= oldest && interval_epoch <= epoch) {
+            interval->histogram.add_to(snapshot);
+        }
+    }
+
+    return snapshot;
+}
+
+std::chrono::nanoseconds RollingHistogram::window() const {
+    return std::chrono::nanoseconds(interval_ns_ * static_cast<int64_t>(intervals_.size()));
+}
+
+void RollingHistogram::reset() {
+    for (auto& interval : intervals_) {
+        interval->epoch.store(-1, std::memory_order_relaxed);
+        interval->histogram.reset();
+    }
+}
+
+} // namespace deribit
\ No newline at end of file
@@ -0,0 +1,661 @@
+#include "market_data_codec.h"
+#include <charconv>
+#include <cmath>
+
+namespace deribit {
+
+namespace {
+
+// Forward-only reader over a JSON text; every method returns false on malformed input
+class JsonCursor {
+public:
+    explicit JsonCursor(std::string_view text)
+        : begin_(text.data()), p_(text.data()), end_(text.data() + text.size()) {}
+
+    size_t offset() const {
+        return static_cast<size_t>(p_ - begin_);
+    }
+
+    char peek() {
+        skip_whitespace();
+        return p_ < end_ ? *p_ : '\0';
+    }
+
+    bool consume(char c) {
+        if (peek() != c) {
+            return false;
+        }
+
+        ++p_;
+        return true;
+    }
+
+    // Strings with escapes are left to the generic json path
+    bool string(std::string_view& out) {
+        if (!consume('"')) {
+            return false;
+        }
+
+        const char* start = p_;
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ == '\\') {
+                return false;
+            }
+            ++p_;
+        }
+
+        if (p_ == end_) {
+            return false;
+        }
+
+        out = std::string_view(start, static_cast<size_t>(p_ - start));
+        ++p_;
+        return true;
+    }
+
+    bool integer(int64_t& out) {
+        skip_whitespace();
+        const char* start = p_;
+        auto result = std::from_chars(p_, end_, out);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+
+        p_ = result.ptr;
+
+        // Integral fields may still be sent as 123.0
+        if (p_ < end_ && (*p_ == '.' || *p_ == 'e' || *p_ == 'E')) {
+            double value;
+            auto fraction = std::from_chars(start, end_, value);
+            if (fraction.ec != std::errc()) {
+                return false;
+            }
+
+            p_ = fraction.ptr;
+            out = static_cast<int64_t>(value);
+        }
+
+        return true;
+    }
+
+    bool number(double& out) {
+        skip_whitespace();
+        auto result = std::from_chars(p_, end_, out);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+
+        p_ = result.ptr;
+        return true;
+    }
+
+    // Start of a key-value pair inside an object, or the end of the object
+    bool next_key(std::string_view& key, bool& done, bool first) {
+        if (consume('}')) {
+            done = true;
+            return true;
+        }
+
+        if (!first && !consume(',')) {
+            return false;
+        }
+
+        done = false;
+        return string(key) && consume(':');
+    }
+
+    // Start of an element inside an array, or the end of the array
+    bool next_element(bool& done, bool first) {
+        if (consume(']')) {
+            done = true;
+            return true;
+        }
+
+        done = false;
+        return first || consume(',');
+    }
+
+    bool skip_value() {
+        char c = peek();
+
+        if (c == '"') {
+            return skip_string();
+        }
+
+        if (c == '{' || c == '[') {
+            return skip_container();
+        }
+
+        // Number or literal
+        const char* start = p_;
+        while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' &&
+               *p_ != ' ' && *p_ != '\t' && *p_ != '\n' && *p_ != '\r') {
+            ++p_;
+        }
+
+        return p_ != start;
+    }
+
+private:
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+
+    void skip_whitespace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+            ++p_;
+        }
+    }
+
+    bool skip_string() {
+        ++p_;
+        while (p_ < end_ && *p_ != '"') {
+            p_ += (*p_ == '\\') ? 2 : 1;
+        }
+
+        if (p_ >= end_) {
+            return false;
+        }
+
+        ++p_;
+        return true;
+    }
+
+    bool skip_container() {
+        int depth = 0;
+
+        while (p_ < end_) {
+            char c = *p_;
+
+            if (c == '"') {
+                if (!skip_string()) {
+                    return false;
+                }
+                continue;
+            }
+
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    ++p_;
+                    return true;
+                }
+            }
+
+            ++p_;
+        }
+
+        return false;
+    }
+};
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool parse_action(std::string_view text, BookAction& action) {
+    if (text == "new") {
+        action = BookAction::NEW;
+    } else if (text == "change") {
+        action = BookAction::CHANGE;
+    } else if (text == "delete") {
+        action = BookAction::DELETE;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// Levels are [action, price, amount], or [price, amount] on grouped channels
+bool parse_levels(JsonCursor& cursor, std::vector<BookLevelUpdate>& levels, bool& pair_format) {
+    if (!cursor.consume('[')) {
+        return false;
+    }
+
+    bool done = false;
+    for (bool first = true; ; first = false) {
+        if (!cursor.next_element(done, first)) {
+            return false;
+        }
+
+        if (done) {
+            return true;
+        }
+
+        if (!cursor.consume('[')) {
+            return false;
+        }
+
+        BookLevelUpdate level{BookAction::NEW, 0.0, 0.0};
+
+        if (cursor.peek() == '"') {
+            std::string_view action;
+            if (!cursor.string(action) || !parse_action(action, level.action) || !cursor.consume(',')) {
+                return false;
+            }
+        } else {
+            pair_format = true;
+        }
+
+        if (!cursor.number(level.price) || !cursor.consume(',') ||
+            !cursor.number(level.amount) || !cursor.consume(']')) {
+            return false;
+        }
+
+        levels.push_back(level);
+    }
+}
+
+bool parse_trade(JsonCursor& cursor, TradeUpdate& trade) {
+    if (!cursor.consume('{')) {
+        return false;
+    }
+
+    bool done = false;
+    for (bool first = true; ; first = false) {
+        std::string_view key;
+        if (!cursor.next_key(key, done, first)) {
+            return false;
+        }
+
+        if (done) {
+            return true;
+        }
+
+        bool ok;
+        if (key == "instrument_name") {
+            ok = cursor.string(trade.instrument_name);
+        } else if (key == "trade_id") {
+            ok = cursor.string(trade.trade_id);
+        } else if (key == "direction") {
+            ok = cursor.string(trade.direction);
+        } else if (key == "trade_seq") {
+            ok = cursor.integer(trade.trade_seq);
+        } else if (key == "timestamp") {
+            ok = cursor.integer(trade.timestamp);
+        } else if (key == "price") {
+            ok = cursor.number(trade.price);
+        } else if (key == "amount") {
+            ok = cursor.number(trade.amount);
+        } else if (key == "mark_price") {
+            ok = cursor.number(trade.mark_price);
+        } else if (key == "index_price") {
+            ok = cursor.number(trade.index_price);
+        } else {
+            ok = cursor.skip_value();
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+void append_escaped(std::string& out, std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+
+    out.push_back('"');
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (u < 0x20) {
+            out.append("\\u00");
+            out.push_back(hex[u >> 4]);
+            out.push_back(hex[u & 0xf]);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void append_number(std::string& out, double value) {
+    // json::dump() writes non-finite numbers as null
+    if (!std::isfinite(value)) {
+        out.append("null");
+        return;
+    }
+
+    // The serializer's own formatter, so digits and exponent form match json::dump(),
+    // e.g. 100000.0 and 0.0001 rather than the shortest 1e+05 and 1e-04
+    char buffer[64];
+    char* end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+void append_levels(std::string& out, const std::vector<std::pair<double, double>>& levels) {
+    out.push_back('[');
+    for (size_t i = 0; i < levels.size(); ++i) {
+        if (i > 0) {
+            out.push_back(',');
+        }
+
+        out.push_back('[');
+        append_number(out, levels[i].first);
+        out.push_back(',');
+        append_number(out, levels[i].second);
+        out.push_back(']');
+    }
+    out.push_back(']');
+}
+
+} // namespace
+
+// MarketDataDecoder implementation
+bool MarketDataDecoder::parse_envelope(std::string_view payload, MessageEnvelope& envelope) {
+    JsonCursor cursor(payload);
+    if (!cursor.consume('{')) {
+        return false;
+    }
+
+    bool subscription = false;
+    bool have_method = false;
+    bool have_channel = false;
+    bool have_data = false;
+
+    bool done = false;
+    for (bool first = true; ; first = false) {
+        std::string_view key;
+        if (!cursor.next_key(key, done, first)) {
+            return false;
+        }
+
+        if (done) {
+            break;
+        }
+
+        if (key == "method") {
+            std::string_view method;
+            if (!cursor.string(method)) {
+                return false;
+            }
+
+            have_method = true;
+            subscription = method == "subscription";
+
+            if (!subscription) {
+                return false;
+            }
+        } else if (key == "params") {
+            if (!cursor.consume('{')) {
+                return false;
+            }
+
+            bool params_done = false;
+            for (bool params_first = true; ; params_first = false) {
+                std::string_view params_key;
+                if (!cursor.next_key(params_key, params_done, params_first)) {
+                    return false;
+                }
+
+                if (params_done) {
+                    break;
+                }
+
+                if (params_key == "channel") {
+                    if (!cursor.string(envelope.channel)) {
+                        return false;
+                    }
+                    have_channel = true;
+                } else if (params_key == "data") {
+                    cursor.peek();
+                    envelope.data_offset = cursor.offset();
+                    have_data = true;
+
+                    // Usual field order: nothing after the data is needed
+                    if (have_method && have_channel) {
+                        return true;
+                    }
+
+                    if (!cursor.skip_value()) {
+                        return false;
+                    }
+                } else if (!cursor.skip_value()) {
+                    return false;
+                }
+            }
+        } else if (key == "jsonrpc") {
+            if (!cursor.skip_value()) {
+                return false;
+            }
+        } else {
+            // Responses and errors carry id, result or error
+            return false;
+        }
+    }
+
+    return subscription && have_channel && have_data;
+}
+
+bool MarketDataDecoder::decode_book(std::string_view data, BookUpdate& update) {
+    update.clear();
+
+    JsonCursor cursor(data);
+    if (!cursor.consume('{')) {
+        return false;
+    }
+
+    bool have_bids = false;
+    bool have_asks = false;
+    bool pair_format = false;
+
+    bool done = false;
+    for (bool first = true; ; first = false) {
+        std::string_view key;
+        if (!cursor.next_key(key, done, first)) {
+            return false;
+        }
+
+        if (done) {
+            break;
+        }
+
+        bool ok;
+        if (key == "bids") {
+            ok = parse_levels(cursor, update.bids, pair_format);
+            have_bids = true;
+        } else if (key == "asks") {
+            ok = parse_levels(cursor, update.asks, pair_format);
+            have_asks = true;
+        } else if (key == "type") {
+            std::string_view type;
+            ok = cursor.string(type);
+            update.snapshot = update.snapshot || type == "snapshot";
+        } else if (key == "instrument_name") {
+            ok = cursor.string(update.instrument_name);
+        } else if (key == "timestamp") {
+            ok = cursor.integer(update.timestamp);
+        } else if (key == "change_id") {
+            ok = cursor.integer(update.change_id);
+        } else if (key == "prev_change_id") {
+            ok = cursor.integer(update.prev_change_id);
+        } else {
+            ok = cursor.skip_value();
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+
+    // Grouped channels only ever send full books
+    update.snapshot = update.snapshot || pair_format;
+
+    return have_bids && have_asks;
+}
+
+bool MarketDataDecoder::decode_book_json(const json& data, BookUpdate& update) {
+    update.clear();
+
+    try {
+        bool pair_format = false;
+
+        auto read_levels = [&pair_format](const json& levels, std::vector<BookLevelUpdate>& out) {
+            for (const auto& level : levels) {
+                BookLevelUpdate entry{BookAction::NEW, 0.0, 0.0};
+
+                if (level.size() == 3) {
+                    if (!parse_action(level[0].get_ref<const std::string&>(), entry.action)) {
+                        return false;
+                    }
+                    entry.price = level[1].get<double>();
+                    entry.amount = level[2].get<double>();
+                } else {
+                    pair_format = true;
+                    entry.price = level.at(0).get<double>();
+                    entry.amount = level.at(1).get<double>();
+                }
+
+                out.push_back(entry);
+            }
+
+            return true;
+        };
+
+        if (!read_levels(data.at("bids"), update.bids) || !read_levels(data.at("asks"), update.asks)) {
+            return false;
+        }
+
+        auto type = data.find("type");
+        update.snapshot = pair_format || (type != data.end() && *type == "snapshot");
+
+        auto instrument_name = data.find("instrument_name");
+        if (instrument_name != data.end()) {
+            update.instrument_name = instrument_name->get_ref<const std::string&>();
+        }
+
+        update.timestamp = data.value("timestamp", static_cast<int64_t>(0));
+        update.change_id = data.value("change_id", static_cast<int64_t>(0));
+        update.prev_change_id = data.value("prev_change_id", static_cast<int64_t>(0));
+
+        return true;
+    } catch (const json::exception&) {
+        return false;
+    }
+}
+
+bool MarketDataDecoder::decode_trades(std::string_view data, std::vector<TradeUpdate>& trades) {
+    trades.clear();
+
+    JsonCursor cursor(data);
+    if (!cursor.consume('[')) {
+        return false;
+    }
+
+    bool done = false;
+    for (bool first = true; ; first = false) {
+        if (!cursor.next_element(done, first)) {
+            return false;
+        }
+
+        if (done) {
+            return true;
+        }
+
+        trades.emplace_back();
+        if (!parse_trade(cursor, trades.back())) {
+            return false;
+        }
+    }
+}
+
+bool MarketDataDecoder::decode_trades_json(const json& data, std::vector<TradeUpdate>& trades) {
+    trades.clear();
+
+    try {
+        auto read_string = [](const json& trade, const char* key) {
+            auto it = trade.find(key);
+            return it != trade.end() && it->is_string() ?
+                std::string_view(it->get_ref<const std::string&>()) : std::string_view();
+        };
+
+        for (const auto& trade : data) {
+            TradeUpdate entry;
+            entry.instrument_name = read_string(trade, "instrument_name");
+            entry.trade_id = read_string(trade, "trade_id");
+            entry.direction = read_string(trade, "direction");
+            entry.trade_seq = trade.value("trade_seq", static_cast<int64_t>(0));
+            entry.timestamp = trade.value("timestamp", static_cast<int64_t>(0));
+            entry.price = trade.value("price", 0.0);
+            entry.amount = trade.value("amount", 0.0);
+            entry.mark_price = trade.value("mark_price", 0.0);
+            entry.index_price = trade.value("index_price", 0.0);
+            trades.push_back(entry);
+        }
+
+        return true;
+    } catch (const json::exception&) {
+        return false;
+    }
+}
+
+bool MarketDataDecoder::is_book_channel(std::string_view channel) {
+    return starts_with(channel, "book.");
+}
+
+bool MarketDataDecoder::is_trades_channel(std::string_view channel) {
+    return starts_with(channel, "trades.");
+}
+
+void write_orderbook_message(std::string& out,
+                             std::string_view instrument_name,
+                             std::string_view timestamp,
+                             const std::vector<std::pair<double, double>>& bids,
+                             const std::vector<std::pair<double, double>>& asks) {
+    // Roughly 40 bytes per level plus the fixed fields
+    out.reserve(out.size() + 96 + instrument_name.size() + timestamp.size() + 40 * (bids.size() + asks.size()));
+
+    // Keys in the sorted order json::dump() uses
+    out.append("{\"asks\":");
+    append_levels(out, asks);
+    out.append(",\"bids\":");
+    append_levels(out, bids);
+    out.append(",\"instrument_name\":");
+    append_escaped(out, instrument_name);
+    out.append(",\"timestamp\":");
+    append_escaped(out, timestamp);
+    out.append(",\"type\":\"orderbook\"}");
+}
+
+void write_ticker_message(std::string& out,
+                          std::string_view instrument_name,
+                          std::string_view timestamp,
+                          const std::pair<double, double>* best_bid,
+                          const std::pair<double, double>* best_ask) {
+    out.reserve(out.size() + 160 + instrument_name.size() + timestamp.size());
+
+    // A missing side is written as null amount and price
+    auto append_side = [&out](const char* side, const std::pair<double, double>* level) {
+        out.append("\"best_").append(side).append("_amount\":");
+        if (level) {
+            append_number(out, level->second);
+        } else {
+            out.append("null");
+        }
+
+        out.append(",\"best_").append(side).append("_price\":");
+        if (level) {
+            append_number(out, level->first);
+        } else {
+            out.append("null");
+        }
+    };
+
+    // Keys in the sorted order json::dump() uses
+    out.push_back('{');
+    append_side("ask", best_ask);
+    out.push_back(',');
+    append_side("bid", best_bid);
+    out.append(",\"instrument_name\":");
+    append_escaped(out, instrument_name);
+    out.append(",\"timestamp\":");
+    append_escaped(out, timestamp);
+    out.append(",\"type\":\"ticker\"}");
+}
+
+} // namespace deribit
\ No newline at end of file
@@ -0,0 +1,425 @@
+#include "market_data_journal.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace deribit {
+
+namespace {
+
+const char JOURNAL_MAGIC[8] = {'D', 'R', 'B', 'J', 'R', 'N', 'L', '1'};
+constexpr uint32_t JOURNAL_VERSION = 1;
+constexpr size_t RECORD_HEADER_SIZE = 16;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int64_t created_wall_ns;
+    int64_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t length;
+    uint32_t reserved;
+    int64_t received_wall_ns;
+};
+
+static_assert(sizeof(FileHeader) == JournalWriter::HEADER_SIZE, "Unexpected journal header size");
+static_assert(sizeof(RecordHeader) == RECORD_HEADER_SIZE, "Unexpected record header size");
+
+size_t padded(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+int64_t wall_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool valid_header(const char* data, size_t size) {
+    if (size < JournalWriter::HEADER_SIZE) {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 &&
+           header.version == JOURNAL_VERSION && header.header_size == JournalWriter::HEADER_SIZE;
+}
+
+// Walk the records of a journal image; stops at the zero-filled tail or a truncated record
+size_t find_end(const char* data, size_t size, uint64_t& records) {
+    size_t offset = JournalWriter::HEADER_SIZE;
+    records = 0;
+
+    while (offset + RECORD_HEADER_SIZE <= size) {
+        RecordHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        if (header.length == 0 || offset + RECORD_HEADER_SIZE + header.length > size) {
+            break;
+        }
+
+        offset += RECORD_HEADER_SIZE + padded(header.length);
+        ++records;
+    }
+
+    return std::min(offset, size);
+}
+
+} // namespace
+
+// JournalWriter implementation
+JournalWriter::JournalWriter(const JournalConfig& config)
+    : config_(config),
+      queue_(config.queue_capacity),
+      waiter_(WaitPolicy::BLOCKING) {
+    auto& monitor = PerformanceMonitor::instance();
+    records_counter_ = monitor.get_counter("journal_records");
+    bytes_counter_ = monitor.get_counter("journal_bytes");
+    dropped_counter_ = monitor.get_counter("journal_dropped");
+}
+
+JournalWriter::~JournalWriter() {
+    close();
+}
+
+bool JournalWriter::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (open_) {
+        std::cerr << "Journal already open" << std::endl;
+        return false;
+    }
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open journal " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0) {
+        std::cerr << "Failed to stat journal " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // Check an existing file before growing it
+    size_t existing = static_cast<size_t>(info.st_size);
+    if (existing > 0) {
+        char header[HEADER_SIZE];
+        if (existing < HEADER_SIZE || pread(fd_, header, HEADER_SIZE, 0) != static_cast<ssize_t>(HEADER_SIZE) ||
+            !valid_header(header, HEADER_SIZE)) {
+            std::cerr << "Not a journal: " << path << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+    }
+
+    if (!map(std::max(existing, config_.grow_bytes))) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    if (existing == 0) {
+        // New journal: write the header
+        FileHeader header{};
+        std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        header.version = JOURNAL_VERSION;
+        header.header_size = HEADER_SIZE;
+        header.created_wall_ns = wall_now_ns();
+        std::memcpy(mapping_, &header, sizeof(header));
+
+        end_offset_ = HEADER_SIZE;
+        records_ = 0;
+    } else {
+        // Existing journal: continue after its last complete record
+        uint64_t records = 0;
+        end_offset_ = find_end(mapping_, existing, records);
+        records_ = records;
+    }
+
+    appended_ = 0;
+    written_ = 0;
+    synced_ = 0;
+    open_ = true;
+    thread_ = std::thread(&JournalWriter::run, this);
+
+    return true;
+}
+
+void JournalWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!open_.exchange(false)) {
+        return;
+    }
+
+    // The flusher drains the queue before it exits
+    waiter_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    sync(true);
+    unmap();
+
+    // Trim the zero-filled tail
+    if (ftruncate(fd_, static_cast<off_t>(end_offset_.load())) != 0) {
+        std::cerr << "Failed to trim journal: " << std::strerror(errno) << std::endl;
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool JournalWriter::is_open() const {
+    return open_;
+}
+
+bool JournalWriter::append(std::shared_ptr<const std::string> payload, int64_t received_wall_ns) {
+    if (!open_.load(std::memory_order_relaxed) || !payload || payload->empty()) {
+        return false;
+    }
+
+    bool pushed = queue_.try_push([&](Entry& entry) {
+        entry.payload = std::move(payload);
+        entry.received_wall_ns = received_wall_ns;
+    });
+
+    if (!pushed) {
+        dropped_counter_->add();
+        return false;
+    }
+
+    appended_.fetch_add(1, std::memory_order_relaxed);
+    waiter_.notify();
+    return true;
+}
+
+bool JournalWriter::flush(std::chrono::milliseconds timeout) {
+    uint64_t target = appended_.load();
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (synced_.load() < target) {
+        if (!open_ || std::chrono::steady_clock::now() > deadline) {
+            return synced_.load() >= target;
+        }
+
+        sync_requested_ = true;
+        waiter_.notify_all();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+uint64_t JournalWriter::records_written() const {
+    return records_;
+}
+
+uint64_t JournalWriter::bytes_written() const {
+    return end_offset_;
+}
+
+bool JournalWriter::map(size_t size) {
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        std::cerr << "Failed to grow journal: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map journal: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    mapping_ = static_cast<char*>(mapping);
+    mapped_size_ = size;
+    return true;
+}
+
+void JournalWriter::unmap() {
+    if (mapping_) {
+        munmap(mapping_, mapped_size_);
+        mapping_ = nullptr;
+        mapped_size_ = 0;
+    }
+}
+
+bool JournalWriter::write_entry(const Entry& entry) {
+    const std::string& payload = *entry.payload;
+    size_t offset = end_offset_.load(std::memory_order_relaxed);
+    size_t record_size = RECORD_HEADER_SIZE + padded(payload.size());
+
+    // After a failed remap every frame is dropped
+    if (!mapping_ || payload.size() > UINT32_MAX) {
+        dropped_counter_->add();
+        return false;
+    }
+
+    // Remapping happens here, off the capture path
+    if (offset + record_size > mapped_size_) {
+        size_t size = std::max(mapped_size_ + config_.grow_bytes, offset + record_size);
+        sync(false);
+        unmap();
+        if (!map(size)) {
+            dropped_counter_->add();
+            return false;
+        }
+    }
+
+    // Payload first, so a crash never leaves a length pointing at missing data
+    std::memcpy(mapping_ + offset + RECORD_HEADER_SIZE, payload.data(), payload.size());
+
+    RecordHeader header{};
+    header.length = static_cast<uint32_t>(payload.size());
+    header.received_wall_ns = entry.received_wall_ns;
+    std::memcpy(mapping_ + offset, &header, sizeof(header));
+
+    end_offset_.store(offset + record_size, std::memory_order_relaxed);
+    records_.fetch_add(1, std::memory_order_relaxed);
+    records_counter_->add();
+    bytes_counter_->add(static_cast<int64_t>(record_size));
+    return true;
+}
+
+void JournalWriter::sync(bool wait) {
+    if (mapping_ && msync(mapping_, end_offset_.load(), wait ? MS_SYNC : MS_ASYNC) != 0) {
+        std::cerr << "Failed to sync journal: " << std::strerror(errno) << std::endl;
+    }
+    synced_.store(written_.load());
+}
+
+void JournalWriter::run() {
+    Entry entry;
+    auto next_sync = std::chrono::steady_clock::now() + config_.sync_interval;
+
+    for (;;) {
+        bool drained = true;
+        while (queue_.try_pop(entry)) {
+            write_entry(entry);
+            entry.payload.reset();
+            written_.fetch_add(1, std::memory_order_relaxed);
+            drained = false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (sync_requested_.exchange(false) || now >= next_sync) {
+            sync(false);
+            next_sync = now + config_.sync_interval;
+        }
+
+        // Exit only once the queue stayed empty after close()
+        if (drained && !open_) {
+            break;
+        }
+
+        waiter_.wait([this] {
+            return !queue_.empty() || !open_ || sync_requested_.load(std::memory_order_relaxed);
+        });
+    }
+}
+
+// JournalReader implementation
+JournalReader::~JournalReader() {
+    close();
+}
+
+bool JournalReader::open(const std::string& path) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open journal " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || static_cast<size_t>(info.st_size) < JournalWriter::HEADER_SIZE) {
+        std::cerr << "Not a journal: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    size_ = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map journal " << path << ": " << std::strerror(errno) << std::endl;
+        size_ = 0;
+        close();
+        return false;
+    }
+    mapping_ = static_cast<const char*>(mapping);
+
+    if (!valid_header(mapping_, size_)) {
+        std::cerr << "Not a journal: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    // Replay reads sequentially
+    madvise(const_cast<char*>(mapping_), size_, MADV_SEQUENTIAL);
+
+    FileHeader header;
+    std::memcpy(&header, mapping_, sizeof(header));
+    created_wall_ns_ = header.created_wall_ns;
+    offset_ = JournalWriter::HEADER_SIZE;
+
+    return true;
+}
+
+void JournalReader::close() {
+    if (mapping_) {
+        munmap(const_cast<char*>(mapping_), size_);
+        mapping_ = nullptr;
+    }
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    size_ = 0;
+    offset_ = 0;
+    created_wall_ns_ = 0;
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    if (!mapping_ || offset_ + RECORD_HEADER_SIZE > size_) {
+        return false;
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, mapping_ + offset_, sizeof(header));
+    if (header.length == 0 || offset_ + RECORD_HEADER_SIZE + header.length > size_) {
+        return false;
+    }
+
+    record.received_wall_ns = header.received_wall_ns;
+    record.payload = std::string_view(mapping_ + offset_ + RECORD_HEADER_SIZE, header.length);
+    offset_ += RECORD_HEADER_SIZE + padded(header.length);
+
+    return true;
+}
+
+void JournalReader::rewind() {
+    if (mapping_) {
+        offset_ = JournalWriter::HEADER_SIZE;
+    }
+}
+
+int64_t JournalReader::created_wall_ns() const {
+    return created_wall_ns_;
+}
+
+} // namespace deribit
\ No newline at end of file
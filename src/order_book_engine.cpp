@@ -0,0 +1,453 @@
+#include "order_book_engine.h"
+#include <iostream>
+#include <algorithm>
+#include "performance_monitor.h"
+
+namespace deribit {
+
+// BookSide implementation
+BookSide::BookSide(bool descending)
+    : descending_(descending) {
+}
+
+void BookSide::set(double price, double size) {
+    if (size <= 0.0) {
+        erase(price);
+        return;
+    }
+
+    size_t position = find_position(price);
+
+    if (position < levels_.size() && levels_[position].price == price) {
+        levels_[position].size = size;
+    } else {
+        levels_.insert(levels_.begin() + position, PriceLevel{price, size});
+    }
+}
+
+void BookSide::erase(double price) {
+    size_t position = find_position(price);
+
+    if (position < levels_.size() && levels_[position].price == price) {
+        levels_.erase(levels_.begin() + position);
+    }
+}
+
+void BookSide::clear() {
+    levels_.clear();
+}
+
+void BookSide::reserve(size_t levels) {
+    levels_.reserve(levels);
+}
+
+const PriceLevel* BookSide::best() const {
+    return levels_.empty() ? nullptr : &levels_.front();
+}
+
+BookView BookSide::top(size_t depth) const {
+    BookView view;
+    view.levels = levels_.data();
+    view.count = std::min(depth, levels_.size());
+    return view;
+}
+
+size_t BookSide::size() const {
+    return levels_.size();
+}
+
+size_t BookSide::find_position(double price) const {
+    // First level that is not better than the given price
+    auto it = std::lower_bound(levels_.begin(), levels_.end(), price,
+        [this](const PriceLevel& level, double value) {
+            return descending_ ? level.price > value : level.price < value;
+        });
+
+    return static_cast<size_t>(it - levels_.begin());
+}
+
+// L2Book implementation
+L2Book::L2Book(const std::string& instrument_name)
+    : instrument_name_(instrument_name),
+      bids_(true),
+      asks_(false) {
+}
+
+BookUpdateResult L2Book::apply(const json& update) {
+    BookUpdate decoded;
+
+    if (!MarketDataDecoder::decode_book_json(update, decoded)) {
+        std::cerr << "Invalid book update for " << instrument_name_ << std::endl;
+        return BookUpdateResult::INVALID;
+    }
+
+    return apply(decoded);
+}
+
+BookUpdateResult L2Book::apply(const BookUpdate& update) {
+    if (update.snapshot) {
+        replace_levels(bids_, update.bids);
+        replace_levels(asks_, update.asks);
+        change_id_ = update.change_id;
+        timestamp_ = update.timestamp;
+        valid_ = true;
+        return BookUpdateResult::SNAPSHOT_APPLIED;
+    }
+
+    // A delta without a base snapshot cannot be applied
+    if (!valid_) {
+        return BookUpdateResult::GAP;
+    }
+
+    if (update.change_id <= change_id_) {
+        return BookUpdateResult::STALE;
+    }
+
+    // Each delta must continue exactly where the previous one ended
+    if (update.prev_change_id != change_id_) {
+        valid_ = false;
+        return BookUpdateResult::GAP;
+    }
+
+    apply_levels(bids_, update.bids);
+    apply_levels(asks_, update.asks);
+    change_id_ = update.change_id;
+    if (update.timestamp != 0) {
+        timestamp_ = update.timestamp;
+    }
+
+    return BookUpdateResult::APPLIED;
+}
+
+void L2Book::apply_snapshot(const json& snapshot) {
+    replace_levels(bids_, snapshot.at("bids"));
+    replace_levels(asks_, snapshot.at("asks"));
+    change_id_ = snapshot.value("change_id", static_cast<int64_t>(0));
+    timestamp_ = snapshot.value("timestamp", static_cast<int64_t>(0));
+    valid_ = true;
+}
+
+void L2Book::clear() {
+    bids_.clear();
+    asks_.clear();
+    change_id_ = 0;
+    timestamp_ = 0;
+    valid_ = false;
+}
+
+bool L2Book::is_valid() const {
+    return valid_;
+}
+
+const std::string& L2Book::instrument_name() const {
+    return instrument_name_;
+}
+
+InstrumentId L2Book::instrument_id() const {
+    return instrument_id_;
+}
+
+void L2Book::set_instrument_id(InstrumentId id) {
+    instrument_id_ = id;
+}
+
+int64_t L2Book::change_id() const {
+    return change_id_;
+}
+
+int64_t L2Book::timestamp() const {
+    return timestamp_;
+}
+
+const PriceLevel* L2Book::best_bid() const {
+    return bids_.best();
+}
+
+const PriceLevel* L2Book::best_ask() const {
+    return asks_.best();
+}
+
+BookView L2Book::bids(size_t depth) const {
+    return bids_.top(depth);
+}
+
+BookView L2Book::asks(size_t depth) const {
+    return asks_.top(depth);
+}
+
+void L2Book::to_orderbook(OrderBook& orderbook, size_t depth) const {
+    orderbook.instrument_name = instrument_name_;
+    orderbook.timestamp = std::to_string(timestamp_);
+
+    // clear() keeps capacity, so a reused orderbook does not reallocate
+    orderbook.bids.clear();
+    for (const auto& level : bids_.top(depth)) {
+        orderbook.bids.emplace_back(level.price, level.size);
+    }
+
+    orderbook.asks.clear();
+    for (const auto& level : asks_.top(depth)) {
+        orderbook.asks.emplace_back(level.price, level.size);
+    }
+}
+
+void L2Book::apply_levels(BookSide& side, const std::vector<BookLevelUpdate>& levels) {
+    for (const auto& level : levels) {
+        if (level.action == BookAction::DELETE) {
+            side.erase(level.price);
+        } else {
+            side.set(level.price, level.amount);
+        }
+    }
+}
+
+void L2Book::replace_levels(BookSide& side, const std::vector<BookLevelUpdate>& levels) {
+    side.clear();
+    side.reserve(levels.size());
+
+    for (const auto& level : levels) {
+        if (level.action != BookAction::DELETE) {
+            side.set(level.price, level.amount);
+        }
+    }
+}
+
+void L2Book::replace_levels(BookSide& side, const json& levels) {
+    side.clear();
+    side.reserve(levels.size());
+
+    for (const auto& level : levels) {
+        if (level.size() == 3) {
+            // Snapshot entries on the delta channels are ["new", price, amount]
+            if (level[0] != "delete") {
+                side.set(level[1].get<double>(), level[2].get<double>());
+            }
+        } else {
+            side.set(level[0].get<double>(), level[1].get<double>());
+        }
+    }
+}
+
+// OrderBookEngine implementation
+OrderBookEngine::OrderBookEngine(std::shared_ptr<ApiClient> api_client,
+                                 int snapshot_depth,
+                                 size_t max_buffered_updates)
+    : api_client_(api_client),
+      snapshot_depth_(snapshot_depth),
+      max_buffered_updates_(max_buffered_updates) {
+    // Validate API client
+    if (!api_client_) {
+        throw std::invalid_argument("API client cannot be null");
+    }
+}
+
+void OrderBookEngine::set_book_callback(BookCallback callback) {
+    book_callback_ = callback;
+}
+
+void OrderBookEngine::set_instrument_registry(std::shared_ptr<InstrumentRegistry> registry) {
+    instrument_registry_ = registry;
+}
+
+BookUpdateResult OrderBookEngine::handle_update(const json& update) {
+    BookUpdate decoded;
+
+    if (!MarketDataDecoder::decode_book_json(update, decoded) || decoded.instrument_name.empty()) {
+        std::cerr << "Invalid book update" << std::endl;
+        return BookUpdateResult::INVALID;
+    }
+
+    return handle_update(decoded);
+}
+
+BookUpdateResult OrderBookEngine::handle_update(const BookUpdate& update) {
+    std::shared_ptr<BookState> state = get_state(update.instrument_name, true);
+    BookUpdateResult result;
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+
+        if (state->resyncing && !update.snapshot) {
+            // Keep deltas to replay on top of the snapshot; if too many pile up,
+            // start over and let the replay detect the gap
+            if (state->buffered_updates.size() >= max_buffered_updates_) {
+                state->buffered_updates.clear();
+            }
+            buffer_update(*state, update);
+            return BookUpdateResult::RESYNCING;
+        }
+
+        result = state->book.apply(update);
+
+        if (result == BookUpdateResult::SNAPSHOT_APPLIED) {
+            // A snapshot on the stream supersedes any pending REST snapshot
+            state->resyncing = false;
+            state->buffered_updates.clear();
+            resolve_instrument_id(state->book);
+        }
+
+        if (result == BookUpdateResult::GAP) {
+            state->resyncing = true;
+            state->buffered_updates.clear();
+            buffer_update(*state, update);
+        } else if ((result == BookUpdateResult::APPLIED || result == BookUpdateResult::SNAPSHOT_APPLIED) &&
+                   book_callback_) {
+            book_callback_(state->book);
+        }
+    }
+
+    if (result == BookUpdateResult::GAP) {
+        request_snapshot(state);
+    }
+
+    return result;
+}
+
+bool OrderBookEngine::with_book(const std::string& instrument_name, const BookCallback& fn) {
+    std::shared_ptr<BookState> state = get_state(instrument_name, false);
+    if (!state) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (!state->book.is_valid()) {
+        return false;
+    }
+
+    fn(state->book);
+    return true;
+}
+
+void OrderBookEngine::remove(const std::string& instrument_name) {
+    std::lock_guard<std::mutex> lock(books_mutex_);
+    books_.erase(instrument_name);
+}
+
+void OrderBookEngine::invalidate_all() {
+    std::vector<std::shared_ptr<BookState>> states;
+    {
+        std::lock_guard<std::mutex> lock(books_mutex_);
+        for (const auto& pair : books_) {
+            states.push_back(pair.second);
+        }
+    }
+
+    // A pending REST snapshot finds resyncing cleared and is dropped
+    for (const auto& state : states) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->book.clear();
+        state->resyncing = false;
+        state->buffered_updates.clear();
+    }
+}
+
+std::shared_ptr<OrderBookEngine::BookState> OrderBookEngine::get_state(std::string_view instrument_name, bool create) {
+    std::lock_guard<std::mutex> lock(books_mutex_);
+
+    auto it = books_.find(instrument_name);
+    if (it != books_.end()) {
+        return it->second;
+    }
+
+    if (!create) {
+        return nullptr;
+    }
+
+    auto state = std::make_shared<BookState>(std::string(instrument_name));
+    resolve_instrument_id(state->book);
+    books_.emplace(std::string(instrument_name), state);
+
+    return state;
+}
+
+void OrderBookEngine::buffer_update(BookState& state, const BookUpdate& update) {
+    state.buffered_updates.push_back(update);
+    state.buffered_updates.back().instrument_name = std::string_view();
+}
+
+void OrderBookEngine::resolve_instrument_id(L2Book& book) const {
+    // Instruments loaded after the book was created are picked up on the next snapshot
+    if (instrument_registry_ && book.instrument_id() == INVALID_INSTRUMENT_ID) {
+        book.set_instrument_id(instrument_registry_->find_id(book.instrument_name()));
+    }
+}
+
+void OrderBookEngine::request_snapshot(std::shared_ptr<BookState> state) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("book_resync", true);
+    auto tracking_id = tracker->start();
+
+    json params = {
+        {"instrument_name", state->book.instrument_name()},
+        {"depth", snapshot_depth_}
+    };
+
+    std::weak_ptr<OrderBookEngine> self = weak_from_this();
+
+    api_client_->public_request_async("public/get_order_book", params,
+        [self, state, tracking_id](const ApiResponse& response) {
+            // End latency tracking
+            tracker->end(tracking_id);
+
+            if (auto engine = self.lock()) {
+                engine->handle_snapshot(state, response);
+            }
+        });
+}
+
+void OrderBookEngine::handle_snapshot(const std::shared_ptr<BookState>& state, const ApiResponse& response) {
+    bool retry = false;
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+
+        // Already resolved by a snapshot on the stream
+        if (!state->resyncing) {
+            return;
+        }
+
+        if (!response.success) {
+            std::cerr << "Error resyncing orderbook for " << state->book.instrument_name() << ": "
+                      << response.error_message << std::endl;
+
+            // The next delta finds the book invalid and triggers another attempt
+            state->resyncing = false;
+            state->buffered_updates.clear();
+            return;
+        }
+
+        try {
+            state->book.apply_snapshot(response.data["result"]);
+            resolve_instrument_id(state->book);
+        } catch (const json::exception& e) {
+            std::cerr << "Invalid orderbook snapshot for " << state->book.instrument_name() << ": "
+                      << e.what() << std::endl;
+            state->resyncing = false;
+            state->buffered_updates.clear();
+            return;
+        }
+
+        // Replay deltas received while waiting; older ones are skipped as stale
+        for (const auto& update : state->buffered_updates) {
+            if (state->book.apply(update) == BookUpdateResult::GAP) {
+                retry = true;
+                break;
+            }
+        }
+        state->buffered_updates.clear();
+
+        if (!retry) {
+            state->resyncing = false;
+
+            if (book_callback_) {
+                book_callback_(state->book);
+            }
+        }
+    }
+
+    if (retry) {
+        request_snapshot(state);
+    }
+}
+
+} // namespace deribit
\ No newline at end of file
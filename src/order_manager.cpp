@@ -2,10 +2,45 @@
 #include <iostream>
 #include <chrono>
 #include <algorithm>
+#include <future>
+#include <condition_variable>
+#include <unordered_map>
 #include "performance_monitor.h"
 
 namespace deribit {
 
+namespace {
+
+// Label of orders placed without one
+const char* const DEFAULT_ORDER_LABEL = "deribit_trading_system";
+
+// Collects the replies of a pipelined batch
+struct BatchState {
+    explicit BatchState(size_t count)
+        : results(count), pending(count) {}
+    
+    std::vector<OrderResult> results;
+    size_t pending;
+    std::mutex mutex;
+    std::condition_variable done;
+    
+    void complete(size_t index, OrderResult result) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results[index] = std::move(result);
+        if (--pending == 0) {
+            done.notify_all();
+        }
+    }
+    
+    std::vector<OrderResult> wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        return std::move(results);
+    }
+};
+
+} // namespace
+
 OrderManager::OrderManager(std::shared_ptr<ApiClient> api_client)
     : api_client_(api_client) {
     // Validate API client
@@ -14,6 +49,22 @@ OrderManager::OrderManager(std::shared_ptr<ApiClient> api_client)
     }
 }
 
+void OrderManager::set_transport(OrderTransport transport) {
+    transport_ = transport;
+}
+
+OrderTransport OrderManager::get_transport() const {
+    return transport_;
+}
+
+void OrderManager::set_instrument_registry(std::shared_ptr<InstrumentRegistry> registry) {
+    instrument_registry_ = registry;
+}
+
+void OrderManager::set_risk_gate(std::shared_ptr<RiskGate> risk_gate) {
+    risk_gate_ = risk_gate;
+}
+
 std::string OrderManager::place_order(const std::string& instrument_name,
                                      OrderType type,
                                      OrderDirection direction,
@@ -21,80 +72,26 @@ std::string OrderManager::place_order(const std::string& instrument_name,
                                      double price,
                                      TimeInForce time_in_force) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("place_order", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("place_order", true);
     auto tracking_id = tracker->start();
     
     try {
-        // Validate parameters
-        if (instrument_name.empty()) {
-            throw std::invalid_argument("Instrument name cannot be empty");
-        }
+        // Validate parameters and create request
+        InstrumentId instrument_id = INVALID_INSTRUMENT_ID;
+        json params = make_place_order_params(instrument_name, type, direction, amount, price, time_in_force,
+                                              "", instrument_id);
         
-        if (amount <= 0.0) {
-            throw std::invalid_argument("Amount must be positive");
-        }
-        
-        if (type == OrderType::LIMIT && price <= 0.0) {
-            throw std::invalid_argument("Price must be positive for limit orders");
-        }
-        
-        // Create request parameters
-        json params = {
-            {"instrument_name", instrument_name},
-            {"amount", amount},
-            {"type", order_type_to_string(type)},
-            {"label", "deribit_trading_system"}
-        };
-        
-        // Add direction-specific parameters
-        if (direction == OrderDirection::BUY) {
-            params["side"] = "buy";
-        } else {
-            params["side"] = "sell";
-        }
+        // Make API request
+        ApiResponse response = send_private_request(place_order_method(direction), params);
         
-        // Add type-specific parameters
-        if (type == OrderType::LIMIT || type == OrderType::STOP_LIMIT) {
-            params["price"] = price;
-            params["time_in_force"] = time_in_force_to_string(time_in_force);
-        }
+        // Store order in cache
+        std::string order_id = record_placed_order(response, instrument_name, type, direction,
+                                                   amount, price, time_in_force, instrument_id);
         
-        // Make API request
-        ApiResponse response = api_client_->private_request("private/buy", params);
+        // End latency tracking
+        tracker->end(tracking_id);
         
-        if (response.success) {
-            // Extract order ID
-            std::string order_id = response.data["result"]["order"]["order_id"];
-            
-            // Store order in cache
-            Order order;
-            order.order_id = order_id;
-            order.instrument_name = instrument_name;
-            order.type = type;
-            order.direction = direction;
-            order.price = price;
-            order.amount = amount;
-            order.time_in_force = time_in_force;
-            order.status = "open";
-            order.created_at = response.data["result"]["order"]["creation_timestamp"];
-            order.last_updated_at = order.created_at;
-            
-            // Add to open orders
-            std::lock_guard<std::mutex> lock(orders_mutex_);
-            open_orders_[order_id] = order;
-            
-            // End latency tracking
-            tracker->end(tracking_id);
-            
-            return order_id;
-        } else {
-            std::cerr << "Error placing order: " << response.error_message << std::endl;
-            
-            // End latency tracking
-            tracker->end(tracking_id);
-            
-            return "";
-        }
+        return order_id;
     } catch (const std::exception& e) {
         std::cerr << "Error placing order: " << e.what() << std::endl;
         
@@ -105,42 +102,85 @@ std::string OrderManager::place_order(const std::string& instrument_name,
     }
 }
 
-bool OrderManager::cancel_order(const std::string& order_id) {
+std::future<std::string> OrderManager::place_order_async(const std::string& instrument_name,
+                                                         OrderType type,
+                                                         OrderDirection direction,
+                                                         double amount,
+                                                         double price,
+                                                         TimeInForce time_in_force) {
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    
+    place_order_async([promise](const std::string& order_id) {
+        promise->set_value(order_id);
+    }, instrument_name, type, direction, amount, price, time_in_force);
+    
+    return future;
+}
+
+void OrderManager::place_order_async(PlaceOrderCallback callback,
+                                     const std::string& instrument_name,
+                                     OrderType type,
+                                     OrderDirection direction,
+                                     double amount,
+                                     double price,
+                                     TimeInForce time_in_force) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("cancel_order", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("place_order_async", true);
     auto tracking_id = tracker->start();
     
+    json params;
+    InstrumentId instrument_id = INVALID_INSTRUMENT_ID;
     try {
-        // Validate parameters
-        if (order_id.empty()) {
-            throw std::invalid_argument("Order ID cannot be empty");
-        }
-        
-        // Create request parameters
-        json params = {
-            {"order_id", order_id}
-        };
-        
-        // Make API request
-        ApiResponse response = api_client_->private_request("private/cancel", params);
-        
-        if (response.success) {
-            // Remove from open orders
-            std::lock_guard<std::mutex> lock(orders_mutex_);
-            open_orders_.erase(order_id);
-            
-            // End latency tracking
-            tracker->end(tracking_id);
+        // Validate parameters and create request
+        params = make_place_order_params(instrument_name, type, direction, amount, price, time_in_force,
+                                         "", instrument_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Error placing order: " << e.what() << std::endl;
+        tracker->end(tracking_id);
+        callback("");
+        return;
+    }
+    
+    // Send without waiting; the reply completes the callback
+    send_private_request_async(place_order_method(direction), params,
+        [this, callback, tracking_id, instrument_name, type, direction, amount, price, time_in_force, instrument_id]
+        (const ApiResponse& response) {
+            std::string order_id;
             
-            return true;
-        } else {
-            std::cerr << "Error canceling order: " << response.error_message << std::endl;
+            try {
+                order_id = record_placed_order(response, instrument_name, type, direction,
+                                               amount, price, time_in_force, instrument_id);
+            } catch (const std::exception& e) {
+                std::cerr << "Error placing order: " << e.what() << std::endl;
+            }
             
             // End latency tracking
             tracker->end(tracking_id);
             
-            return false;
-        }
+            callback(order_id);
+        });
+}
+
+bool OrderManager::cancel_order(const std::string& order_id) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("cancel_order", true);
+    auto tracking_id = tracker->start();
+    
+    try {
+        // Validate parameters and create request
+        json params = make_cancel_order_params(order_id);
+        
+        // Make API request
+        ApiResponse response = send_private_request("private/cancel", params);
+        
+        // Remove from open orders
+        bool result = record_cancelled_order(response, order_id);
+        
+        // End latency tracking
+        tracker->end(tracking_id);
+        
+        return result;
     } catch (const std::exception& e) {
         std::cerr << "Error canceling order: " << e.what() << std::endl;
         
@@ -151,80 +191,392 @@ bool OrderManager::cancel_order(const std::string& order_id) {
     }
 }
 
+std::future<bool> OrderManager::cancel_order_async(const std::string& order_id) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    
+    cancel_order_async([promise](bool success) {
+        promise->set_value(success);
+    }, order_id);
+    
+    return future;
+}
+
+void OrderManager::cancel_order_async(RequestCallback callback, const std::string& order_id) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("cancel_order_async", true);
+    auto tracking_id = tracker->start();
+    
+    json params;
+    try {
+        // Validate parameters and create request
+        params = make_cancel_order_params(order_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Error canceling order: " << e.what() << std::endl;
+        tracker->end(tracking_id);
+        callback(false);
+        return;
+    }
+    
+    send_private_request_async("private/cancel", params,
+        [this, callback, tracking_id, order_id](const ApiResponse& response) {
+            bool result = false;
+            
+            try {
+                result = record_cancelled_order(response, order_id);
+            } catch (const std::exception& e) {
+                std::cerr << "Error canceling order: " << e.what() << std::endl;
+            }
+            
+            // End latency tracking
+            tracker->end(tracking_id);
+            
+            callback(result);
+        });
+}
+
 bool OrderManager::modify_order(const std::string& order_id, double amount, double price) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("modify_order", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("modify_order", true);
     auto tracking_id = tracker->start();
     
     try {
-        // Validate parameters
-        if (order_id.empty()) {
-            throw std::invalid_argument("Order ID cannot be empty");
-        }
+        // Validate parameters and create request
+        json params = make_modify_order_params(order_id, amount, price);
         
-        if (amount <= 0.0 && price <= 0.0) {
-            throw std::invalid_argument("Either amount or price must be specified");
-        }
+        // Make API request
+        ApiResponse response = send_private_request("private/edit", params);
         
-        // Create request parameters
-        json params = {
-            {"order_id", order_id}
-        };
+        // Update order in cache
+        bool result = record_modified_order(response, order_id, amount, price);
         
-        if (amount > 0.0) {
-            params["amount"] = amount;
-        }
+        // End latency tracking
+        tracker->end(tracking_id);
         
-        if (price > 0.0) {
-            params["price"] = price;
-        }
+        return result;
+    } catch (const std::exception& e) {
+        std::cerr << "Error modifying order: " << e.what() << std::endl;
         
-        // Make API request
-        ApiResponse response = api_client_->private_request("private/edit", params);
+        // End latency tracking
+        tracker->end(tracking_id);
         
-        if (response.success) {
-            // Update order in cache
-            std::lock_guard<std::mutex> lock(orders_mutex_);
-            auto it = open_orders_.find(order_id);
+        return false;
+    }
+}
+
+std::future<bool> OrderManager::modify_order_async(const std::string& order_id, double amount, double price) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    
+    modify_order_async([promise](bool success) {
+        promise->set_value(success);
+    }, order_id, amount, price);
+    
+    return future;
+}
+
+void OrderManager::modify_order_async(RequestCallback callback,
+                                      const std::string& order_id,
+                                      double amount,
+                                      double price) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("modify_order_async", true);
+    auto tracking_id = tracker->start();
+    
+    json params;
+    try {
+        // Validate parameters and create request
+        params = make_modify_order_params(order_id, amount, price);
+    } catch (const std::exception& e) {
+        std::cerr << "Error modifying order: " << e.what() << std::endl;
+        tracker->end(tracking_id);
+        callback(false);
+        return;
+    }
+    
+    send_private_request_async("private/edit", params,
+        [this, callback, tracking_id, order_id, amount, price](const ApiResponse& response) {
+            bool result = false;
             
-            if (it != open_orders_.end()) {
-                if (amount > 0.0) {
-                    it->second.amount = amount;
-                }
-                
-                if (price > 0.0) {
-                    it->second.price = price;
-                }
-                
-                it->second.last_updated_at = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::system_clock::now().time_since_epoch()).count());
+            try {
+                result = record_modified_order(response, order_id, amount, price);
+            } catch (const std::exception& e) {
+                std::cerr << "Error modifying order: " << e.what() << std::endl;
             }
             
             // End latency tracking
             tracker->end(tracking_id);
             
-            return true;
-        } else {
-            std::cerr << "Error modifying order: " << response.error_message << std::endl;
-            
-            // End latency tracking
+            callback(result);
+        });
+}
+
+std::vector<OrderResult> OrderManager::place_orders(const std::vector<OrderRequest>& requests) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("place_orders", true);
+    auto tracking_id = tracker->start();
+    
+    // Send everything first, then wait for the replies together
+    auto state = std::make_shared<BatchState>(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        send_place_order(requests[i], [state, i](OrderResult result) {
+            state->complete(i, std::move(result));
+        });
+    }
+    
+    std::vector<OrderResult> results = state->wait();
+    
+    // End latency tracking
+    tracker->end(tracking_id);
+    
+    return results;
+}
+
+std::vector<OrderResult> OrderManager::modify_orders(const std::vector<OrderModification>& modifications) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("modify_orders", true);
+    auto tracking_id = tracker->start();
+    
+    auto state = std::make_shared<BatchState>(modifications.size());
+    for (size_t i = 0; i < modifications.size(); ++i) {
+        send_modify_order(modifications[i], [state, i](OrderResult result) {
+            state->complete(i, std::move(result));
+        });
+    }
+    
+    std::vector<OrderResult> results = state->wait();
+    
+    // End latency tracking
+    tracker->end(tracking_id);
+    
+    return results;
+}
+
+int OrderManager::cancel_all(CancelScope scope, const std::string& value) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("cancel_all", true);
+    auto tracking_id = tracker->start();
+    
+    try {
+        // Validate parameters
+        if (scope != CancelScope::ALL && value.empty()) {
+            throw std::invalid_argument("Cancel scope value cannot be empty");
+        }
+        
+        // Map the scope to its Deribit method
+        std::string method;
+        json params = json::object();
+        
+        switch (scope) {
+            case CancelScope::ALL:
+                method = "private/cancel_all";
+                break;
+            case CancelScope::INSTRUMENT:
+                method = "private/cancel_all_by_instrument";
+                params["instrument_name"] = value;
+                break;
+            case CancelScope::CURRENCY:
+                method = "private/cancel_all_by_currency";
+                params["currency"] = value;
+                break;
+            case CancelScope::LABEL:
+                method = "private/cancel_by_label";
+                params["label"] = value;
+                break;
+        }
+        
+        // Make API request
+        ApiResponse response = send_private_request(method, params);
+        
+        if (!response.success) {
+            std::cerr << "Error canceling orders: " << response.error_message << std::endl;
             tracker->end(tracking_id);
-            
-            return false;
+            return -1;
+        }
+        
+        // Remove the cancelled orders; Deribit groups instruments by settlement currency
+        {
+            std::lock_guard<std::mutex> lock(orders_mutex_);
+            open_orders_.erase_if([this, scope, &value](const Order& order) {
+                switch (scope) {
+                    case CancelScope::INSTRUMENT:
+                        return order.instrument_name == value;
+                    case CancelScope::CURRENCY:
+                        return settlement_currency(order.instrument_name) == value;
+                    case CancelScope::LABEL:
+                        return order.label == value;
+                    default:
+                        return true;
+                }
+            });
         }
+        
+        const json& result = response.data["result"];
+        int cancelled = result.is_number() ? result.get<int>() : 0;
+        
+        // End latency tracking
+        tracker->end(tracking_id);
+        
+        return cancelled;
     } catch (const std::exception& e) {
-        std::cerr << "Error modifying order: " << e.what() << std::endl;
+        std::cerr << "Error canceling orders: " << e.what() << std::endl;
         
         // End latency tracking
         tracker->end(tracking_id);
         
-        return false;
+        return -1;
+    }
+}
+
+std::string OrderManager::settlement_currency(const std::string& instrument_name) const {
+    if (instrument_registry_) {
+        auto instrument = instrument_registry_->get(instrument_name);
+        if (instrument && !instrument->settlement_currency.empty()) {
+            return instrument->settlement_currency;
+        }
+    }
+    
+    // Unknown instruments fall back to the name: BTC-PERPETUAL settles in BTC, BTC_USDC-PERPETUAL in USDC
+    std::string pair = instrument_name.substr(0, instrument_name.find('-'));
+    size_t separator = pair.find('_');
+    return separator == std::string::npos ? pair : pair.substr(separator + 1);
+}
+
+InstrumentId OrderManager::resolve_instrument_id(const std::string& instrument_name) const {
+    return risk_gate_ ? risk_gate_->instrument_id(instrument_name) : INVALID_INSTRUMENT_ID;
+}
+
+std::vector<OrderResult> OrderManager::replace_quotes(const std::string& label,
+                                                      const std::vector<OrderRequest>& quotes) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("replace_quotes", true);
+    auto tracking_id = tracker->start();
+    
+    // Group the resting quotes by instrument and side
+    std::vector<Order> resting;
+    std::unordered_map<std::string, std::vector<size_t>> resting_by_key;
+    auto key = [](const std::string& instrument_name, OrderDirection direction) {
+        return instrument_name + (direction == OrderDirection::BUY ? "/buy" : "/sell");
+    };
+    
+    {
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        open_orders_.for_each([&](const Order& order) {
+            if (order.label == label) {
+                resting_by_key[key(order.instrument_name, order.direction)].push_back(resting.size());
+                resting.push_back(order);
+            }
+        });
+    }
+    
+    // Reuse a resting quote on the same instrument and side if there is one
+    std::vector<bool> matched(resting.size(), false);
+    std::vector<size_t> reused(quotes.size(), resting.size());
+    for (size_t i = 0; i < quotes.size(); ++i) {
+        auto it = resting_by_key.find(key(quotes[i].instrument_name, quotes[i].direction));
+        if (it != resting_by_key.end() && !it->second.empty()) {
+            reused[i] = it->second.back();
+            it->second.pop_back();
+            matched[reused[i]] = true;
+        }
+    }
+    
+    // Resting quotes without a counterpart in the new set are pulled
+    std::vector<size_t> unmatched;
+    for (size_t i = 0; i < resting.size(); ++i) {
+        if (!matched[i]) {
+            unmatched.push_back(i);
+        }
+    }
+    
+    // The batch also waits for the cancels, whose results follow the quotes'
+    auto state = std::make_shared<BatchState>(quotes.size() + unmatched.size());
+    
+    for (size_t i = 0; i < quotes.size(); ++i) {
+        OrderRequest quote = quotes[i];
+        quote.label = label;
+        
+        auto done = [state, i](OrderResult result) {
+            state->complete(i, std::move(result));
+        };
+        
+        if (reused[i] == resting.size()) {
+            send_place_order(quote, done);
+            continue;
+        }
+        
+        const Order& order = resting[reused[i]];
+        if (order.price == quote.price && order.amount == quote.amount) {
+            done(OrderResult{true, order.order_id, ""});
+        } else {
+            send_modify_order(OrderModification{order.order_id, quote.amount, quote.price}, done);
+        }
+    }
+    
+    for (size_t i = 0; i < unmatched.size(); ++i) {
+        const std::string& order_id = resting[unmatched[i]].order_id;
+        size_t index = quotes.size() + i;
+        
+        cancel_order_async([state, index, order_id](bool success) {
+            state->complete(index, OrderResult{success, order_id, success ? "" : "Cancel failed"});
+        }, order_id);
     }
+    
+    std::vector<OrderResult> results = state->wait();
+    
+    // End latency tracking
+    tracker->end(tracking_id);
+    
+    return results;
+}
+
+void OrderManager::set_max_orderbook_staleness(std::chrono::milliseconds max_staleness) {
+    max_orderbook_staleness_ms_ = max_staleness.count();
+}
+
+std::chrono::milliseconds OrderManager::get_max_orderbook_staleness() const {
+    return std::chrono::milliseconds(max_orderbook_staleness_ms_.load());
+}
+
+void OrderManager::update_orderbook(const std::string& instrument_name, BookView bids, BookView asks, int64_t timestamp,
+                                    InstrumentId instrument_id) {
+    // The stream carries the full book, so the snapshot covers its maximum depth
+    orderbook_cache_.store(instrument_name, bids, asks, timestamp, BookSnapshot::MAX_DEPTH);
+    
+    if (risk_gate_) {
+        double best_bid = bids.empty() ? 0.0 : bids[0].price;
+        double best_ask = asks.empty() ? 0.0 : asks[0].price;
+        if (instrument_id != INVALID_INSTRUMENT_ID) {
+            risk_gate_->update_market(instrument_id, best_bid, best_ask);
+        } else {
+            risk_gate_->update_market(instrument_name, best_bid, best_ask);
+        }
+    }
+}
+
+void OrderManager::invalidate_orderbook(const std::string& instrument_name) {
+    orderbook_cache_.invalidate(instrument_name);
+    
+    if (risk_gate_) {
+        risk_gate_->update_market(instrument_name, 0.0, 0.0);
+    }
+}
+
+void OrderManager::invalidate_orderbooks() {
+    orderbook_cache_.invalidate_all();
+    
+    if (risk_gate_) {
+        risk_gate_->clear_market();
+    }
+}
+
+bool OrderManager::get_orderbook_snapshot(const std::string& instrument_name, BookSnapshot& snapshot) const {
+    return orderbook_cache_.load(instrument_name, snapshot);
 }
 
 OrderBook OrderManager::get_orderbook(const std::string& instrument_name, int depth) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("get_orderbook", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("get_orderbook", true);
     auto tracking_id = tracker->start();
     
     OrderBook orderbook;
@@ -241,16 +593,11 @@ OrderBook OrderManager::get_orderbook(const std::string& instrument_name, int de
         }
         
         // Check cache first
-        {
-            std::lock_guard<std::mutex> lock(orderbooks_mutex_);
-            auto it = orderbooks_.find(instrument_name);
+        if (read_cached_orderbook(instrument_name, depth, orderbook)) {
+            // End latency tracking
+            tracker->end(tracking_id);
             
-            if (it != orderbooks_.end()) {
-                // End latency tracking
-                tracker->end(tracking_id);
-                
-                return it->second;
-            }
+            return orderbook;
         }
         
         // Create request parameters
@@ -262,30 +609,8 @@ OrderBook OrderManager::get_orderbook(const std::string& instrument_name, int de
         // Make API request
         ApiResponse response = api_client_->public_request("public/get_order_book", params);
         
-        if (response.success) {
-            // Parse orderbook
-            orderbook.timestamp = response.data["result"]["timestamp"];
-            
-            // Parse bids
-            for (const auto& bid : response.data["result"]["bids"]) {
-                double price = bid[0];
-                double size = bid[1];
-                orderbook.bids.push_back(std::make_pair(price, size));
-            }
-            
-            // Parse asks
-            for (const auto& ask : response.data["result"]["asks"]) {
-                double price = ask[0];
-                double size = ask[1];
-                orderbook.asks.push_back(std::make_pair(price, size));
-            }
-            
-            // Store in cache
-            std::lock_guard<std::mutex> lock(orderbooks_mutex_);
-            orderbooks_[instrument_name] = orderbook;
-        } else {
-            std::cerr << "Error getting orderbook: " << response.error_message << std::endl;
-        }
+        // Parse and cache orderbook
+        record_orderbook(response, orderbook, depth);
     } catch (const std::exception& e) {
         std::cerr << "Error getting orderbook: " << e.what() << std::endl;
     }
@@ -296,18 +621,82 @@ OrderBook OrderManager::get_orderbook(const std::string& instrument_name, int de
     return orderbook;
 }
 
+std::future<OrderBook> OrderManager::get_orderbook_async(const std::string& instrument_name, int depth) {
+    auto promise = std::make_shared<std::promise<OrderBook>>();
+    std::future<OrderBook> future = promise->get_future();
+    
+    get_orderbook_async([promise](const OrderBook& orderbook) {
+        promise->set_value(orderbook);
+    }, instrument_name, depth);
+    
+    return future;
+}
+
+void OrderManager::get_orderbook_async(OrderBookCallback callback, const std::string& instrument_name, int depth) {
+    // Start latency tracking
+    static auto tracker = PerformanceMonitor::instance().get_tracker("get_orderbook_async", true);
+    auto tracking_id = tracker->start();
+    
+    OrderBook orderbook;
+    orderbook.instrument_name = instrument_name;
+    
+    try {
+        // Validate parameters
+        if (instrument_name.empty()) {
+            throw std::invalid_argument("Instrument name cannot be empty");
+        }
+        
+        if (depth <= 0) {
+            throw std::invalid_argument("Depth must be positive");
+        }
+        
+        // Check cache first
+        if (read_cached_orderbook(instrument_name, depth, orderbook)) {
+            tracker->end(tracking_id);
+            callback(orderbook);
+            return;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error getting orderbook: " << e.what() << std::endl;
+        tracker->end(tracking_id);
+        callback(orderbook);
+        return;
+    }
+    
+    // Create request parameters
+    json params = {
+        {"instrument_name", instrument_name},
+        {"depth", depth}
+    };
+    
+    api_client_->public_request_async("public/get_order_book", params,
+        [this, callback, tracking_id, orderbook, depth](const ApiResponse& response) mutable {
+            try {
+                record_orderbook(response, orderbook, depth);
+            } catch (const std::exception& e) {
+                std::cerr << "Error getting orderbook: " << e.what() << std::endl;
+            }
+            
+            // End latency tracking
+            tracker->end(tracking_id);
+            
+            callback(orderbook);
+        });
+}
+
 std::vector<Position> OrderManager::get_positions() {
     std::vector<Position> result;
     
     try {
         // Make API request
-        ApiResponse response = api_client_->private_request("private/get_positions", {});
+        ApiResponse response = send_private_request("private/get_positions", {});
         
         if (response.success) {
             // Parse positions
             for (const auto& pos : response.data["result"]) {
                 Position position;
                 position.instrument_name = pos["instrument_name"];
+                position.instrument_id = resolve_instrument_id(position.instrument_name);
                 position.size = pos["size"];
                 position.entry_price = pos["average_price"];
                 position.mark_price = pos["mark_price"];
@@ -317,6 +706,10 @@ std::vector<Position> OrderManager::get_positions() {
                 
                 result.push_back(position);
                 
+                if (risk_gate_) {
+                    risk_gate_->update_position(position.instrument_id, position.size);
+                }
+                
                 // Update cache
                 std::lock_guard<std::mutex> lock(positions_mutex_);
                 positions_[position.instrument_name] = position;
@@ -344,7 +737,10 @@ std::shared_ptr<Position> OrderManager::get_position(const std::string& instrume
             auto it = positions_.find(instrument_name);
             
             if (it != positions_.end()) {
-                return std::make_shared<Position>(it->second);
+                // Assignment reuses the pooled copy's string capacity
+                std::shared_ptr<Position> pos = position_pool_.acquire();
+                *pos = it->second;
+                return pos;
             }
         }
         
@@ -354,12 +750,13 @@ std::shared_ptr<Position> OrderManager::get_position(const std::string& instrume
         };
         
         // Make API request
-        ApiResponse response = api_client_->private_request("private/get_position", params);
+        ApiResponse response = send_private_request("private/get_position", params);
         
         if (response.success) {
             // Parse position
-            auto pos = std::make_shared<Position>();
+            std::shared_ptr<Position> pos = position_pool_.acquire();
             pos->instrument_name = response.data["result"]["instrument_name"];
+            pos->instrument_id = resolve_instrument_id(pos->instrument_name);
             pos->size = response.data["result"]["size"];
             pos->entry_price = response.data["result"]["average_price"];
             pos->mark_price = response.data["result"]["mark_price"];
@@ -367,6 +764,10 @@ std::shared_ptr<Position> OrderManager::get_position(const std::string& instrume
             pos->unrealized_pnl = response.data["result"]["floating_profit_loss"];
             pos->realized_pnl = response.data["result"]["realized_profit_loss"];
             
+            if (risk_gate_) {
+                risk_gate_->update_position(pos->instrument_id, pos->size);
+            }
+            
             // Update cache
             std::lock_guard<std::mutex> lock(positions_mutex_);
             positions_[instrument_name] = *pos;
@@ -382,71 +783,35 @@ std::shared_ptr<Position> OrderManager::get_position(const std::string& instrume
     }
 }
 
-std::vector<Order> OrderManager::get_open_orders() {
-    std::vector<Order> result;
-    
+OrderStore::Snapshot OrderManager::get_open_orders() {
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    return open_orders_.snapshot();
+}
+
+int OrderManager::refresh_open_orders() {
     try {
         // Make API request
-        ApiResponse response = api_client_->private_request("private/get_open_orders_by_currency", {});
+        ApiResponse response = send_private_request("private/get_open_orders_by_currency", {});
         
-        if (response.success) {
-            // Parse orders
-            for (const auto& order_json : response.data["result"]) {
-                Order order;
-                order.order_id = order_json["order_id"];
-                order.instrument_name = order_json["instrument_name"];
-                
-                // Parse order type
-                std::string type_str = order_json["order_type"];
-                if (type_str == "limit") {
-                    order.type = OrderType::LIMIT;
-                } else if (type_str == "market") {
-                    order.type = OrderType::MARKET;
-                } else if (type_str == "stop_market") {
-                    order.type = OrderType::STOP_MARKET;
-                } else if (type_str == "stop_limit") {
-                    order.type = OrderType::STOP_LIMIT;
-                }
-                
-                // Parse direction
-                std::string direction_str = order_json["direction"];
-                if (direction_str == "buy") {
-                    order.direction = OrderDirection::BUY;
-                } else {
-                    order.direction = OrderDirection::SELL;
-                }
-                
-                order.price = order_json["price"];
-                order.amount = order_json["amount"];
-                
-                // Parse time in force
-                std::string tif_str = order_json["time_in_force"];
-                if (tif_str == "good_til_cancelled") {
-                    order.time_in_force = TimeInForce::GOOD_TIL_CANCELLED;
-                } else if (tif_str == "fill_or_kill") {
-                    order.time_in_force = TimeInForce::FILL_OR_KILL;
-                } else if (tif_str == "immediate_or_cancel") {
-                    order.time_in_force = TimeInForce::IMMEDIATE_OR_CANCEL;
-                }
-                
-                order.status = order_json["order_state"];
-                order.created_at = order_json["creation_timestamp"];
-                order.last_updated_at = order_json["last_update_timestamp"];
-                
-                result.push_back(order);
-                
-                // Update cache
-                std::lock_guard<std::mutex> lock(orders_mutex_);
-                open_orders_[order.order_id] = order;
-            }
-        } else {
+        if (!response.success) {
             std::cerr << "Error getting open orders: " << response.error_message << std::endl;
+            return -1;
+        }
+        
+        // Replace the local orders with the server's view
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        open_orders_.clear();
+        
+        for (const auto& order_json : response.data["result"]) {
+            Order& order = open_orders_.emplace(order_json["order_id"].get_ref<const std::string&>());
+            parse_order(order_json, order);
         }
+        
+        return static_cast<int>(open_orders_.size());
     } catch (const std::exception& e) {
         std::cerr << "Error getting open orders: " << e.what() << std::endl;
+        return -1;
     }
-    
-    return result;
 }
 
 std::shared_ptr<Order> OrderManager::get_order(const std::string& order_id) {
@@ -459,10 +824,14 @@ std::shared_ptr<Order> OrderManager::get_order(const std::string& order_id) {
         // Check cache first
         {
             std::lock_guard<std::mutex> lock(orders_mutex_);
-            auto it = open_orders_.find(order_id);
+            // A const lookup leaves the shared snapshot valid
+            const OrderStore& orders = open_orders_;
+            const Order* order = orders.find(order_id);
             
-            if (it != open_orders_.end()) {
-                return std::make_shared<Order>(it->second);
+            if (order) {
+                std::shared_ptr<Order> copy = order_pool_.acquire();
+                *copy = *order;
+                return copy;
             }
         }
         
@@ -472,55 +841,18 @@ std::shared_ptr<Order> OrderManager::get_order(const std::string& order_id) {
         };
         
         // Make API request
-        ApiResponse response = api_client_->private_request("private/get_order_state", params);
+        ApiResponse response = send_private_request("private/get_order_state", params);
         
         if (response.success) {
-            // Parse order
-            auto order = std::make_shared<Order>();
-            order->order_id = response.data["result"]["order_id"];
-            order->instrument_name = response.data["result"]["instrument_name"];
-            
-            // Parse order type
-            std::string type_str = response.data["result"]["order_type"];
-            if (type_str == "limit") {
-                order->type = OrderType::LIMIT;
-            } else if (type_str == "market") {
-                order->type = OrderType::MARKET;
-            } else if (type_str == "stop_market") {
-                order->type = OrderType::STOP_MARKET;
-            } else if (type_str == "stop_limit") {
-                order->type = OrderType::STOP_LIMIT;
-            }
-            
-            // Parse direction
-            std::string direction_str = response.data["result"]["direction"];
-            if (direction_str == "buy") {
-                order->direction = OrderDirection::BUY;
-            } else {
-                order->direction = OrderDirection::SELL;
-            }
-            
-            order->price = response.data["result"]["price"];
-            order->amount = response.data["result"]["amount"];
-            
-            // Parse time in force
-            std::string tif_str = response.data["result"]["time_in_force"];
-            if (tif_str == "good_til_cancelled") {
-                order->time_in_force = TimeInForce::GOOD_TIL_CANCELLED;
-            } else if (tif_str == "fill_or_kill") {
-                order->time_in_force = TimeInForce::FILL_OR_KILL;
-            } else if (tif_str == "immediate_or_cancel") {
-                order->time_in_force = TimeInForce::IMMEDIATE_OR_CANCEL;
-            }
-            
-            order->status = response.data["result"]["order_state"];
-            order->created_at = response.data["result"]["creation_timestamp"];
-            order->last_updated_at = response.data["result"]["last_update_timestamp"];
+            // Parse order; missing fields are left as they are, so the pooled copy is reset first
+            std::shared_ptr<Order> order = order_pool_.acquire();
+            *order = Order();
+            parse_order(response.data["result"], *order);
             
             // Update cache if order is still open
-            if (order->status == "open") {
+            if (order->is_open()) {
                 std::lock_guard<std::mutex> lock(orders_mutex_);
-                open_orders_[order_id] = *order;
+                open_orders_.upsert(*order);
             }
             
             return order;
@@ -536,59 +868,20 @@ std::shared_ptr<Order> OrderManager::get_order(const std::string& order_id) {
 
 void OrderManager::handle_order_update(const json& update) {
     try {
-        // Extract order ID
-        std::string order_id = update["order_id"];
-        
-        // Extract order status
-        std::string status = update["order_state"];
+        // Read the fields in place; only a new order copies its strings
+        const std::string& order_id = update["order_id"].get_ref<const std::string&>();
+        OrderStatus status = parse_order_status(update["order_state"].get_ref<const std::string&>());
         
         // Update or remove from cache based on status
         std::lock_guard<std::mutex> lock(orders_mutex_);
         
-        if (status == "open" || status == "untriggered") {
-            // Update existing order or add new one
-            Order order;
-            order.order_id = order_id;
-            order.instrument_name = update["instrument_name"];
-            
-            // Parse order type
-            std::string type_str = update["order_type"];
-            if (type_str == "limit") {
-                order.type = OrderType::LIMIT;
-            } else if (type_str == "market") {
-                order.type = OrderType::MARKET;
-            } else if (type_str == "stop_market") {
-                order.type = OrderType::STOP_MARKET;
-            } else if (type_str == "stop_limit") {
-                order.type = OrderType::STOP_LIMIT;
+        if (status == OrderStatus::OPEN || status == OrderStatus::UNTRIGGERED) {
+            // Update existing order or add new one; the id is looked up once per order
+            Order& order = open_orders_.emplace(order_id);
+            parse_order(update, order);
+            if (order.instrument_id == INVALID_INSTRUMENT_ID) {
+                order.instrument_id = resolve_instrument_id(order.instrument_name);
             }
-            
-            // Parse direction
-            std::string direction_str = update["direction"];
-            if (direction_str == "buy") {
-                order.direction = OrderDirection::BUY;
-            } else {
-                order.direction = OrderDirection::SELL;
-            }
-            
-            order.price = update["price"];
-            order.amount = update["amount"];
-            
-            // Parse time in force
-            std::string tif_str = update["time_in_force"];
-            if (tif_str == "good_til_cancelled") {
-                order.time_in_force = TimeInForce::GOOD_TIL_CANCELLED;
-            } else if (tif_str == "fill_or_kill") {
-                order.time_in_force = TimeInForce::FILL_OR_KILL;
-            } else if (tif_str == "immediate_or_cancel") {
-                order.time_in_force = TimeInForce::IMMEDIATE_OR_CANCEL;
-            }
-            
-            order.status = status;
-            order.created_at = update["creation_timestamp"];
-            order.last_updated_at = update["last_update_timestamp"];
-            
-            open_orders_[order_id] = order;
         } else {
             // Order is no longer open, remove from cache
             open_orders_.erase(order_id);
@@ -600,26 +893,481 @@ void OrderManager::handle_order_update(const json& update) {
 
 void OrderManager::handle_position_update(const json& update) {
     try {
-        // Extract instrument name
-        std::string instrument_name = update["instrument_name"];
+        // Read the name in place; only a new instrument copies it
+        const std::string& instrument_name = update["instrument_name"].get_ref<const std::string&>();
+        double size = update["size"];
         
-        // Update position in cache
-        Position position;
+        // Update the cached position in place; the id is looked up once per instrument
+        std::lock_guard<std::mutex> lock(positions_mutex_);
+        Position& position = positions_[instrument_name];
+        if (position.instrument_id == INVALID_INSTRUMENT_ID) {
+            position.instrument_id = resolve_instrument_id(instrument_name);
+        }
         position.instrument_name = instrument_name;
-        position.size = update["size"];
+        position.size = size;
         position.entry_price = update["average_price"];
         position.mark_price = update["mark_price"];
         position.liquidation_price = update["estimated_liquidation_price"];
         position.unrealized_pnl = update["floating_profit_loss"];
         position.realized_pnl = update["realized_profit_loss"];
         
-        std::lock_guard<std::mutex> lock(positions_mutex_);
-        positions_[instrument_name] = position;
+        if (risk_gate_) {
+            risk_gate_->update_position(position.instrument_id, size);
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error handling position update: " << e.what() << std::endl;
     }
 }
 
+ApiResponse OrderManager::send_private_request(const std::string& method, const json& params) {
+    // Orders sent while handling a market data message close its tick-to-trade time
+    if (RequestScheduler::classify(method) != RequestLane::QUERY) {
+        Tracer::mark(TraceStage::ORDER_SENT);
+    }
+    
+    // The authenticated WebSocket session needs no access token and no connection setup
+    if (transport_ == OrderTransport::WEBSOCKET && api_client_->is_websocket_authenticated()) {
+        return api_client_->websocket_request(method, params);
+    }
+    
+    return api_client_->private_request(method, params);
+}
+
+void OrderManager::send_private_request_async(const std::string& method,
+                                              const json& params,
+                                              ApiClient::ResponseCallback callback) {
+    if (RequestScheduler::classify(method) != RequestLane::QUERY) {
+        Tracer::mark(TraceStage::ORDER_SENT);
+    }
+    
+    // WebSocket requests are pipelined on one connection; REST requests run on the I/O pool
+    if (transport_ == OrderTransport::WEBSOCKET && api_client_->is_websocket_authenticated()) {
+        api_client_->websocket_request_async(method, params, callback);
+        return;
+    }
+    
+    api_client_->private_request_async(method, params, callback);
+}
+
+json OrderManager::make_place_order_params(const std::string& instrument_name,
+                                           OrderType type,
+                                           OrderDirection direction,
+                                           double amount,
+                                           double price,
+                                           TimeInForce time_in_force,
+                                           const std::string& label,
+                                           InstrumentId& instrument_id) {
+    // Validate parameters
+    if (instrument_name.empty()) {
+        throw std::invalid_argument("Instrument name cannot be empty");
+    }
+    
+    if (amount <= 0.0) {
+        throw std::invalid_argument("Amount must be positive");
+    }
+    
+    if (type == OrderType::LIMIT && price <= 0.0) {
+        throw std::invalid_argument("Price must be positive for limit orders");
+    }
+    
+    // Check against instrument metadata when it is known; a cached id avoids the lookup by name
+    if (instrument_registry_) {
+        auto instrument = instrument_id != INVALID_INSTRUMENT_ID ? instrument_registry_->get(instrument_id)
+                                                                 : instrument_registry_->get(instrument_name);
+        if (instrument) {
+            instrument_id = instrument->id;
+            
+            if (!instrument->active) {
+                throw std::invalid_argument("Instrument is not active: " + instrument_name);
+            }
+            
+            if (amount < instrument->min_trade_amount) {
+                throw std::invalid_argument("Amount is below the minimum trade amount");
+            }
+            
+            if ((type == OrderType::LIMIT || type == OrderType::STOP_LIMIT) && !instrument->is_valid_price(price)) {
+                throw std::invalid_argument("Price is not a multiple of the tick size");
+            }
+        }
+    }
+    
+    // Check against the pre-trade limits last, so only orders that are sent count towards the rate
+    if (risk_gate_) {
+        double checked_price = (type == OrderType::LIMIT || type == OrderType::STOP_LIMIT) ? price : 0.0;
+        if (instrument_id == INVALID_INSTRUMENT_ID) {
+            instrument_id = risk_gate_->instrument_id(instrument_name);
+        }
+        
+        RiskCheck result = risk_gate_->check(instrument_id, direction, amount, checked_price);
+        if (result != RiskCheck::ACCEPTED) {
+            throw std::invalid_argument(std::string("Risk check failed: ") + risk_check_to_string(result));
+        }
+    }
+    
+    // Create request parameters
+    json params = {
+        {"instrument_name", instrument_name},
+        {"amount", amount},
+        {"type", order_type_to_string(type)},
+        {"label", label.empty() ? DEFAULT_ORDER_LABEL : label}
+    };
+    
+    // Add type-specific parameters
+    if (type == OrderType::LIMIT || type == OrderType::STOP_LIMIT) {
+        params["price"] = price;
+        params["time_in_force"] = time_in_force_to_string(time_in_force);
+    }
+    
+    return params;
+}
+
+void OrderManager::send_place_order(const OrderRequest& request, std::function<void(OrderResult)> done) {
+    json params;
+    InstrumentId instrument_id = request.instrument_id;
+    try {
+        // Validate parameters and create request
+        params = make_place_order_params(request.instrument_name, request.type, request.direction,
+                                         request.amount, request.price, request.time_in_force,
+                                         request.label, instrument_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Error placing order: " << e.what() << std::endl;
+        done(OrderResult{false, "", e.what()});
+        return;
+    }
+    
+    send_private_request_async(place_order_method(request.direction), params,
+        [this, request, instrument_id, done](const ApiResponse& response) {
+            OrderResult result;
+            
+            try {
+                result.order_id = record_placed_order(response, request.instrument_name, request.type,
+                                                      request.direction, request.amount, request.price,
+                                                      request.time_in_force, instrument_id);
+                result.success = !result.order_id.empty();
+                result.error_message = response.error_message;
+            } catch (const std::exception& e) {
+                std::cerr << "Error placing order: " << e.what() << std::endl;
+                result.error_message = e.what();
+            }
+            
+            done(std::move(result));
+        });
+}
+
+void OrderManager::send_modify_order(const OrderModification& modification, std::function<void(OrderResult)> done) {
+    json params;
+    try {
+        // Validate parameters and create request
+        params = make_modify_order_params(modification.order_id, modification.amount, modification.price);
+    } catch (const std::exception& e) {
+        std::cerr << "Error modifying order: " << e.what() << std::endl;
+        done(OrderResult{false, modification.order_id, e.what()});
+        return;
+    }
+    
+    send_private_request_async("private/edit", params,
+        [this, modification, done](const ApiResponse& response) {
+            OrderResult result;
+            result.order_id = modification.order_id;
+            
+            try {
+                result.success = record_modified_order(response, modification.order_id,
+                                                       modification.amount, modification.price);
+                result.error_message = response.error_message;
+            } catch (const std::exception& e) {
+                std::cerr << "Error modifying order: " << e.what() << std::endl;
+                result.error_message = e.what();
+            }
+            
+            done(std::move(result));
+        });
+}
+
+std::string OrderManager::place_order_method(OrderDirection direction) {
+    // Deribit encodes the side in the method name
+    return direction == OrderDirection::BUY ? "private/buy" : "private/sell";
+}
+
+std::string OrderManager::record_placed_order(const ApiResponse& response,
+                                              const std::string& instrument_name,
+                                              OrderType type,
+                                              OrderDirection direction,
+                                              double amount,
+                                              double price,
+                                              TimeInForce time_in_force,
+                                              InstrumentId instrument_id) {
+    if (!response.success) {
+        std::cerr << "Error placing order: " << response.error_message << std::endl;
+        return "";
+    }
+    
+    // Extract order ID
+    const json& order_json = response.data["result"]["order"];
+    std::string order_id = order_json["order_id"];
+    
+    // Add to open orders
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    Order& order = open_orders_.emplace(order_id);
+    order.instrument_name = instrument_name;
+    order.instrument_id = instrument_id;
+    order.label = order_json.value("label", DEFAULT_ORDER_LABEL);
+    order.type = type;
+    order.direction = direction;
+    order.price = price;
+    order.amount = amount;
+    order.time_in_force = time_in_force;
+    order.status = OrderStatus::OPEN;
+    order.created_at = order_json.value("creation_timestamp", now_ms());
+    order.last_updated_at = order.created_at;
+    
+    return order_id;
+}
+
+json OrderManager::make_cancel_order_params(const std::string& order_id) {
+    // Validate parameters
+    if (order_id.empty()) {
+        throw std::invalid_argument("Order ID cannot be empty");
+    }
+    
+    // Create request parameters
+    return json{
+        {"order_id", order_id}
+    };
+}
+
+bool OrderManager::record_cancelled_order(const ApiResponse& response, const std::string& order_id) {
+    if (!response.success) {
+        std::cerr << "Error canceling order: " << response.error_message << std::endl;
+        return false;
+    }
+    
+    // Remove from open orders
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    open_orders_.erase(order_id);
+    
+    return true;
+}
+
+json OrderManager::make_modify_order_params(const std::string& order_id, double amount, double price) {
+    // Validate parameters
+    if (order_id.empty()) {
+        throw std::invalid_argument("Order ID cannot be empty");
+    }
+    
+    if (amount <= 0.0 && price <= 0.0) {
+        throw std::invalid_argument("Either amount or price must be specified");
+    }
+    
+    // Check the order as it will be after the modification when it is known locally
+    if (risk_gate_) {
+        bool known = false;
+        Order modified;
+        {
+            std::lock_guard<std::mutex> lock(orders_mutex_);
+            const Order* order = static_cast<const OrderStore&>(open_orders_).find(order_id);
+            if (order) {
+                modified.instrument_name = order->instrument_name;
+                modified.instrument_id = order->instrument_id;
+                modified.direction = order->direction;
+                modified.amount = amount > 0.0 ? amount : order->amount;
+                modified.price = price > 0.0 ? price : order->price;
+                known = true;
+            }
+        }
+        
+        if (known) {
+            // Orders read back over REST have no cached id
+            InstrumentId instrument_id = modified.instrument_id != INVALID_INSTRUMENT_ID
+                ? modified.instrument_id : risk_gate_->instrument_id(modified.instrument_name);
+            RiskCheck result = risk_gate_->check(instrument_id, modified.direction,
+                                                 modified.amount, modified.price);
+            if (result != RiskCheck::ACCEPTED) {
+                throw std::invalid_argument(std::string("Risk check failed: ") + risk_check_to_string(result));
+            }
+        }
+    }
+    
+    // Create request parameters
+    json params = {
+        {"order_id", order_id}
+    };
+    
+    if (amount > 0.0) {
+        params["amount"] = amount;
+    }
+    
+    if (price > 0.0) {
+        params["price"] = price;
+    }
+    
+    return params;
+}
+
+bool OrderManager::record_modified_order(const ApiResponse& response,
+                                         const std::string& order_id,
+                                         double amount,
+                                         double price) {
+    if (!response.success) {
+        std::cerr << "Error modifying order: " << response.error_message << std::endl;
+        return false;
+    }
+    
+    // Update order in cache
+    std::lock_guard<std::mutex> lock(orders_mutex_);
+    Order* order = open_orders_.find(order_id);
+    
+    if (order) {
+        if (amount > 0.0) {
+            order->amount = amount;
+        }
+        
+        if (price > 0.0) {
+            order->price = price;
+        }
+        
+        order->last_updated_at = now_ms();
+    }
+    
+    return true;
+}
+
+bool OrderManager::read_cached_orderbook(const std::string& instrument_name, int depth, OrderBook& orderbook) const {
+    BookSnapshot snapshot;
+    if (!orderbook_cache_.load(instrument_name, snapshot)) {
+        return false;
+    }
+    
+    // A shallower snapshot or one past the staleness limit needs a REST refresh
+    if (static_cast<size_t>(depth) > snapshot.depth ||
+        snapshot.age() > std::chrono::milliseconds(max_orderbook_staleness_ms_.load())) {
+        return false;
+    }
+    
+    size_t levels = static_cast<size_t>(depth);
+    
+    orderbook.timestamp = std::to_string(snapshot.timestamp);
+    
+    orderbook.bids.clear();
+    for (const auto& bid : snapshot.bid_view()) {
+        if (orderbook.bids.size() == levels) {
+            break;
+        }
+        orderbook.bids.emplace_back(bid.price, bid.size);
+    }
+    
+    orderbook.asks.clear();
+    for (const auto& ask : snapshot.ask_view()) {
+        if (orderbook.asks.size() == levels) {
+            break;
+        }
+        orderbook.asks.emplace_back(ask.price, ask.size);
+    }
+    
+    return true;
+}
+
+void OrderManager::record_orderbook(const ApiResponse& response, OrderBook& orderbook, int depth) {
+    if (!response.success) {
+        std::cerr << "Error getting orderbook: " << response.error_message << std::endl;
+        return;
+    }
+    
+    // Parse orderbook
+    orderbook.timestamp = timestamp_to_string(response.data["result"]["timestamp"]);
+    
+    // Parse bids
+    for (const auto& bid : response.data["result"]["bids"]) {
+        double price = bid[0];
+        double size = bid[1];
+        orderbook.bids.push_back(std::make_pair(price, size));
+    }
+    
+    // Parse asks
+    for (const auto& ask : response.data["result"]["asks"]) {
+        double price = ask[0];
+        double size = ask[1];
+        orderbook.asks.push_back(std::make_pair(price, size));
+    }
+    
+    // Store in cache unless the request was deeper than a snapshot can hold
+    if (static_cast<size_t>(depth) > BookSnapshot::MAX_DEPTH) {
+        return;
+    }
+    
+    std::vector<PriceLevel> bids;
+    bids.reserve(orderbook.bids.size());
+    for (const auto& bid : orderbook.bids) {
+        bids.push_back(PriceLevel{bid.first, bid.second});
+    }
+    
+    std::vector<PriceLevel> asks;
+    asks.reserve(orderbook.asks.size());
+    for (const auto& ask : orderbook.asks) {
+        asks.push_back(PriceLevel{ask.first, ask.second});
+    }
+    
+    int64_t timestamp = response.data["result"].value("timestamp", static_cast<int64_t>(0));
+    orderbook_cache_.store(orderbook.instrument_name, BookView{bids.data(), bids.size()},
+                           BookView{asks.data(), asks.size()}, timestamp, depth);
+}
+
+std::string OrderManager::timestamp_to_string(const json& timestamp) {
+    // Deribit sends millisecond timestamps as integers
+    if (timestamp.is_number()) {
+        return std::to_string(timestamp.get<int64_t>());
+    }
+    
+    return timestamp.is_string() ? timestamp.get<std::string>() : "";
+}
+
+void OrderManager::parse_order(const json& order_json, Order& order) {
+    // Assigning into the existing strings reuses their buffers
+    order.order_id.assign(order_json["order_id"].get_ref<const std::string&>());
+    order.instrument_name.assign(order_json["instrument_name"].get_ref<const std::string&>());
+    if (order_json.contains("label") && order_json["label"].is_string()) {
+        order.label.assign(order_json["label"].get_ref<const std::string&>());
+    }
+    
+    // Parse order type
+    const std::string& type_str = order_json["order_type"].get_ref<const std::string&>();
+    if (type_str == "limit") {
+        order.type = OrderType::LIMIT;
+    } else if (type_str == "market") {
+        order.type = OrderType::MARKET;
+    } else if (type_str == "stop_market") {
+        order.type = OrderType::STOP_MARKET;
+    } else if (type_str == "stop_limit") {
+        order.type = OrderType::STOP_LIMIT;
+    }
+    
+    // Parse direction
+    const std::string& direction_str = order_json["direction"].get_ref<const std::string&>();
+    order.direction = direction_str == "buy" ? OrderDirection::BUY : OrderDirection::SELL;
+    
+    // Market orders carry a string price
+    order.price = order_json["price"].is_number() ? order_json["price"].get<double>() : 0.0;
+    order.amount = order_json["amount"];
+    
+    // Parse time in force
+    const std::string& tif_str = order_json["time_in_force"].get_ref<const std::string&>();
+    if (tif_str == "good_til_cancelled") {
+        order.time_in_force = TimeInForce::GOOD_TIL_CANCELLED;
+    } else if (tif_str == "fill_or_kill") {
+        order.time_in_force = TimeInForce::FILL_OR_KILL;
+    } else if (tif_str == "immediate_or_cancel") {
+        order.time_in_force = TimeInForce::IMMEDIATE_OR_CANCEL;
+    }
+    
+    order.status = parse_order_status(order_json["order_state"].get_ref<const std::string&>());
+    order.created_at = order_json.value("creation_timestamp", static_cast<int64_t>(0));
+    order.last_updated_at = order_json.value("last_update_timestamp", order.created_at);
+}
+
+int64_t OrderManager::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 std::string OrderManager::order_type_to_string(OrderType type) {
     switch (type) {
         case OrderType::MARKET:
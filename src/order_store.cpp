@@ -0,0 +1,197 @@
+#include "order_store.h"
+
+namespace deribit {
+
+OrderStatus parse_order_status(std::string_view state) {
+    if (state == "open") {
+        return OrderStatus::OPEN;
+    } else if (state == "untriggered") {
+        return OrderStatus::UNTRIGGERED;
+    } else if (state == "filled") {
+        return OrderStatus::FILLED;
+    } else if (state == "rejected") {
+        return OrderStatus::REJECTED;
+    } else if (state == "cancelled") {
+        return OrderStatus::CANCELLED;
+    }
+
+    return OrderStatus::UNKNOWN;
+}
+
+const char* order_status_to_string(OrderStatus status) {
+    switch (status) {
+        case OrderStatus::OPEN:
+            return "open";
+        case OrderStatus::UNTRIGGERED:
+            return "untriggered";
+        case OrderStatus::FILLED:
+            return "filled";
+        case OrderStatus::REJECTED:
+            return "rejected";
+        case OrderStatus::CANCELLED:
+            return "cancelled";
+        default:
+            return "unknown";
+    }
+}
+
+OrderStore::OrderStore(size_t capacity) {
+    slots_.reserve(capacity);
+    free_slots_.reserve(capacity);
+    index_.reserve(capacity);
+}
+
+Order& OrderStore::emplace(const std::string& order_id, OrderHandle* handle) {
+    ++version_;
+
+    auto it = index_.find(order_id);
+    if (it != index_.end()) {
+        Slot& slot = slots_[it->second];
+        if (handle) {
+            *handle = make_handle(it->second, slot.generation);
+        }
+        return slot.order;
+    }
+
+    uint32_t index;
+    if (!free_slots_.empty()) {
+        index = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+
+    Slot& slot = slots_[index];
+    slot.in_use = true;
+
+    // Reset the fields but keep the string buffers of the previous order
+    slot.order.order_id.assign(order_id);
+    slot.order.instrument_name.clear();
+    slot.order.instrument_id = INVALID_INSTRUMENT_ID;
+    slot.order.label.clear();
+    slot.order.type = OrderType::LIMIT;
+    slot.order.direction = OrderDirection::BUY;
+    slot.order.price = 0.0;
+    slot.order.amount = 0.0;
+    slot.order.time_in_force = TimeInForce::GOOD_TIL_CANCELLED;
+    slot.order.status = OrderStatus::UNKNOWN;
+    slot.order.created_at = 0;
+    slot.order.last_updated_at = 0;
+
+    index_.emplace(order_id, index);
+
+    if (handle) {
+        *handle = make_handle(index, slot.generation);
+    }
+    return slot.order;
+}
+
+OrderHandle OrderStore::upsert(const Order& order) {
+    OrderHandle result;
+    Order& stored = emplace(order.order_id, &result);
+
+    stored.instrument_name.assign(order.instrument_name);
+    stored.instrument_id = order.instrument_id;
+    stored.label.assign(order.label);
+    stored.type = order.type;
+    stored.direction = order.direction;
+    stored.price = order.price;
+    stored.amount = order.amount;
+    stored.time_in_force = order.time_in_force;
+    stored.status = order.status;
+    stored.created_at = order.created_at;
+    stored.last_updated_at = order.last_updated_at;
+
+    return result;
+}
+
+Order* OrderStore::find(const std::string& order_id) {
+    auto it = index_.find(order_id);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+
+    // The caller may modify the order
+    ++version_;
+    return &slots_[it->second].order;
+}
+
+const Order* OrderStore::find(const std::string& order_id) const {
+    auto it = index_.find(order_id);
+    return it != index_.end() ? &slots_[it->second].order : nullptr;
+}
+
+const Order* OrderStore::get(OrderHandle handle) const {
+    uint32_t index = static_cast<uint32_t>(handle);
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+
+    if (index >= slots_.size() || !slots_[index].in_use || slots_[index].generation != generation) {
+        return nullptr;
+    }
+
+    return &slots_[index].order;
+}
+
+OrderHandle OrderStore::handle(const std::string& order_id) const {
+    auto it = index_.find(order_id);
+    if (it == index_.end()) {
+        return INVALID_ORDER_HANDLE;
+    }
+
+    return make_handle(it->second, slots_[it->second].generation);
+}
+
+bool OrderStore::erase(const std::string& order_id) {
+    auto it = index_.find(order_id);
+    if (it == index_.end()) {
+        return false;
+    }
+
+    release(it->second);
+    return true;
+}
+
+void OrderStore::clear() {
+    for (uint32_t i = 0; i < slots_.size(); ++i) {
+        if (slots_[i].in_use) {
+            release(i);
+        }
+    }
+}
+
+void OrderStore::release(uint32_t slot) {
+    Slot& released = slots_[slot];
+    index_.erase(released.order.order_id);
+
+    released.in_use = false;
+    ++released.generation;
+    free_slots_.push_back(slot);
+    ++version_;
+}
+
+size_t OrderStore::size() const {
+    return index_.size();
+}
+
+OrderStore::Snapshot OrderStore::snapshot() {
+    if (snapshot_ && snapshot_version_ == version_) {
+        return snapshot_;
+    }
+
+    auto orders = std::make_shared<std::vector<Order>>();
+    orders->reserve(index_.size());
+    for_each([&orders](const Order& order) {
+        orders->push_back(order);
+    });
+
+    snapshot_ = std::move(orders);
+    snapshot_version_ = version_;
+    return snapshot_;
+}
+
+OrderHandle OrderStore::make_handle(uint32_t slot, uint32_t generation) {
+    return (static_cast<OrderHandle>(generation) << 32) | slot;
+}
+
+} // namespace deribit
\ No newline at end of file
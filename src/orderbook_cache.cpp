@@ -0,0 +1,167 @@
+#include "orderbook_cache.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace deribit {
+
+namespace {
+
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+std::chrono::nanoseconds BookSnapshot::age() const {
+    return std::chrono::nanoseconds(steady_now_ns() - received_at);
+}
+
+OrderBookCache::OrderBookCache(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    slots_ = std::make_unique<std::atomic<Slot*>[]>(size);
+    for (size_t i = 0; i < size; ++i) {
+        slots_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    mask_ = size - 1;
+}
+
+OrderBookCache::~OrderBookCache() {
+    for (size_t i = 0; i <= mask_; ++i) {
+        delete slots_[i].load(std::memory_order_relaxed);
+    }
+}
+
+bool OrderBookCache::store(const std::string& instrument_name, BookView bids, BookView asks,
+                           int64_t timestamp, size_t depth) {
+    Slot* slot = get_or_create_slot(instrument_name);
+    if (!slot) {
+        std::cerr << "Orderbook cache full, dropping snapshot for " << instrument_name << std::endl;
+        return false;
+    }
+
+    write_slot(*slot, bids, asks, timestamp, depth, steady_now_ns());
+    return true;
+}
+
+bool OrderBookCache::load(const std::string& instrument_name, BookSnapshot& snapshot) const {
+    const Slot* slot = find_slot(instrument_name);
+    if (!slot) {
+        return false;
+    }
+
+    while (true) {
+        uint64_t before = slot->sequence.load(std::memory_order_acquire);
+
+        // A writer is in the middle of an update
+        if (before & 1) {
+            continue;
+        }
+
+        std::memcpy(&snapshot, &slot->snapshot, sizeof(BookSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot->sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    return snapshot.received_at != 0;
+}
+
+void OrderBookCache::invalidate(const std::string& instrument_name) {
+    Slot* slot = find_slot(instrument_name);
+    if (slot) {
+        write_slot(*slot, BookView(), BookView(), 0, 0, 0);
+    }
+}
+
+void OrderBookCache::invalidate_all() {
+    for (size_t i = 0; i <= mask_; ++i) {
+        Slot* slot = slots_[i].load(std::memory_order_acquire);
+        if (slot) {
+            write_slot(*slot, BookView(), BookView(), 0, 0, 0);
+        }
+    }
+}
+
+OrderBookCache::Slot* OrderBookCache::find_slot(const std::string& instrument_name) const {
+    size_t index = std::hash<std::string>()(instrument_name) & mask_;
+
+    // Linear probing; an empty bucket ends the probe since slots are never removed
+    for (size_t probes = 0; probes <= mask_; ++probes) {
+        Slot* slot = slots_[index].load(std::memory_order_acquire);
+
+        if (!slot) {
+            return nullptr;
+        }
+
+        if (slot->instrument_name == instrument_name) {
+            return slot;
+        }
+
+        index = (index + 1) & mask_;
+    }
+
+    return nullptr;
+}
+
+OrderBookCache::Slot* OrderBookCache::get_or_create_slot(const std::string& instrument_name) {
+    Slot* slot = find_slot(instrument_name);
+    if (slot) {
+        return slot;
+    }
+
+    // Inserts are rare, so they are serialized to keep the table free of duplicates
+    std::lock_guard<std::mutex> lock(insert_mutex_);
+
+    size_t index = std::hash<std::string>()(instrument_name) & mask_;
+    for (size_t probes = 0; probes <= mask_; ++probes) {
+        slot = slots_[index].load(std::memory_order_acquire);
+
+        if (!slot) {
+            slot = new Slot(instrument_name);
+            slots_[index].store(slot, std::memory_order_release);
+            return slot;
+        }
+
+        if (slot->instrument_name == instrument_name) {
+            return slot;
+        }
+
+        index = (index + 1) & mask_;
+    }
+
+    return nullptr;
+}
+
+void OrderBookCache::write_slot(Slot& slot, BookView bids, BookView asks, int64_t timestamp,
+                                size_t depth, int64_t received_at) {
+    // Claim the slot so concurrent writers for the same instrument do not interleave
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    while ((sequence & 1) ||
+           !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+        sequence = slot.sequence.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    BookSnapshot& snapshot = slot.snapshot;
+    snapshot.bid_count = static_cast<uint32_t>(std::min(bids.size(), BookSnapshot::MAX_DEPTH));
+    snapshot.ask_count = static_cast<uint32_t>(std::min(asks.size(), BookSnapshot::MAX_DEPTH));
+    std::copy(bids.begin(), bids.begin() + snapshot.bid_count, snapshot.bids);
+    std::copy(asks.begin(), asks.begin() + snapshot.ask_count, snapshot.asks);
+    snapshot.depth = static_cast<uint32_t>(std::min(depth, BookSnapshot::MAX_DEPTH));
+    snapshot.timestamp = timestamp;
+    snapshot.received_at = received_at;
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace deribit
\ No newline at end of file
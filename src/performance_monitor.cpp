@@ -4,97 +4,183 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DERIBIT_HAS_TSC 1
+#else
+#define DERIBIT_HAS_TSC 0
+#endif
 
 namespace deribit {
 
-// LatencyTracker implementation
-LatencyTracker::LatencyTracker(const std::string& name, bool store_samples, size_t max_samples)
-    : name_(name) {
-    metrics_.name = name;
-    metrics_.store_samples = store_samples;
-    metrics_.max_samples = max_samples;
+namespace {
+
+uint64_t steady_clock_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
 }
 
-uint64_t LatencyTracker::start() {
-    auto now = std::chrono::high_resolution_clock::now();
-    uint64_t id = next_id_++;
+#if DERIBIT_HAS_TSC
+// Measure the TSC rate against the steady clock once per process
+double tsc_ticks_per_ns() {
+    static const double ticks_per_ns = []() {
+        uint64_t clock_start = steady_clock_ns();
+        uint64_t tsc_start = __rdtsc();
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        
+        uint64_t tsc_elapsed = __rdtsc() - tsc_start;
+        uint64_t clock_elapsed = steady_clock_ns() - clock_start;
+        
+        return static_cast<double>(tsc_elapsed) / static_cast<double>(clock_elapsed);
+    }();
     
-    std::lock_guard<std::mutex> lock(mutex_);
-    start_times_[id] = now;
+    return ticks_per_ns;
+}
+#endif
+
+} // namespace
+
+// LatencyTracker implementation
+LatencyTracker::LatencyTracker(const std::string& name, bool record_histogram,
+                               ClockSource clock_source, const HistogramConfig& histogram_config)
+    : name_(name),
+      clock_source_(clock_source),
+      min_ns_(std::chrono::nanoseconds::max().count()),
+      max_ns_(std::chrono::nanoseconds::min().count()) {
+#if DERIBIT_HAS_TSC
+    // Calibrate up front so the first end() does not pay for it
+    if (clock_source_ == ClockSource::TSC) {
+        tsc_ticks_per_ns();
+    }
+#else
+    clock_source_ = ClockSource::STEADY_CLOCK;
+#endif
     
-    return id;
+    if (record_histogram) {
+        histogram_ = std::make_unique<LatencyHistogram>(histogram_config.significant_bits,
+                                                        histogram_config.max_value_ns);
+        window_histogram_ = std::make_unique<RollingHistogram>(histogram_config);
+    }
 }
 
-void LatencyTracker::end(uint64_t id) {
-    auto now = std::chrono::high_resolution_clock::now();
+uint64_t LatencyTracker::start() const {
+#if DERIBIT_HAS_TSC
+    if (clock_source_ == ClockSource::TSC) {
+        return __rdtsc();
+    }
+#endif
     
-    std::lock_guard<std::mutex> lock(mutex_);
+    return steady_clock_ns();
+}
+
+void LatencyTracker::end(uint64_t token) {
+    int64_t latency_ns;
     
-    auto it = start_times_.find(id);
-    if (it == start_times_.end()) {
-        std::cerr << "Warning: No start time found for ID " << id << std::endl;
-        return;
+#if DERIBIT_HAS_TSC
+    if (clock_source_ == ClockSource::TSC) {
+        latency_ns = static_cast<int64_t>(static_cast<double>(__rdtsc() - token) / tsc_ticks_per_ns());
+    } else {
+        latency_ns = static_cast<int64_t>(steady_clock_ns() - token);
     }
+#else
+    latency_ns = static_cast<int64_t>(steady_clock_ns() - token);
+#endif
+    
+    record(std::chrono::nanoseconds(latency_ns));
+}
+
+void LatencyTracker::record(std::chrono::nanoseconds latency) {
+    int64_t latency_ns = latency.count();
     
-    auto start_time = it->second;
-    auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(latency_ns, std::memory_order_relaxed);
     
-    // Update metrics
-    metrics_.min_latency = std::min(metrics_.min_latency, latency);
-    metrics_.max_latency = std::max(metrics_.max_latency, latency);
-    metrics_.total_latency += latency;
-    metrics_.count++;
+    int64_t current_min = min_ns_.load(std::memory_order_relaxed);
+    while (latency_ns < current_min &&
+           !min_ns_.compare_exchange_weak(current_min, latency_ns, std::memory_order_relaxed)) {
+    }
     
-    // Store sample if enabled
-    if (metrics_.store_samples && metrics_.samples.size() < metrics_.max_samples) {
-        metrics_.samples.push_back(latency);
+    int64_t current_max = max_ns_.load(std::memory_order_relaxed);
+    while (latency_ns > current_max &&
+           !max_ns_.compare_exchange_weak(current_max, latency_ns, std::memory_order_relaxed)) {
     }
     
-    // Remove start time
-    start_times_.erase(it);
+    // Bucket the value if percentiles are enabled
+    if (histogram_) {
+        histogram_->record(latency_ns);
+        window_histogram_->record(latency_ns, static_cast<int64_t>(steady_clock_ns()));
+    }
 }
 
 LatencyMetric LatencyTracker::get_metrics() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return metrics_;
+    LatencyMetric metrics;
+    metrics.name = name_;
+    metrics.count = count_.load(std::memory_order_relaxed);
+    metrics.total_latency = std::chrono::nanoseconds(total_ns_.load(std::memory_order_relaxed));
+    metrics.min_latency = std::chrono::nanoseconds(min_ns_.load(std::memory_order_relaxed));
+    metrics.max_latency = std::chrono::nanoseconds(max_ns_.load(std::memory_order_relaxed));
+    
+    if (histogram_) {
+        metrics.histogram = histogram_->snapshot();
+        metrics.window_histogram = window_histogram_->snapshot(static_cast<int64_t>(steady_clock_ns()));
+    }
+    
+    return metrics;
 }
 
 void LatencyTracker::reset() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    count_.store(0, std::memory_order_relaxed);
+    total_ns_.store(0, std::memory_order_relaxed);
+    min_ns_.store(std::chrono::nanoseconds::max().count(), std::memory_order_relaxed);
+    max_ns_.store(std::chrono::nanoseconds::min().count(), std::memory_order_relaxed);
     
-    metrics_.min_latency = std::chrono::nanoseconds::max();
-    metrics_.max_latency = std::chrono::nanoseconds::min();
-    metrics_.total_latency = std::chrono::nanoseconds(0);
-    metrics_.count = 0;
-    metrics_.samples.clear();
+    if (histogram_) {
+        histogram_->reset();
+        window_histogram_->reset();
+    }
+}
+
+ClockSource LatencyTracker::clock_source() const {
+    return clock_source_;
 }
 
 // LatencyMetric implementation
 double LatencyMetric::percentile_latency_ns(double percentile) const {
-    if (samples.empty()) {
-        return 0.0;
-    }
-    
-    // Make a copy of the samples
-    std::vector<std::chrono::nanoseconds> sorted_samples = samples;
-    
-    // Sort the samples
-    std::sort(sorted_samples.begin(), sorted_samples.end());
-    
-    // Calculate the index
-    double index = percentile * (sorted_samples.size() - 1) / 100.0;
-    size_t lower_index = static_cast<size_t>(std::floor(index));
-    size_t upper_index = static_cast<size_t>(std::ceil(index));
-    
-    // Handle edge cases
-    if (lower_index == upper_index) {
-        return sorted_samples[lower_index].count();
+    return static_cast<double>(histogram.percentile(percentile));
+}
+
+double LatencyMetric::window_percentile_latency_ns(double percentile) const {
+    return static_cast<double>(window_histogram.percentile(percentile));
+}
+
+// Counter implementation
+Counter::Counter(const std::string& name)
+    : name_(name) {
+}
+
+void Counter::add(int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void Counter::set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+}
+
+void Counter::update_max(int64_t value) {
+    int64_t current = value_.load(std::memory_order_relaxed);
+    while (current < value && !value_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
     }
-    
-    // Interpolate
-    double weight = index - lower_index;
-    return sorted_samples[lower_index].count() * (1.0 - weight) + 
-           sorted_samples[upper_index].count() * weight;
+}
+
+int64_t Counter::get() const {
+    return value_.load(std::memory_order_relaxed);
+}
+
+const std::string& Counter::name() const {
+    return name_;
 }
 
 // PerformanceMonitor implementation
@@ -104,8 +190,7 @@ PerformanceMonitor& PerformanceMonitor::instance() {
 }
 
 std::shared_ptr<LatencyTracker> PerformanceMonitor::get_tracker(const std::string& name, 
-                                                              bool store_samples, 
-                                                              size_t max_samples) {
+                                                              bool record_histogram) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     auto it = trackers_.find(name);
@@ -113,12 +198,57 @@ std::shared_ptr<LatencyTracker> PerformanceMonitor::get_tracker(const std::strin
         return it->second;
     }
     
-    auto tracker = std::make_shared<LatencyTracker>(name, store_samples, max_samples);
+    auto tracker = std::make_shared<LatencyTracker>(name, record_histogram, clock_source_.load(),
+                                                    histogram_config_);
     trackers_[name] = tracker;
     
     return tracker;
 }
 
+void PerformanceMonitor::set_clock_source(ClockSource clock_source) {
+    clock_source_ = clock_source;
+}
+
+ClockSource PerformanceMonitor::get_clock_source() const {
+    return clock_source_;
+}
+
+void PerformanceMonitor::set_histogram_config(const HistogramConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histogram_config_ = config;
+}
+
+HistogramConfig PerformanceMonitor::get_histogram_config() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return histogram_config_;
+}
+
+std::shared_ptr<Counter> PerformanceMonitor::get_counter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = counters_.find(name);
+    if (it != counters_.end()) {
+        return it->second;
+    }
+    
+    auto counter = std::make_shared<Counter>(name);
+    counters_[name] = counter;
+    
+    return counter;
+}
+
+std::map<std::string, int64_t> PerformanceMonitor::get_all_counters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    std::map<std::string, int64_t> counters;
+    
+    for (const auto& pair : counters_) {
+        counters[pair.first] = pair.second->get();
+    }
+    
+    return counters;
+}
+
 std::map<std::string, LatencyMetric> PerformanceMonitor::get_all_metrics() const {
     std::lock_guard<std::mutex> lock(mutex_);
     
@@ -169,7 +299,8 @@ bool PerformanceMonitor::export_to_csv(const std::string& filename) const {
         }
         
         // Write header
-        file << "Operation,Count,Min (ns),Max (ns),Avg (ns),Avg (us),Avg (ms),P50 (ns),P90 (ns),P99 (ns)\n";
+        file << "Operation,Count,Min (ns),Max (ns),Avg (ns),Avg (us),Avg (ms),P50 (ns),P90 (ns),P99 (ns),P99.9 (ns),"
+             << "Window P50 (ns),Window P99 (ns)\n";
         
         // Get all metrics
         auto metrics = get_all_metrics();
@@ -186,13 +317,21 @@ bool PerformanceMonitor::export_to_csv(const std::string& filename) const {
                  << metric.average_latency_us() << ","
                  << metric.average_latency_ms() << ",";
             
-            // Add percentiles if samples are available
-            if (!metric.samples.empty()) {
+            // Add percentiles if a histogram is recorded
+            if (metric.histogram.count() > 0) {
                 file << metric.percentile_latency_ns(50) << ","
                      << metric.percentile_latency_ns(90) << ","
-                     << metric.percentile_latency_ns(99);
+                     << metric.percentile_latency_ns(99) << ","
+                     << metric.percentile_latency_ns(99.9) << ",";
+            } else {
+                file << "N/A,N/A,N/A,N/A,";
+            }
+            
+            if (metric.window_histogram.count() > 0) {
+                file << metric.window_percentile_latency_ns(50) << ","
+                     << metric.window_percentile_latency_ns(99);
             } else {
-                file << "N/A,N/A,N/A";
+                file << "N/A,N/A";
             }
             
             file << "\n";
@@ -219,9 +358,11 @@ void PerformanceMonitor::print_metrics() const {
               << std::right << std::setw(15) << "P50 (us)"
               << std::right << std::setw(15) << "P90 (us)"
               << std::right << std::setw(15) << "P99 (us)"
+              << std::right << std::setw(15) << "P99.9 (us)"
+              << std::right << std::setw(15) << "Win P99 (us)"
               << std::endl;
     
-    std::cout << std::string(130, '-') << std::endl;
+    std::cout << std::string(160, '-') << std::endl;
     
     // Print data
     for (const auto& pair : metrics) {
@@ -233,19 +374,46 @@ void PerformanceMonitor::print_metrics() const {
                   << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.max_latency.count() / 1000.0)
                   << std::right << std::setw(15) << std::fixed << std::setprecision(3) << metric.average_latency_us();
         
-        // Add percentiles if samples are available
-        if (!metric.samples.empty()) {
+        // Add percentiles if a histogram is recorded
+        if (metric.histogram.count() > 0) {
             std::cout << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.percentile_latency_ns(50) / 1000.0)
                       << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.percentile_latency_ns(90) / 1000.0)
-                      << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.percentile_latency_ns(99) / 1000.0);
+                      << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.percentile_latency_ns(99) / 1000.0)
+                      << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.percentile_latency_ns(99.9) / 1000.0);
         } else {
             std::cout << std::right << std::setw(15) << "N/A"
+                      << std::right << std::setw(15) << "N/A"
                       << std::right << std::setw(15) << "N/A"
                       << std::right << std::setw(15) << "N/A";
         }
         
+        if (metric.window_histogram.count() > 0) {
+            std::cout << std::right << std::setw(15) << std::fixed << std::setprecision(3) << (metric.window_percentile_latency_ns(99) / 1000.0);
+        } else {
+            std::cout << std::right << std::setw(15) << "N/A";
+        }
+        
         std::cout << std::endl;
     }
+    
+    // Print counters
+    auto counters = get_all_counters();
+    if (counters.empty()) {
+        return;
+    }
+    
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(30) << "Counter"
+              << std::right << std::setw(15) << "Value"
+              << std::endl;
+    
+    std::cout << std::string(45, '-') << std::endl;
+    
+    for (const auto& pair : counters) {
+        std::cout << std::left << std::setw(30) << pair.first
+                  << std::right << std::setw(15) << pair.second
+                  << std::endl;
+    }
 }
 
 // ScopedLatencyTracker implementation
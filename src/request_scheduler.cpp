@@ -0,0 +1,324 @@
+#include "request_scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace deribit {
+
+namespace {
+
+const char* lane_name(size_t lane) {
+    switch (static_cast<RequestLane>(lane)) {
+        case RequestLane::CANCEL:
+            return "cancel";
+        case RequestLane::ORDER_ENTRY:
+            return "order_entry";
+        default:
+            return "query";
+    }
+}
+
+bool starts_with(const std::string& value, const char* prefix) {
+    return value.rfind(prefix, 0) == 0;
+}
+
+} // namespace
+
+RequestScheduler::RequestScheduler(const RateLimitConfig& config)
+    : config_(config) {
+    auto& monitor = PerformanceMonitor::instance();
+
+    matching_engine_.config = config.matching_engine;
+    matching_engine_.credits = config.matching_engine.max_credits;
+    matching_engine_.credits_counter = monitor.get_counter("api_rate_limit_credits.matching_engine");
+    matching_engine_.credits_counter->set(static_cast<int64_t>(matching_engine_.credits));
+
+    non_matching_engine_.config = config.non_matching_engine;
+    non_matching_engine_.credits = config.non_matching_engine.max_credits;
+    non_matching_engine_.credits_counter = monitor.get_counter("api_rate_limit_credits.non_matching_engine");
+    non_matching_engine_.credits_counter->set(static_cast<int64_t>(non_matching_engine_.credits));
+
+    for (size_t i = 0; i < LANE_COUNT; ++i) {
+        delay_trackers_[i] = monitor.get_tracker(std::string("api_rate_limit_queue_delay.") + lane_name(i), true);
+    }
+
+    queued_counter_ = monitor.get_counter("api_rate_limit_queued");
+    merged_counter_ = monitor.get_counter("api_rate_limit_merged");
+    dropped_counter_ = monitor.get_counter("api_rate_limit_dropped");
+}
+
+RequestScheduler::~RequestScheduler() {
+    stop();
+}
+
+void RequestScheduler::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    thread_ = std::thread(&RequestScheduler::run, this);
+}
+
+void RequestScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        wake_ = true;
+    }
+    condition_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // Fail whatever is still waiting so no caller is left hanging
+    std::vector<ResponseCallback> stranded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& lane : lanes_) {
+            for (auto& request : lane) {
+                stranded.insert(stranded.end(), request.callbacks.begin(), request.callbacks.end());
+            }
+            lane.clear();
+        }
+        merge_index_.clear();
+        queued_ = 0;
+        queued_counter_->set(0);
+    }
+
+    fail(stranded, "Rate limiter stopped");
+}
+
+bool RequestScheduler::submit(const std::string& method, const json& params, ResponseCallback callback,
+                              SendFunction send, bool mergeable) {
+    RequestLane lane = classify(method);
+    std::string key = mergeable ? merge_key(method, lane, params) : std::string();
+    std::vector<ResponseCallback> cancelled_edits;
+    bool rejected = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // An order about to be cancelled does not need its pending edits
+        if (method == "private/cancel" && params.contains("order_id") && params["order_id"].is_string()) {
+            auto edit = merge_index_.find("private/edit:" + params["order_id"].get<std::string>());
+            if (edit != merge_index_.end()) {
+                auto request = edit->second;
+                cancelled_edits = std::move(request->callbacks);
+                merge_index_.erase(edit);
+                lanes_[static_cast<size_t>(RequestLane::ORDER_ENTRY)].erase(request);
+                --queued_;
+                dropped_counter_->add();
+            }
+        }
+
+        auto merged = key.empty() ? merge_index_.end() : merge_index_.find(key);
+        if (merged != merge_index_.end()) {
+            // Keep the queue position of the first request and the contents of the latest
+            QueuedRequest& request = *merged->second;
+            request.params = params;
+            request.send = std::move(send);
+            request.callbacks.push_back(std::move(callback));
+            merged_counter_->add();
+        } else if (queued_ >= config_.max_queued) {
+            rejected = true;
+            dropped_counter_->add();
+        } else {
+            auto& queue = lanes_[static_cast<size_t>(lane)];
+            queue.emplace_back();
+
+            QueuedRequest& request = queue.back();
+            request.method = method;
+            request.params = params;
+            request.merge_key = key;
+            request.callbacks.push_back(std::move(callback));
+            request.send = std::move(send);
+            request.enqueued_at = now_ns();
+
+            if (!key.empty()) {
+                merge_index_[key] = std::prev(queue.end());
+            }
+            ++queued_;
+        }
+
+        queued_counter_->set(static_cast<int64_t>(queued_));
+        wake_ = true;
+    }
+    condition_.notify_one();
+
+    fail(cancelled_edits, "Request dropped: order cancelled");
+
+    if (rejected) {
+        fail({callback}, "Rate limit queue full");
+        return false;
+    }
+
+    return true;
+}
+
+int64_t RequestScheduler::dispatch(int64_t now_ns) {
+    std::vector<QueuedRequest> ready;
+    int64_t next_wait = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (size_t i = 0; i < LANE_COUNT; ++i) {
+            auto& queue = lanes_[i];
+            CreditPool& pool = pool_for(static_cast<RequestLane>(i));
+            refill(pool, now_ns);
+
+            while (!queue.empty() && pool.credits >= pool.config.request_cost) {
+                pool.credits -= pool.config.request_cost;
+
+                if (!queue.front().merge_key.empty()) {
+                    merge_index_.erase(queue.front().merge_key);
+                }
+                ready.push_back(std::move(queue.front()));
+                queue.pop_front();
+                --queued_;
+            }
+
+            if (!queue.empty() && pool.config.refill_per_second > 0.0) {
+                double missing = pool.config.request_cost - pool.credits;
+                auto wait = static_cast<int64_t>(std::ceil(missing / pool.config.refill_per_second * 1e9));
+                next_wait = next_wait < 0 ? wait : std::min(next_wait, wait);
+            }
+        }
+
+        matching_engine_.credits_counter->set(static_cast<int64_t>(matching_engine_.credits));
+        non_matching_engine_.credits_counter->set(static_cast<int64_t>(non_matching_engine_.credits));
+        queued_counter_->set(static_cast<int64_t>(queued_));
+    }
+
+    for (auto& request : ready) {
+        size_t lane = static_cast<size_t>(classify(request.method));
+        delay_trackers_[lane]->record(std::chrono::nanoseconds(std::max<int64_t>(0, now_ns - request.enqueued_at)));
+
+        try {
+            request.send(request.method, request.params, make_callback(request.method, std::move(request.callbacks)));
+        } catch (const std::exception& e) {
+            std::cerr << "Error sending scheduled request: " << e.what() << std::endl;
+        }
+    }
+
+    return next_wait;
+}
+
+void RequestScheduler::on_rate_limited(const std::string& method) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CreditPool& pool = pool_for(classify(method));
+    pool.credits = 0.0;
+    pool.credits_counter->set(0);
+}
+
+double RequestScheduler::available_credits(RequestLane lane) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lane == RequestLane::QUERY ? non_matching_engine_.credits : matching_engine_.credits;
+}
+
+size_t RequestScheduler::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_;
+}
+
+RequestLane RequestScheduler::classify(const std::string& method) {
+    if (starts_with(method, "private/cancel")) {
+        return RequestLane::CANCEL;
+    }
+
+    if (method == "private/buy" || method == "private/sell" || starts_with(method, "private/edit") ||
+        method == "private/close_position" || method == "private/mass_quote") {
+        return RequestLane::ORDER_ENTRY;
+    }
+
+    return RequestLane::QUERY;
+}
+
+int64_t RequestScheduler::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RequestScheduler::CreditPool& RequestScheduler::pool_for(RequestLane lane) {
+    return lane == RequestLane::QUERY ? non_matching_engine_ : matching_engine_;
+}
+
+void RequestScheduler::refill(CreditPool& pool, int64_t now_ns) {
+    if (pool.refilled_at >= 0 && now_ns > pool.refilled_at) {
+        double elapsed = static_cast<double>(now_ns - pool.refilled_at) / 1e9;
+        pool.credits = std::min(pool.config.max_credits, pool.credits + elapsed * pool.config.refill_per_second);
+    }
+
+    if (pool.refilled_at < 0 || now_ns > pool.refilled_at) {
+        pool.refilled_at = now_ns;
+    }
+}
+
+std::string RequestScheduler::merge_key(const std::string& method, RequestLane lane, const json& params) {
+    if (method == "private/edit") {
+        bool has_id = params.contains("order_id") && params["order_id"].is_string();
+        return has_id ? "private/edit:" + params["order_id"].get<std::string>() : std::string();
+    }
+
+    // Sending a cancel or a read-only query twice gains nothing
+    if (lane == RequestLane::CANCEL || method.find("/get_") != std::string::npos) {
+        return method + params.dump();
+    }
+
+    return std::string();
+}
+
+RequestScheduler::ResponseCallback RequestScheduler::make_callback(const std::string& method,
+                                                                   std::vector<ResponseCallback> callbacks) {
+    return [this, method, callbacks = std::move(callbacks)](const ApiResponse& response) {
+        if (!response.success && response.error_message == "too_many_requests") {
+            on_rate_limited(method);
+        }
+
+        for (const auto& callback : callbacks) {
+            try {
+                callback(response);
+            } catch (const std::exception& e) {
+                std::cerr << "Error in request callback: " << e.what() << std::endl;
+            }
+        }
+    };
+}
+
+void RequestScheduler::fail(const std::vector<ResponseCallback>& callbacks, const std::string& error_message) {
+    ApiResponse response;
+    response.success = false;
+    response.error_message = error_message;
+
+    for (const auto& callback : callbacks) {
+        try {
+            callback(response);
+        } catch (const std::exception& e) {
+            std::cerr << "Error in request callback: " << e.what() << std::endl;
+        }
+    }
+}
+
+void RequestScheduler::run() {
+    while (running_) {
+        int64_t wait = dispatch(now_ns());
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_) {
+            break;
+        }
+
+        if (!wake_) {
+            if (wait < 0) {
+                condition_.wait(lock, [this]() { return wake_; });
+            } else {
+                condition_.wait_for(lock, std::chrono::nanoseconds(wait), [this]() { return wake_; });
+            }
+        }
+        wake_ = false;
+    }
+}
+
+} // namespace deribit
\ No newline at end of file
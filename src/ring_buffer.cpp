@@ -0,0 +1,43 @@
+#include "ring_buffer.h"
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace deribit {
+
+// QueueWaiter implementation
+QueueWaiter::QueueWaiter(WaitPolicy policy, size_t spin_iterations)
+    : policy_(policy),
+      spin_iterations_(spin_iterations > 0 ? spin_iterations : 1) {
+}
+
+void QueueWaiter::notify() {
+    // Pairs with the fence in wait()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        condition_.notify_one();
+    }
+}
+
+void QueueWaiter::notify_all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_all();
+}
+
+WaitPolicy QueueWaiter::policy() const {
+    return policy_;
+}
+
+void QueueWaiter::pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+} // namespace deribit
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "risk_gate.h"
+#include <chrono>
+#include <cmath>
+
+namespace deribit {
+
+namespace {
+
+constexpr int64_t RATE_WINDOW_NS = 1000000000;
+
+int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* risk_check_to_string(RiskCheck check) {
+    switch (check) {
+        case RiskCheck::ACCEPTED:
+            return "accepted";
+        case RiskCheck::ORDER_AMOUNT:
+            return "order_amount";
+        case RiskCheck::NOTIONAL:
+            return "notional";
+        case RiskCheck::POSITION:
+            return "position";
+        case RiskCheck::PRICE_BAND:
+            return "price_band";
+        case RiskCheck::ORDER_RATE:
+            return "order_rate";
+        case RiskCheck::NO_REFERENCE:
+            return "no_reference";
+        default:
+            return "unknown";
+    }
+}
+
+RiskGate::RiskGate(std::shared_ptr<InstrumentRegistry> registry, size_t max_instruments)
+    : registry_(registry),
+      max_instruments_(max_instruments),
+      instruments_(std::make_unique<InstrumentState[]>(max_instruments)) {
+    auto& monitor = PerformanceMonitor::instance();
+    tracker_ = monitor.get_tracker("risk_gate", true);
+
+    for (int i = 1; i < 7; ++i) {
+        rejection_counters_[i] = monitor.get_counter(
+            std::string("risk_rejections.") + risk_check_to_string(static_cast<RiskCheck>(i)));
+    }
+}
+
+void RiskGate::set_default_limits(const RiskLimits& limits) {
+    store_limits(defaults_, limits);
+}
+
+void RiskGate::set_limits(InstrumentId id, const RiskLimits& limits) {
+    InstrumentState* instrument = state(id);
+    if (!instrument) {
+        return;
+    }
+
+    store_limits(*instrument, limits);
+    instrument->has_limits.store(true, std::memory_order_release);
+}
+
+bool RiskGate::set_limits(std::string_view instrument_name, const RiskLimits& limits) {
+    InstrumentId id = instrument_id(instrument_name);
+    if (!state(id)) {
+        return false;
+    }
+
+    set_limits(id, limits);
+    return true;
+}
+
+void RiskGate::set_max_orders_per_second(uint32_t max_orders) {
+    max_orders_per_second_.store(max_orders, std::memory_order_relaxed);
+}
+
+void RiskGate::set_max_market_age(std::chrono::milliseconds max_age) {
+    max_market_age_ns_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(max_age).count(),
+                             std::memory_order_relaxed);
+}
+
+void RiskGate::update_position(InstrumentId id, double size) {
+    InstrumentState* instrument = state(id);
+    if (instrument) {
+        instrument->position.store(size, std::memory_order_relaxed);
+    }
+}
+
+void RiskGate::update_position(std::string_view instrument_name, double size) {
+    update_position(instrument_id(instrument_name), size);
+}
+
+void RiskGate::update_market(InstrumentId id, double best_bid, double best_ask) {
+    InstrumentState* instrument = state(id);
+    if (instrument) {
+        instrument->best_bid.store(best_bid, std::memory_order_relaxed);
+        instrument->best_ask.store(best_ask, std::memory_order_relaxed);
+        instrument->market_updated_ns.store(steady_now_ns(), std::memory_order_relaxed);
+    }
+}
+
+void RiskGate::update_market(std::string_view instrument_name, double best_bid, double best_ask) {
+    update_market(instrument_id(instrument_name), best_bid, best_ask);
+}
+
+void RiskGate::clear_market() {
+    for (size_t id = 0; id < max_instruments_; ++id) {
+        instruments_[id].best_bid.store(0.0, std::memory_order_relaxed);
+        instruments_[id].best_ask.store(0.0, std::memory_order_relaxed);
+    }
+}
+
+RiskCheck RiskGate::check(InstrumentId id, OrderDirection direction, double amount, double price) {
+    auto tracking_id = tracker_->start();
+
+    RiskCheck result = evaluate(id, direction, amount, price);
+    if (result != RiskCheck::ACCEPTED) {
+        rejection_counters_[static_cast<int>(result)]->add();
+    }
+
+    tracker_->end(tracking_id);
+    return result;
+}
+
+RiskCheck RiskGate::check(std::string_view instrument_name, OrderDirection direction, double amount, double price) {
+    return check(instrument_id(instrument_name), direction, amount, price);
+}
+
+InstrumentId RiskGate::instrument_id(std::string_view instrument_name) const {
+    return registry_ ? registry_->find_id(instrument_name) : INVALID_INSTRUMENT_ID;
+}
+
+RiskGate::InstrumentState* RiskGate::state(InstrumentId id) {
+    return id < max_instruments_ ? &instruments_[id] : nullptr;
+}
+
+void RiskGate::store_limits(InstrumentState& state, const RiskLimits& limits) {
+    state.max_order_amount.store(limits.max_order_amount, std::memory_order_relaxed);
+    state.max_notional.store(limits.max_notional, std::memory_order_relaxed);
+    state.max_position.store(limits.max_position, std::memory_order_relaxed);
+    state.price_band.store(limits.price_band, std::memory_order_relaxed);
+}
+
+RiskCheck RiskGate::evaluate(InstrumentId id, OrderDirection direction, double amount, double price) {
+    InstrumentState* instrument = state(id);
+    const InstrumentState& limits =
+        instrument && instrument->has_limits.load(std::memory_order_acquire) ? *instrument : defaults_;
+
+    double max_order_amount = limits.max_order_amount.load(std::memory_order_relaxed);
+    if (max_order_amount > 0.0 && amount > max_order_amount) {
+        return RiskCheck::ORDER_AMOUNT;
+    }
+
+    // Market orders are valued at the far side of the book when it is known and fresh
+    double best_bid = instrument ? instrument->best_bid.load(std::memory_order_relaxed) : 0.0;
+    double best_ask = instrument ? instrument->best_ask.load(std::memory_order_relaxed) : 0.0;
+    int64_t max_market_age = max_market_age_ns_.load(std::memory_order_relaxed);
+    if (instrument && max_market_age > 0 && (best_bid > 0.0 || best_ask > 0.0) &&
+        steady_now_ns() - instrument->market_updated_ns.load(std::memory_order_relaxed) > max_market_age) {
+        best_bid = 0.0;
+        best_ask = 0.0;
+    }
+    double reference = price > 0.0 ? price : (direction == OrderDirection::BUY ? best_ask : best_bid);
+
+    // Without a fresh far side a market order's value is unknown, so it fails closed
+    double max_notional = limits.max_notional.load(std::memory_order_relaxed);
+    if (max_notional > 0.0 && reference <= 0.0) {
+        return RiskCheck::NO_REFERENCE;
+    }
+    if (max_notional > 0.0 && amount * reference > max_notional) {
+        return RiskCheck::NOTIONAL;
+    }
+
+    if (instrument) {
+        double max_position = limits.max_position.load(std::memory_order_relaxed);
+        if (max_position > 0.0) {
+            double position = instrument->position.load(std::memory_order_relaxed);
+            double projected = position + (direction == OrderDirection::BUY ? amount : -amount);
+
+            // Orders that reduce an oversized position are always allowed
+            if (std::fabs(projected) > max_position && std::fabs(projected) > std::fabs(position)) {
+                return RiskCheck::POSITION;
+            }
+        }
+
+        double price_band = limits.price_band.load(std::memory_order_relaxed);
+        if (price_band > 0.0 && price > 0.0 && best_bid > 0.0 && best_ask > 0.0) {
+            double mid = (best_bid + best_ask) * 0.5;
+            if (std::fabs(price - mid) > price_band * mid) {
+                return RiskCheck::PRICE_BAND;
+            }
+        }
+    }
+
+    if (!take_rate_slot()) {
+        return RiskCheck::ORDER_RATE;
+    }
+
+    return RiskCheck::ACCEPTED;
+}
+
+bool RiskGate::take_rate_slot() {
+    uint32_t max_orders = max_orders_per_second_.load(std::memory_order_relaxed);
+    if (max_orders == 0) {
+        return true;
+    }
+
+    // The first order after the window expires opens a new one
+    int64_t now = steady_now_ns();
+    int64_t window_start = rate_window_start_ns_.load(std::memory_order_relaxed);
+    if (now - window_start >= RATE_WINDOW_NS &&
+        rate_window_start_ns_.compare_exchange_strong(window_start, now, std::memory_order_relaxed)) {
+        rate_window_count_.store(0, std::memory_order_relaxed);
+    }
+
+    return rate_window_count_.fetch_add(1, std::memory_order_relaxed) < max_orders;
+}
+
+} // namespace deribit
\ No newline at end of file
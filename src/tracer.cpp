@@ -0,0 +1,176 @@
+#include "tracer.h"
+#include <algorithm>
+#include <chrono>
+
+namespace deribit {
+
+namespace {
+
+// Trace open on this thread, if any
+thread_local TraceRecord current_trace;
+thread_local bool trace_open = false;
+
+} // namespace
+
+const char* trace_stage_to_string(TraceStage stage) {
+    switch (stage) {
+        case TraceStage::RECEIVE:
+            return "receive";
+        case TraceStage::DEQUEUE:
+            return "dequeue";
+        case TraceStage::DECODE:
+            return "decode";
+        case TraceStage::BOOK_APPLIED:
+            return "book_applied";
+        case TraceStage::PUBLISHED:
+            return "published";
+        case TraceStage::ORDER_SENT:
+            return "order_sent";
+        case TraceStage::COMPLETE:
+            return "complete";
+        default:
+            return "unknown";
+    }
+}
+
+Tracer& Tracer::instance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer()
+    : records_(RECORD_CAPACITY) {
+    auto& monitor = PerformanceMonitor::instance();
+
+    for (size_t i = 1; i < TRACE_STAGE_COUNT; ++i) {
+        stage_trackers_[i] = monitor.get_tracker(
+            std::string("trace.") + trace_stage_to_string(static_cast<TraceStage>(i)), true);
+    }
+
+    total_tracker_ = monitor.get_tracker("trace.total", true);
+    tick_to_trade_tracker_ = monitor.get_tracker("trace.tick_to_trade", true);
+    network_tracker_ = monitor.get_tracker("trace.network", true);
+}
+
+void Tracer::set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::is_enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+void Tracer::set_record_interval(uint32_t interval) {
+    record_interval_.store(interval, std::memory_order_relaxed);
+}
+
+void Tracer::begin(int64_t received_ns, int64_t received_wall_ns) {
+    trace_open = enabled_.load(std::memory_order_relaxed);
+    if (!trace_open) {
+        return;
+    }
+
+    current_trace = TraceRecord();
+    current_trace.trace_id = next_trace_id_.fetch_add(1, std::memory_order_relaxed);
+    current_trace.received_wall_ns = received_wall_ns;
+    current_trace.stamps[static_cast<size_t>(TraceStage::RECEIVE)] = received_ns;
+    current_trace.stamps[static_cast<size_t>(TraceStage::DEQUEUE)] = steady_now_ns();
+}
+
+void Tracer::end() {
+    if (!trace_open) {
+        return;
+    }
+
+    trace_open = false;
+    TraceRecord& trace = current_trace;
+    trace.stamps[static_cast<size_t>(TraceStage::COMPLETE)] = steady_now_ns();
+
+    // Each stage is timed from the latest earlier stage reached before it
+    for (size_t i = 1; i < TRACE_STAGE_COUNT; ++i) {
+        int64_t stamp = trace.stamps[i];
+        if (stamp == 0) {
+            continue;
+        }
+
+        int64_t previous = 0;
+        for (size_t j = 0; j < i; ++j) {
+            if (trace.stamps[j] != 0 && trace.stamps[j] <= stamp) {
+                previous = std::max(previous, trace.stamps[j]);
+            }
+        }
+
+        if (previous != 0) {
+            stage_trackers_[i]->record(std::chrono::nanoseconds(stamp - previous));
+        }
+    }
+
+    total_tracker_->record(std::chrono::nanoseconds(trace.since_receive(TraceStage::COMPLETE)));
+
+    if (trace.at(TraceStage::ORDER_SENT) != 0) {
+        tick_to_trade_tracker_->record(std::chrono::nanoseconds(trace.since_receive(TraceStage::ORDER_SENT)));
+    }
+
+    // Clock skew can make the difference negative; such samples are dropped
+    if (trace.exchange_timestamp_ms > 0) {
+        int64_t network_ns = trace.received_wall_ns - trace.exchange_timestamp_ms * 1000000;
+        if (network_ns >= 0) {
+            network_tracker_->record(std::chrono::nanoseconds(network_ns));
+        }
+    }
+
+    uint32_t interval = record_interval_.load(std::memory_order_relaxed);
+    if (interval != 0 && trace.trace_id % interval == 0) {
+        std::lock_guard<std::mutex> lock(records_mutex_);
+        records_[records_next_] = trace;
+        records_next_ = (records_next_ + 1) % RECORD_CAPACITY;
+        records_size_ = std::min(records_size_ + 1, RECORD_CAPACITY);
+    }
+}
+
+void Tracer::mark(TraceStage stage) {
+    if (!trace_open) {
+        return;
+    }
+
+    int64_t& stamp = current_trace.stamps[static_cast<size_t>(stage)];
+    if (stamp == 0) {
+        stamp = steady_now_ns();
+    }
+}
+
+void Tracer::set_exchange_timestamp(int64_t timestamp_ms) {
+    if (trace_open) {
+        current_trace.exchange_timestamp_ms = timestamp_ms;
+    }
+}
+
+const TraceRecord* Tracer::current() {
+    return trace_open ? &current_trace : nullptr;
+}
+
+std::vector<TraceRecord> Tracer::recent_records() const {
+    std::lock_guard<std::mutex> lock(records_mutex_);
+
+    std::vector<TraceRecord> result;
+    result.reserve(records_size_);
+
+    size_t first = (records_next_ + RECORD_CAPACITY - records_size_) % RECORD_CAPACITY;
+    for (size_t i = 0; i < records_size_; ++i) {
+        result.push_back(records_[(first + i) % RECORD_CAPACITY]);
+    }
+
+    return result;
+}
+
+int64_t Tracer::steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t Tracer::wall_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace deribit
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "websocket_compression.h"
+#include <algorithm>
+
+namespace deribit {
+
+CompressionConfig clamp_compression_config(const CompressionConfig& config) {
+    CompressionConfig clamped = config;
+    clamped.level = std::clamp(config.level, 1, 9);
+    clamped.memory_level = std::clamp(config.memory_level, 1, 9);
+    clamped.max_window_bits = std::clamp<uint8_t>(config.max_window_bits, 9, 15);
+    return clamped;
+}
+
+bool is_deflate_available() {
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+
+namespace {
+
+thread_local const CompressionConfig* current_settings = nullptr;
+
+} // namespace
+
+DeflateSettingsScope::DeflateSettingsScope(const CompressionConfig* settings)
+    : previous_(current_settings) {
+    current_settings = settings;
+}
+
+DeflateSettingsScope::~DeflateSettingsScope() {
+    current_settings = previous_;
+}
+
+const CompressionConfig* DeflateSettingsScope::current() {
+    return current_settings;
+}
+
+#endif // DERIBIT_WS_PERMESSAGE_DEFLATE
+
+} // namespace deribit
\ No newline at end of file
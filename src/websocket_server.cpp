@@ -1,17 +1,121 @@
 #include "websocket_server.h"
 #include <iostream>
 #include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <unordered_set>
 #include "performance_monitor.h"
+#include "tracer.h"
+#include "market_data_codec.h"
+#include "binary_book_codec.h"
 
 namespace deribit {
 
+namespace {
+
+// OrderBook keeps the timestamp as text; binary messages carry the number
+int64_t parse_timestamp(const std::string& timestamp) {
+    return std::strtoll(timestamp.c_str(), nullptr, 10);
+}
+
+// Channels the server publishes from orderbook updates
+enum class ChannelKind {
+    OTHER,
+    ORDERBOOK,          // orderbook.<instrument>
+    ORDERBOOK_DEPTH,    // orderbook.<instrument>.<depth>.<interval>
+    TICKER              // ticker.<instrument>
+};
+
+struct ChannelSpec {
+    ChannelKind kind{ChannelKind::OTHER};
+    std::string instrument_name;
+    size_t depth{0};
+    std::chrono::milliseconds interval{0};
+};
+
+bool is_digits(const std::string& text) {
+    return !text.empty() && text.size() <= 9 && text.find_first_not_of("0123456789") == std::string::npos;
+}
+
+// Throws std::invalid_argument for a malformed derived channel; instrument names have no dots
+ChannelSpec parse_channel(const std::string& channel) {
+    ChannelSpec spec;
+    
+    if (channel.compare(0, 7, "ticker.") == 0) {
+        spec.instrument_name = channel.substr(7);
+        if (spec.instrument_name.empty() || spec.instrument_name.find('.') != std::string::npos) {
+            throw std::invalid_argument("Invalid ticker channel: " + channel);
+        }
+        spec.kind = ChannelKind::TICKER;
+        return spec;
+    }
+    
+    if (channel.compare(0, 10, "orderbook.") != 0) {
+        return spec;
+    }
+    
+    std::string rest = channel.substr(10);
+    size_t first_dot = rest.find('.');
+    if (first_dot == std::string::npos) {
+        spec.kind = ChannelKind::ORDERBOOK;
+        spec.instrument_name = rest;
+        return spec;
+    }
+    
+    size_t second_dot = rest.find('.', first_dot + 1);
+    if (first_dot == 0 || second_dot == std::string::npos || rest.find('.', second_dot + 1) != std::string::npos) {
+        throw std::invalid_argument("Invalid orderbook channel: " + channel);
+    }
+    
+    std::string depth = rest.substr(first_dot + 1, second_dot - first_dot - 1);
+    std::string interval = rest.substr(second_dot + 1);
+    
+    if (!is_digits(depth) || std::stoul(depth) == 0) {
+        throw std::invalid_argument("Invalid orderbook depth: " + channel);
+    }
+    
+    if (interval == "raw") {
+        spec.interval = std::chrono::milliseconds(0);
+    } else if (interval.size() > 2 && interval.compare(interval.size() - 2, 2, "ms") == 0 &&
+               is_digits(interval.substr(0, interval.size() - 2)) &&
+               std::stol(interval.substr(0, interval.size() - 2)) > 0) {
+        spec.interval = std::chrono::milliseconds(std::stol(interval.substr(0, interval.size() - 2)));
+    } else {
+        throw std::invalid_argument("Invalid orderbook interval: " + channel);
+    }
+    
+    spec.kind = ChannelKind::ORDERBOOK_DEPTH;
+    spec.instrument_name = rest.substr(0, first_dot);
+    spec.depth = std::stoul(depth);
+    return spec;
+}
+
+} // namespace
+
 WebSocketServer::WebSocketServer(std::shared_ptr<ApiClient> api_client,
                                std::shared_ptr<OrderManager> order_manager,
                                uint16_t port)
     : api_client_(api_client),
       order_manager_(order_manager),
       port_(port),
-      running_(false) {
+      running_(false),
+      handler_gate_(std::make_shared<HandlerGate>()),
+      message_manager_(std::make_shared<MessageManager>()) {
+    // Queue metrics
+    queued_messages_counter_ = PerformanceMonitor::instance().get_counter("ws_send_queue_depth");
+    max_queue_depth_counter_ = PerformanceMonitor::instance().get_counter("ws_send_queue_max_depth");
+    conflated_messages_counter_ = PerformanceMonitor::instance().get_counter("ws_messages_conflated");
+    dropped_messages_counter_ = PerformanceMonitor::instance().get_counter("ws_messages_dropped");
+    slow_consumer_counter_ = PerformanceMonitor::instance().get_counter("ws_slow_consumer_disconnects");
+    
+    // Traffic metrics
+    frames_sent_counter_ = PerformanceMonitor::instance().get_counter("ws_frames_sent");
+    bytes_sent_counter_ = PerformanceMonitor::instance().get_counter("ws_bytes_sent");
+    coalesced_messages_counter_ = PerformanceMonitor::instance().get_counter("ws_messages_coalesced");
+    fanout_tracker_ = PerformanceMonitor::instance().get_tracker("fanout_per_subscriber", true);
+    
     // Validate parameters
     if (!api_client_) {
         throw std::invalid_argument("API client cannot be null");
@@ -27,6 +131,17 @@ WebSocketServer::~WebSocketServer() {
     if (running_) {
         stop();
     }
+    
+    // Handlers still queued on a shared io_context must not reach the server
+    close_gate();
+}
+
+void WebSocketServer::set_thread_count(size_t count) {
+    thread_count_ = std::max<size_t>(1, count);
+}
+
+void WebSocketServer::set_io_context(boost::asio::io_context& io_context) {
+    external_io_context_ = &io_context;
 }
 
 bool WebSocketServer::initialize() {
@@ -38,13 +153,41 @@ bool WebSocketServer::initialize() {
         server_->set_access_channels(websocketpp::log::alevel::none);
         server_->set_error_channels(websocketpp::log::elevel::fatal);
         
-        // Initialize ASIO
-        server_->init_asio();
+        if (compression_config_.enabled && !is_deflate_available()) {
+            std::cerr << "permessage-deflate requested but not built in; "
+                      << "configure with -DWEBSOCKET_PERMESSAGE_DEFLATE=ON" << std::endl;
+        }
+        
+        // Initialize ASIO, on a shared io_context if one was given
+        if (external_io_context_) {
+            server_->init_asio(external_io_context_);
+        } else {
+            server_->init_asio();
+        }
+        
+        // Allow quick restarts on the same port
+        server_->set_reuse_addr(true);
+        
+        // Set handlers; connections keep copies, so they are gated against outliving the server
+        server_->set_open_handler(guarded([this](ConnectionHandle hdl) {
+            on_open(hdl);
+        }));
+        server_->set_close_handler(guarded([this](ConnectionHandle hdl) {
+            on_close(hdl);
+        }));
+        server_->set_message_handler(guarded([this](ConnectionHandle hdl, MessagePtr msg) {
+            on_message(hdl, msg);
+        }));
+        
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+        // Each connection negotiates compression with this server's settings, not another server's
+        auto deflate_settings = std::make_shared<const CompressionConfig>(compression_config_);
+        server_->set_tcp_pre_init_handler(guarded([this, deflate_settings](ConnectionHandle hdl) {
+            server_->get_con_from_hdl(hdl)->deflate_settings = deflate_settings;
+        }));
+#endif
         
-        // Set handlers
-        server_->set_open_handler(std::bind(&WebSocketServer::on_open, this, std::placeholders::_1));
-        server_->set_close_handler(std::bind(&WebSocketServer::on_close, this, std::placeholders::_1));
-        server_->set_message_handler(std::bind(&WebSocketServer::on_message, this, std::placeholders::_1, std::placeholders::_2));
+        drain_timer_ = std::make_unique<boost::asio::steady_timer>(server_->get_io_service());
         
         return true;
     } catch (const std::exception& e) {
@@ -65,17 +208,29 @@ bool WebSocketServer::start() {
         // Start accept loop
         server_->start_accept();
         
-        // Start server thread
-        server_thread_ = std::thread([this]() {
-            try {
-                server_->run();
-            } catch (const std::exception& e) {
-                std::cerr << "WebSocket server thread error: " << e.what() << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(handler_gate_->mutex);
+            handler_gate_->open = true;
+        }
+        
+        // Start server threads; websocketpp serializes each connection on its own strand
+        if (!external_io_context_) {
+            for (size_t i = 0; i < thread_count_; ++i) {
+                server_threads_.emplace_back([this]() {
+                    try {
+                        server_->run();
+                    } catch (const std::exception& e) {
+                        std::cerr << "WebSocket server thread error: " << e.what() << std::endl;
+                    }
+                });
             }
-        });
+        }
         
         running_ = true;
         
+        // Start draining outbound queues
+        schedule_drain();
+        
         std::cout << "WebSocket server started on port " << port_ << std::endl;
         
         return true;
@@ -91,15 +246,65 @@ void WebSocketServer::stop() {
     }
     
     try {
-        // Stop server
-        server_->stop();
+        running_ = false;
         
-        // Join server thread
-        if (server_thread_.joinable()) {
-            server_thread_.join();
+        if (external_io_context_) {
+            // The io_context belongs to someone else, so only shut down our own work
+            websocketpp::lib::error_code ec;
+            server_->stop_listening(ec);
+            
+            std::vector<ConnectionHandle> connections;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex_);
+                for (const auto& pair : connections_) {
+                    connections.push_back(pair.first);
+                }
+            }
+            
+            for (const auto& hdl : connections) {
+                server_->close(hdl, websocketpp::close::status::going_away, "Server stopping", ec);
+            }
+            
+            // Give the close handshakes a moment to finish
+            std::unique_lock<std::mutex> lock(connections_mutex_);
+            if (!connections_closed_.wait_for(lock, CLOSE_TIMEOUT, [this]() { return connections_.empty(); })) {
+                std::cerr << "Closing WebSocket server with " << connections_.size()
+                          << " connections still open" << std::endl;
+            }
+        } else {
+            // Stop server
+            server_->stop();
         }
         
-        running_ = false;
+        // Join server threads
+        for (auto& thread : server_threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+        server_threads_.clear();
+        
+        // Cancel our timers, then wait for any handler already running
+        if (drain_timer_) {
+            drain_timer_->cancel();
+        }
+        
+        std::vector<ConnectionStatePtr> states;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            for (const auto& pair : connections_) {
+                states.push_back(pair.second);
+            }
+        }
+        
+        for (const auto& state : states) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->batch_timer) {
+                state->batch_timer->cancel();
+            }
+        }
+        
+        close_gate();
         
         std::cout << "WebSocket server stopped" << std::endl;
     } catch (const std::exception& e) {
@@ -107,10 +312,67 @@ void WebSocketServer::stop() {
     }
 }
 
+void WebSocketServer::leave_gate(HandlerGate& gate) {
+    std::lock_guard<std::mutex> lock(gate.mutex);
+    if (--gate.running == 0) {
+        gate.idle.notify_all();
+    }
+}
+
+void WebSocketServer::close_gate() {
+    std::unique_lock<std::mutex> lock(handler_gate_->mutex);
+    handler_gate_->open = false;
+    handler_gate_->idle.wait(lock, [this]() { return handler_gate_->running == 0; });
+}
+
 bool WebSocketServer::is_running() const {
     return running_;
 }
 
+void WebSocketServer::set_send_queue_config(const SendQueueConfig& config) {
+    send_queue_config_ = config;
+}
+
+const SendQueueConfig& WebSocketServer::get_send_queue_config() const {
+    return send_queue_config_;
+}
+
+void WebSocketServer::set_compression_config(const CompressionConfig& config) {
+    compression_config_ = clamp_compression_config(config);
+}
+
+const CompressionConfig& WebSocketServer::get_compression_config() const {
+    return compression_config_;
+}
+
+void WebSocketServer::set_coalescing_config(const CoalescingConfig& config) {
+    coalescing_config_ = config;
+}
+
+const CoalescingConfig& WebSocketServer::get_coalescing_config() const {
+    return coalescing_config_;
+}
+
+void WebSocketServer::set_depth_channel_config(const DepthChannelConfig& config) {
+    depth_channel_config_ = config;
+}
+
+const DepthChannelConfig& WebSocketServer::get_depth_channel_config() const {
+    return depth_channel_config_;
+}
+
+void WebSocketServer::set_channel_prefixes(const std::vector<std::string>& prefixes) {
+    channel_prefixes_ = prefixes;
+}
+
+const std::vector<std::string>& WebSocketServer::get_channel_prefixes() const {
+    return channel_prefixes_;
+}
+
+void WebSocketServer::set_instrument_registry(std::shared_ptr<InstrumentRegistry> registry) {
+    instrument_registry_ = registry;
+}
+
 void WebSocketServer::set_open_callback(ConnectionCallback callback) {
     open_callback_ = callback;
 }
@@ -125,19 +387,25 @@ void WebSocketServer::set_message_callback(MessageCallback callback) {
 
 void WebSocketServer::broadcast(const std::string& message) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("broadcast_message", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("broadcast_message", true);
     auto tracking_id = tracker->start();
     
     try {
-        std::lock_guard<std::mutex> lock(connections_mutex_);
-        
-        for (auto& hdl : connections_) {
-            try {
-                server_->send(hdl, message, websocketpp::frame::opcode::text);
-            } catch (const std::exception& e) {
-                std::cerr << "Error sending message to client: " << e.what() << std::endl;
+        // Copy the connections so sends happen outside the lock
+        std::vector<ConnectionStatePtr> connections;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections.reserve(connections_.size());
+            for (const auto& pair : connections_) {
+                connections.push_back(pair.second);
             }
         }
+        
+        MessagePtr prepared = make_prepared_message(message);
+        
+        for (const auto& state : connections) {
+            enqueue(state, prepared, "");
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error broadcasting message: " << e.what() << std::endl;
     }
@@ -148,21 +416,22 @@ void WebSocketServer::broadcast(const std::string& message) {
 
 void WebSocketServer::broadcast_to_channel(const std::string& channel, const std::string& message) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("broadcast_to_channel", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("broadcast_to_channel", true);
     auto tracking_id = tracker->start();
     
     try {
-        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        // Take a snapshot of the subscriber list; the lock is not held while sending
+        ChannelSubscribers entry = find_subscribers(channel);
         
-        auto it = channel_subscriptions_.find(channel);
-        if (it != channel_subscriptions_.end()) {
-            for (auto& hdl : it->second) {
-                try {
-                    server_->send(hdl, message, websocketpp::frame::opcode::text);
-                } catch (const std::exception& e) {
-                    std::cerr << "Error sending message to client: " << e.what() << std::endl;
-                }
-            }
+        if (entry.subscribers && !entry.subscribers->empty()) {
+            // Only the newest book matters, so backed-up clients may skip older ones
+            static const std::string no_conflation;
+            const std::string& conflation_key =
+                channel.compare(0, 10, "orderbook.") == 0 || channel.compare(0, 7, "ticker.") == 0 ? channel
+                                                                                                   : no_conflation;
+            
+            // Frame once; every connection queues the same buffer
+            fan_out(*entry.subscribers, make_prepared_message(message), conflation_key);
         }
     } catch (const std::exception& e) {
         std::cerr << "Error broadcasting message to channel: " << e.what() << std::endl;
@@ -174,7 +443,14 @@ void WebSocketServer::broadcast_to_channel(const std::string& channel, const std
 
 void WebSocketServer::send(ConnectionHandle hdl, const std::string& message) {
     try {
-        server_->send(hdl, message, websocketpp::frame::opcode::text);
+        ConnectionStatePtr state = find_connection(hdl);
+        if (!state) {
+            std::cerr << "Error sending message to client: connection not open" << std::endl;
+            return;
+        }
+        
+        // Queue behind any pending broadcasts to keep per-connection ordering
+        enqueue(state, make_prepared_message(message), "");
     } catch (const std::exception& e) {
         std::cerr << "Error sending message to client: " << e.what() << std::endl;
     }
@@ -185,34 +461,83 @@ size_t WebSocketServer::get_connection_count() const {
     return connections_.size();
 }
 
+std::vector<ConnectionStats> WebSocketServer::get_connection_stats() const {
+    std::vector<ConnectionStatePtr> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.reserve(connections_.size());
+        for (const auto& pair : connections_) {
+            connections.push_back(pair.second);
+        }
+    }
+    
+    std::vector<ConnectionStats> stats;
+    stats.reserve(connections.size());
+    
+    for (const auto& state : connections) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->closing || !state->connection) {
+            continue;
+        }
+        
+        ConnectionStats entry;
+        entry.remote_endpoint = state->connection->get_remote_endpoint();
+        entry.frames_sent = state->frames_sent;
+        entry.bytes_sent = state->bytes_sent;
+        entry.messages_coalesced = state->messages_coalesced;
+        entry.queued_messages = state->queue.size();
+        entry.compressed = state->deflate;
+        entry.coalescing = state->coalesce;
+        stats.push_back(entry);
+    }
+    
+    return stats;
+}
+
 void WebSocketServer::handle_orderbook_update(const std::string& instrument_name, const OrderBook& orderbook) {
     // Start latency tracking
-    auto tracker = PerformanceMonitor::instance().get_tracker("handle_orderbook_update", true);
+    static auto tracker = PerformanceMonitor::instance().get_tracker("handle_orderbook_update", true);
     auto tracking_id = tracker->start();
     
     try {
-        // Create message
-        json message = {
-            {"type", "orderbook"},
-            {"instrument_name", instrument_name},
-            {"timestamp", orderbook.timestamp},
-            {"bids", json::array()},
-            {"asks", json::array()}
-        };
+        std::shared_ptr<PublishedBook> published = get_published_book(instrument_name);
+        const std::string& channel = published->book_channel;
+        
+        // Held across the fan-out so a binary subscriber's snapshot is never overtaken
+        std::lock_guard<std::mutex> lock(published->mutex);
+        
+        // An index into precomputed lists; patterns were matched when the book was created
+        ChannelSubscribers entry = get_subscribers(published->book_channel_id);
+        uint64_t sequence = published->sequence.load(std::memory_order_relaxed) + 1;
         
-        // Add bids
-        for (const auto& bid : orderbook.bids) {
-            message["bids"].push_back({bid.first, bid.second});
+        // Each encoding is only built when someone subscribed to it
+        if (entry.subscribers && !entry.subscribers->empty()) {
+            fan_out(*entry.subscribers, make_prepared_message(make_orderbook_message(instrument_name, orderbook)),
+                    channel);
         }
         
-        // Add asks
-        for (const auto& ask : orderbook.asks) {
-            message["asks"].push_back({ask.first, ask.second});
+        if (entry.binary_subscribers && !entry.binary_subscribers->empty()) {
+            published->binary_message.clear();
+            write_binary_book_delta(published->binary_message, instrument_name, sequence,
+                                    parse_timestamp(orderbook.timestamp),
+                                    published->book.bids, published->book.asks, orderbook.bids, orderbook.asks);
+            
+            // A conflated delta would leave a gap, so binary messages are always queued
+            static const std::string no_conflation;
+            fan_out(*entry.binary_subscribers,
+                    make_prepared_message(published->binary_message, websocketpp::frame::opcode::binary),
+                    no_conflation);
         }
         
-        // Broadcast to subscribers
-        std::string channel = "orderbook." + instrument_name;
-        broadcast_to_channel(channel, message.dump());
+        // Copy assignment reuses the level vectors' capacity
+        published->book = orderbook;
+        published->sequence.store(sequence, std::memory_order_relaxed);
+        
+        // Derived channels only send what their subscribers have not seen
+        publish_ticker(*published);
+        for (const auto& depth_channel : published->depth_channels) {
+            publish_depth(*published, *depth_channel);
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error handling orderbook update: " << e.what() << std::endl;
     }
@@ -221,12 +546,28 @@ void WebSocketServer::handle_orderbook_update(const std::string& instrument_name
     tracker->end(tracking_id);
 }
 
+uint64_t WebSocketServer::get_book_sequence(const std::string& instrument_name) const {
+    std::lock_guard<std::mutex> lock(published_books_mutex_);
+    
+    auto it = published_books_.find(instrument_name);
+    return it != published_books_.end() ? it->second->sequence.load(std::memory_order_relaxed) : 0;
+}
+
 void WebSocketServer::on_open(ConnectionHandle hdl) {
     try {
         // Add to connections
+        auto state = std::make_shared<ConnectionState>();
+        state->hdl = hdl;
+        state->connection = server_->get_con_from_hdl(hdl);
+        
+        // Compressed frames are built per connection, so these skip the shared prepared frame
+        state->deflate = is_deflate_available() &&
+            state->connection->get_response_header("Sec-WebSocket-Extensions").find("permessage-deflate") !=
+                std::string::npos;
+        
         {
             std::lock_guard<std::mutex> lock(connections_mutex_);
-            connections_.insert(hdl);
+            connections_[hdl] = state;
         }
         
         // Send welcome message
@@ -249,9 +590,26 @@ void WebSocketServer::on_open(ConnectionHandle hdl) {
 void WebSocketServer::on_close(ConnectionHandle hdl) {
     try {
         // Remove from connections
+        ConnectionStatePtr state;
         {
             std::lock_guard<std::mutex> lock(connections_mutex_);
-            connections_.erase(hdl);
+            auto it = connections_.find(hdl);
+            if (it != connections_.end()) {
+                state = it->second;
+                connections_.erase(it);
+            }
+            
+            if (connections_.empty()) {
+                connections_closed_.notify_all();
+            }
+        }
+        
+        // Drop anything still queued; broadcasts holding an old subscriber list skip it
+        if (state) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->closing = true;
+            discard_queue(*state);
+            state->connection.reset();
         }
         
         // Remove from subscriptions
@@ -288,71 +646,200 @@ void WebSocketServer::on_message(ConnectionHandle hdl, MessagePtr msg) {
     }
 }
 
-bool WebSocketServer::subscribe_client(ConnectionHandle hdl, const std::string& channel) {
+bool WebSocketServer::subscribe_client(ConnectionHandle hdl, const std::string& channel, bool binary) {
+    ConnectionStatePtr state = find_connection(hdl);
+    if (!state) {
+        return false;
+    }
+    
     std::lock_guard<std::mutex> lock(subscriptions_mutex_);
     
-    // Add to channel subscriptions
-    channel_subscriptions_[channel].insert(hdl);
+    // Add to connection subscriptions; subscribing again may switch the encoding
+    bool resubscribe = !connection_subscriptions_[hdl].insert(channel).second;
+    
+    // A pattern is matched once here; channels seen later match it in intern_channel()
+    if (ChannelRouter::is_pattern(channel)) {
+        if (resubscribe) {
+            return true;
+        }
+        
+        SubscriberList& subscribers = pattern_subscriptions_[channel];
+        subscribers.push_back(state);
+        router_.add_pattern(channel);
+        
+        for (ChannelId id : router_.match_channels(channel)) {
+            rebuild_subscribers(id);
+        }
+        
+        return true;
+    }
     
-    // Add to connection subscriptions
-    connection_subscriptions_[hdl].insert(channel);
+    if (resubscribe) {
+        remove_subscriber(channel, hdl);
+    }
+    
+    ChannelId id = intern_channel(channel);
+    ChannelEntry& entry = channels_[id];
+    (binary ? entry.binary : entry.exact).push_back(state);
+    rebuild_subscribers(id);
     
     return true;
 }
 
 bool WebSocketServer::unsubscribe_client(ConnectionHandle hdl, const std::string& channel) {
-    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-    
-    // Remove from channel subscriptions
-    auto channel_it = channel_subscriptions_.find(channel);
-    if (channel_it != channel_subscriptions_.end()) {
-        channel_it->second.erase(hdl);
+    std::vector<std::string> emptied;
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
         
-        // Remove channel if empty
-        if (channel_it->second.empty()) {
-            channel_subscriptions_.erase(channel_it);
+        // Remove from channel subscriptions
+        if (remove_subscriber(channel, hdl)) {
+            emptied.push_back(channel);
         }
-    }
-    
-    // Remove from connection subscriptions
-    auto connection_it = connection_subscriptions_.find(hdl);
-    if (connection_it != connection_subscriptions_.end()) {
-        connection_it->second.erase(channel);
         
-        // Remove connection if empty
-        if (connection_it->second.empty()) {
-            connection_subscriptions_.erase(connection_it);
+        // Remove from connection subscriptions
+        auto connection_it = connection_subscriptions_.find(hdl);
+        if (connection_it != connection_subscriptions_.end()) {
+            connection_it->second.erase(channel);
+            
+            // Remove connection if empty
+            if (connection_it->second.empty()) {
+                connection_subscriptions_.erase(connection_it);
+            }
         }
     }
     
+    // Released after the subscriptions lock, which ranks below the books' locks
+    release_depth_channels(emptied);
+    
     return true;
 }
 
 void WebSocketServer::unsubscribe_all(ConnectionHandle hdl) {
-    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
-    
-    // Get channels for this connection
-    auto connection_it = connection_subscriptions_.find(hdl);
-    if (connection_it != connection_subscriptions_.end()) {
-        // Copy channels to avoid iterator invalidation
-        std::set<std::string> channels = connection_it->second;
-        
-        // Remove from each channel
-        for (const auto& channel : channels) {
-            auto channel_it = channel_subscriptions_.find(channel);
-            if (channel_it != channel_subscriptions_.end()) {
-                channel_it->second.erase(hdl);
-                
-                // Remove channel if empty
-                if (channel_it->second.empty()) {
-                    channel_subscriptions_.erase(channel_it);
+    std::vector<std::string> emptied;
+    {
+        std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+        
+        // Get channels for this connection
+        auto connection_it = connection_subscriptions_.find(hdl);
+        if (connection_it != connection_subscriptions_.end()) {
+            // Remove from each channel
+            for (const auto& channel : connection_it->second) {
+                if (remove_subscriber(channel, hdl)) {
+                    emptied.push_back(channel);
                 }
             }
+            
+            // Remove connection subscriptions
+            connection_subscriptions_.erase(connection_it);
+        }
+    }
+    
+    release_depth_channels(emptied);
+}
+
+bool WebSocketServer::remove_subscriber(const std::string& channel, ConnectionHandle hdl) {
+    std::owner_less<ConnectionHandle> less;
+    auto remove = [&](SubscriberList& list) {
+        list.erase(std::remove_if(list.begin(), list.end(),
+                                  [&](const ConnectionStatePtr& subscriber) {
+                                      return !less(subscriber->hdl, hdl) && !less(hdl, subscriber->hdl);
+                                  }),
+                   list.end());
+    };
+    
+    if (ChannelRouter::is_pattern(channel)) {
+        auto pattern_it = pattern_subscriptions_.find(channel);
+        if (pattern_it == pattern_subscriptions_.end()) {
+            return false;
+        }
+        
+        remove(pattern_it->second);
+        
+        // Remove pattern if empty
+        if (pattern_it->second.empty()) {
+            pattern_subscriptions_.erase(pattern_it);
+            router_.remove_pattern(channel);
+        }
+        
+        for (ChannelId id : router_.match_channels(channel)) {
+            rebuild_subscribers(id);
+            release_channel(id);
+        }
+        
+        return false;
+    }
+    
+    ChannelId id = router_.find(channel);
+    if (id == INVALID_CHANNEL_ID) {
+        return false;
+    }
+    
+    ChannelEntry& entry = channels_[id];
+    remove(entry.exact);
+    remove(entry.binary);
+    rebuild_subscribers(id);
+    
+    // Tells the caller the channel has no direct subscribers left
+    bool emptied = entry.exact.empty() && entry.binary.empty();
+    release_channel(id);
+    
+    return emptied;
+}
+
+ChannelId WebSocketServer::intern_channel(const std::string& channel) {
+    ChannelId id = router_.find(channel);
+    if (id != INVALID_CHANNEL_ID) {
+        return id;
+    }
+    
+    // A new channel picks up the subscribers of the patterns matching it; it may
+    // reuse the id, and so the entry, of a released one
+    id = router_.intern(channel);
+    if (id == channels_.size()) {
+        channels_.emplace_back();
+    }
+    rebuild_subscribers(id);
+    
+    return id;
+}
+
+void WebSocketServer::release_channel(ChannelId id) {
+    ChannelEntry& entry = channels_[id];
+    if (entry.held || entry.published.subscribers || entry.published.binary_subscribers) {
+        return;
+    }
+    
+    entry = ChannelEntry();
+    router_.release(id);
+}
+
+void WebSocketServer::rebuild_subscribers(ChannelId id) {
+    ChannelEntry& entry = channels_[id];
+    const std::string& channel = router_.name(id);
+    
+    // A connection matched by several subscriptions still gets each message once
+    auto subscribers = std::make_shared<SubscriberList>(entry.exact);
+    std::unordered_set<const ConnectionState*> seen;
+    for (const auto& subscriber : entry.exact) {
+        seen.insert(subscriber.get());
+    }
+    
+    for (const auto& pattern : router_.match_patterns(channel)) {
+        auto pattern_it = pattern_subscriptions_.find(pattern);
+        if (pattern_it == pattern_subscriptions_.end()) {
+            continue;
         }
         
-        // Remove connection subscriptions
-        connection_subscriptions_.erase(connection_it);
+        for (const auto& subscriber : pattern_it->second) {
+            if (seen.insert(subscriber.get()).second) {
+                subscribers->push_back(subscriber);
+            }
+        }
     }
+    
+    // Publish new lists; broadcasts in flight keep the old ones
+    entry.published.subscribers = subscribers->empty() ? nullptr : subscribers;
+    entry.published.binary_subscribers = entry.binary.empty() ? nullptr : std::make_shared<SubscriberList>(entry.binary);
 }
 
 void WebSocketServer::process_message(ConnectionHandle hdl, const std::string& message) {
@@ -371,6 +858,8 @@ void WebSocketServer::process_message(ConnectionHandle hdl, const std::string& m
             handle_subscribe_request(hdl, request);
         } else if (type == "unsubscribe") {
             handle_unsubscribe_request(hdl, request);
+        } else if (type == "configure") {
+            handle_configure_request(hdl, request);
         } else {
             throw std::invalid_argument("Unknown message type: " + type);
         }
@@ -386,9 +875,44 @@ void WebSocketServer::handle_subscribe_request(ConnectionHandle hdl, const json&
     }
     
     std::string channel = request["channel"];
+    std::string encoding = request.value("encoding", "json");
+    
+    if (encoding == "binary") {
+        handle_binary_subscribe_request(hdl, channel);
+        return;
+    }
+    
+    if (encoding != "json") {
+        throw std::invalid_argument("Unknown encoding: " + encoding);
+    }
+    
+    if (ChannelRouter::is_pattern(channel)) {
+        handle_pattern_subscribe_request(hdl, channel);
+        return;
+    }
     
-    // Subscribe client
-    if (subscribe_client(hdl, channel)) {
+    ChannelSpec spec = parse_channel(channel);
+    if (spec.kind != ChannelKind::OTHER) {
+        validate_instrument(spec.instrument_name);
+    } else {
+        validate_channel(channel);
+    }
+    
+    // Depth channels are computed per channel, so the first subscriber registers it; the
+    // book's lock keeps the channel from being released before the client is subscribed
+    bool subscribed = false;
+    if (spec.kind == ChannelKind::ORDERBOOK_DEPTH) {
+        validate_depth(channel, spec.depth, spec.interval);
+        
+        std::shared_ptr<PublishedBook> published = get_published_book(spec.instrument_name);
+        std::lock_guard<std::mutex> lock(published->mutex);
+        get_depth_channel(published, channel, spec.depth, spec.interval);
+        subscribed = subscribe_client(hdl, channel);
+    } else {
+        subscribed = subscribe_client(hdl, channel);
+    }
+    
+    if (subscribed) {
         // Send success response
         json response = {
             {"type", "subscribed"},
@@ -397,11 +921,9 @@ void WebSocketServer::handle_subscribe_request(ConnectionHandle hdl, const json&
         
         send(hdl, response.dump());
         
-        // If this is an orderbook channel, send initial orderbook
-        if (channel.substr(0, 10) == "orderbook.") {
-            std::string instrument_name = channel.substr(10);
-            OrderBook orderbook = order_manager_->get_orderbook(instrument_name);
-            handle_orderbook_update(instrument_name, orderbook);
+        // Only the new subscriber needs the initial book; later messages go to everyone
+        if (spec.kind != ChannelKind::OTHER) {
+            send_initial_book(hdl, channel, spec.instrument_name);
         }
     } else {
         // Send error response
@@ -414,6 +936,195 @@ void WebSocketServer::handle_subscribe_request(ConnectionHandle hdl, const json&
     }
 }
 
+void WebSocketServer::handle_pattern_subscribe_request(ConnectionHandle hdl, const std::string& pattern) {
+    ChannelSpec spec = parse_channel(pattern);
+    if (spec.kind != ChannelKind::ORDERBOOK && spec.kind != ChannelKind::TICKER) {
+        throw std::invalid_argument("Patterns are only supported on orderbook.<instrument> and ticker.<instrument> channels");
+    }
+    
+    if (!subscribe_client(hdl, pattern)) {
+        json error = {
+            {"type", "error"},
+            {"message", "Failed to subscribe to channel: " + pattern}
+        };
+        
+        send(hdl, error.dump());
+        return;
+    }
+    
+    std::vector<std::string> channels = get_matching_channels(pattern);
+    
+    json response = {
+        {"type", "subscribed"},
+        {"channel", pattern},
+        {"matched", channels.size()}
+    };
+    
+    send(hdl, response.dump());
+    
+    // Initial messages come from the last published books rather than one request per instrument
+    for (const auto& channel : channels) {
+        ChannelSpec matched = parse_channel(channel);
+        std::shared_ptr<PublishedBook> published = find_published_book(matched.instrument_name);
+        if (!published) {
+            continue;
+        }
+        
+        // Queued under the book's lock, as in send_initial_book()
+        std::lock_guard<std::mutex> lock(published->mutex);
+        if (published->sequence.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        
+        send(hdl, spec.kind == ChannelKind::TICKER ? make_ticker_message(matched.instrument_name, published->book)
+                                                   : make_orderbook_message(matched.instrument_name, published->book));
+    }
+}
+
+void WebSocketServer::handle_binary_subscribe_request(ConnectionHandle hdl, const std::string& channel) {
+    ChannelSpec spec = parse_channel(channel);
+    if (spec.kind != ChannelKind::ORDERBOOK || ChannelRouter::is_pattern(channel)) {
+        throw std::invalid_argument("Binary encoding is only available on orderbook.<instrument> channels");
+    }
+    validate_instrument(spec.instrument_name);
+    
+    std::shared_ptr<PublishedBook> published = get_published_book(spec.instrument_name);
+    {
+        std::lock_guard<std::mutex> lock(published->mutex);
+        if (published->sequence.load(std::memory_order_relaxed) > 0) {
+            subscribe_binary(hdl, channel, *published);
+            return;
+        }
+    }
+    
+    // Nothing to base deltas on yet; the client is subscribed once the book arrives
+    request_initial_book(hdl, channel, spec.instrument_name, true);
+}
+
+void WebSocketServer::subscribe_binary(ConnectionHandle hdl, const std::string& channel, PublishedBook& published) {
+    // Queue the snapshot before the next delta can reach this connection
+    if (!subscribe_client(hdl, channel, true)) {
+        json error = {
+            {"type", "error"},
+            {"message", "Failed to subscribe to channel: " + channel}
+        };
+        
+        send(hdl, error.dump());
+        return;
+    }
+    
+    json response = {
+        {"type", "subscribed"},
+        {"channel", channel},
+        {"encoding", "binary"}
+    };
+    
+    send(hdl, response.dump());
+    
+    std::string snapshot;
+    write_binary_book_snapshot(snapshot, published.instrument_name, published.sequence.load(std::memory_order_relaxed),
+                               parse_timestamp(published.book.timestamp), published.book.bids, published.book.asks);
+    
+    ConnectionStatePtr state = find_connection(hdl);
+    if (state) {
+        enqueue(state, make_prepared_message(snapshot, websocketpp::frame::opcode::binary), "");
+    }
+}
+
+void WebSocketServer::send_initial_book(ConnectionHandle hdl, const std::string& channel,
+                                        const std::string& instrument_name) {
+    // The last published book is the freshest and needs no request; it is queued under the
+    // book's lock so a newer update to the client, already subscribed, cannot go out first
+    std::shared_ptr<PublishedBook> published = find_published_book(instrument_name);
+    if (published) {
+        std::lock_guard<std::mutex> lock(published->mutex);
+        if (published->sequence.load(std::memory_order_relaxed) > 0) {
+            send(hdl, make_initial_message(channel, published->book, std::numeric_limits<size_t>::max()));
+            return;
+        }
+    }
+    
+    request_initial_book(hdl, channel, instrument_name, false);
+}
+
+void WebSocketServer::request_initial_book(ConnectionHandle hdl, const std::string& channel,
+                                           const std::string& instrument_name, bool binary) {
+    // Deep enough for every depth channel, so subscribers of one instrument share a request
+    size_t depth = INITIAL_BOOK_DEPTH;
+    for (size_t allowed : depth_channel_config_.depths) {
+        depth = std::max(depth, allowed);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(pending_books_mutex_);
+        std::vector<BookWaiter>& waiters = pending_books_[instrument_name];
+        waiters.push_back(BookWaiter{hdl, channel, binary});
+        if (waiters.size() > 1) {
+            return;
+        }
+    }
+    
+    // Served from the order manager's cache when it is fresh, otherwise fetched over REST; the
+    // reply runs on an ApiClient I/O thread, so the server thread never waits for it
+    order_manager_->get_orderbook_async(guarded([this, instrument_name](const OrderBook& orderbook) {
+        handle_initial_book(instrument_name, orderbook);
+    }), instrument_name, static_cast<int>(depth));
+}
+
+void WebSocketServer::handle_initial_book(const std::string& instrument_name, const OrderBook& orderbook) {
+    std::vector<BookWaiter> waiters;
+    {
+        std::lock_guard<std::mutex> lock(pending_books_mutex_);
+        auto it = pending_books_.find(instrument_name);
+        if (it == pending_books_.end()) {
+            return;
+        }
+        
+        waiters.swap(it->second);
+        pending_books_.erase(it);
+    }
+    
+    std::shared_ptr<PublishedBook> published = get_published_book(instrument_name);
+    std::lock_guard<std::mutex> lock(published->mutex);
+    
+    // A book published while the request was in flight is newer than the fetched one; otherwise
+    // the fetched book seeds the binary deltas
+    size_t max_depth = INITIAL_BOOK_DEPTH;
+    if (published->sequence.load(std::memory_order_relaxed) == 0) {
+        published->book = orderbook;
+    } else {
+        max_depth = std::numeric_limits<size_t>::max();
+    }
+    
+    for (const auto& waiter : waiters) {
+        if (waiter.binary) {
+            subscribe_binary(waiter.hdl, waiter.channel, *published);
+        } else if (is_subscribed(waiter.hdl, waiter.channel)) {
+            send(waiter.hdl, make_initial_message(waiter.channel, published->book, max_depth));
+        }
+    }
+}
+
+std::string WebSocketServer::make_initial_message(const std::string& channel, const OrderBook& orderbook,
+                                                  size_t max_depth) {
+    ChannelSpec spec = parse_channel(channel);
+    if (spec.kind == ChannelKind::TICKER) {
+        return make_ticker_message(spec.instrument_name, orderbook);
+    }
+    
+    // Depth channels, and orderbook channels served from a fetched book, send only the top levels
+    size_t depth = spec.kind == ChannelKind::ORDERBOOK_DEPTH ? std::min(spec.depth, max_depth) : max_depth;
+    if (orderbook.bids.size() <= depth && orderbook.asks.size() <= depth) {
+        return make_orderbook_message(spec.instrument_name, orderbook);
+    }
+    
+    OrderBook top;
+    top.timestamp = orderbook.timestamp;
+    top.bids.assign(orderbook.bids.begin(), orderbook.bids.begin() + std::min(depth, orderbook.bids.size()));
+    top.asks.assign(orderbook.asks.begin(), orderbook.asks.begin() + std::min(depth, orderbook.asks.size()));
+    return make_orderbook_message(spec.instrument_name, top);
+}
+
 void WebSocketServer::handle_unsubscribe_request(ConnectionHandle hdl, const json& request) {
     // Check required fields
     if (!request.contains("channel")) {
@@ -442,4 +1153,570 @@ void WebSocketServer::handle_unsubscribe_request(ConnectionHandle hdl, const jso
     }
 }
 
+void WebSocketServer::handle_configure_request(ConnectionHandle hdl, const json& request) {
+    ConnectionStatePtr state = find_connection(hdl);
+    if (!state) {
+        return;
+    }
+    
+    bool coalesce = false;
+    bool compressed = false;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        
+        // Coalescing stays off unless the server has a window for it
+        if (request.contains("coalesce")) {
+            state->coalesce = request["coalesce"].get<bool>() && coalescing_config_.window.count() > 0;
+            
+            if (state->coalesce && !state->batch_timer) {
+                state->batch_timer = std::make_unique<boost::asio::steady_timer>(server_->get_io_service());
+            } else if (!state->coalesce) {
+                flush_batch(*state);
+            }
+        }
+        
+        coalesce = state->coalesce;
+        compressed = state->deflate;
+    }
+    
+    json response = {
+        {"type", "configured"},
+        {"coalesce", coalesce},
+        {"compressed", compressed}
+    };
+    
+    send(hdl, response.dump());
+}
+
+std::string WebSocketServer::make_orderbook_message(const std::string& instrument_name, const OrderBook& orderbook) {
+    // Written directly; building a json tree per update costs an allocation per level
+    std::string message;
+    write_orderbook_message(message, instrument_name, orderbook.timestamp, orderbook.bids, orderbook.asks);
+    return message;
+}
+
+std::string WebSocketServer::make_ticker_message(const std::string& instrument_name, const OrderBook& orderbook) {
+    std::string message;
+    write_ticker_message(message, instrument_name, orderbook.timestamp,
+                         orderbook.bids.empty() ? nullptr : &orderbook.bids.front(),
+                         orderbook.asks.empty() ? nullptr : &orderbook.asks.front());
+    return message;
+}
+
+WebSocketServer::ConnectionStatePtr WebSocketServer::find_connection(ConnectionHandle hdl) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    
+    auto it = connections_.find(hdl);
+    return it != connections_.end() ? it->second : nullptr;
+}
+
+bool WebSocketServer::is_subscribed(ConnectionHandle hdl, const std::string& channel) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    auto it = connection_subscriptions_.find(hdl);
+    return it != connection_subscriptions_.end() && it->second.count(channel) > 0;
+}
+
+WebSocketServer::ChannelSubscribers WebSocketServer::get_subscribers(ChannelId id) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    return id < channels_.size() ? channels_[id].published : ChannelSubscribers();
+}
+
+std::vector<std::string> WebSocketServer::get_matching_channels(const std::string& pattern) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    std::vector<std::string> channels;
+    for (ChannelId id : router_.match_channels(pattern)) {
+        channels.push_back(router_.name(id));
+    }
+    
+    return channels;
+}
+
+WebSocketServer::ChannelSubscribers WebSocketServer::find_subscribers(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    // Nobody subscribed by name, but a pattern may still match a channel not seen before
+    ChannelId id = router_.find(channel);
+    if (id == INVALID_CHANNEL_ID) {
+        if (router_.match_patterns(channel).empty()) {
+            return ChannelSubscribers();
+        }
+        id = intern_channel(channel);
+    }
+    
+    return channels_[id].published;
+}
+
+ChannelId WebSocketServer::hold_channel(const std::string& channel) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    // Kept, and its id stays valid, until drop_channel()
+    ChannelId id = intern_channel(channel);
+    channels_[id].held = true;
+    return id;
+}
+
+void WebSocketServer::drop_channel(ChannelId id) {
+    std::lock_guard<std::mutex> lock(subscriptions_mutex_);
+    
+    channels_[id].held = false;
+    release_channel(id);
+}
+
+std::shared_ptr<WebSocketServer::PublishedBook> WebSocketServer::get_published_book(const std::string& instrument_name) {
+    std::lock_guard<std::mutex> lock(published_books_mutex_);
+    
+    auto& published = published_books_[instrument_name];
+    if (!published) {
+        published = std::make_shared<PublishedBook>();
+        published->instrument_name = instrument_name;
+        published->book_channel = "orderbook." + instrument_name;
+        published->ticker_channel = "ticker." + instrument_name;
+        
+        // A new instrument is where pattern subscriptions pick it up
+        published->book_channel_id = hold_channel(published->book_channel);
+        published->ticker_channel_id = hold_channel(published->ticker_channel);
+    }
+    
+    return published;
+}
+
+std::shared_ptr<WebSocketServer::PublishedBook> WebSocketServer::find_published_book(
+    const std::string& instrument_name) const {
+    std::lock_guard<std::mutex> lock(published_books_mutex_);
+    
+    auto it = published_books_.find(instrument_name);
+    return it != published_books_.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<WebSocketServer::DepthChannel> WebSocketServer::get_depth_channel(
+    const std::shared_ptr<PublishedBook>& published, const std::string& channel, size_t depth,
+    std::chrono::milliseconds interval) {
+    for (const auto& depth_channel : published->depth_channels) {
+        if (depth_channel->channel == channel) {
+            return depth_channel;
+        }
+    }
+    
+    // Kept until release_depth_channels() sees its last subscriber leave
+    auto depth_channel = std::make_shared<DepthChannel>();
+    depth_channel->channel = channel;
+    depth_channel->id = hold_channel(channel);
+    depth_channel->depth = depth;
+    depth_channel->interval = interval;
+    published->depth_channels.push_back(depth_channel);
+    
+    // Subscribers start from the published book, so only changes to its top are sent
+    if (published->sequence.load(std::memory_order_relaxed) > 0) {
+        const OrderBook& book = published->book;
+        depth_channel->bids.assign(book.bids.begin(), book.bids.begin() + std::min(depth, book.bids.size()));
+        depth_channel->asks.assign(book.asks.begin(), book.asks.begin() + std::min(depth, book.asks.size()));
+    }
+    
+    if (interval.count() > 0) {
+        std::lock_guard<std::mutex> throttled_lock(throttled_channels_mutex_);
+        throttled_channels_.emplace_back(published, depth_channel);
+    }
+    
+    return depth_channel;
+}
+
+void WebSocketServer::validate_instrument(const std::string& instrument_name) const {
+    // An empty registry has not been loaded yet and vouches for nothing
+    if (instrument_registry_ && instrument_registry_->size() > 0 &&
+        instrument_registry_->find_id(instrument_name) == INVALID_INSTRUMENT_ID) {
+        throw std::invalid_argument("Unknown instrument: " + instrument_name);
+    }
+}
+
+void WebSocketServer::validate_channel(const std::string& channel) const {
+    // Every name subscribed to is kept while subscribed, so arbitrary ones are refused
+    for (const auto& prefix : channel_prefixes_) {
+        if (channel.size() > prefix.size() && channel.compare(0, prefix.size(), prefix) == 0) {
+            return;
+        }
+    }
+    
+    throw std::invalid_argument("Unknown channel: " + channel);
+}
+
+void WebSocketServer::validate_depth(const std::string& channel, size_t depth,
+                                     std::chrono::milliseconds interval) const {
+    const auto& depths = depth_channel_config_.depths;
+    if (std::find(depths.begin(), depths.end(), depth) == depths.end()) {
+        throw std::invalid_argument("Unsupported orderbook depth: " + channel);
+    }
+    
+    const auto& intervals = depth_channel_config_.intervals;
+    if (std::find(intervals.begin(), intervals.end(), interval) == intervals.end()) {
+        throw std::invalid_argument("Unsupported orderbook interval: " + channel);
+    }
+}
+
+void WebSocketServer::release_depth_channels(const std::vector<std::string>& channels) {
+    for (const auto& channel : channels) {
+        ChannelSpec spec = parse_channel(channel);
+        if (spec.kind != ChannelKind::ORDERBOOK_DEPTH) {
+            continue;
+        }
+        
+        std::shared_ptr<PublishedBook> published = find_published_book(spec.instrument_name);
+        if (!published) {
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> lock(published->mutex);
+        
+        auto& depth_channels = published->depth_channels;
+        auto it = std::find_if(depth_channels.begin(), depth_channels.end(),
+                               [&](const std::shared_ptr<DepthChannel>& depth_channel) {
+                                   return depth_channel->channel == channel;
+                               });
+        if (it == depth_channels.end()) {
+            continue;
+        }
+        
+        // Someone may have subscribed again since the lists were emptied
+        ChannelSubscribers entry = get_subscribers((*it)->id);
+        if (entry.subscribers && !entry.subscribers->empty()) {
+            continue;
+        }
+        
+        std::shared_ptr<DepthChannel> depth_channel = *it;
+        depth_channels.erase(it);
+        drop_channel(depth_channel->id);
+        
+        if (depth_channel->interval.count() > 0) {
+            std::lock_guard<std::mutex> throttled_lock(throttled_channels_mutex_);
+            throttled_channels_.erase(std::remove_if(throttled_channels_.begin(), throttled_channels_.end(),
+                                                     [&](const ThrottledChannel& throttled) {
+                                                         return throttled.second == depth_channel;
+                                                     }),
+                                      throttled_channels_.end());
+        }
+    }
+}
+
+void WebSocketServer::publish_ticker(PublishedBook& published) {
+    const OrderBook& book = published.book;
+    std::pair<double, double> bid = book.bids.empty() ? std::make_pair(0.0, 0.0) : book.bids.front();
+    std::pair<double, double> ask = book.asks.empty() ? std::make_pair(0.0, 0.0) : book.asks.front();
+    
+    // Deeper levels moving does not concern ticker subscribers
+    if (published.ticker_sent && bid == published.ticker_bid && ask == published.ticker_ask) {
+        return;
+    }
+    
+    // Tracked without subscribers too, so the first one is not sent an unchanged top
+    published.ticker_sent = true;
+    published.ticker_bid = bid;
+    published.ticker_ask = ask;
+    
+    ChannelSubscribers entry = get_subscribers(published.ticker_channel_id);
+    if (!entry.subscribers || entry.subscribers->empty()) {
+        return;
+    }
+    
+    fan_out(*entry.subscribers, make_prepared_message(make_ticker_message(published.instrument_name, book)),
+            published.ticker_channel);
+}
+
+void WebSocketServer::publish_depth(PublishedBook& published, DepthChannel& depth_channel) {
+    ChannelSubscribers entry = get_subscribers(depth_channel.id);
+    if (!entry.subscribers || entry.subscribers->empty()) {
+        depth_channel.pending = false;
+        return;
+    }
+    
+    const OrderBook& book = published.book;
+    auto bids_end = book.bids.begin() + std::min(depth_channel.depth, book.bids.size());
+    auto asks_end = book.asks.begin() + std::min(depth_channel.depth, book.asks.size());
+    
+    // Only the top levels are compared, so changes deeper in the book are not sent
+    if (std::equal(book.bids.begin(), bids_end, depth_channel.bids.begin(), depth_channel.bids.end()) &&
+        std::equal(book.asks.begin(), asks_end, depth_channel.asks.begin(), depth_channel.asks.end())) {
+        depth_channel.pending = false;
+        return;
+    }
+    
+    // Within the interval the change waits for the drain pass
+    auto now = std::chrono::steady_clock::now();
+    if (depth_channel.interval.count() > 0 && now - depth_channel.last_sent < depth_channel.interval) {
+        depth_channel.pending = true;
+        return;
+    }
+    
+    depth_channel.bids.assign(book.bids.begin(), bids_end);
+    depth_channel.asks.assign(book.asks.begin(), asks_end);
+    depth_channel.last_sent = now;
+    depth_channel.pending = false;
+    
+    std::string message;
+    write_orderbook_message(message, published.instrument_name, book.timestamp,
+                            depth_channel.bids, depth_channel.asks);
+    
+    fan_out(*entry.subscribers, make_prepared_message(message), depth_channel.channel);
+}
+
+void WebSocketServer::publish_throttled() {
+    std::vector<ThrottledChannel> channels;
+    {
+        std::lock_guard<std::mutex> lock(throttled_channels_mutex_);
+        channels = throttled_channels_;
+    }
+    
+    for (const auto& entry : channels) {
+        std::lock_guard<std::mutex> lock(entry.first->mutex);
+        if (entry.second->pending) {
+            publish_depth(*entry.first, *entry.second);
+        }
+    }
+}
+
+WebSocketServer::MessagePtr WebSocketServer::make_prepared_message(const std::string& payload,
+                                                                   websocketpp::frame::opcode::value opcode) {
+    MessagePtr message = message_manager_->get_message(opcode, payload.size());
+    message->set_payload(payload);
+    
+    // Server frames are unmasked, so one header is valid on every connection
+    websocketpp::frame::basic_header header(opcode, payload.size(), true, false);
+    websocketpp::frame::extended_header extended_header(payload.size());
+    message->set_header(websocketpp::frame::prepare_header(header, extended_header));
+    message->set_prepared(true);
+    
+    return message;
+}
+
+void WebSocketServer::fan_out(const SubscriberList& subscribers, const MessagePtr& message,
+                              const std::string& conflation_key) {
+    auto fanout_start = std::chrono::steady_clock::now();
+    
+    for (const auto& state : subscribers) {
+        enqueue(state, message, conflation_key);
+    }
+    
+    auto fanout_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - fanout_start);
+    fanout_tracker_->record(fanout_time / subscribers.size());
+    Tracer::mark(TraceStage::PUBLISHED);
+}
+
+void WebSocketServer::enqueue(const ConnectionStatePtr& state, const MessagePtr& message, const std::string& channel) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    
+    if (state->closing) {
+        return;
+    }
+    
+    // Small text messages may share a frame while the client keeps up; a backed-up client conflates instead
+    if (state->coalesce && state->queue.empty() &&
+        message->get_opcode() == websocketpp::frame::opcode::text &&
+        message->get_payload().size() <= coalescing_config_.max_message_bytes) {
+        add_to_batch(state, message->get_payload());
+        return;
+    }
+    
+    // Anything else goes out behind what is already batched
+    flush_batch(*state);
+    queue_or_send(*state, message, channel);
+}
+
+void WebSocketServer::queue_or_send(ConnectionState& state, const MessagePtr& message, const std::string& channel) {
+    // Hand the message straight to websocketpp while the client keeps up
+    if (state.queue.empty() &&
+        state.connection->get_buffered_amount() < send_queue_config_.socket_buffer_limit) {
+        send_now(state, message);
+        return;
+    }
+    
+    size_t size = message->get_payload().size();
+    
+    // Past the high-water mark, replace the pending update for the same channel
+    if (!channel.empty() && state.queue.size() >= send_queue_config_.high_water_mark) {
+        auto it = state.latest_by_channel.find(channel);
+        if (it != state.latest_by_channel.end()) {
+            state.queued_bytes = state.queued_bytes - it->second->message->get_payload().size() + size;
+            it->second->message = message;
+            conflated_messages_counter_->add();
+            return;
+        }
+    }
+    
+    // A client this far behind is not going to catch up
+    if (state.queue.size() >= send_queue_config_.max_queued_messages ||
+        state.queued_bytes + size > send_queue_config_.max_queued_bytes) {
+        disconnect_slow_consumer(state);
+        return;
+    }
+    
+    state.queue.push_back(QueuedMessage{message, channel});
+    if (!channel.empty()) {
+        state.latest_by_channel[channel] = &state.queue.back();
+    }
+    state.queued_bytes += size;
+    
+    queued_messages_counter_->add();
+    max_queue_depth_counter_->update_max(static_cast<int64_t>(state.queue.size()));
+}
+
+void WebSocketServer::add_to_batch(const ConnectionStatePtr& state, const std::string& payload) {
+    if (state->batch_messages > 0) {
+        state->batch.push_back('\n');
+    }
+    state->batch.append(payload);
+    ++state->batch_messages;
+    
+    if (state->batch.size() >= coalescing_config_.max_batch_bytes) {
+        flush_batch(*state);
+        return;
+    }
+    
+    // The first message of a batch starts the window
+    if (state->batch_messages == 1) {
+        std::weak_ptr<ConnectionState> weak_state = state;
+        
+        state->batch_timer->expires_after(coalescing_config_.window);
+        state->batch_timer->async_wait(guarded([this, weak_state](const boost::system::error_code& ec) {
+            ConnectionStatePtr locked = weak_state.lock();
+            if (ec || !locked) {
+                return;
+            }
+            
+            std::lock_guard<std::mutex> lock(locked->mutex);
+            if (!locked->closing) {
+                flush_batch(*locked);
+            }
+        }));
+    }
+}
+
+void WebSocketServer::flush_batch(ConnectionState& state) {
+    if (state.batch_messages == 0) {
+        return;
+    }
+    
+    MessagePtr message = make_prepared_message(state.batch);
+    
+    uint64_t coalesced = state.batch_messages - 1;
+    state.messages_coalesced += coalesced;
+    coalesced_messages_counter_->add(static_cast<int64_t>(coalesced));
+    
+    state.batch.clear();
+    state.batch_messages = 0;
+    state.batch_timer->cancel();
+    
+    queue_or_send(state, message, "");
+}
+
+void WebSocketServer::drain(ConnectionState& state) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    
+    if (state.closing) {
+        return;
+    }
+    
+    while (!state.queue.empty() &&
+           state.connection->get_buffered_amount() < send_queue_config_.socket_buffer_limit) {
+        QueuedMessage& front = state.queue.front();
+        
+        // Forget the conflation slot if it points at this entry
+        if (!front.channel.empty()) {
+            auto it = state.latest_by_channel.find(front.channel);
+            if (it != state.latest_by_channel.end() && it->second == &front) {
+                state.latest_by_channel.erase(it);
+            }
+        }
+        
+        send_now(state, front.message);
+        
+        state.queued_bytes -= front.message->get_payload().size();
+        state.queue.pop_front();
+        queued_messages_counter_->add(-1);
+    }
+}
+
+void WebSocketServer::drain_all() {
+    std::vector<ConnectionStatePtr> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.reserve(connections_.size());
+        for (const auto& pair : connections_) {
+            connections.push_back(pair.second);
+        }
+    }
+    
+    for (const auto& state : connections) {
+        drain(*state);
+    }
+}
+
+void WebSocketServer::schedule_drain() {
+    // Our own timer rather than set_timer, whose handler runs through the endpoint
+    drain_timer_->expires_after(send_queue_config_.drain_interval);
+    drain_timer_->async_wait(guarded([this](const boost::system::error_code& ec) {
+        if (ec || !running_) {
+            return;
+        }
+        
+        try {
+            publish_throttled();
+            drain_all();
+        } catch (const std::exception& e) {
+            std::cerr << "Error draining send queues: " << e.what() << std::endl;
+        }
+        
+        schedule_drain();
+    }));
+}
+
+void WebSocketServer::send_now(ConnectionState& state, const MessagePtr& message) {
+    // websocketpp compresses unprepared messages with the connection's own deflate context
+    websocketpp::lib::error_code ec = state.deflate
+        ? state.connection->send(message->get_payload(), message->get_opcode())
+        : state.connection->send(message);
+    
+    size_t size = message->get_payload().size();
+    ++state.frames_sent;
+    state.bytes_sent += size;
+    frames_sent_counter_->add();
+    bytes_sent_counter_->add(static_cast<int64_t>(size));
+    
+    if (ec) {
+        std::cerr << "Error sending message to client: " << ec.message() << std::endl;
+    }
+}
+
+void WebSocketServer::disconnect_slow_consumer(ConnectionState& state) {
+    std::cerr << "Disconnecting slow WebSocket client " << state.connection->get_remote_endpoint()
+              << " with " << state.queue.size() << " queued messages" << std::endl;
+    
+    state.closing = true;
+    slow_consumer_counter_->add();
+    discard_queue(state);
+    
+    websocketpp::lib::error_code ec;
+    state.connection->close(websocketpp::close::status::policy_violation, "Slow consumer", ec);
+}
+
+void WebSocketServer::discard_queue(ConnectionState& state) {
+    int64_t dropped = static_cast<int64_t>(state.queue.size());
+    
+    dropped_messages_counter_->add(dropped);
+    queued_messages_counter_->add(-dropped);
+    
+    state.queue.clear();
+    state.latest_by_channel.clear();
+    state.queued_bytes = 0;
+    
+    // Batched messages are dropped too; the timer still holds only a weak reference
+    dropped_messages_counter_->add(static_cast<int64_t>(state.batch_messages));
+    state.batch.clear();
+    state.batch_messages = 0;
+    if (state.batch_timer) {
+        state.batch_timer->cancel();
+    }
+}
+
 } // namespace deribit
\ No newline at end of file
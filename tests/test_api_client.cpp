@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include <memory>
 #include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include "deribit_api_client.h"
 
 // Mock API credentials for testing
@@ -97,6 +101,29 @@ TEST_F(ApiClientTest, WebSocketConnection) {
     EXPECT_FALSE(api_client_->is_websocket_connected());
 }
 
+// Test WebSocket request without a connection
+TEST_F(ApiClientTest, WebSocketRequestNotConnected) {
+    // Request should fail immediately instead of waiting for the timeout
+    deribit::ApiResponse response = api_client_->websocket_request("public/test");
+    
+    // Check response
+    EXPECT_FALSE(response.success);
+    EXPECT_FALSE(response.error_message.empty());
+    EXPECT_FALSE(api_client_->is_websocket_authenticated());
+}
+
+// Test private requests before authentication
+TEST_F(ApiClientTest, PrivateRequestNotAuthenticated) {
+    api_client_->set_token_refresh_margin(std::chrono::seconds(30));
+    
+    // Fails without a round trip; the refresh thread idles until a token exists
+    deribit::ApiResponse response = api_client_->private_request("private/get_positions");
+    
+    EXPECT_FALSE(response.success);
+    EXPECT_EQ(response.error_message, "Not authenticated");
+    EXPECT_FALSE(api_client_->is_authenticated());
+}
+
 // Test subscription
 TEST_F(ApiClientTest, Subscription) {
     // Skip actual WebSocket connection in unit tests
@@ -123,6 +150,225 @@ TEST_F(ApiClientTest, Subscription) {
     api_client_->disconnect_websocket();
 }
 
+// Test starting and stopping the message thread with a spinning wait policy
+TEST_F(ApiClientTest, MessageQueueConfig) {
+    auto api_client = std::make_shared<deribit::ApiClient>(TEST_API_KEY, TEST_API_SECRET, true);
+    
+    deribit::MessageQueueConfig config;
+    config.capacity = 1024;
+    config.wait_policy = deribit::WaitPolicy::HYBRID;
+    config.spin_iterations = 100;
+    api_client->set_message_queue_config(config);
+    
+    EXPECT_TRUE(api_client->initialize());
+    
+    // Destruction must wake and join the message thread
+    api_client.reset();
+}
+
+// Test the connection pool can only be replaced before the client starts using it
+TEST_F(ApiClientTest, ConnectionPoolConfig) {
+    auto api_client = std::make_shared<deribit::ApiClient>(TEST_API_KEY, TEST_API_SECRET, true);
+    
+    deribit::ConnectionPoolConfig config;
+    config.pool_size = 2;
+    EXPECT_TRUE(api_client->set_connection_pool_config(config));
+    EXPECT_TRUE(api_client->initialize());
+    
+    // Request threads may be using the pool by now
+    EXPECT_FALSE(api_client->set_connection_pool_config(config));
+    EXPECT_FALSE(api_client_->set_connection_pool_config(config));
+    
+    api_client.reset();
+}
+
+// Test several pinned workers start and shut down
+TEST_F(ApiClientTest, ShardedWorkers) {
+    auto api_client = std::make_shared<deribit::ApiClient>(TEST_API_KEY, TEST_API_SECRET, true);
+    
+    deribit::MessageQueueConfig config;
+    config.worker_count = 4;
+    config.worker_cpus = {0};
+    api_client->set_message_queue_config(config);
+    
+    EXPECT_EQ(api_client->get_worker_count(), 4u);
+    EXPECT_TRUE(api_client->initialize());
+    
+    // Destruction must wake and join every worker
+    api_client.reset();
+}
+
+// Test channels of one instrument are assigned to the same worker
+TEST_F(ApiClientTest, ShardForChannel) {
+    auto api_client = std::make_shared<deribit::ApiClient>(TEST_API_KEY, TEST_API_SECRET, true);
+    
+    deribit::MessageQueueConfig config;
+    config.worker_count = 8;
+    api_client->set_message_queue_config(config);
+    
+    size_t shard = api_client->shard_for_channel("book.BTC-PERPETUAL.100ms");
+    EXPECT_LT(shard, 8u);
+    EXPECT_EQ(api_client->shard_for_channel("book.BTC-PERPETUAL.100ms"), shard);
+    EXPECT_EQ(api_client->shard_for_channel("trades.BTC-PERPETUAL.raw"), shard);
+    EXPECT_EQ(api_client->shard_for_channel("ticker.BTC-PERPETUAL.100ms"), shard);
+    
+    // A single worker serves everything
+    config.worker_count = 0;
+    api_client->set_message_queue_config(config);
+    EXPECT_EQ(api_client->get_worker_count(), 1u);
+    EXPECT_EQ(api_client->shard_for_channel("book.ETH-PERPETUAL.100ms"), 0u);
+}
+
+// Test typed subscriptions reject channels of the wrong kind
+TEST_F(ApiClientTest, TypedSubscriptionChannel) {
+    EXPECT_FALSE(api_client_->subscribe_book("trades.BTC-PERPETUAL.raw", [](const deribit::BookUpdate&) {}));
+    EXPECT_FALSE(api_client_->subscribe_trades("book.BTC-PERPETUAL.100ms",
+                                               [](const std::vector<deribit::TradeUpdate>&) {}));
+}
+
+// Test batch calls report every channel as failed while disconnected
+TEST_F(ApiClientTest, SubscribeManyDisconnected) {
+    std::vector<std::string> channels = {"book.BTC-PERPETUAL.100ms", "book.ETH-PERPETUAL.100ms"};
+    
+    deribit::SubscriptionResult result = api_client_->subscribe_many(channels, [](const deribit::json&) {});
+    EXPECT_TRUE(result.confirmed.empty());
+    EXPECT_EQ(result.failed, channels);
+    
+    result = api_client_->unsubscribe_many(channels);
+    EXPECT_TRUE(result.confirmed.empty());
+    EXPECT_EQ(result.failed, channels);
+}
+
+// Test typed batch subscriptions reject channels of the wrong kind
+TEST_F(ApiClientTest, SubscribeBookManyChannel) {
+    deribit::SubscriptionResult result = api_client_->subscribe_book_many(
+        {"trades.BTC-PERPETUAL.raw"}, [](const deribit::BookUpdate&) {});
+    
+    EXPECT_TRUE(result.confirmed.empty());
+    ASSERT_EQ(result.failed.size(), 1u);
+    EXPECT_EQ(result.failed[0], "trades.BTC-PERPETUAL.raw");
+}
+
+// Test replayed frames reach the subscription callbacks without a connection
+TEST_F(ApiClientTest, ReplayMessage) {
+    api_client_->set_replay_mode(true);
+    EXPECT_TRUE(api_client_->is_replay_mode());
+    
+    std::atomic<int> received{0};
+    std::atomic<int64_t> change_id{0};
+    ASSERT_TRUE(api_client_->subscribe_book("book.BTC-PERPETUAL.100ms", [&](const deribit::BookUpdate& update) {
+        change_id = update.change_id;
+        received++;
+    }));
+    
+    api_client_->replay_message(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.100ms",)"
+        R"("data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"BTC-PERPETUAL","change_id":5,)"
+        R"("bids":[["new",100.0,1.0]],"asks":[["new",101.0,2.0]]}}})", 1700000000001000000);
+    
+    // Frames for channels without a handler are ignored
+    api_client_->replay_message(
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.ETH-PERPETUAL.100ms",)"
+        R"("data":{"type":"snapshot","timestamp":1700000000000,"instrument_name":"ETH-PERPETUAL","change_id":7,)"
+        R"("bids":[],"asks":[]}}})", 1700000000002000000);
+    
+    EXPECT_TRUE(api_client_->wait_until_idle(std::chrono::seconds(5)));
+    EXPECT_EQ(received, 1);
+    EXPECT_EQ(change_id, 5);
+    
+    EXPECT_TRUE(api_client_->unsubscribe("book.BTC-PERPETUAL.100ms"));
+}
+
+// Test reconnect settings before any connection
+TEST_F(ApiClientTest, ReconnectConfig) {
+    deribit::ReconnectConfig config;
+    EXPECT_TRUE(config.enabled);
+    EXPECT_EQ(config.heartbeat_interval, std::chrono::seconds(10));
+    
+    config.initial_backoff = std::chrono::milliseconds(100);
+    config.max_backoff = std::chrono::milliseconds(1000);
+    api_client_->set_reconnect_config(config);
+    
+    std::atomic<int> changes{0};
+    api_client_->set_connection_callback([&changes](bool) {
+        changes++;
+    });
+    
+    EXPECT_EQ(api_client_->get_reconnect_count(), 0u);
+    
+    // Disconnecting without a connection neither reconnects nor notifies
+    api_client_->disconnect_websocket();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_FALSE(api_client_->is_websocket_connected());
+    EXPECT_EQ(changes, 0);
+}
+
+// Test a replayed heartbeat test request is not answered
+TEST_F(ApiClientTest, ReplayHeartbeat) {
+    api_client_->set_replay_mode(true);
+    
+    api_client_->replay_message(R"({"jsonrpc":"2.0","method":"heartbeat","params":{"type":"test_request"}})",
+                                1700000000000000000);
+    api_client_->replay_message(R"({"jsonrpc":"2.0","method":"heartbeat","params":{"type":"heartbeat"}})",
+                                1700000000001000000);
+    
+    EXPECT_TRUE(api_client_->wait_until_idle(std::chrono::seconds(5)));
+    EXPECT_FALSE(api_client_->is_websocket_connected());
+}
+
+// Test the first copy of each book update is delivered and the other feeds' copies are dropped
+TEST_F(ApiClientTest, FeedArbitration) {
+    api_client_->set_replay_mode(true);
+    EXPECT_TRUE(api_client_->get_feed_stats().empty());
+    ASSERT_TRUE(api_client_->add_market_data_feed("wss://www.deribit.com/ws/api/v2"));
+    
+    std::vector<int64_t> change_ids;
+    ASSERT_TRUE(api_client_->subscribe_book("book.BTC-PERPETUAL.100ms", [&](const deribit::BookUpdate& update) {
+        change_ids.push_back(update.change_id);
+    }));
+    
+    std::atomic<int> json_received{0};
+    ASSERT_TRUE(api_client_->subscribe("book.ETH-PERPETUAL.100ms", [&](const deribit::json&) {
+        json_received++;
+    }));
+    
+    auto frame = [](const std::string& instrument, int64_t change_id) {
+        return R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.)" + instrument +
+               R"(.100ms","data":{"type":"change","timestamp":1700000000000,"instrument_name":")" + instrument +
+               R"(","prev_change_id":)" + std::to_string(change_id - 1) + R"(,"change_id":)" +
+               std::to_string(change_id) + R"(,"bids":[["new",100.0,1.0]],"asks":[]}}})";
+    };
+    
+    // Feed 0 wins update 5, feed 1 wins update 6; copies and older updates are dropped
+    api_client_->replay_message(frame("BTC-PERPETUAL", 5), 1700000000001000000, 0);
+    api_client_->replay_message(frame("BTC-PERPETUAL", 5), 1700000000002000000, 1);
+    api_client_->replay_message(frame("BTC-PERPETUAL", 6), 1700000000003000000, 1);
+    api_client_->replay_message(frame("BTC-PERPETUAL", 6), 1700000000004000000, 0);
+    api_client_->replay_message(frame("BTC-PERPETUAL", 4), 1700000000005000000, 0);
+    
+    // Channels decoded from json are arbitrated too
+    api_client_->replay_message(frame("ETH-PERPETUAL", 9), 1700000000006000000, 1);
+    api_client_->replay_message(frame("ETH-PERPETUAL", 9), 1700000000007000000, 0);
+    
+    // Frames of an unknown feed are ignored
+    api_client_->replay_message(frame("BTC-PERPETUAL", 7), 1700000000008000000, 2);
+    
+    EXPECT_TRUE(api_client_->wait_until_idle(std::chrono::seconds(5)));
+    EXPECT_EQ(change_ids, (std::vector<int64_t>{5, 6}));
+    EXPECT_EQ(json_received, 1);
+    
+    std::vector<deribit::FeedStats> stats = api_client_->get_feed_stats();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].url, api_client_->get_websocket_url());
+    EXPECT_EQ(stats[1].url, "wss://www.deribit.com/ws/api/v2");
+    EXPECT_FALSE(stats[1].connected);
+    EXPECT_EQ(stats[0].wins, 1u);
+    EXPECT_EQ(stats[0].duplicates, 3u);
+    EXPECT_EQ(stats[1].wins, 2u);
+    EXPECT_EQ(stats[1].duplicates, 1u);
+    EXPECT_DOUBLE_EQ(stats[0].win_ratio, 0.25);
+}
+
 // Test getting instruments
 TEST_F(ApiClientTest, GetInstruments) {
     // Skip actual API call in unit tests
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include "binary_book_codec.h"
+
+using Levels = std::vector<std::pair<double, double>>;
+
+class BinaryBookCodecTest : public ::testing::Test {
+protected:
+    Levels bids_ = {{100.0, 1.0}, {99.5, 2.0}, {99.0, 3.0}};
+    Levels asks_ = {{100.5, 1.5}, {101.0, 2.5}};
+
+    deribit::BinaryBookMessage message_;
+};
+
+// Test a snapshot decodes to the book it was written from
+TEST_F(BinaryBookCodecTest, SnapshotRoundTrip) {
+    std::string data;
+    deribit::write_binary_book_snapshot(data, "BTC-PERPETUAL", 42, 1700000000123, bids_, asks_);
+
+    EXPECT_EQ(data.size(), deribit::BINARY_BOOK_HEADER_SIZE + 13 + 5 * deribit::BINARY_BOOK_LEVEL_SIZE);
+    EXPECT_EQ(static_cast<uint8_t>(data[0]), 1);
+    EXPECT_EQ(static_cast<uint8_t>(data[1]), deribit::BINARY_PROTOCOL_VERSION);
+
+    // The sequence is little-endian
+    EXPECT_EQ(static_cast<uint8_t>(data[8]), 42);
+    EXPECT_EQ(static_cast<uint8_t>(data[15]), 0);
+
+    ASSERT_TRUE(deribit::read_binary_book(data, message_));
+    EXPECT_EQ(message_.type, deribit::BinaryMessageType::BOOK_SNAPSHOT);
+    EXPECT_EQ(message_.instrument_name, "BTC-PERPETUAL");
+    EXPECT_EQ(message_.sequence, 42u);
+    EXPECT_EQ(message_.timestamp, 1700000000123);
+    EXPECT_EQ(message_.bids, bids_);
+    EXPECT_EQ(message_.asks, asks_);
+}
+
+// Test a delta only carries changed levels and rebuilds the new book
+TEST_F(BinaryBookCodecTest, Delta) {
+    Levels bids = {{100.5, 0.5}, {100.0, 1.0}, {99.0, 4.0}};
+    Levels asks = {{100.5, 1.5}, {101.0, 2.5}};
+
+    std::string data;
+    deribit::write_binary_book_delta(data, "BTC-PERPETUAL", 43, 1700000000456, bids_, asks_, bids, asks);
+
+    ASSERT_TRUE(deribit::read_binary_book(data, message_));
+    EXPECT_EQ(message_.type, deribit::BinaryMessageType::BOOK_DELTA);
+    EXPECT_EQ(message_.sequence, 43u);
+
+    // A new best bid, 99.5 removed and 99.0 resized; the asks did not change
+    Levels expected_bids = {{100.5, 0.5}, {99.5, 0.0}, {99.0, 4.0}};
+    EXPECT_EQ(message_.bids, expected_bids);
+    EXPECT_TRUE(message_.asks.empty());
+
+    Levels book_bids = bids_;
+    Levels book_asks = asks_;
+    deribit::apply_binary_book_delta(book_bids, book_asks, message_);
+    EXPECT_EQ(book_bids, bids);
+    EXPECT_EQ(book_asks, asks);
+}
+
+// Test an unchanged book still produces a delta that advances the sequence
+TEST_F(BinaryBookCodecTest, EmptyDelta) {
+    std::string data;
+    deribit::write_binary_book_delta(data, "ETH-PERPETUAL", 7, 0, bids_, asks_, bids_, asks_);
+
+    ASSERT_TRUE(deribit::read_binary_book(data, message_));
+    EXPECT_EQ(message_.sequence, 7u);
+    EXPECT_TRUE(message_.bids.empty());
+    EXPECT_TRUE(message_.asks.empty());
+}
+
+// Test truncated and unknown messages are rejected
+TEST_F(BinaryBookCodecTest, RejectsInvalid) {
+    std::string data;
+    deribit::write_binary_book_snapshot(data, "BTC-PERPETUAL", 1, 0, bids_, asks_);
+
+    EXPECT_FALSE(deribit::read_binary_book(data.substr(0, data.size() - 1), message_));
+    EXPECT_FALSE(deribit::read_binary_book(data.substr(0, 10), message_));
+    EXPECT_FALSE(deribit::read_binary_book("{\"type\":\"orderbook\"}", message_));
+
+    std::string wrong_version = data;
+    wrong_version[1] = 2;
+    EXPECT_FALSE(deribit::read_binary_book(wrong_version, message_));
+}
\ No newline at end of file
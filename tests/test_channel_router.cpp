@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "channel_router.h"
+
+class ChannelRouterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        btc_perpetual_ = router_.intern("orderbook.BTC-PERPETUAL");
+        eth_perpetual_ = router_.intern("orderbook.ETH-PERPETUAL");
+        btc_option_ = router_.intern("orderbook.BTC-27JUN25-60000-C");
+        btc_depth_ = router_.intern("orderbook.BTC-PERPETUAL.10.100ms");
+        btc_ticker_ = router_.intern("ticker.BTC-PERPETUAL");
+    }
+    
+    std::vector<deribit::ChannelId> sorted(std::vector<deribit::ChannelId> ids) {
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+    
+    deribit::ChannelRouter router_;
+    deribit::ChannelId btc_perpetual_;
+    deribit::ChannelId eth_perpetual_;
+    deribit::ChannelId btc_option_;
+    deribit::ChannelId btc_depth_;
+    deribit::ChannelId btc_ticker_;
+};
+
+// Test channels get dense, stable ids
+TEST_F(ChannelRouterTest, Intern) {
+    EXPECT_EQ(btc_perpetual_, 0u);
+    EXPECT_EQ(btc_ticker_, 4u);
+    EXPECT_EQ(router_.channel_count(), 5u);
+    
+    EXPECT_EQ(router_.intern("orderbook.ETH-PERPETUAL"), eth_perpetual_);
+    EXPECT_EQ(router_.find("orderbook.ETH-PERPETUAL"), eth_perpetual_);
+    EXPECT_EQ(router_.find("orderbook.ETH"), deribit::INVALID_CHANNEL_ID);
+    EXPECT_EQ(router_.name(btc_option_), "orderbook.BTC-27JUN25-60000-C");
+}
+
+// Test a wildcard matches within one dot-separated segment only
+TEST_F(ChannelRouterTest, Matches) {
+    using deribit::ChannelRouter;
+    
+    EXPECT_TRUE(ChannelRouter::is_pattern("orderbook.BTC-*"));
+    EXPECT_FALSE(ChannelRouter::is_pattern("orderbook.BTC-PERPETUAL"));
+    
+    EXPECT_TRUE(ChannelRouter::matches("orderbook.BTC-*", "orderbook.BTC-PERPETUAL"));
+    EXPECT_TRUE(ChannelRouter::matches("orderbook.*-PERPETUAL", "orderbook.ETH-PERPETUAL"));
+    EXPECT_TRUE(ChannelRouter::matches("orderbook.BTC-*-C", "orderbook.BTC-27JUN25-60000-C"));
+    EXPECT_TRUE(ChannelRouter::matches("orderbook.*", "orderbook.BTC-PERPETUAL"));
+    EXPECT_TRUE(ChannelRouter::matches("*.BTC-PERPETUAL", "ticker.BTC-PERPETUAL"));
+    
+    EXPECT_FALSE(ChannelRouter::matches("orderbook.BTC-*", "orderbook.ETH-PERPETUAL"));
+    EXPECT_FALSE(ChannelRouter::matches("orderbook.BTC-*-C", "orderbook.BTC-27JUN25-60000-P"));
+    EXPECT_FALSE(ChannelRouter::matches("orderbook.*", "orderbook.BTC-PERPETUAL.10.100ms"));
+    EXPECT_FALSE(ChannelRouter::matches("orderbook.*.*", "orderbook.BTC-PERPETUAL"));
+    EXPECT_FALSE(ChannelRouter::matches("orderbook.*", "ticker.BTC-PERPETUAL"));
+}
+
+// Test a new pattern is matched against the channels below its prefix
+TEST_F(ChannelRouterTest, MatchChannels) {
+    EXPECT_EQ(sorted(router_.match_channels("orderbook.BTC-*")),
+              (std::vector<deribit::ChannelId>{btc_perpetual_, btc_option_}));
+    EXPECT_EQ(sorted(router_.match_channels("orderbook.*-PERPETUAL")),
+              (std::vector<deribit::ChannelId>{btc_perpetual_, eth_perpetual_}));
+    EXPECT_EQ(sorted(router_.match_channels("*.BTC-PERPETUAL")),
+              (std::vector<deribit::ChannelId>{btc_perpetual_, btc_ticker_}));
+    EXPECT_EQ(router_.match_channels("orderbook.BTC-*.10.*"), (std::vector<deribit::ChannelId>{btc_depth_}));
+    EXPECT_TRUE(router_.match_channels("orderbook.SOL-*").empty());
+}
+
+// Test a new channel is matched against the patterns on its path
+TEST_F(ChannelRouterTest, MatchPatterns) {
+    EXPECT_TRUE(router_.add_pattern("orderbook.BTC-*"));
+    EXPECT_TRUE(router_.add_pattern("orderbook.*-PERPETUAL"));
+    EXPECT_TRUE(router_.add_pattern("ticker.*"));
+    EXPECT_FALSE(router_.add_pattern("orderbook.BTC-*"));
+    
+    std::vector<std::string> patterns = router_.match_patterns("orderbook.BTC-28MAR25-PERPETUAL");
+    std::sort(patterns.begin(), patterns.end());
+    EXPECT_EQ(patterns, (std::vector<std::string>{"orderbook.*-PERPETUAL", "orderbook.BTC-*"}));
+    
+    EXPECT_EQ(router_.match_patterns("ticker.SOL-PERPETUAL"), (std::vector<std::string>{"ticker.*"}));
+    EXPECT_TRUE(router_.match_patterns("orderbook.ETH-27JUN25").empty());
+    
+    EXPECT_TRUE(router_.remove_pattern("orderbook.BTC-*"));
+    EXPECT_FALSE(router_.remove_pattern("orderbook.BTC-*"));
+    EXPECT_FALSE(router_.remove_pattern("orderbook.SOL-*"));
+    EXPECT_EQ(router_.match_patterns("orderbook.BTC-27JUN25"), std::vector<std::string>());
+}
+
+// Test a released channel is forgotten and its id goes to the next new channel
+TEST_F(ChannelRouterTest, Release) {
+    router_.add_pattern("orderbook.BTC-*");
+    router_.release(btc_option_);
+    
+    EXPECT_EQ(router_.channel_count(), 4u);
+    EXPECT_EQ(router_.find("orderbook.BTC-27JUN25-60000-C"), deribit::INVALID_CHANNEL_ID);
+    EXPECT_EQ(router_.match_channels("orderbook.BTC-*"), (std::vector<deribit::ChannelId>{btc_perpetual_}));
+    EXPECT_EQ(router_.match_patterns("orderbook.BTC-PERPETUAL"), (std::vector<std::string>{"orderbook.BTC-*"}));
+    
+    deribit::ChannelId sol_perpetual = router_.intern("orderbook.SOL-PERPETUAL");
+    EXPECT_EQ(sol_perpetual, btc_option_);
+    EXPECT_EQ(router_.name(sol_perpetual), "orderbook.SOL-PERPETUAL");
+    EXPECT_EQ(router_.find("orderbook.SOL-PERPETUAL"), sol_perpetual);
+    
+    // Releasing a channel that shares its path with a longer one keeps the longer one
+    router_.release(btc_perpetual_);
+    EXPECT_EQ(router_.find("orderbook.BTC-PERPETUAL.10.100ms"), btc_depth_);
+    EXPECT_EQ(router_.match_channels("orderbook.BTC-*.10.*"), (std::vector<deribit::ChannelId>{btc_depth_}));
+    EXPECT_TRUE(router_.match_channels("orderbook.BTC-*").empty());
+    
+    EXPECT_TRUE(router_.remove_pattern("orderbook.BTC-*"));
+    EXPECT_EQ(router_.intern("orderbook.BTC-PERPETUAL"), btc_perpetual_);
+    EXPECT_TRUE(router_.match_patterns("orderbook.BTC-PERPETUAL").empty());
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "instrument_registry.h"
+
+class InstrumentRegistryTest : public ::testing::Test {
+protected:
+    deribit::json option(const std::string& name, int64_t expiry, double strike, const std::string& option_type) {
+        return {
+            {"instrument_name", name},
+            {"base_currency", "BTC"},
+            {"kind", "option"},
+            {"tick_size", 0.0005},
+            {"min_trade_amount", 0.1},
+            {"contract_size", 1.0},
+            {"expiration_timestamp", expiry},
+            {"strike", strike},
+            {"option_type", option_type},
+            {"is_active", true}
+        };
+    }
+    
+    void SetUp() override {
+        registry_ = std::make_shared<deribit::InstrumentRegistry>();
+        
+        registry_->upsert({
+            {"instrument_name", "BTC-PERPETUAL"},
+            {"base_currency", "BTC"},
+            {"kind", "future"},
+            {"tick_size", 0.5},
+            {"min_trade_amount", 10.0},
+            {"contract_size", 10.0},
+            {"expiration_timestamp", 32503708800000},
+            {"is_active", true}
+        });
+        registry_->upsert(option("BTC-27JUN25-60000-C", 1751011200000, 60000.0, "call"));
+        registry_->upsert(option("BTC-27JUN25-50000-P", 1751011200000, 50000.0, "put"));
+        registry_->upsert(option("BTC-28MAR25-50000-C", 1743148800000, 50000.0, "call"));
+    }
+    
+    std::shared_ptr<deribit::InstrumentRegistry> registry_;
+};
+
+// Test dense ids and lookups by name
+TEST_F(InstrumentRegistryTest, Lookup) {
+    EXPECT_EQ(registry_->size(), 4u);
+    EXPECT_EQ(registry_->find_id("BTC-PERPETUAL"), 0u);
+    EXPECT_EQ(registry_->find_id("BTC-28MAR25-50000-C"), 3u);
+    EXPECT_EQ(registry_->find_id("ETH-PERPETUAL"), deribit::INVALID_INSTRUMENT_ID);
+    
+    auto perpetual = registry_->get(0);
+    ASSERT_TRUE(perpetual != nullptr);
+    EXPECT_EQ(perpetual->instrument_name, "BTC-PERPETUAL");
+    EXPECT_EQ(perpetual->kind, deribit::InstrumentType::FUTURES);
+    EXPECT_DOUBLE_EQ(perpetual->tick_size, 0.5);
+    
+    auto call = registry_->get("BTC-27JUN25-60000-C");
+    ASSERT_TRUE(call != nullptr);
+    EXPECT_EQ(call->id, 1u);
+    EXPECT_DOUBLE_EQ(call->strike, 60000.0);
+    EXPECT_EQ(call->option_type, "call");
+    
+    EXPECT_TRUE(registry_->get(99) == nullptr);
+    
+    // Malformed objects are rejected
+    EXPECT_EQ(registry_->upsert({{"kind", "future"}}), deribit::INVALID_INSTRUMENT_ID);
+    EXPECT_EQ(registry_->upsert({{"instrument_name", "X"}, {"kind", "bond"}}), deribit::INVALID_INSTRUMENT_ID);
+}
+
+// Test updating an instrument keeps its id
+TEST_F(InstrumentRegistryTest, Upsert) {
+    auto before = registry_->get("BTC-PERPETUAL");
+    
+    deribit::json perpetual = {
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"base_currency", "BTC"},
+        {"kind", "future"},
+        {"tick_size", 1.0}
+    };
+    EXPECT_EQ(registry_->upsert(perpetual), 0u);
+    EXPECT_EQ(registry_->size(), 4u);
+    EXPECT_DOUBLE_EQ(registry_->get(0)->tick_size, 1.0);
+    
+    // Entries handed out earlier are unchanged
+    EXPECT_DOUBLE_EQ(before->tick_size, 0.5);
+    
+    // Without a settlement currency the base currency is used
+    EXPECT_EQ(registry_->get(0)->settlement_currency, "BTC");
+    
+    deribit::json linear = {
+        {"instrument_name", "BTC_USDC-PERPETUAL"},
+        {"base_currency", "BTC"},
+        {"settlement_currency", "USDC"},
+        {"kind", "future"}
+    };
+    registry_->upsert(linear);
+    EXPECT_EQ(registry_->get("BTC_USDC-PERPETUAL")->settlement_currency, "USDC");
+}
+
+// Test queries by currency, kind, expiry and strike
+TEST_F(InstrumentRegistryTest, Find) {
+    deribit::InstrumentFilter filter;
+    filter.currency = "BTC";
+    filter.match_kind = true;
+    filter.kind = deribit::InstrumentType::OPTIONS;
+    
+    auto options = registry_->find(filter);
+    ASSERT_EQ(options.size(), 3u);
+    EXPECT_EQ(options[0]->instrument_name, "BTC-28MAR25-50000-C");
+    EXPECT_EQ(options[1]->instrument_name, "BTC-27JUN25-50000-P");
+    EXPECT_EQ(options[2]->instrument_name, "BTC-27JUN25-60000-C");
+    
+    filter.expiration_timestamp = 1751011200000;
+    filter.strike = 60000.0;
+    auto strikes = registry_->find(filter);
+    ASSERT_EQ(strikes.size(), 1u);
+    EXPECT_EQ(strikes[0]->instrument_name, "BTC-27JUN25-60000-C");
+    
+    std::vector<int64_t> expirations = registry_->expirations("BTC", deribit::InstrumentType::OPTIONS);
+    EXPECT_EQ(expirations, (std::vector<int64_t>{1743148800000, 1751011200000}));
+    
+    filter = deribit::InstrumentFilter();
+    filter.currency = "ETH";
+    EXPECT_TRUE(registry_->find(filter).empty());
+}
+
+// Test instrument.state notifications deactivate instruments
+TEST_F(InstrumentRegistryTest, StateUpdate) {
+    registry_->handle_state_update({{"instrument_name", "BTC-28MAR25-50000-C"}, {"state", "settled"}});
+    EXPECT_FALSE(registry_->get("BTC-28MAR25-50000-C")->active);
+    
+    // Inactive instruments keep their id but are filtered out by default
+    EXPECT_EQ(registry_->find_id("BTC-28MAR25-50000-C"), 3u);
+    std::vector<int64_t> expirations = registry_->expirations("BTC", deribit::InstrumentType::OPTIONS);
+    EXPECT_EQ(expirations, (std::vector<int64_t>{1751011200000}));
+    
+    registry_->handle_state_update({{"instrument_name", "BTC-28MAR25-50000-C"}, {"state", "started"}});
+    EXPECT_TRUE(registry_->get("BTC-28MAR25-50000-C")->active);
+}
+
+// Test saving and reloading the cache file
+TEST_F(InstrumentRegistryTest, CacheFile) {
+    std::string filename = ::testing::TempDir() + "instrument_registry_test.json";
+    
+    registry_->handle_state_update({{"instrument_name", "BTC-28MAR25-50000-C"}, {"state", "settled"}});
+    ASSERT_TRUE(registry_->save_to_file(filename));
+    
+    deribit::InstrumentRegistry loaded;
+    ASSERT_TRUE(loaded.load_from_file(filename));
+    EXPECT_EQ(loaded.size(), 4u);
+    EXPECT_EQ(loaded.find_id("BTC-27JUN25-50000-P"), 2u);
+    EXPECT_DOUBLE_EQ(loaded.get("BTC-27JUN25-50000-P")->tick_size, 0.0005);
+    EXPECT_FALSE(loaded.get("BTC-28MAR25-50000-C")->active);
+    
+    std::remove(filename.c_str());
+    
+    EXPECT_FALSE(loaded.load_from_file(filename));
+}
+
+// Test tick size rounding and validation
+TEST_F(InstrumentRegistryTest, TickSize) {
+    auto option = registry_->get("BTC-27JUN25-60000-C");
+    
+    EXPECT_TRUE(option->is_valid_price(0.0015));
+    EXPECT_FALSE(option->is_valid_price(0.0012));
+    EXPECT_NEAR(option->round_price(0.0012), 0.001, 1e-12);
+    
+    deribit::InstrumentInfo unknown;
+    EXPECT_TRUE(unknown.is_valid_price(1.2345));
+    EXPECT_DOUBLE_EQ(unknown.round_price(1.2345), 1.2345);
+}
\ No newline at end of file
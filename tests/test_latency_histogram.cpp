@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include "latency_histogram.h"
+
+class LatencyHistogramTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        histogram_ = std::make_unique<deribit::LatencyHistogram>(7, 60000000000);
+    }
+    
+    std::unique_ptr<deribit::LatencyHistogram> histogram_;
+};
+
+// Test that every bucket maps back onto the values it holds
+TEST_F(LatencyHistogramTest, BucketBounds) {
+    for (int64_t value : {0, 1, 127, 128, 129, 255, 256, 1000, 123456, 1000000007}) {
+        size_t index = deribit::LatencyHistogram::bucket_index(value, 7);
+        int64_t upper = deribit::LatencyHistogram::bucket_upper_bound(index, 7);
+        
+        EXPECT_GE(upper, value);
+        EXPECT_EQ(deribit::LatencyHistogram::bucket_index(upper, 7), index);
+        EXPECT_EQ(deribit::LatencyHistogram::bucket_index(upper + 1, 7), index + 1);
+        
+        // Relative error stays within 2^-(bits-1)
+        EXPECT_LE(static_cast<double>(upper - value), value / 64.0 + 1.0);
+    }
+}
+
+// Test percentiles against a uniform distribution
+TEST_F(LatencyHistogramTest, Percentiles) {
+    for (int64_t value = 1; value <= 100000; ++value) {
+        histogram_->record(value * 1000);
+    }
+    
+    deribit::HistogramSnapshot snapshot = histogram_->snapshot();
+    EXPECT_EQ(snapshot.count(), 100000u);
+    EXPECT_EQ(snapshot.min(), 1000);
+    EXPECT_EQ(snapshot.max(), 100000000);
+    EXPECT_NEAR(snapshot.mean(), 50000500.0, 1.0);
+    EXPECT_NEAR(snapshot.percentile(50), 50000000.0, 50000000.0 / 64);
+    EXPECT_NEAR(snapshot.percentile(99), 99000000.0, 99000000.0 / 64);
+    EXPECT_NEAR(snapshot.percentile(99.9), 99900000.0, 99900000.0 / 64);
+    EXPECT_EQ(snapshot.percentile(100), 100000000);
+}
+
+// Test values outside the trackable range
+TEST_F(LatencyHistogramTest, Clamping) {
+    deribit::LatencyHistogram histogram(7, 1000000);
+    histogram.record(-5);
+    histogram.record(5000000);
+    
+    deribit::HistogramSnapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count(), 2u);
+    EXPECT_EQ(snapshot.min(), 0);
+    EXPECT_EQ(snapshot.max(), 1000000);
+}
+
+// Test merging snapshots
+TEST_F(LatencyHistogramTest, Merge) {
+    deribit::LatencyHistogram other(7, 60000000000);
+    histogram_->record(100);
+    other.record(300);
+    
+    deribit::HistogramSnapshot merged;
+    merged.merge(histogram_->snapshot());
+    merged.merge(other.snapshot());
+    
+    EXPECT_EQ(merged.count(), 2u);
+    EXPECT_EQ(merged.min(), 100);
+    EXPECT_EQ(merged.max(), 300);
+    
+    // Precisions must match
+    deribit::LatencyHistogram coarse(5, 60000000000);
+    coarse.record(1);
+    EXPECT_THROW(merged.merge(coarse.snapshot()), std::invalid_argument);
+}
+
+// Test concurrent recording
+TEST_F(LatencyHistogramTest, ConcurrentRecord) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([this]() {
+            for (int i = 0; i < 10000; ++i) {
+                histogram_->record(i);
+            }
+        });
+    }
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    EXPECT_EQ(histogram_->snapshot().count(), 40000u);
+    
+    histogram_->reset();
+    EXPECT_EQ(histogram_->snapshot().count(), 0u);
+}
+
+// Test that the rolling window forgets old intervals
+TEST_F(LatencyHistogramTest, RollingWindow) {
+    deribit::HistogramConfig config;
+    config.window_interval = std::chrono::milliseconds(1000);
+    config.window_intervals = 3;
+    deribit::RollingHistogram rolling(config);
+    
+    const int64_t second = 1000000000;
+    EXPECT_EQ(rolling.window(), std::chrono::seconds(3));
+    
+    rolling.record(100, 10 * second);
+    rolling.record(200, 11 * second);
+    rolling.record(300, 12 * second);
+    EXPECT_EQ(rolling.snapshot(12 * second).count(), 3u);
+    
+    // The interval at 10s drops out
+    EXPECT_EQ(rolling.snapshot(13 * second).count(), 2u);
+    
+    // Recording at 13s recycles the slot of 10s
+    rolling.record(400, 13 * second);
+    deribit::HistogramSnapshot snapshot = rolling.snapshot(13 * second);
+    EXPECT_EQ(snapshot.count(), 3u);
+    EXPECT_EQ(snapshot.min(), 200);
+    
+    // A late value for an interval already recycled is dropped
+    rolling.record(500, 10 * second);
+    EXPECT_EQ(rolling.snapshot(13 * second).count(), 3u);
+    
+    EXPECT_EQ(rolling.snapshot(100 * second).count(), 0u);
+}
\ No newline at end of file
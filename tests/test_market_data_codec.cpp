@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "market_data_codec.h"
+
+using json = nlohmann::json;
+
+class MarketDataCodecTest : public ::testing::Test {
+protected:
+    std::string make_notification(const std::string& channel, const std::string& data) {
+        return "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"" +
+               channel + "\",\"data\":" + data + "}}";
+    }
+    
+    std::string book_change_ =
+        "{\"type\":\"change\",\"timestamp\":1700000000123,\"prev_change_id\":10,"
+        "\"instrument_name\":\"BTC-PERPETUAL\",\"change_id\":11,"
+        "\"bids\":[[\"change\",50000.5,12.0],[\"delete\",49999.0,0.0]],"
+        "\"asks\":[[\"new\",50001.0,3.5]]}";
+    
+    deribit::BookUpdate update_;
+};
+
+// Test locating the data of a notification
+TEST_F(MarketDataCodecTest, ParseEnvelope) {
+    std::string payload = make_notification("book.BTC-PERPETUAL.100ms", book_change_);
+    
+    deribit::MessageEnvelope envelope;
+    ASSERT_TRUE(deribit::MarketDataDecoder::parse_envelope(payload, envelope));
+    EXPECT_EQ(envelope.channel, "book.BTC-PERPETUAL.100ms");
+    EXPECT_EQ(payload.compare(envelope.data_offset, book_change_.size(), book_change_), 0);
+    
+    // Data before the channel is still found
+    std::string reordered = "{\"params\":{\"data\":[1,2],\"channel\":\"trades.BTC-PERPETUAL.raw\"},"
+                            "\"method\":\"subscription\",\"jsonrpc\":\"2.0\"}";
+    ASSERT_TRUE(deribit::MarketDataDecoder::parse_envelope(reordered, envelope));
+    EXPECT_EQ(envelope.channel, "trades.BTC-PERPETUAL.raw");
+    EXPECT_EQ(reordered[envelope.data_offset], '[');
+    
+    // Responses are left to the generic path
+    EXPECT_FALSE(deribit::MarketDataDecoder::parse_envelope(
+        "{\"jsonrpc\":\"2.0\",\"id\":7,\"result\":[\"book.BTC-PERPETUAL.100ms\"]}", envelope));
+    EXPECT_FALSE(deribit::MarketDataDecoder::parse_envelope(
+        "{\"jsonrpc\":\"2.0\",\"method\":\"heartbeat\",\"params\":{\"type\":\"test_request\"}}", envelope));
+}
+
+// Test decoding a book delta
+TEST_F(MarketDataCodecTest, DecodeBookChange) {
+    ASSERT_TRUE(deribit::MarketDataDecoder::decode_book(book_change_, update_));
+    
+    EXPECT_EQ(update_.instrument_name, "BTC-PERPETUAL");
+    EXPECT_FALSE(update_.snapshot);
+    EXPECT_EQ(update_.timestamp, 1700000000123);
+    EXPECT_EQ(update_.change_id, 11);
+    EXPECT_EQ(update_.prev_change_id, 10);
+    
+    ASSERT_EQ(update_.bids.size(), 2u);
+    EXPECT_EQ(update_.bids[0].action, deribit::BookAction::CHANGE);
+    EXPECT_DOUBLE_EQ(update_.bids[0].price, 50000.5);
+    EXPECT_DOUBLE_EQ(update_.bids[0].amount, 12.0);
+    EXPECT_EQ(update_.bids[1].action, deribit::BookAction::DELETE);
+    
+    ASSERT_EQ(update_.asks.size(), 1u);
+    EXPECT_EQ(update_.asks[0].action, deribit::BookAction::NEW);
+    EXPECT_DOUBLE_EQ(update_.asks[0].amount, 3.5);
+    
+    // The json path decodes to the same update
+    deribit::BookUpdate from_json;
+    json data = json::parse(book_change_);
+    ASSERT_TRUE(deribit::MarketDataDecoder::decode_book_json(data, from_json));
+    EXPECT_EQ(from_json.instrument_name, update_.instrument_name);
+    EXPECT_EQ(from_json.change_id, update_.change_id);
+    EXPECT_EQ(from_json.bids.size(), update_.bids.size());
+    EXPECT_EQ(from_json.asks.size(), update_.asks.size());
+}
+
+// Test decoding grouped books and malformed input
+TEST_F(MarketDataCodecTest, DecodeBookVariants) {
+    // Grouped channels send [price, amount] pairs, which are snapshots
+    ASSERT_TRUE(deribit::MarketDataDecoder::decode_book(
+        "{\"timestamp\":1,\"instrument_name\":\"ETH-PERPETUAL\",\"change_id\":5,"
+        "\"bids\":[[2000.0,1]],\"asks\":[[2001.0,2],[2002.5,3]],\"extra\":{\"nested\":[1,\"]\"]}}", update_));
+    EXPECT_TRUE(update_.snapshot);
+    EXPECT_EQ(update_.bids.size(), 1u);
+    EXPECT_EQ(update_.asks.size(), 2u);
+    
+    // Decoding reuses the update
+    ASSERT_TRUE(deribit::MarketDataDecoder::decode_book(book_change_, update_));
+    EXPECT_FALSE(update_.snapshot);
+    EXPECT_EQ(update_.asks.size(), 1u);
+    
+    EXPECT_FALSE(deribit::MarketDataDecoder::decode_book("{\"bids\":[]}", update_));
+    EXPECT_FALSE(deribit::MarketDataDecoder::decode_book("{\"bids\":[[\"move\",1,1]],\"asks\":[]}", update_));
+    EXPECT_FALSE(deribit::MarketDataDecoder::decode_book("{\"bids\":[[1,1]", update_));
+    
+    // Escaped strings are left to the json path
+    EXPECT_FALSE(deribit::MarketDataDecoder::decode_book(
+        "{\"instrument_name\":\"A\\\"B\",\"bids\":[],\"asks\":[]}", update_));
+}
+
+// Test decoding trades
+TEST_F(MarketDataCodecTest, DecodeTrades) {
+    std::string data =
+        "[{\"trade_seq\":30289432,\"trade_id\":\"48079254\",\"timestamp\":1590484156350,"
+        "\"tick_direction\":0,\"price\":8950.0,\"mark_price\":8948.9,\"instrument_name\":\"BTC-PERPETUAL\","
+        "\"index_price\":8955.88,\"direction\":\"sell\",\"amount\":10},"
+        "{\"trade_seq\":30289433,\"trade_id\":\"48079255\",\"timestamp\":1590484156351,"
+        "\"price\":8951.5,\"instrument_name\":\"BTC-PERPETUAL\",\"direction\":\"buy\",\"amount\":20.5,"
+        "\"liquidation\":null}]";
+    
+    std::vector<deribit::TradeUpdate> trades;
+    ASSERT_TRUE(deribit::MarketDataDecoder::decode_trades(data, trades));
+    ASSERT_EQ(trades.size(), 2u);
+    EXPECT_EQ(trades[0].trade_id, "48079254");
+    EXPECT_EQ(trades[0].direction, "sell");
+    EXPECT_EQ(trades[0].trade_seq, 30289432);
+    EXPECT_DOUBLE_EQ(trades[0].amount, 10.0);
+    EXPECT_DOUBLE_EQ(trades[0].index_price, 8955.88);
+    EXPECT_EQ(trades[1].direction, "buy");
+    EXPECT_DOUBLE_EQ(trades[1].price, 8951.5);
+    
+    std::vector<deribit::TradeUpdate> from_json;
+    json parsed = json::parse(data);
+    ASSERT_TRUE(deribit::MarketDataDecoder::decode_trades_json(parsed, from_json));
+    ASSERT_EQ(from_json.size(), 2u);
+    EXPECT_EQ(from_json[1].trade_id, trades[1].trade_id);
+    EXPECT_DOUBLE_EQ(from_json[1].amount, trades[1].amount);
+}
+
+// Test that the hand-written orderbook message matches json::dump()
+TEST_F(MarketDataCodecTest, WriteOrderbookMessage) {
+    std::vector<std::pair<double, double>> bids = {{50000.0, 1.5}, {49999.5, 20.0}};
+    std::vector<std::pair<double, double>> asks = {{50000.5, 0.1}};
+    
+    std::string message;
+    deribit::write_orderbook_message(message, "BTC-PERPETUAL", "1700000000123", bids, asks);
+    
+    json expected = {
+        {"type", "orderbook"},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"timestamp", "1700000000123"},
+        {"bids", json::array()},
+        {"asks", json::array()}
+    };
+    for (const auto& bid : bids) {
+        expected["bids"].push_back({bid.first, bid.second});
+    }
+    for (const auto& ask : asks) {
+        expected["asks"].push_back({ask.first, ask.second});
+    }
+    
+    EXPECT_EQ(message, expected.dump());
+    
+    // Round sizes and small values use json::dump()'s fixed and exponent forms
+    bids = {{100000.0, 1000000.0}, {3000000.0, 0.0001}, {1e16, 0.00001}, {-0.0, 123456789012345.0}};
+    asks = {{0.1, 2.5e-7}};
+    message.clear();
+    deribit::write_orderbook_message(message, "BTC-PERPETUAL", "1700000000123", bids, asks);
+    
+    expected["bids"] = json::array();
+    for (const auto& bid : bids) {
+        expected["bids"].push_back({bid.first, bid.second});
+    }
+    expected["asks"] = json::array();
+    for (const auto& ask : asks) {
+        expected["asks"].push_back({ask.first, ask.second});
+    }
+    
+    EXPECT_EQ(message, expected.dump());
+    EXPECT_NE(message.find("[100000.0,1000000.0],[3000000.0,0.0001]"), std::string::npos);
+    
+    // Empty sides and names needing escapes
+    message.clear();
+    deribit::write_orderbook_message(message, "A\"B", "0", {}, {});
+    EXPECT_EQ(json::parse(message)["instrument_name"], "A\"B");
+    EXPECT_TRUE(json::parse(message)["bids"].empty());
+}
+
+// Test ticker messages match what json::dump() produces
+TEST_F(MarketDataCodecTest, WriteTickerMessage) {
+    std::pair<double, double> bid(50000.0, 1.5);
+    std::pair<double, double> ask(50000.5, 0.25);
+    
+    std::string message;
+    deribit::write_ticker_message(message, "BTC-PERPETUAL", "1700000000123", &bid, &ask);
+    
+    json expected = {
+        {"type", "ticker"},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"timestamp", "1700000000123"},
+        {"best_bid_price", 50000.0},
+        {"best_bid_amount", 1.5},
+        {"best_ask_price", 50000.5},
+        {"best_ask_amount", 0.25}
+    };
+    
+    EXPECT_EQ(message, expected.dump());
+    
+    // A missing side is null
+    message.clear();
+    deribit::write_ticker_message(message, "BTC-PERPETUAL", "0", &bid, nullptr);
+    json parsed = json::parse(message);
+    EXPECT_TRUE(parsed["best_ask_price"].is_null());
+    EXPECT_TRUE(parsed["best_ask_amount"].is_null());
+    EXPECT_EQ(parsed["best_bid_price"], 50000.0);
+}
\ No newline at end of file
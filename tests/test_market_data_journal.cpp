@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "market_data_journal.h"
+
+class MarketDataJournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = ::testing::TempDir() + "market_data_journal_test.bin";
+        std::remove(path_.c_str());
+        
+        // Small growth steps so tests cross remaps
+        config_.grow_bytes = 4096;
+    }
+    
+    void TearDown() override {
+        std::remove(path_.c_str());
+    }
+    
+    std::shared_ptr<const std::string> frame(const std::string& payload) {
+        return std::make_shared<const std::string>(payload);
+    }
+    
+    std::string path_;
+    deribit::JournalConfig config_;
+};
+
+// Test writing frames and reading them back in order
+TEST_F(MarketDataJournalTest, WriteAndRead) {
+    deribit::JournalWriter writer(config_);
+    ASSERT_TRUE(writer.open(path_));
+    
+    // Enough data to grow the file several times
+    std::string large(10000, 'x');
+    EXPECT_TRUE(writer.append(frame("{\"a\":1}"), 1000));
+    EXPECT_TRUE(writer.append(frame(large), 2000));
+    EXPECT_TRUE(writer.append(frame("{\"b\":22}"), 3000));
+    EXPECT_FALSE(writer.append(frame(""), 4000));
+    EXPECT_TRUE(writer.flush());
+    EXPECT_EQ(writer.records_written(), 3u);
+    writer.close();
+    EXPECT_FALSE(writer.append(frame("{}"), 5000));
+    
+    deribit::JournalReader reader;
+    ASSERT_TRUE(reader.open(path_));
+    EXPECT_GT(reader.created_wall_ns(), 0);
+    
+    deribit::JournalRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.payload, "{\"a\":1}");
+    EXPECT_EQ(record.received_wall_ns, 1000);
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.payload, large);
+    EXPECT_EQ(record.received_wall_ns, 2000);
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.payload, "{\"b\":22}");
+    EXPECT_FALSE(reader.next(record));
+    
+    // Replays can start over
+    reader.rewind();
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.received_wall_ns, 1000);
+}
+
+// Test that reopening a journal appends after its last record
+TEST_F(MarketDataJournalTest, Reopen) {
+    {
+        deribit::JournalWriter writer(config_);
+        ASSERT_TRUE(writer.open(path_));
+        writer.append(frame("first"), 1);
+    }
+    
+    deribit::JournalWriter writer(config_);
+    ASSERT_TRUE(writer.open(path_));
+    EXPECT_EQ(writer.records_written(), 1u);
+    writer.append(frame("second"), 2);
+    writer.close();
+    
+    deribit::JournalReader reader;
+    ASSERT_TRUE(reader.open(path_));
+    
+    deribit::JournalRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.payload, "first");
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.payload, "second");
+    EXPECT_FALSE(reader.next(record));
+}
+
+// Test that other files are rejected
+TEST_F(MarketDataJournalTest, RejectsOtherFiles) {
+    std::string contents = "{\"not\":\"a journal\",\"padding\":\"xxxxxxxxxxxxxxxx\"}";
+    {
+        std::ofstream file(path_);
+        file << contents;
+    }
+    
+    deribit::JournalReader reader;
+    EXPECT_FALSE(reader.open(path_));
+    
+    // The writer leaves the file as it was
+    deribit::JournalWriter writer(config_);
+    EXPECT_FALSE(writer.open(path_));
+    std::ifstream file(path_, std::ios::ate);
+    EXPECT_EQ(static_cast<size_t>(file.tellg()), contents.size());
+    
+    EXPECT_FALSE(reader.open(path_ + ".missing"));
+}
\ No newline at end of file
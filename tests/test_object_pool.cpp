@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "object_pool.h"
+
+struct PooledBook {
+    std::string instrument_name;
+    std::vector<std::pair<double, double>> bids;
+};
+
+class ObjectPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Two objects with room for ten levels each
+        pool_ = std::make_unique<deribit::ObjectPool<PooledBook>>(2, "test_book", [](PooledBook& book) {
+            book.instrument_name.reserve(32);
+            book.bids.reserve(10);
+        });
+    }
+    
+    int64_t misses() const {
+        return deribit::PerformanceMonitor::instance().get_counter("test_book_pool_misses")->get();
+    }
+    
+    std::unique_ptr<deribit::ObjectPool<PooledBook>> pool_;
+};
+
+// Test a released object is handed out again with its capacity
+TEST_F(ObjectPoolTest, Recycle) {
+    EXPECT_EQ(pool_->capacity(), 2u);
+    EXPECT_EQ(pool_->available(), 2u);
+    
+    std::shared_ptr<PooledBook> book = pool_->acquire();
+    EXPECT_EQ(book->bids.capacity(), 10u);
+    EXPECT_EQ(pool_->available(), 1u);
+    
+    book->instrument_name = "BTC-PERPETUAL";
+    book->bids.assign(5, {100.0, 1.0});
+    PooledBook* address = book.get();
+    book.reset();
+    EXPECT_EQ(pool_->available(), 2u);
+    
+    // Contents are left as the previous user left them
+    book = pool_->acquire();
+    EXPECT_EQ(book.get(), address);
+    EXPECT_EQ(book->instrument_name, "BTC-PERPETUAL");
+    EXPECT_EQ(book->bids.size(), 5u);
+}
+
+// Test an object only returns once every shared pointer to it is released
+TEST_F(ObjectPoolTest, SharedOwnership) {
+    std::shared_ptr<PooledBook> first = pool_->acquire();
+    std::shared_ptr<PooledBook> second = first;
+    
+    first.reset();
+    EXPECT_EQ(pool_->available(), 1u);
+    
+    second.reset();
+    EXPECT_EQ(pool_->available(), 2u);
+}
+
+// Test an exhausted pool falls back to the heap and counts a miss
+TEST_F(ObjectPoolTest, Exhausted) {
+    int64_t initial_misses = misses();
+    
+    std::shared_ptr<PooledBook> first = pool_->acquire();
+    std::shared_ptr<PooledBook> second = pool_->acquire();
+    EXPECT_EQ(misses(), initial_misses);
+    
+    std::shared_ptr<PooledBook> third = pool_->acquire();
+    ASSERT_TRUE(third != nullptr);
+    EXPECT_EQ(misses(), initial_misses + 1);
+    EXPECT_EQ(pool_->available(), 0u);
+    
+    // A heap object is freed rather than pooled
+    third.reset();
+    EXPECT_EQ(pool_->available(), 0u);
+    first.reset();
+    EXPECT_EQ(pool_->available(), 1u);
+}
+
+// Test objects stay valid after the pool is destroyed
+TEST_F(ObjectPoolTest, OutlivesPool) {
+    std::shared_ptr<PooledBook> book = pool_->acquire();
+    book->instrument_name = "ETH-PERPETUAL";
+    
+    pool_.reset();
+    EXPECT_EQ(book->instrument_name, "ETH-PERPETUAL");
+    book.reset();
+}
+
+// Test acquiring, filling and releasing reuses the same storage without misses
+TEST_F(ObjectPoolTest, SteadyState) {
+    int64_t initial_misses = misses();
+    std::string instrument_name = "BTC-27JUN25-60000-C";
+    
+    std::shared_ptr<PooledBook> book = pool_->acquire();
+    PooledBook* address = book.get();
+    const void* levels = book->bids.data();
+    book.reset();
+    
+    for (int i = 0; i < 1000; ++i) {
+        book = pool_->acquire();
+        std::shared_ptr<PooledBook> copy = book;
+        
+        book->instrument_name = instrument_name;
+        book->bids.clear();
+        for (int level = 0; level < 10; ++level) {
+            book->bids.emplace_back(100.0 + level, 1.0);
+        }
+        
+        // The same object and level buffer every time, so nothing was reallocated
+        ASSERT_EQ(book.get(), address);
+        ASSERT_EQ(static_cast<const void*>(book->bids.data()), levels);
+        book.reset();
+    }
+    
+    EXPECT_EQ(misses(), initial_misses);
+    EXPECT_EQ(pool_->available(), 2u);
+}
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "deribit_api_client.h"
+#include "order_book_engine.h"
+#include "instrument_registry.h"
+
+using json = nlohmann::json;
+
+class OrderBookEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create book for a test instrument
+        book_ = std::make_unique<deribit::L2Book>("BTC-PERPETUAL");
+        
+        // Apply an initial snapshot
+        json snapshot = {
+            {"type", "snapshot"},
+            {"instrument_name", "BTC-PERPETUAL"},
+            {"timestamp", 1000},
+            {"change_id", 10},
+            {"bids", {{"new", 100.0, 1.0}, {"new", 99.5, 2.0}, {"new", 99.0, 3.0}}},
+            {"asks", {{"new", 100.5, 1.5}, {"new", 101.0, 2.5}}}
+        };
+        book_->apply(snapshot);
+    }
+    
+    void TearDown() override {
+        // Clean up
+        book_.reset();
+    }
+    
+    json make_change(int64_t prev_change_id, int64_t change_id, const json& bids, const json& asks) {
+        return {
+            {"type", "change"},
+            {"instrument_name", "BTC-PERPETUAL"},
+            {"timestamp", 1000 + change_id},
+            {"prev_change_id", prev_change_id},
+            {"change_id", change_id},
+            {"bids", bids},
+            {"asks", asks}
+        };
+    }
+    
+    std::unique_ptr<deribit::L2Book> book_;
+};
+
+// Test applying a snapshot
+TEST_F(OrderBookEngineTest, Snapshot) {
+    EXPECT_TRUE(book_->is_valid());
+    EXPECT_EQ(book_->change_id(), 10);
+    EXPECT_EQ(book_->bids(10).size(), 3u);
+    EXPECT_EQ(book_->asks(10).size(), 2u);
+    
+    ASSERT_NE(book_->best_bid(), nullptr);
+    EXPECT_DOUBLE_EQ(book_->best_bid()->price, 100.0);
+    ASSERT_NE(book_->best_ask(), nullptr);
+    EXPECT_DOUBLE_EQ(book_->best_ask()->price, 100.5);
+}
+
+// Test applying new, change and delete actions
+TEST_F(OrderBookEngineTest, ApplyChanges) {
+    json update = make_change(10, 11,
+        {{"new", 100.25, 4.0}, {"change", 99.5, 5.0}, {"delete", 99.0, 0.0}},
+        {{"delete", 100.5, 0.0}});
+    
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::APPLIED);
+    EXPECT_EQ(book_->change_id(), 11);
+    
+    // New level becomes the best bid
+    deribit::BookView bids = book_->bids(10);
+    ASSERT_EQ(bids.size(), 3u);
+    EXPECT_DOUBLE_EQ(bids[0].price, 100.25);
+    EXPECT_DOUBLE_EQ(bids[0].size, 4.0);
+    EXPECT_DOUBLE_EQ(bids[1].price, 100.0);
+    EXPECT_DOUBLE_EQ(bids[2].price, 99.5);
+    EXPECT_DOUBLE_EQ(bids[2].size, 5.0);
+    
+    // Deleted ask exposes the next level
+    ASSERT_NE(book_->best_ask(), nullptr);
+    EXPECT_DOUBLE_EQ(book_->best_ask()->price, 101.0);
+}
+
+// Test that old messages are ignored
+TEST_F(OrderBookEngineTest, StaleUpdate) {
+    json update = make_change(9, 10, {{"delete", 100.0, 0.0}}, json::array());
+    
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::STALE);
+    EXPECT_TRUE(book_->is_valid());
+    EXPECT_DOUBLE_EQ(book_->best_bid()->price, 100.0);
+}
+
+// Test sequence gap detection
+TEST_F(OrderBookEngineTest, GapDetection) {
+    json update = make_change(12, 13, {{"delete", 100.0, 0.0}}, json::array());
+    
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::GAP);
+    EXPECT_FALSE(book_->is_valid());
+    
+    // Further deltas cannot be applied until a new snapshot arrives
+    EXPECT_EQ(book_->apply(make_change(13, 14, json::array(), json::array())),
+              deribit::BookUpdateResult::GAP);
+}
+
+// Test limiting views to the requested depth
+TEST_F(OrderBookEngineTest, TopOfBook) {
+    deribit::BookView bids = book_->bids(2);
+    ASSERT_EQ(bids.size(), 2u);
+    EXPECT_DOUBLE_EQ(bids[0].price, 100.0);
+    EXPECT_DOUBLE_EQ(bids[1].price, 99.5);
+    
+    // Copy into an OrderBook for publishing
+    deribit::OrderBook orderbook;
+    book_->to_orderbook(orderbook, 1);
+    EXPECT_EQ(orderbook.instrument_name, "BTC-PERPETUAL");
+    ASSERT_EQ(orderbook.bids.size(), 1u);
+    ASSERT_EQ(orderbook.asks.size(), 1u);
+    EXPECT_DOUBLE_EQ(orderbook.asks[0].first, 100.5);
+}
+
+// Test grouped channel messages replacing the book
+TEST_F(OrderBookEngineTest, GroupedSnapshot) {
+    json update = {
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"timestamp", 2000},
+        {"change_id", 20},
+        {"bids", {{98.0, 1.0}}},
+        {"asks", {{102.0, 1.0}}}
+    };
+    
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::SNAPSHOT_APPLIED);
+    EXPECT_EQ(book_->bids(10).size(), 1u);
+    EXPECT_DOUBLE_EQ(book_->best_bid()->price, 98.0);
+    EXPECT_DOUBLE_EQ(book_->best_ask()->price, 102.0);
+}
+
+// Test engine buffering deltas while resyncing
+TEST_F(OrderBookEngineTest, EngineResync) {
+    auto api_client = std::make_shared<deribit::ApiClient>("test_api_key", "test_api_secret", true);
+    auto engine = std::make_shared<deribit::OrderBookEngine>(api_client);
+    
+    int callbacks = 0;
+    engine->set_book_callback([&callbacks](const deribit::L2Book&) {
+        callbacks++;
+    });
+    
+    // A delta without a snapshot starts a resync
+    EXPECT_EQ(engine->handle_update(make_change(10, 11, json::array(), json::array())),
+              deribit::BookUpdateResult::GAP);
+    EXPECT_EQ(engine->handle_update(make_change(11, 12, json::array(), json::array())),
+              deribit::BookUpdateResult::RESYNCING);
+    EXPECT_FALSE(engine->with_book("BTC-PERPETUAL", [](const deribit::L2Book&) {}));
+    
+    // A snapshot on the stream ends the resync
+    json snapshot = {
+        {"type", "snapshot"},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"timestamp", 1000},
+        {"change_id", 12},
+        {"bids", {{"new", 100.0, 1.0}}},
+        {"asks", {{"new", 100.5, 1.0}}}
+    };
+    EXPECT_EQ(engine->handle_update(snapshot), deribit::BookUpdateResult::SNAPSHOT_APPLIED);
+    EXPECT_EQ(engine->handle_update(make_change(12, 13, {{"change", 100.0, 2.0}}, json::array())),
+              deribit::BookUpdateResult::APPLIED);
+    EXPECT_EQ(callbacks, 2);
+    
+    double best_bid_size = 0.0;
+    EXPECT_TRUE(engine->with_book("BTC-PERPETUAL", [&best_bid_size](const deribit::L2Book& book) {
+        best_bid_size = book.best_bid()->size;
+    }));
+    EXPECT_DOUBLE_EQ(best_bid_size, 2.0);
+    
+    engine.reset();
+    api_client.reset();
+}
+
+// Test applying a decoded update
+TEST_F(OrderBookEngineTest, TypedUpdate) {
+    deribit::BookUpdate update;
+    update.instrument_name = "BTC-PERPETUAL";
+    update.prev_change_id = 10;
+    update.change_id = 11;
+    update.bids.push_back({deribit::BookAction::DELETE, 100.0, 0.0});
+    update.asks.push_back({deribit::BookAction::NEW, 100.25, 4.0});
+    
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::APPLIED);
+    EXPECT_DOUBLE_EQ(book_->best_bid()->price, 99.5);
+    EXPECT_DOUBLE_EQ(book_->best_ask()->price, 100.25);
+    
+    // The same update again is stale
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::STALE);
+    
+    update.prev_change_id = 12;
+    update.change_id = 13;
+    EXPECT_EQ(book_->apply(update), deribit::BookUpdateResult::GAP);
+}
+
+// Test invalidated books are refused until a snapshot arrives
+TEST_F(OrderBookEngineTest, InvalidateAll) {
+    auto api_client = std::make_shared<deribit::ApiClient>("test_api_key", "test_api_secret", true);
+    auto engine = std::make_shared<deribit::OrderBookEngine>(api_client);
+    
+    json snapshot = {
+        {"type", "snapshot"},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"timestamp", 1000},
+        {"change_id", 10},
+        {"bids", {{"new", 100.0, 1.0}}},
+        {"asks", {{"new", 100.5, 1.0}}}
+    };
+    EXPECT_EQ(engine->handle_update(snapshot), deribit::BookUpdateResult::SNAPSHOT_APPLIED);
+    EXPECT_TRUE(engine->with_book("BTC-PERPETUAL", [](const deribit::L2Book&) {}));
+    
+    // As when the feed drops
+    engine->invalidate_all();
+    EXPECT_FALSE(engine->with_book("BTC-PERPETUAL", [](const deribit::L2Book&) {}));
+    
+    // Resubscribing delivers a fresh snapshot
+    snapshot["change_id"] = 20;
+    EXPECT_EQ(engine->handle_update(snapshot), deribit::BookUpdateResult::SNAPSHOT_APPLIED);
+    EXPECT_TRUE(engine->with_book("BTC-PERPETUAL", [](const deribit::L2Book&) {}));
+    
+    engine.reset();
+    api_client.reset();
+}
+
+// Test books carry the registry id, resolved by the snapshot after the instrument is loaded
+TEST_F(OrderBookEngineTest, InstrumentId) {
+    auto api_client = std::make_shared<deribit::ApiClient>("test_api_key", "test_api_secret", true);
+    auto registry = std::make_shared<deribit::InstrumentRegistry>();
+    auto engine = std::make_shared<deribit::OrderBookEngine>(api_client);
+    engine->set_instrument_registry(registry);
+    
+    deribit::InstrumentId published = 0;
+    engine->set_book_callback([&published](const deribit::L2Book& book) {
+        published = book.instrument_id();
+    });
+    
+    json snapshot = {
+        {"type", "snapshot"},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"timestamp", 1000},
+        {"change_id", 10},
+        {"bids", {{"new", 100.0, 1.0}}},
+        {"asks", {{"new", 100.5, 1.0}}}
+    };
+    EXPECT_EQ(engine->handle_update(snapshot), deribit::BookUpdateResult::SNAPSHOT_APPLIED);
+    EXPECT_EQ(published, deribit::INVALID_INSTRUMENT_ID);
+    
+    deribit::InstrumentId id = registry->upsert({
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"base_currency", "BTC"},
+        {"kind", "future"},
+        {"tick_size", 0.5},
+        {"min_trade_amount", 10.0},
+        {"contract_size", 10.0},
+        {"is_active", true}
+    });
+    ASSERT_NE(id, deribit::INVALID_INSTRUMENT_ID);
+    
+    snapshot["change_id"] = 20;
+    EXPECT_EQ(engine->handle_update(snapshot), deribit::BookUpdateResult::SNAPSHOT_APPLIED);
+    EXPECT_EQ(published, id);
+    
+    // Deltas keep the id without looking it up again
+    published = deribit::INVALID_INSTRUMENT_ID;
+    EXPECT_EQ(engine->handle_update(make_change(20, 21, json::array({{"new", 99.5, 1.0}}), json::array())),
+              deribit::BookUpdateResult::APPLIED);
+    EXPECT_EQ(published, id);
+    
+    engine.reset();
+    api_client.reset();
+}
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <memory>
 #include <string>
+#include <future>
+#include <vector>
+#include <chrono>
 #include "deribit_api_client.h"
 #include "order_manager.h"
 
@@ -36,6 +39,16 @@ TEST_F(OrderManagerTest, Creation) {
     EXPECT_TRUE(order_manager_ != nullptr);
 }
 
+// Test selecting the order entry transport
+TEST_F(OrderManagerTest, Transport) {
+    // REST is the default
+    EXPECT_EQ(order_manager_->get_transport(), deribit::OrderTransport::REST);
+    
+    // Switch to WebSocket order entry
+    order_manager_->set_transport(deribit::OrderTransport::WEBSOCKET);
+    EXPECT_EQ(order_manager_->get_transport(), deribit::OrderTransport::WEBSOCKET);
+}
+
 // Test placing an order
 TEST_F(OrderManagerTest, PlaceOrder) {
     // Skip actual API call in unit tests
@@ -61,6 +74,135 @@ TEST_F(OrderManagerTest, PlaceOrder) {
     order_manager_->cancel_order(order_id);
 }
 
+// Test that asynchronous requests with invalid parameters complete without a round trip
+TEST_F(OrderManagerTest, AsyncValidation) {
+    // Empty instrument name
+    std::future<std::string> order_future = order_manager_->place_order_async(
+        "",
+        deribit::OrderType::LIMIT,
+        deribit::OrderDirection::BUY,
+        0.1,  // amount
+        10000.0  // price
+    );
+    EXPECT_TRUE(order_future.get().empty());
+    
+    // Empty order ID
+    EXPECT_FALSE(order_manager_->cancel_order_async("").get());
+    
+    // Neither amount nor price
+    EXPECT_FALSE(order_manager_->modify_order_async("order", 0.0, 0.0).get());
+}
+
+// Test that batch operations report invalid entries individually without a round trip
+TEST_F(OrderManagerTest, BatchValidation) {
+    std::vector<deribit::OrderRequest> requests(2);
+    requests[0].instrument_name = "";
+    requests[0].amount = 1.0;
+    requests[0].price = 100.0;
+    requests[1].instrument_name = "BTC-PERPETUAL";
+    requests[1].amount = 0.0;
+    requests[1].price = 100.0;
+    
+    std::vector<deribit::OrderResult> results = order_manager_->place_orders(requests);
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_FALSE(results[0].success);
+    EXPECT_FALSE(results[0].error_message.empty());
+    EXPECT_FALSE(results[1].success);
+    
+    std::vector<deribit::OrderModification> modifications = {{"", 1.0, 100.0}, {"order", 0.0, 0.0}};
+    results = order_manager_->modify_orders(modifications);
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_FALSE(results[0].success);
+    EXPECT_FALSE(results[1].success);
+    EXPECT_EQ(results[1].order_id, "order");
+    
+    EXPECT_TRUE(order_manager_->place_orders({}).empty());
+    
+    // Scoped cancels need a value
+    EXPECT_EQ(order_manager_->cancel_all(deribit::CancelScope::INSTRUMENT, ""), -1);
+    EXPECT_EQ(order_manager_->cancel_all(deribit::CancelScope::LABEL, ""), -1);
+}
+
+// Test that requoting reuses resting quotes when nothing changed
+TEST_F(OrderManagerTest, ReplaceQuotesUnchanged) {
+    order_manager_->handle_order_update({
+        {"order_id", "Q-1"},
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"label", "mm"},
+        {"order_type", "limit"},
+        {"direction", "buy"},
+        {"price", 100.0},
+        {"amount", 10.0},
+        {"time_in_force", "good_til_cancelled"},
+        {"order_state", "open"},
+        {"creation_timestamp", 1700000000000},
+        {"last_update_timestamp", 1700000000000}
+    });
+    
+    deribit::OrderRequest quote;
+    quote.instrument_name = "BTC-PERPETUAL";
+    quote.direction = deribit::OrderDirection::BUY;
+    quote.amount = 10.0;
+    quote.price = 100.0;
+    
+    std::vector<deribit::OrderResult> results = order_manager_->replace_quotes("mm", {quote});
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_TRUE(results[0].success);
+    EXPECT_EQ(results[0].order_id, "Q-1");
+    
+    // An invalid new quote fails locally
+    quote.direction = deribit::OrderDirection::SELL;
+    quote.amount = -1.0;
+    results = order_manager_->replace_quotes("other", {quote});
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_FALSE(results[0].success);
+    
+    // A resting quote left out of the new set is cancelled and reported after the quotes
+    results = order_manager_->replace_quotes("mm", {});
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].order_id, "Q-1");
+    EXPECT_FALSE(results[0].success);
+}
+
+// Test that orders violating instrument metadata are rejected locally
+TEST_F(OrderManagerTest, InstrumentValidation) {
+    auto registry = std::make_shared<deribit::InstrumentRegistry>();
+    registry->upsert({
+        {"instrument_name", "BTC-PERPETUAL"},
+        {"base_currency", "BTC"},
+        {"kind", "future"},
+        {"tick_size", 0.5},
+        {"min_trade_amount", 10.0},
+        {"contract_size", 10.0},
+        {"is_active", true}
+    });
+    order_manager_->set_instrument_registry(registry);
+    
+    // Price off the tick grid
+    EXPECT_TRUE(order_manager_->place_order_async("BTC-PERPETUAL", deribit::OrderType::LIMIT,
+                                                  deribit::OrderDirection::BUY, 10.0, 10000.25).get().empty());
+    
+    // Amount below the minimum
+    EXPECT_TRUE(order_manager_->place_order_async("BTC-PERPETUAL", deribit::OrderType::LIMIT,
+                                                  deribit::OrderDirection::BUY, 5.0, 10000.5).get().empty());
+}
+
+// Test that orders rejected by the risk gate are not sent
+TEST_F(OrderManagerTest, RiskGateRejection) {
+    auto gate = std::make_shared<deribit::RiskGate>();
+    deribit::RiskLimits limits;
+    limits.max_order_amount = 100.0;
+    gate->set_default_limits(limits);
+    order_manager_->set_risk_gate(gate);
+    
+    auto rejections = deribit::PerformanceMonitor::instance().get_counter("risk_rejections.order_amount");
+    int64_t before = rejections->get();
+    
+    EXPECT_TRUE(order_manager_->place_order_async("BTC-PERPETUAL", deribit::OrderType::LIMIT,
+                                                  deribit::OrderDirection::BUY, 500.0, 10000.0).get().empty());
+    EXPECT_EQ(rejections->get(), before + 1);
+}
+
 // Test canceling an order
 TEST_F(OrderManagerTest, CancelOrder) {
     // Skip actual API call in unit tests
@@ -129,6 +271,44 @@ TEST_F(OrderManagerTest, GetOrderbook) {
     EXPECT_FALSE(orderbook.timestamp.empty());
 }
 
+// Test serving orderbooks from the stream-fed cache
+TEST_F(OrderManagerTest, CachedOrderbook) {
+    std::vector<deribit::PriceLevel> bids = {{100.0, 1.0}, {99.5, 2.0}, {99.0, 3.0}};
+    std::vector<deribit::PriceLevel> asks = {{100.5, 1.5}};
+    
+    order_manager_->update_orderbook("BTC-PERPETUAL",
+                                     deribit::BookView{bids.data(), bids.size()},
+                                     deribit::BookView{asks.data(), asks.size()},
+                                     1000);
+    
+    // Depth is honoured on every read
+    deribit::OrderBook orderbook = order_manager_->get_orderbook("BTC-PERPETUAL", 2);
+    EXPECT_EQ(orderbook.instrument_name, "BTC-PERPETUAL");
+    ASSERT_EQ(orderbook.bids.size(), 2u);
+    EXPECT_DOUBLE_EQ(orderbook.bids[0].first, 100.0);
+    EXPECT_DOUBLE_EQ(orderbook.bids[1].first, 99.5);
+    ASSERT_EQ(orderbook.asks.size(), 1u);
+    EXPECT_EQ(orderbook.timestamp, "1000");
+    
+    // Snapshot reads carry their freshness
+    deribit::BookSnapshot snapshot;
+    ASSERT_TRUE(order_manager_->get_orderbook_snapshot("BTC-PERPETUAL", snapshot));
+    EXPECT_EQ(snapshot.bid_count, 3u);
+    EXPECT_LT(snapshot.age(), std::chrono::seconds(1));
+    
+    // Invalidated books are no longer served
+    order_manager_->invalidate_orderbook("BTC-PERPETUAL");
+    EXPECT_FALSE(order_manager_->get_orderbook_snapshot("BTC-PERPETUAL", snapshot));
+}
+
+// Test configuring the maximum orderbook staleness
+TEST_F(OrderManagerTest, OrderbookStaleness) {
+    EXPECT_EQ(order_manager_->get_max_orderbook_staleness(), std::chrono::milliseconds(5000));
+    
+    order_manager_->set_max_orderbook_staleness(std::chrono::milliseconds(250));
+    EXPECT_EQ(order_manager_->get_max_orderbook_staleness(), std::chrono::milliseconds(250));
+}
+
 // Test getting positions
 TEST_F(OrderManagerTest, GetPositions) {
     // Skip actual API call in unit tests
@@ -170,13 +350,52 @@ TEST_F(OrderManagerTest, GetOpenOrders) {
     api_client_->authenticate();
     
     // Get open orders
-    std::vector<deribit::Order> orders = order_manager_->get_open_orders();
+    EXPECT_GE(order_manager_->refresh_open_orders(), 0);
+    deribit::OrderStore::Snapshot orders = order_manager_->get_open_orders();
     
     // Check result (may be empty if no open orders)
     // Just check that the call doesn't throw
     SUCCEED();
 }
 
+// Test that order updates maintain the local open order snapshot
+TEST_F(OrderManagerTest, OrderUpdates) {
+    deribit::json update = {
+        {"order_id", "ETH-1"},
+        {"instrument_name", "ETH-PERPETUAL"},
+        {"order_type", "limit"},
+        {"direction", "sell"},
+        {"price", 2000.5},
+        {"amount", 10.0},
+        {"time_in_force", "good_til_cancelled"},
+        {"order_state", "open"},
+        {"creation_timestamp", 1700000000000},
+        {"last_update_timestamp", 1700000000100}
+    };
+    order_manager_->handle_order_update(update);
+    
+    deribit::OrderStore::Snapshot orders = order_manager_->get_open_orders();
+    ASSERT_EQ(orders->size(), 1u);
+    EXPECT_EQ((*orders)[0].order_id, "ETH-1");
+    EXPECT_EQ((*orders)[0].direction, deribit::OrderDirection::SELL);
+    EXPECT_EQ((*orders)[0].status, deribit::OrderStatus::OPEN);
+    EXPECT_EQ((*orders)[0].created_at, 1700000000000);
+    EXPECT_EQ((*orders)[0].last_updated_at, 1700000000100);
+    
+    // An unchanged store hands out the same snapshot
+    EXPECT_EQ(order_manager_->get_open_orders(), orders);
+    
+    auto order = order_manager_->get_order("ETH-1");
+    ASSERT_TRUE(order != nullptr);
+    EXPECT_DOUBLE_EQ(order->price, 2000.5);
+    
+    // Filled orders leave the store; the old snapshot is unaffected
+    update["order_state"] = "filled";
+    order_manager_->handle_order_update(update);
+    EXPECT_TRUE(order_manager_->get_open_orders()->empty());
+    EXPECT_EQ(orders->size(), 1u);
+}
+
 // Test getting a specific order
 TEST_F(OrderManagerTest, GetOrder) {
     // Skip actual API call in unit tests
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "order_store.h"
+
+class OrderStoreTest : public ::testing::Test {
+protected:
+    deribit::Order make_order(const std::string& order_id, double price) {
+        deribit::Order order;
+        order.order_id = order_id;
+        order.instrument_name = "BTC-PERPETUAL";
+        order.price = price;
+        order.amount = 10.0;
+        order.status = deribit::OrderStatus::OPEN;
+        order.created_at = 1700000000000;
+        order.last_updated_at = 1700000000000;
+        return order;
+    }
+    
+    deribit::OrderStore store_{4};
+};
+
+// Test converting order states
+TEST_F(OrderStoreTest, Status) {
+    EXPECT_EQ(deribit::parse_order_status("open"), deribit::OrderStatus::OPEN);
+    EXPECT_EQ(deribit::parse_order_status("untriggered"), deribit::OrderStatus::UNTRIGGERED);
+    EXPECT_EQ(deribit::parse_order_status("cancelled"), deribit::OrderStatus::CANCELLED);
+    EXPECT_EQ(deribit::parse_order_status("bogus"), deribit::OrderStatus::UNKNOWN);
+    EXPECT_STREQ(deribit::order_status_to_string(deribit::OrderStatus::FILLED), "filled");
+}
+
+// Test inserting, finding and updating orders
+TEST_F(OrderStoreTest, Upsert) {
+    deribit::OrderHandle first = store_.upsert(make_order("1", 100.0));
+    deribit::OrderHandle second = store_.upsert(make_order("2", 101.0));
+    EXPECT_NE(first, second);
+    EXPECT_EQ(store_.size(), 2u);
+    
+    ASSERT_TRUE(store_.find("1") != nullptr);
+    EXPECT_DOUBLE_EQ(store_.find("1")->price, 100.0);
+    EXPECT_TRUE(store_.find("3") == nullptr);
+    
+    // Replacing keeps the handle
+    EXPECT_EQ(store_.upsert(make_order("1", 99.5)), first);
+    EXPECT_EQ(store_.size(), 2u);
+    ASSERT_TRUE(store_.get(first) != nullptr);
+    EXPECT_DOUBLE_EQ(store_.get(first)->price, 99.5);
+    EXPECT_EQ(store_.handle("2"), second);
+    EXPECT_EQ(store_.handle("3"), deribit::INVALID_ORDER_HANDLE);
+    
+    // Updating in place
+    deribit::Order& order = store_.emplace("2");
+    order.amount = 20.0;
+    EXPECT_DOUBLE_EQ(store_.get(second)->amount, 20.0);
+}
+
+// Test handles of erased orders no longer resolve when slots are reused
+TEST_F(OrderStoreTest, StaleHandles) {
+    deribit::OrderHandle first = store_.upsert(make_order("1", 100.0));
+    
+    EXPECT_TRUE(store_.erase("1"));
+    EXPECT_FALSE(store_.erase("1"));
+    EXPECT_TRUE(store_.get(first) == nullptr);
+    
+    // The next order reuses the slot under a new handle
+    deribit::OrderHandle reused = store_.upsert(make_order("2", 101.0));
+    EXPECT_NE(reused, first);
+    EXPECT_TRUE(store_.get(first) == nullptr);
+    ASSERT_TRUE(store_.get(reused) != nullptr);
+    EXPECT_EQ(store_.get(reused)->order_id, "2");
+    EXPECT_EQ(store_.size(), 1u);
+    
+    store_.clear();
+    EXPECT_EQ(store_.size(), 0u);
+    EXPECT_TRUE(store_.get(reused) == nullptr);
+    EXPECT_TRUE(store_.find("2") == nullptr);
+}
+
+// Test snapshots are shared until the store changes
+TEST_F(OrderStoreTest, Snapshot) {
+    store_.upsert(make_order("1", 100.0));
+    store_.upsert(make_order("2", 101.0));
+    
+    deribit::OrderStore::Snapshot snapshot = store_.snapshot();
+    ASSERT_EQ(snapshot->size(), 2u);
+    EXPECT_EQ(store_.snapshot(), snapshot);
+    
+    // Const lookups do not invalidate it
+    const deribit::OrderStore& const_store = store_;
+    EXPECT_TRUE(const_store.find("1") != nullptr);
+    EXPECT_EQ(store_.snapshot(), snapshot);
+    
+    store_.erase("1");
+    deribit::OrderStore::Snapshot updated = store_.snapshot();
+    EXPECT_NE(updated, snapshot);
+    ASSERT_EQ(updated->size(), 1u);
+    EXPECT_EQ((*updated)[0].order_id, "2");
+    EXPECT_EQ(snapshot->size(), 2u);
+    
+    size_t visited = 0;
+    store_.for_each([&visited](const deribit::Order& order) {
+        EXPECT_EQ(order.order_id, "2");
+        ++visited;
+    });
+    EXPECT_EQ(visited, 1u);
+}
+
+// Test the store grows past its initial capacity
+TEST_F(OrderStoreTest, Growth) {
+    std::vector<deribit::OrderHandle> handles;
+    for (int i = 0; i < 100; ++i) {
+        handles.push_back(store_.upsert(make_order(std::to_string(i), 100.0 + i)));
+    }
+    
+    EXPECT_EQ(store_.size(), 100u);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(store_.get(handles[i]) != nullptr);
+        EXPECT_DOUBLE_EQ(store_.get(handles[i])->price, 100.0 + i);
+    }
+}
+
+// Test removing orders by predicate
+TEST_F(OrderStoreTest, EraseIf) {
+    store_.upsert(make_order("1", 100.0));
+    deribit::Order other = make_order("2", 101.0);
+    other.instrument_name = "ETH-PERPETUAL";
+    store_.upsert(other);
+    store_.upsert(make_order("3", 102.0));
+    
+    size_t removed = store_.erase_if([](const deribit::Order& order) {
+        return order.instrument_name == "BTC-PERPETUAL";
+    });
+    
+    EXPECT_EQ(removed, 2u);
+    EXPECT_EQ(store_.size(), 1u);
+    EXPECT_TRUE(store_.find("1") == nullptr);
+    EXPECT_TRUE(store_.find("2") != nullptr);
+}
\ No newline at end of file
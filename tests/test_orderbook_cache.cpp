@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "orderbook_cache.h"
+
+class OrderBookCacheTest : public ::testing::Test {
+protected:
+    deribit::BookView view(const std::vector<deribit::PriceLevel>& levels) {
+        return deribit::BookView{levels.data(), levels.size()};
+    }
+    
+    deribit::OrderBookCache cache_{16};
+};
+
+// Test storing and loading a snapshot
+TEST_F(OrderBookCacheTest, StoreAndLoad) {
+    std::vector<deribit::PriceLevel> bids = {{100.0, 1.0}, {99.0, 2.0}};
+    std::vector<deribit::PriceLevel> asks = {{101.0, 3.0}};
+    
+    deribit::BookSnapshot snapshot;
+    EXPECT_FALSE(cache_.load("BTC-PERPETUAL", snapshot));
+    
+    EXPECT_TRUE(cache_.store("BTC-PERPETUAL", view(bids), view(asks), 1234, 10));
+    ASSERT_TRUE(cache_.load("BTC-PERPETUAL", snapshot));
+    
+    EXPECT_EQ(snapshot.bid_count, 2u);
+    EXPECT_EQ(snapshot.ask_count, 1u);
+    EXPECT_EQ(snapshot.depth, 10u);
+    EXPECT_EQ(snapshot.timestamp, 1234);
+    EXPECT_DOUBLE_EQ(snapshot.bids[1].price, 99.0);
+    EXPECT_DOUBLE_EQ(snapshot.asks[0].size, 3.0);
+    
+    // Other instruments are unaffected
+    EXPECT_FALSE(cache_.load("ETH-PERPETUAL", snapshot));
+    
+    // Invalidating every instrument drops the snapshot until the next store
+    cache_.invalidate_all();
+    EXPECT_FALSE(cache_.load("BTC-PERPETUAL", snapshot));
+    EXPECT_TRUE(cache_.store("BTC-PERPETUAL", view(bids), view(asks), 1235, 10));
+    EXPECT_TRUE(cache_.load("BTC-PERPETUAL", snapshot));
+}
+
+// Test that snapshots are capped at the maximum depth
+TEST_F(OrderBookCacheTest, DepthLimit) {
+    std::vector<deribit::PriceLevel> bids;
+    for (size_t i = 0; i < deribit::BookSnapshot::MAX_DEPTH + 10; ++i) {
+        bids.push_back({100.0 - i, 1.0});
+    }
+    
+    cache_.store("BTC-PERPETUAL", view(bids), deribit::BookView(), 0, bids.size());
+    
+    deribit::BookSnapshot snapshot;
+    ASSERT_TRUE(cache_.load("BTC-PERPETUAL", snapshot));
+    EXPECT_EQ(snapshot.bid_count, deribit::BookSnapshot::MAX_DEPTH);
+    EXPECT_EQ(snapshot.depth, deribit::BookSnapshot::MAX_DEPTH);
+}
+
+// Test filling the table
+TEST_F(OrderBookCacheTest, Capacity) {
+    for (int i = 0; i < 16; ++i) {
+        EXPECT_TRUE(cache_.store("INSTRUMENT-" + std::to_string(i), deribit::BookView(), deribit::BookView(), 0, 0));
+    }
+    
+    EXPECT_FALSE(cache_.store("INSTRUMENT-16", deribit::BookView(), deribit::BookView(), 0, 0));
+}
+
+// Test that readers never observe a partially written snapshot
+TEST_F(OrderBookCacheTest, ConsistentReads) {
+    std::atomic<bool> running{true};
+    
+    std::thread writer([this, &running]() {
+        std::vector<deribit::PriceLevel> bids(deribit::BookSnapshot::MAX_DEPTH);
+        int64_t version = 1;
+        
+        while (running) {
+            // Every level of a given version carries the same size
+            for (auto& level : bids) {
+                level.price = 100.0;
+                level.size = static_cast<double>(version);
+            }
+            cache_.store("BTC-PERPETUAL", view(bids), deribit::BookView(), version, bids.size());
+            version++;
+        }
+    });
+    
+    deribit::BookSnapshot snapshot;
+    for (int i = 0; i < 10000; ++i) {
+        if (!cache_.load("BTC-PERPETUAL", snapshot)) {
+            continue;
+        }
+        
+        for (uint32_t level = 0; level < snapshot.bid_count; ++level) {
+            ASSERT_DOUBLE_EQ(snapshot.bids[level].size, static_cast<double>(snapshot.timestamp));
+        }
+    }
+    
+    running = false;
+    writer.join();
+}
\ No newline at end of file
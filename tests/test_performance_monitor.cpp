@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include "performance_monitor.h"
+
+class PerformanceMonitorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Start every test from clean metrics
+        deribit::PerformanceMonitor::instance().reset_all();
+    }
+    
+    void TearDown() override {
+        // Restore the default clock source
+        deribit::PerformanceMonitor::instance().set_clock_source(deribit::ClockSource::STEADY_CLOCK);
+    }
+};
+
+// Test that a tracker is created once per name
+TEST_F(PerformanceMonitorTest, GetTracker) {
+    auto first = deribit::PerformanceMonitor::instance().get_tracker("test_get_tracker");
+    auto second = deribit::PerformanceMonitor::instance().get_tracker("test_get_tracker");
+    
+    EXPECT_TRUE(first != nullptr);
+    EXPECT_EQ(first, second);
+}
+
+// Test timing an operation with a start token
+TEST_F(PerformanceMonitorTest, StartEnd) {
+    auto tracker = deribit::PerformanceMonitor::instance().get_tracker("test_start_end", true);
+    
+    auto token = tracker->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    tracker->end(token);
+    
+    deribit::LatencyMetric metric = tracker->get_metrics();
+    EXPECT_EQ(metric.count, 1u);
+    EXPECT_GE(metric.min_latency, std::chrono::milliseconds(1));
+    EXPECT_EQ(metric.min_latency, metric.max_latency);
+    EXPECT_EQ(metric.histogram.count(), 1u);
+    EXPECT_EQ(metric.window_histogram.count(), 1u);
+}
+
+// Test recording externally measured latencies
+TEST_F(PerformanceMonitorTest, Record) {
+    auto tracker = deribit::PerformanceMonitor::instance().get_tracker("test_record", true);
+    
+    tracker->record(std::chrono::nanoseconds(300));
+    tracker->record(std::chrono::nanoseconds(100));
+    tracker->record(std::chrono::nanoseconds(200));
+    
+    deribit::LatencyMetric metric = tracker->get_metrics();
+    EXPECT_EQ(metric.count, 3u);
+    EXPECT_EQ(metric.min_latency.count(), 100);
+    EXPECT_EQ(metric.max_latency.count(), 300);
+    EXPECT_DOUBLE_EQ(metric.average_latency_ns(), 200.0);
+    
+    // Percentiles come from the histogram, within its bucket precision
+    EXPECT_EQ(metric.histogram.count(), 3u);
+    EXPECT_NEAR(metric.percentile_latency_ns(50), 200.0, 2.0);
+    EXPECT_DOUBLE_EQ(metric.window_percentile_latency_ns(100), 300.0);
+    
+    // Reset clears everything
+    tracker->reset();
+    metric = tracker->get_metrics();
+    EXPECT_EQ(metric.count, 0u);
+    EXPECT_EQ(metric.histogram.count(), 0u);
+    EXPECT_EQ(metric.window_histogram.count(), 0u);
+}
+
+// Test concurrent use of one tracker
+TEST_F(PerformanceMonitorTest, ConcurrentRecord) {
+    auto tracker = deribit::PerformanceMonitor::instance().get_tracker("test_concurrent");
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([tracker]() {
+            for (int i = 0; i < 10000; ++i) {
+                tracker->end(tracker->start());
+            }
+        });
+    }
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    EXPECT_EQ(tracker->get_metrics().count, 40000u);
+}
+
+// Test using the timestamp counter as the time source
+TEST_F(PerformanceMonitorTest, TscClockSource) {
+    deribit::PerformanceMonitor::instance().set_clock_source(deribit::ClockSource::TSC);
+    auto tracker = deribit::PerformanceMonitor::instance().get_tracker("test_tsc");
+    
+    auto token = tracker->start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    tracker->end(token);
+    
+    // Converted latencies are in nanoseconds
+    deribit::LatencyMetric metric = tracker->get_metrics();
+    EXPECT_EQ(metric.count, 1u);
+    EXPECT_GT(metric.max_latency, std::chrono::milliseconds(1));
+    EXPECT_LT(metric.max_latency, std::chrono::seconds(1));
+}
+
+// Test counters
+TEST_F(PerformanceMonitorTest, Counters) {
+    auto counter = deribit::PerformanceMonitor::instance().get_counter("test_counter");
+    counter->set(0);
+    
+    counter->add();
+    counter->add(4);
+    counter->add(-2);
+    EXPECT_EQ(counter->get(), 3);
+    
+    counter->update_max(2);
+    EXPECT_EQ(counter->get(), 3);
+    counter->update_max(7);
+    EXPECT_EQ(counter->get(), 7);
+    
+    auto counters = deribit::PerformanceMonitor::instance().get_all_counters();
+    EXPECT_EQ(counters["test_counter"], 7);
+}
+
+// Test that each scope of a TRACK_LATENCY call site is recorded in the named tracker
+TEST_F(PerformanceMonitorTest, TrackLatency) {
+    for (int i = 0; i < 3; ++i) {
+        TRACK_LATENCY("test_track_latency");
+    }
+    
+    auto tracker = deribit::PerformanceMonitor::instance().get_tracker("test_track_latency");
+    EXPECT_EQ(tracker->get_metrics().count, 3u);
+}
\ No newline at end of file
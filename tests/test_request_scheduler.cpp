@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <future>
+#include <string>
+#include <vector>
+#include "request_scheduler.h"
+
+using deribit::ApiResponse;
+using deribit::RequestLane;
+using deribit::RequestScheduler;
+
+class RequestSchedulerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Bursts of 2 matching engine and 3 other requests, one more of each per second
+        config_.matching_engine = {2.0, 1.0, 1.0};
+        config_.non_matching_engine = {3.0, 1.0, 1.0};
+        config_.max_queued = 8;
+        now_ = RequestScheduler::now_ns();
+    }
+    
+    // Records what is sent and answers with the method name
+    RequestScheduler::SendFunction recorder() {
+        return [this](const std::string& method, const deribit::json& params,
+                      RequestScheduler::ResponseCallback callback) {
+            sent_.push_back(method + params.dump());
+            callback(ApiResponse{true, method, ""});
+        };
+    }
+    
+    RequestScheduler::ResponseCallback counter(int& replies, int& failures) {
+        return [&replies, &failures](const ApiResponse& response) {
+            (response.success ? replies : failures)++;
+        };
+    }
+    
+    deribit::RateLimitConfig config_;
+    std::vector<std::string> sent_;
+    int64_t now_{0};
+};
+
+// Test the lane of each kind of method
+TEST_F(RequestSchedulerTest, Classify) {
+    EXPECT_EQ(RequestScheduler::classify("private/cancel"), RequestLane::CANCEL);
+    EXPECT_EQ(RequestScheduler::classify("private/cancel_all_by_currency"), RequestLane::CANCEL);
+    EXPECT_EQ(RequestScheduler::classify("private/buy"), RequestLane::ORDER_ENTRY);
+    EXPECT_EQ(RequestScheduler::classify("private/edit"), RequestLane::ORDER_ENTRY);
+    EXPECT_EQ(RequestScheduler::classify("private/get_positions"), RequestLane::QUERY);
+    EXPECT_EQ(RequestScheduler::classify("public/get_order_book"), RequestLane::QUERY);
+}
+
+// Test that a burst is sent at once and the rest as credit refills
+TEST_F(RequestSchedulerTest, TokenBucket) {
+    RequestScheduler scheduler(config_);
+    int replies = 0, failures = 0;
+    
+    for (int i = 0; i < 4; ++i) {
+        scheduler.submit("private/buy", {{"amount", i}}, counter(replies, failures), recorder());
+    }
+    
+    int64_t wait = scheduler.dispatch(now_);
+    EXPECT_EQ(sent_.size(), 2u);
+    EXPECT_EQ(scheduler.queued(), 2u);
+    EXPECT_EQ(wait, 1000000000);
+    
+    // Queries draw from the other pool
+    scheduler.submit("private/get_positions", {}, counter(replies, failures), recorder());
+    scheduler.dispatch(now_);
+    EXPECT_EQ(sent_.size(), 3u);
+    
+    scheduler.dispatch(now_ + 1000000000);
+    EXPECT_EQ(sent_.size(), 4u);
+    EXPECT_EQ(sent_.back(), "private/buy{\"amount\":2}");
+    
+    scheduler.dispatch(now_ + 2000000000);
+    EXPECT_EQ(sent_.size(), 5u);
+    EXPECT_EQ(scheduler.dispatch(now_ + 2000000000), -1);
+    EXPECT_EQ(replies, 5);
+    EXPECT_EQ(failures, 0);
+}
+
+// Test that cancels overtake queued order entry
+TEST_F(RequestSchedulerTest, CancelPriority) {
+    RequestScheduler scheduler(config_);
+    int replies = 0, failures = 0;
+    
+    scheduler.dispatch(now_);
+    for (int i = 0; i < 3; ++i) {
+        scheduler.submit("private/buy", {{"amount", i}}, counter(replies, failures), recorder());
+    }
+    scheduler.dispatch(now_);
+    ASSERT_EQ(sent_.size(), 2u);
+    
+    scheduler.submit("private/cancel", {{"order_id", "1"}}, counter(replies, failures), recorder());
+    scheduler.dispatch(now_ + 1000000000);
+    ASSERT_EQ(sent_.size(), 3u);
+    EXPECT_EQ(sent_.back(), "private/cancel{\"order_id\":\"1\"}");
+}
+
+// Test folding of redundant requests while they wait
+TEST_F(RequestSchedulerTest, Merge) {
+    RequestScheduler scheduler(config_);
+    int replies = 0, failures = 0;
+    
+    // Exhaust the matching engine pool so requests queue
+    scheduler.submit("private/buy", {{"amount", 1}}, counter(replies, failures), recorder());
+    scheduler.submit("private/buy", {{"amount", 1}}, counter(replies, failures), recorder());
+    scheduler.dispatch(now_);
+    ASSERT_EQ(sent_.size(), 2u);
+    sent_.clear();
+    
+    // Edits of one order keep the latest contents
+    scheduler.submit("private/edit", {{"order_id", "A"}, {"price", 1.0}}, counter(replies, failures), recorder());
+    scheduler.submit("private/edit", {{"order_id", "A"}, {"price", 2.0}}, counter(replies, failures), recorder());
+    scheduler.submit("private/edit", {{"order_id", "B"}, {"price", 3.0}}, counter(replies, failures), recorder());
+    EXPECT_EQ(scheduler.queued(), 2u);
+    
+    // A cancel drops the pending edits of its order
+    scheduler.submit("private/cancel", {{"order_id", "B"}}, counter(replies, failures), recorder());
+    EXPECT_EQ(scheduler.queued(), 2u);
+    EXPECT_EQ(failures, 1);
+    
+    // Identical buys are separate orders
+    scheduler.submit("private/buy", {{"amount", 1}}, counter(replies, failures), recorder());
+    scheduler.submit("private/buy", {{"amount", 1}}, counter(replies, failures), recorder());
+    EXPECT_EQ(scheduler.queued(), 4u);
+    
+    scheduler.dispatch(now_ + 2000000000);
+    ASSERT_EQ(sent_.size(), 2u);
+    EXPECT_EQ(sent_[0], "private/cancel{\"order_id\":\"B\"}");
+    EXPECT_EQ(sent_[1], "private/edit{\"order_id\":\"A\",\"price\":2.0}");
+    EXPECT_EQ(replies, 2 + 3);
+}
+
+// Test that identical read-only queries are sent once
+TEST_F(RequestSchedulerTest, MergeQueries) {
+    RequestScheduler scheduler(config_);
+    int replies = 0, failures = 0;
+    
+    scheduler.submit("private/get_positions", {}, counter(replies, failures), recorder());
+    scheduler.submit("private/get_positions", {}, counter(replies, failures), recorder());
+    scheduler.submit("public/subscribe", {{"channels", {"a"}}}, counter(replies, failures), recorder());
+    scheduler.submit("public/subscribe", {{"channels", {"a"}}}, counter(replies, failures), recorder());
+    EXPECT_EQ(scheduler.queued(), 3u);
+    
+    scheduler.dispatch(now_);
+    EXPECT_EQ(sent_.size(), 3u);
+    EXPECT_EQ(replies, 4);
+}
+
+// Test the queue limit, server rejections and stopping
+TEST_F(RequestSchedulerTest, Limits) {
+    config_.max_queued = 2;
+    RequestScheduler scheduler(config_);
+    int replies = 0, failures = 0;
+    
+    EXPECT_TRUE(scheduler.submit("private/buy", {}, counter(replies, failures), recorder()));
+    EXPECT_TRUE(scheduler.submit("private/buy", {}, counter(replies, failures), recorder()));
+    EXPECT_FALSE(scheduler.submit("private/buy", {}, counter(replies, failures), recorder()));
+    EXPECT_EQ(failures, 1);
+    
+    scheduler.dispatch(now_);
+    EXPECT_DOUBLE_EQ(scheduler.available_credits(RequestLane::ORDER_ENTRY), 0.0);
+    EXPECT_DOUBLE_EQ(scheduler.available_credits(RequestLane::QUERY), 3.0);
+    
+    scheduler.on_rate_limited("public/get_time");
+    EXPECT_DOUBLE_EQ(scheduler.available_credits(RequestLane::QUERY), 0.0);
+    
+    scheduler.submit("public/get_time", {}, counter(replies, failures), recorder());
+    scheduler.dispatch(now_);
+    EXPECT_EQ(scheduler.queued(), 1u);
+    
+    scheduler.stop();
+    EXPECT_EQ(scheduler.queued(), 0u);
+    EXPECT_EQ(failures, 2);
+    EXPECT_EQ(replies, 2);
+}
+
+// Test the scheduler thread
+TEST_F(RequestSchedulerTest, Thread) {
+    RequestScheduler scheduler(config_);
+    scheduler.start();
+    
+    std::promise<ApiResponse> reply;
+    scheduler.submit("public/get_time", {}, [&reply](const ApiResponse& response) {
+        reply.set_value(response);
+    }, [](const std::string& method, const deribit::json&, RequestScheduler::ResponseCallback callback) {
+        callback(ApiResponse{true, method, ""});
+    });
+    
+    auto future = reply.get_future();
+    ASSERT_EQ(future.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_TRUE(future.get().success);
+    scheduler.stop();
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ring_buffer.h"
+
+class RingBufferTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Create a small queue so tests can fill it
+        queue_ = std::make_unique<deribit::MpscRingBuffer<std::string>>(4);
+    }
+    
+    bool push(const std::string& value) {
+        return queue_->try_push([&value](std::string& slot) {
+            slot = value;
+        });
+    }
+    
+    std::unique_ptr<deribit::MpscRingBuffer<std::string>> queue_;
+};
+
+// Test values come out in order
+TEST_F(RingBufferTest, PushPop) {
+    EXPECT_EQ(queue_->capacity(), 4u);
+    EXPECT_TRUE(queue_->empty());
+    
+    EXPECT_TRUE(push("a"));
+    EXPECT_TRUE(push("b"));
+    EXPECT_EQ(queue_->size(), 2u);
+    EXPECT_FALSE(queue_->empty());
+    
+    std::string value;
+    ASSERT_TRUE(queue_->try_pop(value));
+    EXPECT_EQ(value, "a");
+    ASSERT_TRUE(queue_->try_pop(value));
+    EXPECT_EQ(value, "b");
+    EXPECT_FALSE(queue_->try_pop(value));
+    EXPECT_TRUE(queue_->empty());
+}
+
+// Test a full queue rejects pushes until a slot is released
+TEST_F(RingBufferTest, Full) {
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(push(std::to_string(i)));
+    }
+    EXPECT_FALSE(push("overflow"));
+    
+    std::string value;
+    ASSERT_TRUE(queue_->try_pop(value));
+    EXPECT_EQ(value, "0");
+    EXPECT_TRUE(push("4"));
+    
+    // Wrap around keeps the order
+    for (int i = 1; i <= 4; ++i) {
+        ASSERT_TRUE(queue_->try_pop(value));
+        EXPECT_EQ(value, std::to_string(i));
+    }
+}
+
+// Test several producers feeding one consumer
+TEST_F(RingBufferTest, MultipleProducers) {
+    deribit::MpscRingBuffer<uint64_t> queue(1024);
+    deribit::QueueWaiter waiter(deribit::WaitPolicy::HYBRID, 100);
+    
+    const int producers = 4;
+    const uint64_t per_producer = 20000;
+    std::atomic<int> finished{0};
+    
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint64_t i = 0; i < per_producer; ++i) {
+                uint64_t value = (static_cast<uint64_t>(p) << 32) | i;
+                while (!queue.try_push([value](uint64_t& slot) { slot = value; })) {
+                    std::this_thread::yield();
+                }
+                waiter.notify();
+            }
+            finished++;
+        });
+    }
+    
+    // Each producer's values must arrive in order
+    std::vector<uint64_t> next(producers, 0);
+    uint64_t received = 0;
+    
+    while (received < producers * per_producer) {
+        uint64_t value;
+        if (!queue.try_pop(value)) {
+            waiter.wait([&queue]() { return !queue.empty(); });
+            continue;
+        }
+        
+        size_t producer = static_cast<size_t>(value >> 32);
+        ASSERT_LT(producer, next.size());
+        EXPECT_EQ(value & 0xffffffff, next[producer]);
+        next[producer]++;
+        received++;
+    }
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    EXPECT_EQ(finished.load(), producers);
+    EXPECT_TRUE(queue.empty());
+}
+
+// Test a blocked consumer wakes up on notify
+TEST_F(RingBufferTest, BlockingWait) {
+    deribit::QueueWaiter waiter(deribit::WaitPolicy::BLOCKING);
+    EXPECT_EQ(waiter.policy(), deribit::WaitPolicy::BLOCKING);
+    
+    std::thread producer([this, &waiter]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        push("wake");
+        waiter.notify();
+    });
+    
+    auto start = std::chrono::steady_clock::now();
+    while (queue_->empty()) {
+        waiter.wait([this]() { return !queue_->empty(); });
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    
+    producer.join();
+    
+    std::string value;
+    ASSERT_TRUE(queue_->try_pop(value));
+    EXPECT_EQ(value, "wake");
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+}
\ No newline at end of file
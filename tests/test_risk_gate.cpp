@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "risk_gate.h"
+
+using deribit::OrderDirection;
+using deribit::RiskCheck;
+
+class RiskGateTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        registry_ = std::make_shared<deribit::InstrumentRegistry>();
+        registry_->upsert({
+            {"instrument_name", "BTC-PERPETUAL"},
+            {"base_currency", "BTC"},
+            {"kind", "future"},
+            {"tick_size", 0.5},
+            {"min_trade_amount", 10.0},
+            {"contract_size", 10.0},
+            {"is_active", true}
+        });
+        registry_->upsert({
+            {"instrument_name", "ETH-PERPETUAL"},
+            {"base_currency", "ETH"},
+            {"kind", "future"},
+            {"tick_size", 0.05},
+            {"min_trade_amount", 1.0},
+            {"contract_size", 1.0},
+            {"is_active", true}
+        });
+        
+        gate_ = std::make_shared<deribit::RiskGate>(registry_);
+    }
+    
+    std::shared_ptr<deribit::InstrumentRegistry> registry_;
+    std::shared_ptr<deribit::RiskGate> gate_;
+};
+
+// Test that an unconfigured gate accepts everything
+TEST_F(RiskGateTest, NoLimits) {
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 1000000.0, 50000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check("UNKNOWN", OrderDirection::SELL, 1.0, 0.0), RiskCheck::ACCEPTED);
+}
+
+// Test the order amount and notional checks
+TEST_F(RiskGateTest, AmountAndNotional) {
+    deribit::RiskLimits limits;
+    limits.max_order_amount = 100.0;
+    limits.max_notional = 1000000.0;
+    ASSERT_TRUE(gate_->set_limits("BTC-PERPETUAL", limits));
+    
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 10.0, 50000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 200.0, 50000.0), RiskCheck::ORDER_AMOUNT);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 30.0, 50000.0), RiskCheck::NOTIONAL);
+    
+    // Market orders are valued at the far side of the book, and refused without one
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 1.0, 0.0), RiskCheck::NO_REFERENCE);
+    gate_->update_market("BTC-PERPETUAL", 49990.0, 50010.0);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 30.0, 0.0), RiskCheck::NOTIONAL);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 10.0, 0.0), RiskCheck::ACCEPTED);
+    
+    // Only the side a market order would trade against counts
+    gate_->update_market("BTC-PERPETUAL", 0.0, 50010.0);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::SELL, 1.0, 0.0), RiskCheck::NO_REFERENCE);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 1.0, 0.0), RiskCheck::ACCEPTED);
+    
+    // Unknown instruments have no market at all
+    deribit::RiskLimits defaults;
+    defaults.max_notional = 1000000.0;
+    gate_->set_default_limits(defaults);
+    EXPECT_EQ(gate_->check("UNKNOWN", OrderDirection::BUY, 1.0, 0.0), RiskCheck::NO_REFERENCE);
+    EXPECT_EQ(gate_->check("UNKNOWN", OrderDirection::BUY, 1.0, 100.0), RiskCheck::ACCEPTED);
+    
+    auto counters = deribit::PerformanceMonitor::instance().get_all_counters();
+    EXPECT_TRUE(counters.count("risk_rejections.no_reference") > 0);
+}
+
+// Test the position check, which lets reducing orders through
+TEST_F(RiskGateTest, Position) {
+    deribit::RiskLimits limits;
+    limits.max_position = 100.0;
+    gate_->set_limits("BTC-PERPETUAL", limits);
+    gate_->update_position("BTC-PERPETUAL", 80.0);
+    
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 20.0, 50000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 30.0, 50000.0), RiskCheck::POSITION);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::SELL, 170.0, 50000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::SELL, 190.0, 50000.0), RiskCheck::POSITION);
+    
+    gate_->update_position("BTC-PERPETUAL", 150.0);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::SELL, 10.0, 50000.0), RiskCheck::ACCEPTED);
+}
+
+// Test the price band around the live mid
+TEST_F(RiskGateTest, PriceBand) {
+    deribit::RiskLimits limits;
+    limits.price_band = 0.05;
+    gate_->set_limits("BTC-PERPETUAL", limits);
+    
+    // Without a market the band is not checked
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 10.0, 10000.0), RiskCheck::ACCEPTED);
+    
+    gate_->update_market("BTC-PERPETUAL", 49990.0, 50010.0);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 10.0, 51000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 10.0, 53000.0), RiskCheck::PRICE_BAND);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::SELL, 10.0, 47000.0), RiskCheck::PRICE_BAND);
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::SELL, 10.0, 0.0), RiskCheck::ACCEPTED);
+    
+    // A lost feed clears the market, which skips the band again
+    gate_->clear_market();
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 10.0, 53000.0), RiskCheck::ACCEPTED);
+}
+
+// Test that a top of book past the maximum age is ignored until it is updated
+TEST_F(RiskGateTest, StaleMarket) {
+    deribit::RiskLimits limits;
+    limits.price_band = 0.05;
+    limits.max_notional = 1000000.0;
+    deribit::InstrumentId id = gate_->instrument_id("BTC-PERPETUAL");
+    gate_->set_limits(id, limits);
+    gate_->set_max_market_age(std::chrono::milliseconds(20));
+    
+    gate_->update_market(id, 49990.0, 50010.0);
+    EXPECT_EQ(gate_->check(id, OrderDirection::BUY, 10.0, 53000.0), RiskCheck::PRICE_BAND);
+    EXPECT_EQ(gate_->check(id, OrderDirection::BUY, 100.0, 0.0), RiskCheck::NOTIONAL);
+    
+    // Neither the band nor the market order value use the old book
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(gate_->check(id, OrderDirection::BUY, 10.0, 53000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check(id, OrderDirection::BUY, 1.0, 0.0), RiskCheck::NO_REFERENCE);
+    
+    gate_->update_market(id, 49990.0, 50010.0);
+    EXPECT_EQ(gate_->check(id, OrderDirection::BUY, 10.0, 53000.0), RiskCheck::PRICE_BAND);
+    
+    // An age of zero never ages the book out
+    gate_->set_max_market_age(std::chrono::milliseconds(0));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(gate_->check(id, OrderDirection::BUY, 10.0, 53000.0), RiskCheck::PRICE_BAND);
+}
+
+// Test that instruments without their own limits use the defaults
+TEST_F(RiskGateTest, DefaultLimits) {
+    deribit::RiskLimits defaults;
+    defaults.max_order_amount = 5.0;
+    gate_->set_default_limits(defaults);
+    
+    deribit::RiskLimits limits;
+    limits.max_order_amount = 50.0;
+    gate_->set_limits("BTC-PERPETUAL", limits);
+    
+    EXPECT_EQ(gate_->check("BTC-PERPETUAL", OrderDirection::BUY, 20.0, 50000.0), RiskCheck::ACCEPTED);
+    EXPECT_EQ(gate_->check("ETH-PERPETUAL", OrderDirection::BUY, 20.0, 3000.0), RiskCheck::ORDER_AMOUNT);
+    EXPECT_EQ(gate_->check("UNKNOWN", OrderDirection::BUY, 20.0, 1.0), RiskCheck::ORDER_AMOUNT);
+    EXPECT_FALSE(gate_->set_limits("UNKNOWN", limits));
+}
+
+// Test that only accepted orders count towards the order rate
+TEST_F(RiskGateTest, OrderRate) {
+    deribit::RiskLimits defaults;
+    defaults.max_order_amount = 100.0;
+    gate_->set_default_limits(defaults);
+    gate_->set_max_orders_per_second(3);
+    
+    EXPECT_EQ(gate_->check("ETH-PERPETUAL", OrderDirection::BUY, 500.0, 3000.0), RiskCheck::ORDER_AMOUNT);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(gate_->check("ETH-PERPETUAL", OrderDirection::BUY, 1.0, 3000.0), RiskCheck::ACCEPTED);
+    }
+    EXPECT_EQ(gate_->check("ETH-PERPETUAL", OrderDirection::BUY, 1.0, 3000.0), RiskCheck::ORDER_RATE);
+    
+    gate_->set_max_orders_per_second(0);
+    EXPECT_EQ(gate_->check("ETH-PERPETUAL", OrderDirection::BUY, 1.0, 3000.0), RiskCheck::ACCEPTED);
+}
\ No newline at end of file
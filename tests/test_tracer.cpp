@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "tracer.h"
+
+using deribit::PerformanceMonitor;
+using deribit::TraceStage;
+using deribit::Tracer;
+
+class TracerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Tracer::instance().set_enabled(true);
+        Tracer::instance().set_record_interval(1);
+        PerformanceMonitor::instance().reset_all();
+    }
+    
+    void TearDown() override {
+        Tracer::instance().set_record_interval(16);
+    }
+    
+    uint64_t count(const std::string& name) {
+        auto metrics = PerformanceMonitor::instance().get_metrics(name);
+        return metrics ? metrics->count : 0;
+    }
+};
+
+// Test that stages stamped inside a trace reach its record and histograms
+TEST_F(TracerTest, StageBreakdown) {
+    int64_t received = Tracer::steady_now_ns() - 1000;
+    int64_t received_wall = Tracer::wall_now_ns();
+    
+    {
+        deribit::ScopedTrace trace(received, received_wall);
+        ASSERT_TRUE(Tracer::current() != nullptr);
+        
+        Tracer::set_exchange_timestamp(received_wall / 1000000 - 5);
+        Tracer::mark(TraceStage::DECODE);
+        Tracer::mark(TraceStage::BOOK_APPLIED);
+        Tracer::mark(TraceStage::ORDER_SENT);
+        
+        // Only the first stamp of a stage counts
+        int64_t first = Tracer::current()->at(TraceStage::ORDER_SENT);
+        Tracer::mark(TraceStage::ORDER_SENT);
+        EXPECT_EQ(Tracer::current()->at(TraceStage::ORDER_SENT), first);
+    }
+    EXPECT_TRUE(Tracer::current() == nullptr);
+    
+    auto records = Tracer::instance().recent_records();
+    ASSERT_FALSE(records.empty());
+    const deribit::TraceRecord& record = records.back();
+    
+    EXPECT_EQ(record.at(TraceStage::RECEIVE), received);
+    EXPECT_GE(record.since_receive(TraceStage::DEQUEUE), 1000);
+    EXPECT_GE(record.at(TraceStage::DECODE), record.at(TraceStage::DEQUEUE));
+    EXPECT_EQ(record.at(TraceStage::PUBLISHED), 0);
+    EXPECT_EQ(record.since_receive(TraceStage::PUBLISHED), -1);
+    EXPECT_GE(record.at(TraceStage::COMPLETE), record.at(TraceStage::ORDER_SENT));
+    
+    EXPECT_EQ(count("trace.dequeue"), 1u);
+    EXPECT_EQ(count("trace.book_applied"), 1u);
+    EXPECT_EQ(count("trace.published"), 0u);
+    EXPECT_EQ(count("trace.total"), 1u);
+    EXPECT_EQ(count("trace.tick_to_trade"), 1u);
+    EXPECT_EQ(count("trace.network"), 1u);
+    
+    auto network = PerformanceMonitor::instance().get_metrics("trace.network");
+    EXPECT_GE(network->min_latency.count(), 4000000);
+}
+
+// Test that marks outside a trace, on other threads or while disabled are ignored
+TEST_F(TracerTest, NoOpenTrace) {
+    Tracer::mark(TraceStage::DECODE);
+    EXPECT_TRUE(Tracer::current() == nullptr);
+    
+    {
+        deribit::ScopedTrace trace(Tracer::steady_now_ns(), Tracer::wall_now_ns());
+        std::thread other([]() {
+            EXPECT_TRUE(Tracer::current() == nullptr);
+            Tracer::mark(TraceStage::PUBLISHED);
+        });
+        other.join();
+        EXPECT_EQ(Tracer::current()->at(TraceStage::PUBLISHED), 0);
+    }
+    
+    Tracer::instance().set_enabled(false);
+    {
+        deribit::ScopedTrace trace(Tracer::steady_now_ns(), Tracer::wall_now_ns());
+        EXPECT_TRUE(Tracer::current() == nullptr);
+    }
+    Tracer::instance().set_enabled(true);
+    
+    EXPECT_EQ(count("trace.total"), 1u);
+    EXPECT_EQ(count("trace.network"), 0u);
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "websocket_compression.h"
+
+class WebSocketCompressionTest : public ::testing::Test {};
+
+// Test out-of-range settings are clamped
+TEST_F(WebSocketCompressionTest, ConfigClamped) {
+    deribit::CompressionConfig config;
+    config.enabled = true;
+    config.level = 12;
+    config.memory_level = 0;
+    config.max_window_bits = 8;
+    
+    deribit::CompressionConfig applied = deribit::clamp_compression_config(config);
+    EXPECT_TRUE(applied.enabled);
+    EXPECT_EQ(applied.level, 9);
+    EXPECT_EQ(applied.memory_level, 1);
+    EXPECT_EQ(applied.max_window_bits, 9);
+}
+
+#ifdef DERIBIT_WS_PERMESSAGE_DEFLATE
+
+using Deflate = deribit::PerMessageDeflate<deribit::DeflateServerConfig>;
+
+// Test offers are declined while compression is disabled
+TEST_F(WebSocketCompressionTest, DeclinedWhenDisabled) {
+    Deflate deflate;
+    
+    EXPECT_TRUE(deflate.negotiate(websocketpp::http::attribute_list()).first);
+    EXPECT_FALSE(deflate.is_enabled());
+}
+
+// Test extensions built by websocketpp take the settings in scope
+TEST_F(WebSocketCompressionTest, SettingsScope) {
+    deribit::CompressionConfig config;
+    config.enabled = true;
+    
+    {
+        deribit::DeflateSettingsScope scope(&config);
+        Deflate deflate;
+        EXPECT_FALSE(deflate.negotiate(websocketpp::http::attribute_list()).first);
+        EXPECT_TRUE(deflate.is_enabled());
+    }
+    
+    EXPECT_EQ(deribit::DeflateSettingsScope::current(), nullptr);
+    Deflate deflate;
+    EXPECT_TRUE(deflate.negotiate(websocketpp::http::attribute_list()).first);
+}
+
+// Test the response reflects the configured window and context takeover
+TEST_F(WebSocketCompressionTest, Negotiate) {
+    deribit::CompressionConfig config;
+    config.enabled = true;
+    config.context_takeover = false;
+    config.max_window_bits = 12;
+    
+    Deflate deflate(config);
+    websocketpp::http::attribute_list offer;
+    offer["client_max_window_bits"] = "";
+    
+    auto result = deflate.negotiate(offer);
+    ASSERT_FALSE(result.first);
+    EXPECT_EQ(result.second, "permessage-deflate; server_no_context_takeover; server_max_window_bits=12");
+    EXPECT_TRUE(deflate.is_enabled());
+    
+    // Unknown parameters decline the offer
+    Deflate other(config);
+    offer["unknown"] = "1";
+    EXPECT_TRUE(other.negotiate(offer).first);
+    EXPECT_FALSE(other.is_enabled());
+}
+
+// Test messages compressed without context takeover inflate on their own
+TEST_F(WebSocketCompressionTest, CompressRoundTrip) {
+    deribit::CompressionConfig config;
+    config.enabled = true;
+    config.level = 6;
+    config.context_takeover = false;
+    
+    Deflate deflate(config);
+    ASSERT_FALSE(deflate.negotiate(websocketpp::http::attribute_list()).first);
+    ASSERT_FALSE(deflate.init(true));
+    
+    std::string message = "{\"type\":\"orderbook\",\"bids\":[" + std::string(500, '1') + "]}";
+    
+    for (int i = 0; i < 3; ++i) {
+        std::string compressed;
+        ASSERT_FALSE(deflate.compress(message, compressed));
+        EXPECT_LT(compressed.size(), message.size());
+        
+        // Every message ends in a sync flush
+        ASSERT_GE(compressed.size(), 4u);
+        EXPECT_EQ(compressed.substr(compressed.size() - 4), std::string("\x00\x00\xff\xff", 4));
+        
+        Deflate inflater(config);
+        ASSERT_FALSE(inflater.negotiate(websocketpp::http::attribute_list()).first);
+        ASSERT_FALSE(inflater.init(true));
+        
+        std::string decompressed;
+        ASSERT_FALSE(inflater.decompress(reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size(),
+                                         decompressed));
+        EXPECT_EQ(decompressed, message);
+    }
+}
+
+#endif // DERIBIT_WS_PERMESSAGE_DEFLATE
\ No newline at end of file
@@ -3,23 +3,185 @@
 #include <string>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 #include <websocketpp/config/asio_client.hpp>
 #include <websocketpp/client.hpp>
 #include "deribit_api_client.h"
 #include "order_manager.h"
 #include "websocket_server.h"
+#include "binary_book_codec.h"
+#include "market_data_codec.h"
 
 // Mock API credentials for testing
 const std::string TEST_API_KEY = "test_api_key";
 const std::string TEST_API_SECRET = "test_api_secret";
-const uint16_t TEST_PORT = 9001;
+
+// How long a test waits for the frames it expects
+const std::chrono::seconds TEST_TIMEOUT(5);
 
 // WebSocket client for testing
 using WebSocketClient = websocketpp::client<websocketpp::config::asio_client>;
 
+// A port nothing listens on, so test runs do not collide
+uint16_t free_port() {
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 0));
+    return acceptor.local_endpoint().port();
+}
+
+// Poll a condition the server updates, e.g. a counter
+bool wait_until(const std::function<bool()>& condition) {
+    auto deadline = std::chrono::steady_clock::now() + TEST_TIMEOUT;
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+// Loopback client keeping every frame it receives
+class TestClient {
+public:
+    struct Frame {
+        websocketpp::frame::opcode::value opcode;
+        std::string payload;
+    };
+    
+    using FramePredicate = std::function<bool(const std::vector<Frame>&)>;
+    
+    explicit TestClient(uint16_t port) {
+        client_.clear_access_channels(websocketpp::log::alevel::all);
+        client_.set_error_channels(websocketpp::log::elevel::none);
+        client_.init_asio();
+        
+        client_.set_open_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            open_ = true;
+            changed_.notify_all();
+        });
+        client_.set_close_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            changed_.notify_all();
+        });
+        client_.set_fail_handler([this](websocketpp::connection_hdl) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            changed_.notify_all();
+        });
+        client_.set_message_handler([this](websocketpp::connection_hdl, WebSocketClient::message_ptr msg) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            frames_.push_back(Frame{msg->get_opcode(), msg->get_payload()});
+            changed_.notify_all();
+        });
+        
+        websocketpp::lib::error_code ec;
+        connection_ = client_.get_connection("ws://localhost:" + std::to_string(port), ec);
+        if (!ec && connection_) {
+            client_.connect(connection_);
+        }
+        
+        thread_ = std::thread([this]() {
+            client_.run();
+        });
+    }
+    
+    ~TestClient() {
+        close();
+        client_.stop();
+        
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+    
+    bool wait_open() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, TEST_TIMEOUT, [this]() { return open_ || closed_; }) && open_;
+    }
+    
+    bool wait_closed() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, TEST_TIMEOUT, [this]() { return closed_; });
+    }
+    
+    void send(const std::string& message) {
+        websocketpp::lib::error_code ec;
+        if (connection_) {
+            client_.send(connection_->get_handle(), message, websocketpp::frame::opcode::text, ec);
+        }
+    }
+    
+    void subscribe(const std::string& channel, const std::string& encoding = "json") {
+        send("{\"type\":\"subscribe\",\"channel\":\"" + channel + "\",\"encoding\":\"" + encoding + "\"}");
+    }
+    
+    void pause_reading() {
+        websocketpp::lib::error_code ec;
+        if (connection_) {
+            client_.pause_reading(connection_->get_handle(), ec);
+        }
+    }
+    
+    void close() {
+        websocketpp::lib::error_code ec;
+        if (connection_) {
+            client_.close(connection_->get_handle(), websocketpp::close::status::normal, "Test complete", ec);
+        }
+    }
+    
+    // Wait until the frames received so far satisfy a predicate
+    bool wait_for(const FramePredicate& predicate) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, TEST_TIMEOUT, [this, &predicate]() { return predicate(frames_); });
+    }
+    
+    // Wait for at least count text frames containing text
+    bool wait_for_text(const std::string& text, size_t count = 1) {
+        return wait_for([&text, count](const std::vector<Frame>& frames) {
+            return count_text(frames, text) >= count;
+        });
+    }
+    
+    size_t count_text(const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_text(frames_, text);
+    }
+    
+    std::vector<Frame> frames() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return frames_;
+    }
+    
+    static size_t count_text(const std::vector<Frame>& frames, const std::string& text) {
+        return std::count_if(frames.begin(), frames.end(), [&text](const Frame& frame) {
+            return frame.opcode == websocketpp::frame::opcode::text && frame.payload.find(text) != std::string::npos;
+        });
+    }
+    
+private:
+    WebSocketClient client_;
+    WebSocketClient::connection_ptr connection_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<Frame> frames_;
+    bool open_{false};
+    bool closed_{false};
+};
+
 class WebSocketServerTest : public ::testing::Test {
 protected:
     void SetUp() override {
+        port_ = free_port();
+        
         // Create API client with test credentials
         api_client_ = std::make_shared<deribit::ApiClient>(TEST_API_KEY, TEST_API_SECRET, true);
         
@@ -30,7 +192,7 @@ protected:
         order_manager_ = std::make_shared<deribit::OrderManager>(api_client_);
         
         // Create WebSocket server
-        websocket_server_ = std::make_shared<deribit::WebSocketServer>(api_client_, order_manager_, TEST_PORT);
+        websocket_server_ = std::make_shared<deribit::WebSocketServer>(api_client_, order_manager_, port_);
         
         // Initialize WebSocket server
         websocket_server_->initialize();
@@ -48,6 +210,19 @@ protected:
         api_client_.reset();
     }
     
+    // Publish a book so new subscribers get it instead of one fetched over REST
+    void publish_book(const std::string& instrument_name,
+                      const std::vector<std::pair<double, double>>& bids,
+                      const std::vector<std::pair<double, double>>& asks) {
+        deribit::OrderBook orderbook;
+        orderbook.instrument_name = instrument_name;
+        orderbook.timestamp = "1234567890";
+        orderbook.bids = bids;
+        orderbook.asks = asks;
+        websocket_server_->handle_orderbook_update(instrument_name, orderbook);
+    }
+    
+    uint16_t port_{0};
     std::shared_ptr<deribit::ApiClient> api_client_;
     std::shared_ptr<deribit::OrderManager> order_manager_;
     std::shared_ptr<deribit::WebSocketServer> websocket_server_;
@@ -75,137 +250,482 @@ TEST_F(WebSocketServerTest, StartStop) {
     EXPECT_FALSE(websocket_server_->is_running());
 }
 
-// Test connection count
-TEST_F(WebSocketServerTest, ConnectionCount) {
-    // Skip actual WebSocket connection in unit tests
-    GTEST_SKIP() << "Skipping test that requires actual WebSocket connection";
+// Test configuring the outbound queue limits
+TEST_F(WebSocketServerTest, SendQueueConfig) {
+    deribit::SendQueueConfig config;
+    config.high_water_mark = 8;
+    config.max_queued_messages = 32;
+    websocket_server_->set_send_queue_config(config);
+    
+    EXPECT_EQ(websocket_server_->get_send_queue_config().high_water_mark, 8u);
+    EXPECT_EQ(websocket_server_->get_send_queue_config().max_queued_messages, 32u);
+    
+    // Queue metrics are registered with the performance monitor
+    auto counters = deribit::PerformanceMonitor::instance().get_all_counters();
+    EXPECT_TRUE(counters.count("ws_send_queue_depth") > 0);
+    EXPECT_TRUE(counters.count("ws_messages_conflated") > 0);
+    EXPECT_TRUE(counters.count("ws_slow_consumer_disconnects") > 0);
+}
+
+// Test configuring compression and coalescing
+TEST_F(WebSocketServerTest, TrafficConfig) {
+    deribit::CompressionConfig compression;
+    compression.level = 3;
+    compression.context_takeover = false;
+    websocket_server_->set_compression_config(compression);
+    
+    deribit::CoalescingConfig coalescing;
+    coalescing.window = std::chrono::microseconds(200);
+    coalescing.max_batch_bytes = 4096;
+    websocket_server_->set_coalescing_config(coalescing);
+    
+    EXPECT_EQ(websocket_server_->get_compression_config().level, 3);
+    EXPECT_FALSE(websocket_server_->get_compression_config().context_takeover);
+    EXPECT_EQ(websocket_server_->get_coalescing_config().window.count(), 200);
+    EXPECT_EQ(websocket_server_->get_coalescing_config().max_batch_bytes, 4096u);
+    
+    // No clients, no stats; the traffic counters are registered up front
+    EXPECT_TRUE(websocket_server_->get_connection_stats().empty());
+    auto counters = deribit::PerformanceMonitor::instance().get_all_counters();
+    EXPECT_TRUE(counters.count("ws_frames_sent") > 0);
+    EXPECT_TRUE(counters.count("ws_bytes_sent") > 0);
+    EXPECT_TRUE(counters.count("ws_messages_coalesced") > 0);
+}
+
+// Test that a client which stops reading is conflated and then disconnected
+TEST_F(WebSocketServerTest, SlowConsumer) {
+    // Tiny limits so the test client backs up quickly
+    deribit::SendQueueConfig config;
+    config.socket_buffer_limit = 1024;
+    config.high_water_mark = 4;
+    config.max_queued_messages = 16;
+    websocket_server_->set_send_queue_config(config);
+    ASSERT_TRUE(websocket_server_->start());
+    publish_book("BTC-PERPETUAL", {{10000.0, 1.0}}, {{10100.0, 1.0}});
+    
+    auto conflated = deribit::PerformanceMonitor::instance().get_counter("ws_messages_conflated");
+    auto disconnects = deribit::PerformanceMonitor::instance().get_counter("ws_slow_consumer_disconnects");
+    int64_t conflated_before = conflated->get();
+    int64_t disconnects_before = disconnects->get();
+    
+    // A client that subscribes and then stops reading
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.subscribe("orderbook.BTC-PERPETUAL");
+    client.subscribe("trades.BTC-PERPETUAL");
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"subscribed\"", 2));
+    client.pause_reading();
+    
+    // Orderbook updates replace each other once the queue is past the high-water mark
+    std::string payload(64 * 1024, 'x');
+    for (int i = 0; i < 64; ++i) {
+        websocket_server_->broadcast_to_channel("orderbook.BTC-PERPETUAL", payload);
+    }
+    EXPECT_TRUE(wait_until([&]() { return conflated->get() > conflated_before; }));
+    EXPECT_EQ(disconnects->get(), disconnects_before);
     
-    // Start server
-    websocket_server_->start();
+    // Messages that cannot be merged eventually exceed the queue limit
+    for (int i = 0; i < 64 && disconnects->get() == disconnects_before; ++i) {
+        websocket_server_->broadcast_to_channel("trades.BTC-PERPETUAL", payload);
+    }
+    EXPECT_TRUE(wait_until([&]() { return disconnects->get() > disconnects_before; }));
+    EXPECT_TRUE(wait_until([&]() { return websocket_server_->get_connection_count() == 0; }));
     
-    // Check initial connection count
-    EXPECT_EQ(websocket_server_->get_connection_count(), 0);
+    websocket_server_->stop();
+}
+
+// Test running the server on several threads
+TEST_F(WebSocketServerTest, ThreadPool) {
+    // Recreate the server with a thread pool
+    websocket_server_ = std::make_shared<deribit::WebSocketServer>(api_client_, order_manager_, port_);
+    websocket_server_->set_thread_count(4);
+    ASSERT_TRUE(websocket_server_->initialize());
+    
+    EXPECT_TRUE(websocket_server_->start());
+    EXPECT_TRUE(websocket_server_->is_running());
     
-    // Create WebSocket client
-    WebSocketClient client;
-    client.init_asio();
-    client.set_open_handler([](websocketpp::connection_hdl) {
-        // Connection opened
+    websocket_server_->stop();
+    EXPECT_FALSE(websocket_server_->is_running());
+}
+
+// Test running the server on a shared io_context
+TEST_F(WebSocketServerTest, SharedIoContext) {
+    boost::asio::io_context io_context;
+    auto work = boost::asio::make_work_guard(io_context);
+    std::thread io_thread([&io_context]() {
+        io_context.run();
     });
     
-    // Connect to server
-    websocketpp::lib::error_code ec;
-    WebSocketClient::connection_ptr con = client.get_connection("ws://localhost:" + std::to_string(TEST_PORT), ec);
-    client.connect(con);
+    websocket_server_ = std::make_shared<deribit::WebSocketServer>(api_client_, order_manager_, port_);
+    websocket_server_->set_io_context(io_context);
+    ASSERT_TRUE(websocket_server_->initialize());
     
-    // Run client in a separate thread
-    std::thread client_thread([&client]() {
-        client.run();
-    });
+    EXPECT_TRUE(websocket_server_->start());
+    websocket_server_->stop();
+    EXPECT_FALSE(websocket_server_->is_running());
+    
+    // Stopping the server leaves the shared context running
+    EXPECT_FALSE(io_context.stopped());
+    
+    // Release the server before the io_context it uses
+    websocket_server_ = std::make_shared<deribit::WebSocketServer>(api_client_, order_manager_, port_);
+    
+    work.reset();
+    io_context.stop();
+    io_thread.join();
+}
+
+// Test connection count
+TEST_F(WebSocketServerTest, ConnectionCount) {
+    ASSERT_TRUE(websocket_server_->start());
+    EXPECT_EQ(websocket_server_->get_connection_count(), 0);
     
-    // Wait for connection to establish
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
     
-    // Check connection count
+    // The server greets every new connection
+    EXPECT_TRUE(client.wait_for_text("\"type\":\"welcome\""));
     EXPECT_EQ(websocket_server_->get_connection_count(), 1);
     
-    // Close connection
-    client.close(con->get_handle(), websocketpp::close::status::normal, "Test complete");
+    client.close();
+    ASSERT_TRUE(client.wait_closed());
+    EXPECT_TRUE(wait_until([&]() { return websocket_server_->get_connection_count() == 0; }));
+    
+    websocket_server_->stop();
+}
+
+// Test broadcasting a message
+TEST_F(WebSocketServerTest, Broadcast) {
+    ASSERT_TRUE(websocket_server_->start());
+    
+    TestClient first(port_);
+    TestClient second(port_);
+    ASSERT_TRUE(first.wait_open());
+    ASSERT_TRUE(second.wait_open());
+    ASSERT_TRUE(wait_until([&]() { return websocket_server_->get_connection_count() == 2; }));
     
-    // Wait for connection to close
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Every client gets the message, subscribed or not
+    std::string test_message = "{\"type\":\"test\",\"message\":\"Hello, World!\"}";
+    websocket_server_->broadcast(test_message);
     
-    // Check connection count
-    EXPECT_EQ(websocket_server_->get_connection_count(), 0);
+    for (TestClient* client : {&first, &second}) {
+        EXPECT_TRUE(client->wait_for([&test_message](const std::vector<TestClient::Frame>& frames) {
+            return std::any_of(frames.begin(), frames.end(), [&test_message](const TestClient::Frame& frame) {
+                return frame.payload == test_message;
+            });
+        }));
+    }
     
-    // Stop server
     websocket_server_->stop();
+}
+
+// Test fanning out one framed message to several channel subscribers
+TEST_F(WebSocketServerTest, BroadcastToChannel) {
+    websocket_server_->set_channel_prefixes({"test.", "other."});
+    ASSERT_TRUE(websocket_server_->start());
+    
+    // Three subscribers and one client on another channel
+    std::vector<std::unique_ptr<TestClient>> clients;
+    for (int i = 0; i < 4; ++i) {
+        clients.push_back(std::make_unique<TestClient>(port_));
+        ASSERT_TRUE(clients.back()->wait_open());
+        clients.back()->subscribe(i < 3 ? "test.channel" : "other.channel");
+        ASSERT_TRUE(clients.back()->wait_for_text("\"type\":\"subscribed\""));
+    }
     
-    // Join client thread
-    if (client_thread.joinable()) {
-        client_thread.join();
+    auto fanout = deribit::PerformanceMonitor::instance().get_tracker("fanout_per_subscriber", true);
+    uint64_t fanouts = fanout->get_metrics().count;
+    
+    // A message larger than the 16-bit frame length
+    std::string test_message = "{\"type\":\"test\",\"payload\":\"" + std::string(70000, 'x') + "\"}";
+    websocket_server_->broadcast_to_channel("test.channel", test_message);
+    
+    // Every subscriber gets the same payload and the fan-out is measured once
+    auto received = [&test_message](const std::vector<TestClient::Frame>& frames) {
+        return std::count_if(frames.begin(), frames.end(), [&test_message](const TestClient::Frame& frame) {
+            return frame.payload == test_message;
+        }) == 1;
+    };
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(clients[i]->wait_for(received));
     }
+    EXPECT_EQ(fanout->get_metrics().count, fanouts + 1);
+    
+    // The other channel's client only has the welcome and its confirmation
+    EXPECT_EQ(clients[3]->frames().size(), 2u);
+    
+    websocket_server_->stop();
 }
 
-// Test broadcasting a message
-TEST_F(WebSocketServerTest, Broadcast) {
-    // Skip actual WebSocket connection in unit tests
-    GTEST_SKIP() << "Skipping test that requires actual WebSocket connection";
+// Test handling an orderbook update
+TEST_F(WebSocketServerTest, HandleOrderbookUpdate) {
+    ASSERT_TRUE(websocket_server_->start());
+    publish_book("BTC-PERPETUAL", {{10000.0, 1.0}}, {{10100.0, 1.0}});
     
-    // Start server
-    websocket_server_->start();
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.subscribe("orderbook.BTC-PERPETUAL");
     
-    // Create WebSocket client
-    WebSocketClient client;
-    client.init_asio();
+    // The initial book is the last one published
+    std::string initial;
+    deribit::write_orderbook_message(initial, "BTC-PERPETUAL", "1234567890", {{10000.0, 1.0}}, {{10100.0, 1.0}});
+    ASSERT_TRUE(client.wait_for_text(initial));
     
-    // Message received flag
-    bool message_received = false;
-    std::string received_message;
+    publish_book("BTC-PERPETUAL", {{10000.0, 2.0}, {9999.5, 1.0}}, {{10100.0, 1.0}});
     
-    // Set message handler
-    client.set_message_handler([&message_received, &received_message](websocketpp::connection_hdl, WebSocketClient::message_ptr msg) {
-        received_message = msg->get_payload();
-        message_received = true;
-    });
+    std::string update;
+    deribit::write_orderbook_message(update, "BTC-PERPETUAL", "1234567890",
+                                     {{10000.0, 2.0}, {9999.5, 1.0}}, {{10100.0, 1.0}});
+    EXPECT_TRUE(client.wait_for_text(update));
     
-    // Connect to server
-    websocketpp::lib::error_code ec;
-    WebSocketClient::connection_ptr con = client.get_connection("ws://localhost:" + std::to_string(TEST_PORT), ec);
-    client.connect(con);
+    websocket_server_->stop();
+}
+
+// Test every orderbook update advances the instrument's sequence
+TEST_F(WebSocketServerTest, BookSequence) {
+    deribit::OrderBook orderbook;
+    orderbook.instrument_name = "BTC-PERPETUAL";
+    orderbook.timestamp = "1234567890";
+    orderbook.bids.push_back(std::make_pair(10000.0, 1.0));
+    orderbook.asks.push_back(std::make_pair(10100.0, 1.0));
     
-    // Run client in a separate thread
-    std::thread client_thread([&client]() {
-        client.run();
-    });
+    EXPECT_EQ(websocket_server_->get_book_sequence("BTC-PERPETUAL"), 0u);
     
-    // Wait for connection to establish
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    websocket_server_->handle_orderbook_update("BTC-PERPETUAL", orderbook);
+    websocket_server_->handle_orderbook_update("BTC-PERPETUAL", orderbook);
     
-    // Broadcast a message
-    std::string test_message = "{\"type\":\"test\",\"message\":\"Hello, World!\"}";
-    websocket_server_->broadcast(test_message);
+    EXPECT_EQ(websocket_server_->get_book_sequence("BTC-PERPETUAL"), 2u);
+    EXPECT_EQ(websocket_server_->get_book_sequence("ETH-PERPETUAL"), 0u);
+}
+
+// Test a binary subscriber gets a snapshot and then gap-free deltas
+TEST_F(WebSocketServerTest, BinarySubscription) {
+    ASSERT_TRUE(websocket_server_->start());
+    publish_book("BTC-PERPETUAL", {{10000.0, 1.0}}, {{10100.0, 1.0}});
     
-    // Wait for message to be received
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.subscribe("orderbook.BTC-PERPETUAL", "binary");
+    ASSERT_TRUE(client.wait_for_text("\"encoding\":\"binary\""));
     
-    // Check if message was received
-    EXPECT_TRUE(message_received);
-    EXPECT_EQ(received_message, test_message);
+    deribit::OrderBook orderbook;
+    orderbook.instrument_name = "BTC-PERPETUAL";
+    orderbook.timestamp = "1234567890";
+    for (int i = 0; i < 10; ++i) {
+        orderbook.bids = {{10000.0 - i, 1.0 + i}};
+        orderbook.asks = {{10100.0, 1.0}, {10101.0 + i, 2.0}};
+        websocket_server_->handle_orderbook_update("BTC-PERPETUAL", orderbook);
+    }
     
-    // Close connection
-    client.close(con->get_handle(), websocketpp::close::status::normal, "Test complete");
+    // One snapshot, then a delta per update
+    auto binary_frames = [](const std::vector<TestClient::Frame>& frames) {
+        return std::count_if(frames.begin(), frames.end(), [](const TestClient::Frame& frame) {
+            return frame.opcode == websocketpp::frame::opcode::binary;
+        });
+    };
+    ASSERT_TRUE(client.wait_for([&binary_frames](const std::vector<TestClient::Frame>& frames) {
+        return binary_frames(frames) == 11;
+    }));
+    
+    // Rebuild the book from the binary frames
+    std::vector<std::pair<double, double>> bids;
+    std::vector<std::pair<double, double>> asks;
+    uint64_t sequence = 0;
+    bool snapshot = false;
+    
+    for (const auto& frame : client.frames()) {
+        if (frame.opcode != websocketpp::frame::opcode::binary) {
+            continue;
+        }
+        
+        deribit::BinaryBookMessage message;
+        ASSERT_TRUE(deribit::read_binary_book(frame.payload, message));
+        
+        if (message.type == deribit::BinaryMessageType::BOOK_SNAPSHOT) {
+            EXPECT_FALSE(snapshot);
+            EXPECT_EQ(message.sequence, 1u);
+            snapshot = true;
+            bids = message.bids;
+            asks = message.asks;
+        } else {
+            ASSERT_TRUE(snapshot);
+            EXPECT_EQ(message.sequence, sequence + 1);
+            deribit::apply_binary_book_delta(bids, asks, message);
+        }
+        sequence = message.sequence;
+    }
+    
+    EXPECT_EQ(sequence, websocket_server_->get_book_sequence("BTC-PERPETUAL"));
+    EXPECT_EQ(bids, orderbook.bids);
+    EXPECT_EQ(asks, orderbook.asks);
     
-    // Stop server
     websocket_server_->stop();
+}
+
+// Test a ticker only changes with the top of book and a throttled depth channel is rate limited
+TEST_F(WebSocketServerTest, DerivedChannels) {
+    ASSERT_TRUE(websocket_server_->start());
+    publish_book("BTC-PERPETUAL", {{10000.0, 1.0}, {9999.0, 1.0}}, {{10100.0, 1.0}});
+    
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.subscribe("ticker.BTC-PERPETUAL");
+    client.subscribe("orderbook.BTC-PERPETUAL.1.100ms");
+    
+    // Each subscription starts with one message cut from the published book
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"ticker\""));
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"orderbook\""));
+    std::string depth_one;
+    deribit::write_orderbook_message(depth_one, "BTC-PERPETUAL", "1234567890", {{10000.0, 1.0}}, {{10100.0, 1.0}});
+    EXPECT_EQ(client.count_text(depth_one), 1u);
+    
+    // Only the second level moves, so the ticker and the depth-1 book stay put
+    for (int i = 0; i < 10; ++i) {
+        publish_book("BTC-PERPETUAL", {{10000.0, 1.0}, {9999.0, 1.0 + i}}, {{10100.0, 1.0}});
+    }
+    
+    // A broadcast after the updates marks when they have all been delivered
+    websocket_server_->broadcast("{\"type\":\"marker\",\"seq\":1}");
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"marker\",\"seq\":1"));
+    EXPECT_EQ(client.count_text("\"type\":\"ticker\""), 1u);
+    EXPECT_EQ(client.count_text("\"type\":\"orderbook\""), 1u);
     
-    // Join client thread
-    if (client_thread.joinable()) {
-        client_thread.join();
+    // The top moves every update, faster than the depth channel's interval
+    for (int i = 1; i <= 10; ++i) {
+        publish_book("BTC-PERPETUAL", {{10000.0 + i, 1.0}}, {{10100.0, 1.0}});
     }
+    
+    EXPECT_TRUE(client.wait_for_text("\"type\":\"ticker\"", 11));
+    
+    // The depth channel sends at most the first change and, after its interval, the last one
+    std::string last;
+    deribit::write_orderbook_message(last, "BTC-PERPETUAL", "1234567890", {{10010.0, 1.0}}, {{10100.0, 1.0}});
+    EXPECT_TRUE(client.wait_for_text(last));
+    EXPECT_LE(client.count_text("\"type\":\"orderbook\""), 3u);
+    
+    websocket_server_->stop();
 }
 
-// Test handling an orderbook update
-TEST_F(WebSocketServerTest, HandleOrderbookUpdate) {
-    // Skip actual WebSocket connection in unit tests
-    GTEST_SKIP() << "Skipping test that requires actual WebSocket connection";
+// Test a pattern subscription follows instruments that appear after it
+TEST_F(WebSocketServerTest, PatternSubscription) {
+    ASSERT_TRUE(websocket_server_->start());
     
-    // Start server
-    websocket_server_->start();
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.subscribe("orderbook.*-PERPETUAL");
+    
+    // Nothing matched yet
+    ASSERT_TRUE(client.wait_for_text("\"matched\":0"));
+    
+    // None of these instruments existed when the client subscribed
+    for (const char* name : {"BTC-PERPETUAL", "ETH-PERPETUAL", "BTC-27JUN25"}) {
+        publish_book(name, {{10000.0, 1.0}}, {});
+    }
+    
+    websocket_server_->broadcast("{\"type\":\"marker\"}");
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"marker\""));
+    
+    std::vector<std::string> instruments;
+    for (const auto& frame : client.frames()) {
+        if (frame.payload.find("\"type\":\"orderbook\"") == std::string::npos) {
+            continue;
+        }
+        
+        for (const char* name : {"BTC-PERPETUAL", "ETH-PERPETUAL", "BTC-27JUN25"}) {
+            if (frame.payload.find(name) != std::string::npos) {
+                instruments.push_back(name);
+            }
+        }
+    }
+    EXPECT_EQ(instruments, (std::vector<std::string>{"BTC-PERPETUAL", "ETH-PERPETUAL"}));
+    
+    // A later subscription to the same pattern starts from the published books
+    TestClient late(port_);
+    ASSERT_TRUE(late.wait_open());
+    late.subscribe("orderbook.*-PERPETUAL");
+    EXPECT_TRUE(late.wait_for_text("\"matched\":2"));
+    EXPECT_TRUE(late.wait_for_text("\"type\":\"orderbook\"", 2));
     
-    // Create orderbook
+    websocket_server_->stop();
+}
+
+// Test updates without subscribers to the derived channels are cheap no-ops
+TEST_F(WebSocketServerTest, DerivedChannelsWithoutSubscribers) {
     deribit::OrderBook orderbook;
     orderbook.instrument_name = "BTC-PERPETUAL";
     orderbook.timestamp = "1234567890";
     orderbook.bids.push_back(std::make_pair(10000.0, 1.0));
-    orderbook.asks.push_back(std::make_pair(10100.0, 1.0));
     
-    // Handle orderbook update
-    websocket_server_->handle_orderbook_update("BTC-PERPETUAL", orderbook);
+    EXPECT_NO_THROW(websocket_server_->handle_orderbook_update("BTC-PERPETUAL", orderbook));
+    
+    // An empty side is published as null
+    orderbook.bids.clear();
+    EXPECT_NO_THROW(websocket_server_->handle_orderbook_update("BTC-PERPETUAL", orderbook));
+    EXPECT_EQ(websocket_server_->get_book_sequence("BTC-PERPETUAL"), 2u);
+}
+
+// Test that an opted-in client gets small updates batched into shared frames
+TEST_F(WebSocketServerTest, Coalescing) {
+    deribit::CoalescingConfig config;
+    config.window = std::chrono::milliseconds(20);
+    websocket_server_->set_coalescing_config(config);
+    websocket_server_->set_channel_prefixes({"test."});
+    ASSERT_TRUE(websocket_server_->start());
+    
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.send("{\"type\":\"configure\",\"coalesce\":true}");
+    client.subscribe("test.channel");
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"subscribed\""));
+    
+    // Published well within one window
+    for (int i = 0; i < 10; ++i) {
+        websocket_server_->broadcast_to_channel("test.channel", "{\"type\":\"update\",\"seq\":" + std::to_string(i) + "}");
+    }
+    
+    // Updates in one frame are separated by newlines
+    auto updates = [](const std::vector<TestClient::Frame>& frames) {
+        size_t count = 0;
+        for (const auto& frame : frames) {
+            if (frame.payload.find("\"update\"") != std::string::npos) {
+                count += std::count(frame.payload.begin(), frame.payload.end(), '\n') + 1;
+            }
+        }
+        return count;
+    };
+    ASSERT_TRUE(client.wait_for([&updates](const std::vector<TestClient::Frame>& frames) {
+        return updates(frames) == 10;
+    }));
+    EXPECT_LT(client.count_text("\"update\""), 10u);
+    
+    auto stats = websocket_server_->get_connection_stats();
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_TRUE(stats[0].coalescing);
+    EXPECT_GT(stats[0].messages_coalesced, 0u);
     
-    // Stop server
     websocket_server_->stop();
+}
+
+// Test depth channels outside the configured depths and intervals, and other
+// channels outside the configured prefixes, are refused
+TEST_F(WebSocketServerTest, DepthWhitelist) {
+    EXPECT_EQ(websocket_server_->get_channel_prefixes(), std::vector<std::string>{"trades."});
+    ASSERT_TRUE(websocket_server_->start());
+    publish_book("BTC-PERPETUAL", {{10000.0, 1.0}}, {{10100.0, 1.0}});
+    
+    TestClient client(port_);
+    ASSERT_TRUE(client.wait_open());
+    client.subscribe("orderbook.BTC-PERPETUAL.3.100ms");
+    client.subscribe("orderbook.BTC-PERPETUAL.5.300ms");
+    client.subscribe("made.up.channel");
+    client.subscribe("trades.");
+    ASSERT_TRUE(client.wait_for_text("\"type\":\"error\"", 4));
+    
+    // A listed combination is accepted
+    client.subscribe("orderbook.BTC-PERPETUAL.5.100ms");
+    client.subscribe("trades.BTC-PERPETUAL");
+    EXPECT_TRUE(client.wait_for_text("\"type\":\"subscribed\"", 2));
+    EXPECT_EQ(client.count_text("\"type\":\"error\""), 4u);
     
-    // Just check that the call doesn't throw
-    SUCCEED();
+    websocket_server_->stop();
 }
\ No newline at end of file